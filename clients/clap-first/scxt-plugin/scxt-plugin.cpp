@@ -109,7 +109,7 @@ bool SCXTPlugin::stateSave(const clap_ostream *ostream) noexcept
     try
     {
         auto sg = scxt::engine::Engine::StreamGuard(engine::Engine::FOR_DAW);
-        auto xml = scxt::json::streamEngineState(*engine);
+        auto xml = scxt::json::streamEngineStateForDAW(*engine, dawStreamCache);
 
         auto c = xml.c_str();
         auto s = xml.length() + 1; // write the null terminator
@@ -45,6 +45,7 @@
 #include "sst/clap_juce_shim/clap_juce_shim.h"
 
 #include "engine/engine.h"
+#include "json/stream.h"
 #include "voice/voice.h"
 
 #include "clap-config.h"
@@ -72,6 +73,9 @@ struct SCXTPlugin : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     std::unique_ptr<scxt::engine::Engine> engine;
     size_t blockPos{0};
 
+    // Only touched from stateSave on the main thread
+    scxt::json::DAWStreamCache dawStreamCache;
+
   protected:
     bool activate(double sampleRate, uint32_t minFrameCount,
                   uint32_t maxFrameCount) noexcept override;
@@ -131,7 +131,7 @@ struct DriveFSListBoxModel : juce::ListBoxModel
     juce::Component *refreshComponentForRow(int rowNumber, bool isRowSelected,
                                             juce::Component *existingComponentToUpdate) override;
 
-    void selectedRowsChanged(int lastRowSelected) override {}
+    void selectedRowsChanged(int lastRowSelected) override;
 };
 
 struct DriveFSArea : juce::Component, HasEditor
@@ -228,6 +228,8 @@ struct DriveFSArea : juce::Component, HasEditor
         std::sort(contents.begin(), contents.end(), [](auto &a, auto &b) {
             return strnatcasecmp(a.path().u8string().c_str(), b.path().u8string().c_str()) < 0;
         });
+        // The old selection means nothing in the new contents, and this stops any preview
+        lbox->deselectAllRows();
         lbox->updateContent();
     }
 
@@ -274,6 +276,26 @@ void DriveListBoxModel::selectedRowsChanged(int lastRowSelected)
     browserPane->devicesPane->driveFSArea->setRootRow(browserPane->roots[lastRowSelected].first);
 }
 
+void DriveFSListBoxModel::selectedRowsChanged(int lastRowSelected)
+{
+    if (!browserPane || !browserPane->devicesPane || !browserPane->devicesPane->driveFSArea)
+        return;
+
+    // Selecting a sample previews it; selecting anything else, or nothing, stops the preview
+    namespace cmsg = scxt::messaging::client;
+    const auto &data = browserPane->devicesPane->driveFSArea->contents;
+    if (lastRowSelected >= 0 && lastRowSelected < data.size() &&
+        browser::Browser::isLoadableSingleSample(data[lastRowSelected].path()))
+    {
+        browserPane->sendToSerialization(
+            cmsg::StartBrowserPreview(data[lastRowSelected].path().u8string()));
+    }
+    else
+    {
+        browserPane->sendToSerialization(cmsg::StopBrowserPreview(true));
+    }
+}
+
 int DriveFSListBoxModel::getNumRows()
 {
     if (!browserPane || !browserPane->devicesPane || !browserPane->devicesPane->driveFSArea)
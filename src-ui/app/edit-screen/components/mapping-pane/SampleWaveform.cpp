@@ -29,6 +29,7 @@
 #include "app/SCXTEditor.h"
 
 #include "VariantDisplay.h"
+#include "sample/waveform_pyramid.h"
 
 namespace scxt::ui::app::edit_screen
 {
@@ -161,63 +162,21 @@ void SampleWaveform::rebuildEnvelopePaths()
     auto endSample = std::clamp(startSample + numSamples + 2 * samplePad, 0, (int)l);
     auto fac = std::max(1.0 * numSamples / r.getWidth(), 1.0);
 
+    auto pyramid = samp->getWaveformPyramid();
+
     for (int ch = 0; ch < usedChannels; ++ch)
     {
         std::vector<std::pair<size_t, float>> topLine, bottomLine;
 
-        auto downSampleForUI = [startSample, endSample, fac, &topLine, &bottomLine](auto *data) {
-            using T = std::remove_pointer_t<decltype(data)>;
-            double c = startSample;
-            int ct = 0;
-            auto seedmx = std::numeric_limits<T>::min();
-            auto seedmn = std::numeric_limits<T>::max();
-
-            if constexpr (std::is_same_v<T, float>)
-            {
-                seedmx = -100.f;
-                seedmn = 100.f;
-            }
-            auto mx = seedmx;
-            auto mn = seedmn;
-
-            T normFactor{1};
-            if constexpr (std::is_same_v<T, int16_t>)
-            {
-                normFactor = std::numeric_limits<T>::max();
-            }
-            for (int s = startSample; s < endSample; ++s)
-            {
-                if (c + fac < s)
-                {
-                    double nmx = mx * 1.0 / normFactor;
-                    double nmn = mn * 1.0 / normFactor;
-
-                    topLine.emplace_back(s, nmx);
-                    bottomLine.emplace_back(s, nmn);
-
-                    c += fac;
-                    ct++;
-                    mx = seedmx;
-                    mn = seedmn;
-                }
-                mx = std::max(data[s], mx);
-                mn = std::min(data[s], mn);
-            }
-        };
-
-        if (samp->bitDepth == sample::Sample::BD_I16)
-        {
-            auto d = samp->GetSamplePtrI16(ch);
-            downSampleForUI(d);
-        }
-        else if (samp->bitDepth == sample::Sample::BD_F32)
-        {
-            auto d = samp->GetSamplePtrF32(ch);
-            downSampleForUI(d);
-        }
-        else
+        // One min/max pair per pixel column, answered from the sample's waveform pyramid
+        // so this is O(pixels) however long the sample is
+        for (double c = startSample; c < endSample; c += fac)
         {
-            jassertfalse;
+            auto s0 = (size_t)c;
+            auto s1 = std::clamp((size_t)std::ceil(c + fac), s0 + 1, (size_t)endSample);
+            auto mm = pyramid->minMaxBetween(*samp, ch, s0, s1);
+            topLine.emplace_back(s1, mm.max);
+            bottomLine.emplace_back(s1, mm.min);
         }
 
         upperFill[ch] = juce::Path();
@@ -86,7 +86,7 @@ struct WorkItemLineItem : juce::Component, HasEditor
 struct Contents : juce::Component, HasEditor
 {
     MissingResolutionScreen *parent{nullptr};
-    std::unique_ptr<sst::jucegui::components::TextPushButton> okButton;
+    std::unique_ptr<sst::jucegui::components::TextPushButton> okButton, findAllButton;
 
     std::unique_ptr<jcmp::Viewport> viewport;
     std::unique_ptr<juce::Component> viewportContents;
@@ -104,6 +104,15 @@ struct Contents : juce::Component, HasEditor
         });
         addAndMakeVisible(*okButton);
 
+        findAllButton = std::make_unique<sst::jucegui::components::TextPushButton>();
+        findAllButton->setLabel("Find All");
+        findAllButton->setOnCallback([w = juce::Component::SafePointer(parent)]() {
+            if (!w)
+                return;
+            w->sendToSerialization(cmsg::AutoResolveMissingSamples(true));
+        });
+        addAndMakeVisible(*findAllButton);
+
         viewport = std::make_unique<jcmp::Viewport>("Parts");
         viewportContents = std::make_unique<juce::Component>();
 
@@ -131,6 +140,7 @@ struct Contents : juce::Component, HasEditor
         auto b = getLocalBounds();
         b = b.withTrimmedTop(b.getHeight() - 22).withTrimmedLeft(b.getWidth() - 100);
         okButton->setBounds(b);
+        findAllButton->setBounds(b.translated(-105, 0));
 
         viewport->setBounds(getLocalBounds().withTrimmedBottom(25));
         int vmargin{2};
@@ -270,21 +270,26 @@ void HeaderRegion::filesDropped(const juce::StringArray &files, int x, int y)
     SCLOG("Got a file drop of " << files[0]);
 }
 
-void HeaderRegion::doSaveMulti()
+void HeaderRegion::doSaveMulti(bool monolith)
 {
     fileChooser = std::make_unique<juce::FileChooser>(
-        "Save Multi", juce::File(editor->browser.patchIODirectory.u8string()), "*.scm");
+        monolith ? "Save Monolith" : "Save Multi",
+        juce::File(editor->browser.patchIODirectory.u8string()), "*.scm");
     fileChooser->launchAsync(
         juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::saveMode |
             juce::FileBrowserComponent::warnAboutOverwriting,
-        [w = juce::Component::SafePointer(this)](const juce::FileChooser &c) {
+        [w = juce::Component::SafePointer(this), monolith](const juce::FileChooser &c) {
             auto result = c.getResults();
             if (result.isEmpty() || result.size() > 1)
             {
                 return;
             }
+            auto path = result[0].getFullPathName().toStdString();
             // send a 'save multi' message
-            w->sendToSerialization(cmsg::SaveMulti(result[0].getFullPathName().toStdString()));
+            if (monolith)
+                w->sendToSerialization(cmsg::SaveMonolith(path));
+            else
+                w->sendToSerialization(cmsg::SaveMulti(path));
         });
 }
 
@@ -349,6 +354,10 @@ void HeaderRegion::showSaveMenu()
         if (w)
             w->doSaveMulti();
     });
+    p.addItem("Save Monolith (Multi With Samples)", [w = juce::Component::SafePointer(this)]() {
+        if (w)
+            w->doSaveMulti(true);
+    });
     p.addItem("Save Part " + std::to_string(editor->selectedPart + 1),
               [w = juce::Component::SafePointer(this)]() {
                   if (w)
@@ -107,7 +107,7 @@ struct HeaderRegion : juce::Component, HasEditor, juce::FileDragAndDropTarget
     void setCPULevel(float);
 
     void showSaveMenu();
-    void doSaveMulti();
+    void doSaveMulti(bool monolith = false);
     void doLoadMulti();
     void doSaveSelectedPart();
     void doLoadIntoSelectedPart();
@@ -51,8 +51,13 @@ Browser::Browser(BrowserDB &db, const infrastructure::DefaultsProvider &dp, cons
     };
     patchIODirectory = create("Patches");
     themeDirectory = create("Themes");
+
+    // Bring the catalogue up to date with anything which changed while we weren't running
+    browserDb.crawlDeviceLocations();
 }
 
+Browser::~Browser() { stopMissingSampleSearch(); }
+
 std::vector<std::pair<fs::path, std::string>> Browser::getRootPathsForDeviceView() const
 {
     // TODO - append local favorites
@@ -97,6 +102,53 @@ bool Browser::isShortCircuitFormatFile(const fs::path &p)
                        [p](auto e) { return extensionMatches(p, e); });
 }
 
+std::vector<CatalogueEntry> Browser::search(const CatalogueQuery &q) const
+{
+    return browserDb.queryCatalogue(q);
+}
+
+std::vector<std::optional<fs::path>>
+Browser::findMissingSamples(const std::vector<MissingSampleQuery> &q) const
+{
+    std::vector<fs::path> roots;
+    for (const auto &[p, name] : getRootPathsForDeviceView())
+        roots.push_back(p);
+    return browser::findMissingSamples(browserDb, q, roots);
+}
+
+bool Browser::findMissingSamplesInBackground(const std::vector<MissingSampleQuery> &q,
+                                             missingSearchProgress_t onProgress,
+                                             missingSearchDone_t onDone)
+{
+    if (missingSearchRunning.exchange(true))
+        return false;
+
+    // the last search has finished but its thread may not have been joined yet
+    if (missingSearchThread.joinable())
+        missingSearchThread.join();
+
+    // The roots come from the database, so read them here rather than on the search thread
+    std::vector<fs::path> roots;
+    for (const auto &[p, name] : getRootPathsForDeviceView())
+        roots.push_back(p);
+
+    missingSearchControl.cancel = false;
+    missingSearchControl.onProgress = std::move(onProgress);
+    missingSearchThread = std::thread([this, q, roots, onDone = std::move(onDone)]() {
+        auto res = browser::findMissingSamples(browserDb, q, roots, &missingSearchControl);
+        onDone(res);
+        missingSearchRunning = false;
+    });
+    return true;
+}
+
+void Browser::stopMissingSampleSearch()
+{
+    missingSearchControl.cancel = true;
+    if (missingSearchThread.joinable())
+        missingSearchThread.join();
+}
+
 void Browser::addRootPathForDeviceView(const fs::path &p)
 {
     browserDb.addDeviceLocation(p);
@@ -30,9 +30,12 @@
 
 #include <vector>
 #include <string>
+#include <thread>
 #include <utility>
 #include <functional>
 #include "filesystem/import.h"
+#include "catalogue.h"
+#include "missing_sample_search.h"
 
 namespace scxt::infrastructure
 {
@@ -60,6 +63,7 @@ struct Browser
 
     Browser(BrowserDB &, const infrastructure::DefaultsProvider &, const fs::path &userDirectory,
             errorReporter_t reportError);
+    ~Browser();
 
     /*
      * Paths for user content
@@ -78,6 +82,33 @@ struct Browser
     std::vector<std::pair<fs::path, std::string>> getRootPathsForDeviceView() const;
     void addRootPathForDeviceView(const fs::path &);
 
+    /*
+     * Search: a page of the catalogue entries matching the query (see CatalogueQuery),
+     * with the same threading rules as the views.
+     */
+    std::vector<CatalogueEntry> search(const CatalogueQuery &) const;
+
+    /*
+     * Look for the files of missing samples (see findMissingSamples) in the database and
+     * then under the device view roots. This can crawl and hash for a while so don't call
+     * it from the UI thread.
+     */
+    std::vector<std::optional<fs::path>>
+    findMissingSamples(const std::vector<MissingSampleQuery> &) const;
+
+    /*
+     * The same search on a background thread, one at a time; this returns false without
+     * starting if one is already running. onProgress and onDone are called on that thread,
+     * so post what they get to wherever it is needed. stopMissingSampleSearch cancels a
+     * running search and waits for it (onDone still gets whatever it had found).
+     */
+    using missingSearchProgress_t = std::function<void(const std::string &)>;
+    using missingSearchDone_t = std::function<void(const std::vector<std::optional<fs::path>> &)>;
+    bool findMissingSamplesInBackground(const std::vector<MissingSampleQuery> &,
+                                        missingSearchProgress_t onProgress,
+                                        missingSearchDone_t onDone);
+    void stopMissingSampleSearch();
+
     static bool isLoadableFile(const fs::path &);
     static bool isLoadableSample(const fs::path &);
     static bool isLoadableSingleSample(const fs::path &);
@@ -96,6 +127,11 @@ struct Browser
     const infrastructure::DefaultsProvider &defaultsProvider;
     BrowserDB &browserDb;
     errorReporter_t errorReporter;
+
+  private:
+    std::thread missingSearchThread;
+    std::atomic<bool> missingSearchRunning{false};
+    MissingSampleSearchControl missingSearchControl;
 };
 } // namespace scxt::browser
 #endif // SHORTCIRCUITXT_BROWSER_H
@@ -26,21 +26,170 @@
  */
 
 #include "browser_db.h"
+#include "browser.h"
 #include "utils.h"
 #include "sqlite3.h"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <vector>
 #include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <deque>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#if !WINDOWS
+#include <sys/stat.h>
+#endif
+
+#if LINUX
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #define TRACE_DB 0
 
 namespace scxt::browser
 {
 
+/*
+ * What we compare to decide a file is unchanged since we last hashed it
+ */
+struct FileStamp
+{
+    bool valid{false};
+    int64_t size{0}, mtime{0}, inode{0};
+
+    explicit FileStamp(const fs::path &p)
+    {
+        std::error_code ec;
+        auto sz = fs::file_size(p, ec);
+        if (ec)
+            return;
+        auto lwt = fs::last_write_time(p, ec);
+        if (ec)
+            return;
+        size = (int64_t)sz;
+        mtime = (int64_t)lwt.time_since_epoch().count();
+#if !WINDOWS
+        struct stat sb;
+        if (stat(p.u8string().c_str(), &sb) == 0)
+            inode = (int64_t)sb.st_ino;
+#endif
+        valid = true;
+    }
+
+    bool operator==(const FileStamp &other) const
+    {
+        return valid && other.valid && size == other.size && mtime == other.mtime &&
+               inode == other.inode;
+    }
+};
+
+#if LINUX
+/*
+ * Watches the directories the crawler has catalogued and tells us (on its own thread)
+ * which of them had something created, deleted, moved or written in them. It is up to
+ * the callback to get them rescanned.
+ */
+struct DirectoryWatcher
+{
+    using onChange_t = std::function<void(const fs::path &)>;
+
+    explicit DirectoryWatcher(onChange_t oc) : onChange(std::move(oc))
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            SCLOG("Unable to start inotify; the browser catalogue will only update on a crawl");
+            return;
+        }
+        thread = std::thread([this]() { run(); });
+    }
+
+    ~DirectoryWatcher()
+    {
+        keepRunning = false;
+        if (thread.joinable())
+            thread.join();
+        if (fd >= 0)
+            close(fd);
+    }
+
+    void watch(const fs::path &dir)
+    {
+        if (fd < 0)
+            return;
+        auto wd = inotify_add_watch(fd, dir.u8string().c_str(),
+                                    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                        IN_CLOSE_WRITE | IN_ONLYDIR);
+        if (wd < 0)
+        {
+            if (!warnedAboutWatchLimit)
+            {
+                SCLOG("Unable to watch " << dir.u8string() << " (" << strerror(errno)
+                                         << "); further changes there need a crawl");
+                warnedAboutWatchLimit = true;
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> g(lock);
+        watched[wd] = dir;
+    }
+
+  private:
+    void run()
+    {
+        alignas(inotify_event) char buf[4096];
+        while (keepRunning)
+        {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 100) <= 0)
+                continue;
+            auto n = read(fd, buf, sizeof(buf));
+            if (n <= 0)
+                continue;
+
+            // a burst of events in one directory is one rescan
+            std::unordered_set<std::string> changed;
+            {
+                std::lock_guard<std::mutex> g(lock);
+                for (auto *p = buf; p < buf + n;)
+                {
+                    auto *ev = (inotify_event *)p;
+                    p += sizeof(inotify_event) + ev->len;
+                    auto w = watched.find(ev->wd);
+                    if (w == watched.end())
+                        continue;
+                    if (ev->mask & IN_IGNORED)
+                        watched.erase(w);
+                    else
+                        changed.insert(w->second.u8string());
+                }
+            }
+            for (const auto &c : changed)
+                onChange(fs::u8path(c));
+        }
+    }
+
+    onChange_t onChange;
+    int fd{-1};
+    std::thread thread;
+    std::atomic<bool> keepRunning{true};
+    std::mutex lock;
+    std::unordered_map<int, fs::path> watched;
+    bool warnedAboutWatchLimit{false};
+};
+#endif
+
 namespace SQL
 {
 struct Exception : public std::runtime_error
@@ -149,6 +298,16 @@ struct Statement
             throw Exception(h);
     }
 
+    void bind(int c, double val)
+    {
+        if (!s)
+            throw Exception(-1, "Statement not initialized in bind");
+
+        auto rc = sqlite3_bind_double(s, c, val);
+        if (rc != SQLITE_OK)
+            throw Exception(h);
+    }
+
     void bindi64(int c, int64_t val)
     {
         if (!s)
@@ -239,7 +398,7 @@ struct TxnGuard
 struct WriterWorker
 {
     static constexpr const char *schema_version =
-        "1003"; // I will rebuild if this is not my version
+        "1009"; // I will rebuild if this is not my version
 
     static constexpr const char *setup_sql = R"SQL(
 DROP TABLE IF EXISTS "DebugJunk";
@@ -253,6 +412,87 @@ CREATE TABLE DebugJunk (
     time varchar(256),
     junk varchar(2048)
 );
+-- The identity table is a cache so we rebuild it with the schema
+DROP TABLE IF EXISTS "SampleIdentity";
+CREATE TABLE SampleIdentity (
+    path varchar(2048),
+    hash_kind integer,
+    size integer,
+    mtime integer,
+    inode integer,
+    hash varchar(64),
+    PRIMARY KEY (path, hash_kind)
+);
+CREATE INDEX SampleIdentityByHash ON SampleIdentity (hash);
+-- As is the catalogue, which the crawler refills
+DROP TABLE IF EXISTS "CatalogueSearch";
+DROP TABLE IF EXISTS "Catalogue";
+CREATE TABLE Catalogue (
+    path varchar(2048) PRIMARY KEY,
+    parent varchar(2048),
+    name varchar(256),
+    kind integer,
+    size integer,
+    mtime integer,
+    frames integer,
+    sample_rate integer,
+    channels integer,
+    bit_depth integer,
+    root_key integer,
+    loop_start integer,
+    loop_end integer,
+    format varchar(16),
+    duration real
+);
+CREATE INDEX CatalogueByParent ON Catalogue (parent, kind, name);
+CREATE INDEX CatalogueByName ON Catalogue (name, path);
+CREATE INDEX CatalogueByFormat ON Catalogue (format);
+CREATE INDEX CatalogueByDuration ON Catalogue (duration);
+CREATE INDEX CatalogueByRootKey ON Catalogue (root_key);
+CREATE INDEX CatalogueBySampleRate ON Catalogue (sample_rate);
+CREATE INDEX CatalogueByChannels ON Catalogue (channels);
+CREATE INDEX CatalogueBySize ON Catalogue (size);
+-- The words of the file names, which the triggers keep in step with the catalogue
+CREATE VIRTUAL TABLE CatalogueSearch USING fts5(
+    name, content='Catalogue', content_rowid='rowid', tokenize='unicode61', prefix='2 3 4 5 6'
+);
+CREATE TRIGGER CatalogueSearchInsert AFTER INSERT ON Catalogue BEGIN
+    INSERT INTO CatalogueSearch (rowid, name) VALUES (new.rowid, new.name);
+END;
+CREATE TRIGGER CatalogueSearchDelete AFTER DELETE ON Catalogue BEGIN
+    INSERT INTO CatalogueSearch (CatalogueSearch, rowid, name)
+        VALUES ('delete', old.rowid, old.name);
+END;
+CREATE TRIGGER CatalogueSearchUpdate AFTER UPDATE OF name ON Catalogue BEGIN
+    INSERT INTO CatalogueSearch (CatalogueSearch, rowid, name)
+        VALUES ('delete', old.rowid, old.name);
+    INSERT INTO CatalogueSearch (rowid, name) VALUES (new.rowid, new.name);
+END;
+-- The summaries the crawler reads from patch files, which go with their catalogue row
+DROP TABLE IF EXISTS "PatchSamples";
+DROP TABLE IF EXISTS "PatchSummary";
+CREATE TABLE PatchSummary (
+    path varchar(2048) PRIMARY KEY,
+    type varchar(16),
+    part_names varchar(2048),
+    zone_count integer,
+    sample_bytes integer
+);
+CREATE INDEX PatchSummaryBySampleBytes ON PatchSummary (sample_bytes);
+CREATE TABLE PatchSamples (
+    path varchar(2048),
+    md5 varchar(64),
+    path_hash integer,
+    address0 integer,
+    address1 integer,
+    address2 integer
+);
+CREATE INDEX PatchSamplesByPath ON PatchSamples (path);
+CREATE INDEX PatchSamplesByMD5 ON PatchSamples (md5);
+CREATE TRIGGER PatchSummaryDelete AFTER DELETE ON Catalogue BEGIN
+    DELETE FROM PatchSummary WHERE path = old.path;
+    DELETE FROM PatchSamples WHERE path = old.path;
+END;
 -- We create these tables only if missing of course since it is user data
 CREATE TABLE IF NOT EXISTS DeviceLocations (
     id integer primary key,
@@ -279,6 +519,26 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         void go(WriterWorker &w) override { w.addDeviceLocation(path); }
     };
 
+    struct EnQSampleIdentity : public EnQAble
+    {
+        fs::path path;
+        int hashKind;
+        std::string hash;
+        EnQSampleIdentity(const fs::path &p, int k, const std::string &h)
+            : path(p), hashKind(k), hash(h)
+        {
+        }
+        void go(WriterWorker &w) override { w.addSampleIdentity(path, hashKind, hash); }
+    };
+
+    struct EnQCrawlDirectory : public EnQAble
+    {
+        fs::path dir;
+        bool recursive;
+        EnQCrawlDirectory(const fs::path &d, bool r) : dir(d), recursive(r) {}
+        void go(WriterWorker &w) override { w.crawlDirectory(*this); }
+    };
+
     void openDb()
     {
 #if TRACE_DB
@@ -304,6 +564,13 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
             dbh = nullptr;
             return;
         }
+
+        // WAL lets readers, ours and other instances', carry on while we write. NORMAL sync
+        // can lose the last commits on a power cut but never corrupts, which is fine for
+        // what is mostly a cache. And if another instance is writing, wait on it a while.
+        sqlite3_busy_timeout(dbh, busyTimeoutMS);
+        sqlite3_exec(dbh, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr,
+                     nullptr, nullptr);
     }
 
     void closeDb()
@@ -312,7 +579,11 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         SCLOG("<<<< Closing r/w DB");
 #endif
         if (dbh)
+        {
+            // Keeps the planner's statistics current enough to pick good catalogue indices
+            sqlite3_exec(dbh, "PRAGMA optimize", nullptr, nullptr, nullptr);
             sqlite3_close(dbh);
+        }
         dbh = nullptr;
     }
 
@@ -410,6 +681,10 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
             return;
         // We know this is called in the lock so can manipulate pathQ properly
         haveOpenedForWriteOnce = true;
+#if LINUX
+        watcher = std::make_unique<DirectoryWatcher>(
+            [this](const fs::path &dir) { enqueueCrawl(dir, false); });
+#endif
         qThread = std::thread([this]() { this->loadQueueFunction(); });
 
         {
@@ -424,6 +699,10 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
 
     ~WriterWorker()
     {
+#if LINUX
+        // Stop the watcher first since it queues onto us
+        watcher.reset();
+#endif
         if (haveOpenedForWriteOnce)
         {
             keepRunning = false;
@@ -435,26 +714,31 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
             dbh = nullptr;
         }
 
-        if (rodbh)
-        {
-            sqlite3_close(rodbh);
-            rodbh = nullptr;
-        }
+        for (auto *c : freeReadConnections)
+            sqlite3_close(c);
+        freeReadConnections.clear();
     }
 
     // FIXME features should be an enum or something
 
     /*
      * Functions for the write thread
+     *
+     * Jobs are coalesced into transactions of up to maxJobsPerTransaction, or as many as
+     * run in maxTransactionTime, so a crawl commits in large batches but another instance
+     * sharing the database never waits long for our write lock. Should it wait out the
+     * whole busy timeout, the jobs are still queued and we just go round again.
      */
+    static constexpr int maxJobsPerTransaction{512};
+    static constexpr auto maxTransactionTime = std::chrono::milliseconds(250);
+    static constexpr int busyTimeoutMS{5000};
+
     std::atomic<bool> waiting{false};
     void loadQueueFunction()
     {
-        static constexpr auto transChunkSize = 10; // How many FXP to load in a single txn
-        int lock_retries{0};
+        int lockRetries{0};
         while (keepRunning)
         {
-            std::vector<EnQAble *> doThis;
             {
                 std::unique_lock<std::mutex> lk(qLock);
 
@@ -466,79 +750,70 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
                     qCV.wait(lk);
                     waiting = false;
                 }
+                if (!keepRunning)
+                    break;
+            }
 
-                if (keepRunning)
-                {
-                    auto b = pathQ.begin();
-                    auto e = (pathQ.size() < transChunkSize) ? pathQ.end()
-                                                             : pathQ.begin() + transChunkSize;
-                    std::copy(b, e, std::back_inserter(doThis));
-                    pathQ.erase(b, e);
-                }
+            if (!dbh)
+                openDb();
+            if (!dbh)
+            {
+                SCLOG("Browser database unavailable; dropping queued writes");
+                std::lock_guard<std::mutex> g(qLock);
+                for (auto *p : pathQ)
+                    delete p;
+                pathQ.clear();
+                queuedCrawls.clear();
+                continue;
             }
-            if (!doThis.empty())
+
+            try
             {
-                if (!dbh)
-                    openDb();
-                if (dbh == nullptr)
-                {
-                }
-                else
-                {
-                    try
-                    {
-                        SQL::TxnGuard tg(dbh);
+                SQL::TxnGuard tg(dbh);
+                lockRetries = 0;
 
-                        for (auto *p : doThis)
-                        {
-                            p->go(*this);
-                            delete p;
-                        }
+                auto start = std::chrono::steady_clock::now();
+                for (int n = 0; n < maxJobsPerTransaction; ++n)
+                {
+                    if (n > 0 && std::chrono::steady_clock::now() - start > maxTransactionTime)
+                        break;
 
-                        tg.end();
+                    EnQAble *p{nullptr};
+                    {
+                        std::lock_guard<std::mutex> g(qLock);
+                        if (!keepRunning || pathQ.empty())
+                            break;
+                        p = pathQ.front();
+                        pathQ.pop_front();
+                        jobsInFlight++;
                     }
-                    catch (SQL::LockedException &le)
+                    try
                     {
-                        std::ostringstream oss;
-                        oss << le.what() << "\n"
-                            << "Patch database is locked for writing. Most likely, another "
-                               "Shortcircuit "
-                               "XT instance has exclusive write access. We will attempt to retry "
-                               "writing up to 10 more times. "
-                               "Please dismiss this error in the meantime!\n\n Attempt: "
-                            << lock_retries;
-                        // storage->reportError(oss.str(), "Patch Database Locked");
-                        SCLOG(oss.str());
-                        // OK so in this case, we reload doThis onto the front of the queue and
-                        // sleep
-                        lock_retries++;
-                        if (lock_retries < 10)
-                        {
-                            {
-                                std::unique_lock<std::mutex> lk(qLock);
-                                std::reverse(doThis.begin(), doThis.end());
-                                for (auto p : doThis)
-                                {
-                                    pathQ.push_front(p);
-                                }
-                            }
-                            std::this_thread::sleep_for(std::chrono::seconds(lock_retries * 3));
-                        }
-                        else
-                        {
-                            /*storage->reportError(
-                                "Database is locked and unwritable after multiple attempts!",
-                                "Patch Database Locked");*/
-                            SCLOG("Database Locked");
-                        }
+                        p->go(*this);
                     }
                     catch (SQL::Exception &e)
                     {
-                        // storage->reportError(e.what(), "Patch DB");
                         SCLOG(e.what());
                     }
+                    delete p;
                 }
+
+                tg.end();
+            }
+            catch (SQL::LockedException &le)
+            {
+                lockRetries++;
+                SCLOG(le.what() << " : browser database busy in another instance. Retry "
+                                << lockRetries);
+                std::this_thread::sleep_for(std::chrono::milliseconds(
+                    100 * std::min(lockRetries, 10)));
+            }
+            catch (SQL::Exception &e)
+            {
+                // storage->reportError(e.what(), "Patch DB");
+                SCLOG(e.what());
             }
+            jobsInFlight = 0;
         }
     }
 
@@ -594,14 +869,265 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         }
     }
 
+    void addSampleIdentity(const fs::path &p, int hashKind, const std::string &hash)
+    {
+        // Stamp the file now rather than when we were queued; if it changed in between
+        // we get a stamp which simply won't match and the file is rehashed next time
+        auto stamp = FileStamp(p);
+        if (!stamp.valid)
+            return;
+
+        try
+        {
+            auto there = SQL::Statement(
+                dbh, "INSERT OR REPLACE INTO SampleIdentity (\"path\", \"hash_kind\", \"size\", "
+                     "\"mtime\", \"inode\", \"hash\") VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
+
+            std::string res = p.u8string();
+            there.bind(1, res);
+            there.bind(2, hashKind);
+            there.bindi64(3, stamp.size);
+            there.bindi64(4, stamp.mtime);
+            there.bindi64(5, stamp.inode);
+            there.bind(6, hash);
+
+            there.step();
+            there.finalize();
+        }
+        catch (const SQL::Exception &e)
+        {
+            SCLOG(e.what());
+        }
+    }
+
+    static constexpr const char *catalogueColumns =
+        "path, kind, size, mtime, frames, sample_rate, channels, bit_depth, root_key, "
+        "loop_start, loop_end";
+
+    /*
+     * Catalogue one directory against what we had for it last time: header parse the
+     * loadable files which are new or whose size or mtime moved, drop whatever has gone,
+     * and queue crawls of the subdirectories (all of them if we are recursive, else just
+     * those which are new or changed). Symlinked directories are skipped so a link back up
+     * the tree can't crawl forever.
+     */
+    void crawlDirectory(EnQCrawlDirectory &job)
+    {
+        bool recursive;
+        {
+            std::lock_guard<std::mutex> g(qLock);
+            queuedCrawls.erase(job.dir.u8string());
+            recursive = job.recursive;
+        }
+
+        try
+        {
+            std::error_code ec;
+            if (!fs::is_directory(job.dir, ec))
+            {
+                removeFromCatalogue(job.dir);
+                return;
+            }
+#if LINUX
+            if (watcher)
+                watcher->watch(job.dir);
+#endif
+
+            std::string parent = job.dir.u8string();
+            std::unordered_map<std::string, std::pair<int64_t, int64_t>> known;
+            {
+                auto q = SQL::Statement(
+                    dbh, "SELECT path, size, mtime FROM Catalogue WHERE parent = ?1");
+                q.bind(1, parent);
+                while (q.step())
+                    known[q.col_str(0)] = {q.col_int64(1), q.col_int64(2)};
+                q.finalize();
+            }
+
+            // An upsert rather than a replace keeps the rowid the search index refers to
+            auto ins = SQL::Statement(
+                dbh, std::string("INSERT INTO Catalogue (parent, name, ") + catalogueColumns +
+                         ", format, duration) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, "
+                         "?11, ?12, ?13, ?14, ?15) ON CONFLICT (path) DO UPDATE SET "
+                         "kind = excluded.kind, size = excluded.size, mtime = excluded.mtime, "
+                         "frames = excluded.frames, sample_rate = excluded.sample_rate, "
+                         "channels = excluded.channels, bit_depth = excluded.bit_depth, "
+                         "root_key = excluded.root_key, loop_start = excluded.loop_start, "
+                         "loop_end = excluded.loop_end, format = excluded.format, "
+                         "duration = excluded.duration");
+
+            for (const auto &de :
+                 fs::directory_iterator(job.dir, fs::directory_options::skip_permission_denied, ec))
+            {
+                std::error_code fec;
+                CatalogueEntry e;
+                e.path = de.path();
+                auto isDir = de.is_directory(fec);
+                if (isDir && de.is_symlink(fec))
+                    continue;
+                if (isDir)
+                    e.kind = CatalogueEntry::DIRECTORY;
+                else if (Browser::isLoadableSingleSample(e.path))
+                    e.kind = CatalogueEntry::SINGLE_SAMPLE;
+                else if (Browser::isLoadableMultiSample(e.path))
+                    e.kind = CatalogueEntry::MULTI_SAMPLE;
+                else if (Browser::isShortCircuitFormatFile(e.path))
+                    e.kind = CatalogueEntry::SHORTCIRCUIT_FORMAT;
+                else
+                    continue;
+
+                if (!isDir)
+                {
+                    e.size = (int64_t)de.file_size(fec);
+                    if (fec)
+                        continue;
+                }
+                auto lwt = de.last_write_time(fec);
+                if (fec)
+                    continue;
+                e.mtime = (int64_t)lwt.time_since_epoch().count();
+
+                std::string ps = e.path.u8string();
+                auto k = known.find(ps);
+                auto isNew = k == known.end();
+                auto changed = isNew || k->second.first != e.size || k->second.second != e.mtime;
+                if (!isNew)
+                    known.erase(k);
+
+                if (isDir && (recursive || changed))
+                    enqueueCrawl(e.path, recursive || isNew);
+                if (!changed)
+                    continue;
+
+                if (e.kind == CatalogueEntry::SINGLE_SAMPLE)
+                    e.readSampleHeader();
+
+                std::string name = e.path.filename().u8string();
+                std::string format = isDir ? "" : e.path.extension().u8string();
+                if (!format.empty())
+                    format = format.substr(1);
+                std::transform(format.begin(), format.end(), format.begin(),
+                               [](auto c) { return std::tolower(c); });
+                ins.bind(1, parent);
+                ins.bind(2, name);
+                ins.bind(3, ps);
+                ins.bind(4, (int)e.kind);
+                ins.bindi64(5, e.size);
+                ins.bindi64(6, e.mtime);
+                ins.bindi64(7, e.frames);
+                ins.bind(8, e.sampleRate);
+                ins.bind(9, e.channels);
+                ins.bind(10, e.bitDepth);
+                ins.bind(11, e.rootKey);
+                ins.bindi64(12, e.loopStart);
+                ins.bindi64(13, e.loopEnd);
+                ins.bind(14, format);
+                ins.bind(15, e.duration());
+                ins.step();
+                ins.reset();
+                ins.clearBindings();
+
+                if (e.kind == CatalogueEntry::SHORTCIRCUIT_FORMAT)
+                    storePatchSummary(e.path);
+            }
+            ins.finalize();
+
+            // whatever we didn't see has gone, along with anything under it
+            for (const auto &[p, stamp] : known)
+                removeFromCatalogue(fs::u8path(p));
+        }
+        catch (const SQL::Exception &e)
+        {
+            SCLOG(e.what());
+        }
+    }
+
+    /*
+     * Read the manifest and summary chunks of a patch file (never the patch itself) into the
+     * patch tables, replacing whatever we had for it. A file we can't read keeps its
+     * catalogue row but has no summary.
+     */
+    void storePatchSummary(const fs::path &p)
+    {
+        std::string ps = p.u8string();
+        for (auto t : {"PatchSummary", "PatchSamples"})
+        {
+            auto del = SQL::Statement(dbh, std::string("DELETE FROM ") + t + " WHERE path = ?1");
+            del.bind(1, ps);
+            del.step();
+            del.finalize();
+        }
+
+        auto summary = patch_io::readPatchSummary(p);
+        if (!summary.has_value())
+            return;
+
+        std::string names;
+        for (const auto &n : summary->partNames)
+            names += (names.empty() ? "" : "\n") + n;
+
+        auto ins = SQL::Statement(dbh, "INSERT INTO PatchSummary (path, type, part_names, "
+                                       "zone_count, sample_bytes) VALUES (?1, ?2, ?3, ?4, ?5)");
+        ins.bind(1, ps);
+        ins.bind(2, summary->type);
+        ins.bind(3, names);
+        ins.bind(4, summary->zoneCount);
+        ins.bindi64(5, summary->sampleBytes);
+        ins.step();
+        ins.finalize();
+
+        auto smp = SQL::Statement(dbh, "INSERT INTO PatchSamples (path, md5, path_hash, address0, "
+                                       "address1, address2) VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
+        for (const auto &id : summary->sampleIDs)
+        {
+            // bind doesn't copy text so the hash has to outlive the step
+            auto md5 = id.getMD5();
+            const auto &ma = id.getMultiAddress();
+            smp.bind(1, ps);
+            smp.bind(2, md5);
+            smp.bindi64(3, (int64_t)id.getPathHash());
+            smp.bind(4, ma[0]);
+            smp.bind(5, ma[1]);
+            smp.bind(6, ma[2]);
+            smp.step();
+            smp.reset();
+            smp.clearBindings();
+        }
+        smp.finalize();
+    }
+
+    void removeFromCatalogue(const fs::path &p)
+    {
+        // Everything under p sorts between "p/" and "p0", '0' being the character after '/'
+        auto sep = (char)fs::path::preferred_separator;
+        std::string ps = p.u8string();
+        std::string from = ps + sep, to = ps + (char)(sep + 1);
+        auto q = SQL::Statement(
+            dbh, "DELETE FROM Catalogue WHERE path = ?1 OR (path > ?2 AND path < ?3)");
+        q.bind(1, ps);
+        q.bind(2, from);
+        q.bind(3, to);
+        q.step();
+        q.finalize();
+    }
+
     // FIXME for now I am coding this with a locked vector but probably a
     // thread safe queue is the way to go
     std::thread qThread;
     std::mutex qLock;
     std::condition_variable qCV;
     std::deque<EnQAble *> pathQ;
+    // Jobs taken off the queue but whose transaction hasn't committed yet
+    std::atomic<int> jobsInFlight{0};
     std::atomic<bool> keepRunning{true};
 
+    // Crawls sitting in pathQ by directory, so a burst of changes in one queues one crawl.
+    // Guarded by qLock.
+    std::unordered_map<std::string, EnQCrawlDirectory *> queuedCrawls;
+#if LINUX
+    std::unique_ptr<DirectoryWatcher> watcher;
+#endif
+
     /*
      * Call this from any thread
      */
@@ -615,36 +1141,104 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         qCV.notify_all();
     }
 
-    sqlite3 *getReadOnlyConn(bool notifyOnError = true)
+    void enqueueCrawl(const fs::path &dir, bool recursive)
     {
-        if (!rodbh)
         {
-            auto flag = SQLITE_OPEN_NOMUTEX; // basically lock
-            flag |= SQLITE_OPEN_READONLY;
+            std::lock_guard<std::mutex> g(qLock);
+            auto key = dir.u8string();
+            auto q = queuedCrawls.find(key);
+            if (q != queuedCrawls.end())
+            {
+                q->second->recursive = q->second->recursive || recursive;
+                return;
+            }
+            auto *c = new EnQCrawlDirectory(dir, recursive);
+            queuedCrawls[key] = c;
+            pathQ.push_back(c);
+        }
+        qCV.notify_all();
+    }
+
+    /*
+     * Readers lease a read only connection for the length of a query. They are opened
+     * NOMUTEX, so each is only used by one thread at a time, and there are up to
+     * maxReadConnections of them so readers on different threads don't queue behind one
+     * another (nor, with WAL, behind the writer).
+     */
+    static constexpr size_t maxReadConnections{4};
+
+    struct ReadLease
+    {
+        ReadLease(WriterWorker &w, sqlite3 *c) : worker(w), conn(c) {}
+        ReadLease(const ReadLease &) = delete;
+        ReadLease &operator=(const ReadLease &) = delete;
+        ~ReadLease()
+        {
+            if (conn)
+                worker.returnReadConnection(conn);
+        }
+
+        WriterWorker &worker;
+        sqlite3 *conn;
+    };
 
-            // SCLOG( ">>>RO> Opening r/o DB" );;
-            auto ec = sqlite3_open_v2(dbname.c_str(), &rodbh, flag, nullptr);
+    ReadLease leaseReadConnection(bool notifyOnError = true)
+    {
+        std::unique_lock<std::mutex> lk(readPoolLock);
+        readPoolCV.wait(lk, [this]() {
+            return !freeReadConnections.empty() || openReadConnections < maxReadConnections;
+        });
+        if (!freeReadConnections.empty())
+        {
+            auto *c = freeReadConnections.back();
+            freeReadConnections.pop_back();
+            return ReadLease(*this, c);
+        }
+        openReadConnections++;
+        lk.unlock();
 
-            if (ec != SQLITE_OK)
+        sqlite3 *c{nullptr};
+        auto ec = sqlite3_open_v2(dbname.c_str(), &c, SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_READONLY,
+                                  nullptr);
+        if (ec != SQLITE_OK)
+        {
+            if (notifyOnError)
             {
-                if (notifyOnError)
-                {
-                    std::ostringstream oss;
-                    oss << "An error occurred opening r/o sqlite file '" << dbname
-                        << "'. The error was '" << sqlite3_errmsg(dbh) << "'.";
-                    // storage->reportError(oss.str(), "Surge Patch Database Error");
-                    SCLOG(oss.str());
-                }
-                if (rodbh)
-                    sqlite3_close(rodbh);
-                rodbh = nullptr;
+                std::ostringstream oss;
+                oss << "An error occurred opening r/o sqlite file '" << dbname
+                    << "'. The error was '" << sqlite3_errmsg(c) << "'.";
+                SCLOG(oss.str());
+            }
+            if (c)
+                sqlite3_close(c);
+            c = nullptr;
+            {
+                std::lock_guard<std::mutex> g(readPoolLock);
+                openReadConnections--;
             }
+            readPoolCV.notify_one();
+        }
+        else
+        {
+            sqlite3_busy_timeout(c, busyTimeoutMS);
         }
-        return rodbh;
+        return ReadLease(*this, c);
+    }
+
+    void returnReadConnection(sqlite3 *c)
+    {
+        {
+            std::lock_guard<std::mutex> g(readPoolLock);
+            freeReadConnections.push_back(c);
+        }
+        readPoolCV.notify_one();
     }
 
   private:
-    sqlite3 *rodbh{nullptr};
+    std::mutex readPoolLock;
+    std::condition_variable readPoolCV;
+    std::vector<sqlite3 *> freeReadConnections;
+    size_t openReadConnections{0};
     sqlite3 *dbh{nullptr};
 };
 
@@ -664,11 +1258,385 @@ void BrowserDB::writeDebugMessage(const std::string &s)
 void BrowserDB::addDeviceLocation(const fs::path &p)
 {
     writerWorker->enqueueWorkItem(new WriterWorker::EnQDeviceLocation(p));
+    crawl(p);
+}
+
+void BrowserDB::crawlDeviceLocations()
+{
+    for (const auto &p : getDeviceLocations())
+        crawl(p);
+}
+
+void BrowserDB::crawl(const fs::path &p) { writerWorker->enqueueCrawl(p, true); }
+
+namespace
+{
+CatalogueEntry catalogueEntryFrom(const SQL::Statement &q)
+{
+    CatalogueEntry e;
+    e.path = fs::u8path(q.col_str(0));
+    e.kind = (CatalogueEntry::Kind)q.col_int(1);
+    e.size = q.col_int64(2);
+    e.mtime = q.col_int64(3);
+    e.frames = q.col_int64(4);
+    e.sampleRate = q.col_int(5);
+    e.channels = q.col_int(6);
+    e.bitDepth = q.col_int(7);
+    e.rootKey = q.col_int(8);
+    e.loopStart = q.col_int64(9);
+    e.loopEnd = q.col_int64(10);
+    return e;
+}
+} // namespace
+
+std::vector<CatalogueEntry> BrowserDB::getCatalogueEntries(const fs::path &directory)
+{
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    std::vector<CatalogueEntry> res;
+    if (!conn)
+        return res;
+
+    // language=SQL
+    std::string query = std::string("SELECT ") + WriterWorker::catalogueColumns +
+                        " FROM Catalogue WHERE parent = ?1 ORDER BY kind, name;";
+    try
+    {
+        auto q = SQL::Statement(conn, query);
+        std::string ds = directory.u8string();
+        q.bind(1, ds);
+        while (q.step())
+            res.push_back(catalogueEntryFrom(q));
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        // Most likely the table isn't there yet on a first run
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+namespace
+{
+/*
+ * Each word of the search text as a quoted prefix query, so punctuation in what the user
+ * typed can't be read as FTS5 syntax. Words split as the unicode61 tokenizer splits names.
+ */
+std::string ftsMatchFor(const std::string &text)
+{
+    std::string res, word;
+    auto flush = [&]() {
+        if (word.empty())
+            return;
+        if (!res.empty())
+            res += " ";
+        res += "\"" + word + "\"*";
+        word.clear();
+    };
+    for (auto c : text)
+    {
+        if (std::isalnum((unsigned char)c) || (unsigned char)c >= 0x80)
+            word += c;
+        else
+            flush();
+    }
+    flush();
+    return res;
+}
+
+/*
+ * Text matching many names is quicker to page through by walking the names in order and
+ * checking each against the matches, which stops once the page is full, than by looking up
+ * and sorting every match. We call the matches dense when there are at least this many per
+ * row asked for, which a LIMITed read of the index tells us without reading them all.
+ */
+constexpr int denseMatchesPerRow{50};
+
+bool isDenseMatch(sqlite3 *conn, const std::string &match, int limit)
+{
+    auto q = SQL::Statement(conn, "SELECT count(*) FROM (SELECT rowid FROM CatalogueSearch "
+                                  "WHERE CatalogueSearch MATCH ?1 LIMIT ?2)");
+    auto probe = (int64_t)limit * denseMatchesPerRow;
+    q.bind(1, match);
+    q.bindi64(2, probe);
+    auto res = q.step() && q.col_int64(0) >= probe;
+    q.finalize();
+    return res;
+}
+} // namespace
+
+std::vector<CatalogueEntry> BrowserDB::queryCatalogue(const CatalogueQuery &cq)
+{
+    std::vector<CatalogueEntry> res;
+    if (cq.limit <= 0)
+        return res;
+
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    if (!conn)
+        return res;
+
+    // Build the where clause and the binds to go with it. The strings are held in a deque
+    // since the statement binds them without a copy.
+    std::string where = cq.kind.has_value() ? "kind = ?" : "kind <> ?";
+    std::deque<std::string> strings;
+    std::vector<std::function<void(SQL::Statement &, int)>> binds;
+    auto bindString = [&](const std::string &v) {
+        strings.push_back(v);
+        const auto &sv = strings.back();
+        binds.emplace_back([&sv](auto &q, int i) { q.bind(i, sv); });
+    };
+    auto bindInt = [&](int v) { binds.emplace_back([v](auto &q, int i) { q.bind(i, v); }); };
+    auto bindDouble = [&](double v) {
+        binds.emplace_back([v](auto &q, int i) { q.bind(i, v); });
+    };
+
+    bindInt(cq.kind.has_value() ? (int)*cq.kind : (int)CatalogueEntry::DIRECTORY);
+
+    auto match = ftsMatchFor(cq.text);
+    if (!match.empty())
+    {
+        // The unary + stops the planner driving the query off the matches, so it walks an
+        // index in name order (or a narrower one, like the folder's) instead
+        bool dense{false};
+        try
+        {
+            dense = isDenseMatch(conn, match, cq.limit);
+        }
+        catch (SQL::Exception &e)
+        {
+            SCLOG(e.what());
+        }
+        where += std::string(" AND ") + (dense ? "+" : "") +
+                 "rowid IN (SELECT rowid FROM CatalogueSearch WHERE CatalogueSearch MATCH ?)";
+        bindString(match);
+    }
+    if (cq.folder.has_value())
+    {
+        auto sep = (char)fs::path::preferred_separator;
+        auto folder = cq.folder->u8string();
+        where += " AND path > ? AND path < ?";
+        bindString(folder + sep);
+        bindString(folder + (char)(sep + 1));
+    }
+    if (!cq.formats.empty())
+    {
+        where += " AND format IN (";
+        for (size_t i = 0; i < cq.formats.size(); ++i)
+        {
+            where += (i == 0 ? "?" : ", ?");
+            bindString(cq.formats[i]);
+        }
+        where += ")";
+    }
+    if (cq.minDuration.has_value())
+    {
+        where += " AND duration >= ?";
+        bindDouble(*cq.minDuration);
+    }
+    if (cq.maxDuration.has_value())
+    {
+        where += " AND duration >= 0 AND duration <= ?";
+        bindDouble(*cq.maxDuration);
+    }
+    if (cq.rootKey.has_value())
+    {
+        where += " AND root_key = ?";
+        bindInt(*cq.rootKey);
+    }
+    if (cq.sampleRate.has_value())
+    {
+        where += " AND sample_rate = ?";
+        bindInt(*cq.sampleRate);
+    }
+    if (cq.channels.has_value())
+    {
+        where += " AND channels = ?";
+        bindInt(*cq.channels);
+    }
+    if (cq.after.has_value())
+    {
+        where += " AND (name, path) > (?, ?)";
+        bindString(cq.after->path.filename().u8string());
+        bindString(cq.after->path.u8string());
+    }
+
+    // language=SQL
+    std::string query = std::string("SELECT ") + WriterWorker::catalogueColumns +
+                        " FROM Catalogue WHERE " + where + " ORDER BY name, path LIMIT ?;";
+    try
+    {
+        auto q = SQL::Statement(conn, query);
+        int idx{1};
+        for (const auto &b : binds)
+            b(q, idx++);
+        q.bind(idx, cq.limit);
+        while (q.step())
+            res.push_back(catalogueEntryFrom(q));
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+std::vector<CatalogueEntry> BrowserDB::getCatalogueEntriesNamedOrSized(const std::string &name,
+                                                                       int64_t size)
+{
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    std::vector<CatalogueEntry> res;
+    if (!conn)
+        return res;
+
+    // Each side of the OR has an index so this stays two lookups however big the catalogue
+    // language=SQL
+    std::string query = std::string("SELECT ") + WriterWorker::catalogueColumns +
+                        " FROM Catalogue WHERE (name = ?1 OR size = ?2) AND kind != ?3 "
+                        "ORDER BY path;";
+    try
+    {
+        auto q = SQL::Statement(conn, query);
+        q.bind(1, name);
+        q.bindi64(2, size);
+        q.bind(3, (int)CatalogueEntry::DIRECTORY);
+        while (q.step())
+            res.push_back(catalogueEntryFrom(q));
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+std::optional<CatalogueEntry> BrowserDB::getCatalogueEntry(const fs::path &p)
+{
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    if (!conn)
+        return std::nullopt;
+
+    std::optional<CatalogueEntry> res;
+    // language=SQL
+    std::string query = std::string("SELECT ") + WriterWorker::catalogueColumns +
+                        " FROM Catalogue WHERE path = ?1;";
+    try
+    {
+        auto q = SQL::Statement(conn, query);
+        std::string ps = p.u8string();
+        q.bind(1, ps);
+        if (q.step())
+            res = catalogueEntryFrom(q);
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+std::vector<patch_io::PatchSummary> BrowserDB::getPatchSummaries(const fs::path &folder)
+{
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    std::vector<patch_io::PatchSummary> res;
+    if (!conn)
+        return res;
+
+    // As in removeFromCatalogue, everything under folder sorts between "folder/" and "folder0"
+    auto sep = (char)fs::path::preferred_separator;
+    std::string from = folder.u8string() + sep, to = folder.u8string() + (char)(sep + 1);
+    try
+    {
+        std::unordered_map<std::string, size_t> byPath;
+        // language=SQL
+        auto q = SQL::Statement(conn, "SELECT path, type, part_names, zone_count, sample_bytes "
+                                      "FROM PatchSummary WHERE path > ?1 AND path < ?2 "
+                                      "ORDER BY path;");
+        q.bind(1, from);
+        q.bind(2, to);
+        while (q.step())
+        {
+            patch_io::PatchSummary ps;
+            auto p = q.col_str(0);
+            ps.path = fs::u8path(p);
+            ps.type = q.col_str(1);
+            auto names = q.col_str(2);
+            size_t b = 0;
+            while (!names.empty() && b <= names.size())
+            {
+                auto e = std::min(names.find('\n', b), names.size());
+                ps.partNames.push_back(names.substr(b, e - b));
+                b = e + 1;
+            }
+            ps.zoneCount = q.col_int(3);
+            ps.sampleBytes = q.col_int64(4);
+            byPath[p] = res.size();
+            res.push_back(std::move(ps));
+        }
+        q.finalize();
+
+        // language=SQL
+        auto sq = SQL::Statement(conn, "SELECT path, md5, path_hash, address0, address1, "
+                                       "address2 FROM PatchSamples WHERE path > ?1 AND path < ?2 "
+                                       "ORDER BY rowid;");
+        sq.bind(1, from);
+        sq.bind(2, to);
+        while (sq.step())
+        {
+            auto f = byPath.find(sq.col_str(0));
+            if (f == byPath.end())
+                continue;
+            SampleID id;
+            id.setAsMD5WithAddress(sq.col_str(1), sq.col_int(3), sq.col_int(4), sq.col_int(5));
+            id.setPathHash((size_t)sq.col_int64(2));
+            res[f->second].sampleIDs.push_back(id);
+        }
+        sq.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+std::vector<fs::path> BrowserDB::getPatchesUsingSample(const SampleID &id)
+{
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    std::vector<fs::path> res;
+    if (!conn)
+        return res;
+
+    try
+    {
+        // language=SQL
+        auto q = SQL::Statement(
+            conn, "SELECT DISTINCT path FROM PatchSamples WHERE md5 = ?1 ORDER BY path;");
+        auto md5 = id.getMD5();
+        q.bind(1, md5);
+        while (q.step())
+            res.push_back(fs::u8path(q.col_str(0)));
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
 }
 
 std::vector<fs::path> BrowserDB::getDeviceLocations()
 {
-    auto conn = writerWorker->getReadOnlyConn();
+    auto lease = writerWorker->leaseReadConnection();
+    auto conn = lease.conn;
     std::vector<fs::path> res;
 
     // language=SQL
@@ -690,10 +1658,86 @@ std::vector<fs::path> BrowserDB::getDeviceLocations()
     return res;
 }
 
+std::optional<std::string> BrowserDB::getCachedContentHash(const fs::path &p,
+                                                           infrastructure::ContentHashKind k)
+{
+    auto stamp = FileStamp(p);
+    if (!stamp.valid)
+        return std::nullopt;
+
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    if (!conn)
+        return std::nullopt;
+
+    std::optional<std::string> res;
+    // language=SQL
+    std::string query = "SELECT size, mtime, inode, hash FROM SampleIdentity WHERE path = ?1 AND "
+                        "hash_kind = ?2;";
+    try
+    {
+        auto q = SQL::Statement(conn, query);
+        std::string ps = p.u8string();
+        q.bind(1, ps);
+        q.bind(2, (int)k);
+        if (q.step())
+        {
+            auto cached = stamp;
+            cached.size = q.col_int64(0);
+            cached.mtime = q.col_int64(1);
+            cached.inode = q.col_int64(2);
+            if (cached == stamp)
+            {
+                res = q.col_str(3);
+            }
+        }
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        // Most likely the table isn't there yet on a first run; just a cache miss
+        return std::nullopt;
+    }
+    return res;
+}
+
+std::vector<fs::path> BrowserDB::getPathsWithContentHash(const std::string &hash)
+{
+    auto lease = writerWorker->leaseReadConnection(false);
+    auto conn = lease.conn;
+    std::vector<fs::path> res;
+    if (!conn)
+        return res;
+
+    // language=SQL
+    std::string query = "SELECT DISTINCT path FROM SampleIdentity WHERE hash = ?1;";
+    try
+    {
+        auto q = SQL::Statement(conn, query);
+        q.bind(1, hash);
+        while (q.step())
+            res.push_back(fs::u8path(q.col_str(0)));
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+void BrowserDB::storeContentHash(const fs::path &p, infrastructure::ContentHashKind k,
+                                 const std::string &hash)
+{
+    if (hash.empty())
+        return;
+    writerWorker->enqueueWorkItem(new WriterWorker::EnQSampleIdentity(p, (int)k, hash));
+}
+
 int BrowserDB::numberOfJobsOutstanding() const
 {
     std::lock_guard<std::mutex> guard(writerWorker->qLock);
-    return writerWorker->pathQ.size();
+    return writerWorker->pathQ.size() + writerWorker->jobsInFlight;
 }
 
 int BrowserDB::waitForJobsOutstandingComplete(int maxWaitInMS) const
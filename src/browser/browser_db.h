@@ -30,8 +30,14 @@
 
 #include "filesystem/import.h"
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "infrastructure/content_hash.h"
+#include "catalogue.h"
+#include "patch_io/patch_summary.h"
+
 namespace scxt::browser
 {
 struct WriterWorker;
@@ -45,6 +51,55 @@ struct BrowserDB
 
     std::vector<fs::path> getDeviceLocations();
 
+    /*
+     * The sample identity cache remembers the content hash of a file along with its
+     * size, modification time and inode, so a later load of an unchanged file can skip
+     * hashing. Lookups run on the caller thread against the read only connection; stores
+     * are queued to the writer.
+     */
+    std::optional<std::string> getCachedContentHash(const fs::path &,
+                                                    infrastructure::ContentHashKind);
+    void storeContentHash(const fs::path &, infrastructure::ContentHashKind,
+                          const std::string &hash);
+    // Every path we have ever hashed to this, of any kind. The files may have changed
+    // since, so check them with getCachedContentHash before trusting one.
+    std::vector<fs::path> getPathsWithContentHash(const std::string &hash);
+
+    /*
+     * The catalogue indexes every loadable file under the device locations (see
+     * CatalogueEntry) so the browser can show a directory, with sample lengths, rates and
+     * the like, as one indexed query rather than a walk of the disk. Crawls run on the
+     * writer thread a directory per job and only parse the headers of files whose size or
+     * mtime moved since last time. Adding a device location crawls it; on linux inotify
+     * queues a rescan of any catalogued directory which changes.
+     */
+    void crawlDeviceLocations();
+    void crawl(const fs::path &);
+    std::vector<CatalogueEntry> getCatalogueEntries(const fs::path &directory);
+    std::optional<CatalogueEntry> getCatalogueEntry(const fs::path &);
+    // The files anywhere in the catalogue with this file name or this size in bytes
+    std::vector<CatalogueEntry> getCatalogueEntriesNamedOrSized(const std::string &name,
+                                                                int64_t size);
+
+    /*
+     * Search the catalogue (see CatalogueQuery) on the read only connection. File names
+     * are in an FTS5 index kept up by triggers on the catalogue and each attribute has an
+     * index of its own, so on a 500k file library a page comes back in a ms or so. Text
+     * matching a large share of the names costs more, since every match has to be read,
+     * and a word in a sixth of them takes about 10ms; the "Catalogue Search Benchmark"
+     * test measures these.
+     */
+    std::vector<CatalogueEntry> queryCatalogue(const CatalogueQuery &);
+
+    /*
+     * The crawler reads the summary a patch file carries (see patch_io::PatchSummary) into
+     * tables of its own, so the patch browser can list everything under a folder with part
+     * names, zone counts and sample memory in one query, and find the patches using a sample
+     * by its content hash, without unstreaming a patch.
+     */
+    std::vector<patch_io::PatchSummary> getPatchSummaries(const fs::path &folder);
+    std::vector<fs::path> getPatchesUsingSample(const SampleID &);
+
     int numberOfJobsOutstanding() const;
     int waitForJobsOutstandingComplete(int maxWaitInMS) const;
 
@@ -0,0 +1,237 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catalogue.h"
+#include "utils.h"
+#include "sample/loaders/riff_wave.h"
+#include "sample/loaders/pcm_header.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace scxt::browser
+{
+namespace
+{
+uint32_t be32(const unsigned char *b)
+{
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+uint16_t be16(const unsigned char *b) { return (uint16_t)((b[0] << 8) | b[1]); }
+
+/*
+ * Walk the chunks of a RIFF WAVE, reading the bodies of just the few we care about and
+ * skipping the rest (the data chunk in particular) by seeking over them.
+ */
+bool readWaveHeader(std::ifstream &f, CatalogueEntry &e)
+{
+    char riff[12];
+    if (!f.read(riff, 12) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+        return false;
+
+    sample::loaders::wavheader wh{};
+    bool haveFmt{false}, haveData{false};
+    uint32_t dataBytes{0};
+    int32_t smplRoot{-1}, instRoot{-1};
+    int64_t loopStart{-1}, loopEnd{-1};
+
+    char ch[8];
+    while (f.read(ch, 8))
+    {
+        uint32_t len;
+        memcpy(&len, ch + 4, sizeof(len));
+        auto next = (std::streamoff)f.tellg() + len + (len & 1);
+
+        if (memcmp(ch, "fmt ", 4) == 0 && len >= sizeof(wh))
+        {
+            haveFmt = (bool)f.read((char *)&wh, sizeof(wh));
+        }
+        else if (memcmp(ch, "data", 4) == 0)
+        {
+            dataBytes = len;
+            haveData = true;
+        }
+        else if (memcmp(ch, "smpl", 4) == 0 && len >= sizeof(sample::loaders::SamplerChunk))
+        {
+            sample::loaders::SamplerChunk smpl;
+            if (f.read((char *)&smpl, sizeof(smpl)))
+            {
+                smplRoot = smpl.dwMIDIUnityNote & 0xFF;
+                sample::loaders::SampleLoop loop;
+                if (smpl.cSampleLoops > 0 && f.read((char *)&loop, sizeof(loop)))
+                {
+                    loopStart = loop.dwStart;
+                    loopEnd = (int64_t)loop.dwEnd + 1;
+                }
+            }
+        }
+        else if (memcmp(ch, "inst", 4) == 0 && len >= sizeof(sample::loaders::wave_inst_chunk))
+        {
+            sample::loaders::wave_inst_chunk inst;
+            if (f.read((char *)&inst, sizeof(inst)))
+                instRoot = inst.key_root;
+        }
+
+        f.clear();
+        f.seekg(next);
+    }
+
+    if (!haveFmt || !haveData || wh.nChannels <= 0 || wh.wBitsPerSample <= 0 ||
+        wh.nSamplesPerSec <= 0)
+        return false;
+
+    e.sampleRate = wh.nSamplesPerSec;
+    e.channels = wh.nChannels;
+    e.bitDepth = wh.wBitsPerSample;
+    e.frames = 8 * (int64_t)dataBytes / (wh.wBitsPerSample * wh.nChannels);
+    // the loader lets an inst chunk override the smpl root key
+    e.rootKey = instRoot >= 0 ? instRoot : smplRoot;
+    e.loopStart = loopStart;
+    e.loopEnd = loopEnd;
+    return true;
+}
+
+bool readAiffHeader(std::ifstream &f, CatalogueEntry &e)
+{
+    unsigned char form[12];
+    if (!f.read((char *)form, 12) || memcmp(form, "FORM", 4) != 0 ||
+        (memcmp(form + 8, "AIFF", 4) != 0 && memcmp(form + 8, "AIFC", 4) != 0))
+        return false;
+
+    bool haveComm{false};
+    std::unordered_map<uint16_t, uint32_t> markers;
+    int32_t rootKey{-1};
+    uint16_t loopMode{0}, loopBegin{0}, loopEnd{0};
+
+    unsigned char ch[8];
+    while (f.read((char *)ch, 8))
+    {
+        auto len = be32(ch + 4);
+        auto next = (std::streamoff)f.tellg() + len + (len & 1);
+
+        if (memcmp(ch, "COMM", 4) == 0 && len >= 18)
+        {
+            unsigned char c[18];
+            if (f.read((char *)c, 18))
+            {
+                e.channels = (int16_t)be16(c);
+                e.frames = be32(c + 2);
+                e.bitDepth = (int16_t)be16(c + 6);
+                auto rate = sample::loaders::ConvertFromIeeeExtended(c + 8);
+                e.sampleRate = (int32_t)std::lround(rate);
+                haveComm = true;
+            }
+        }
+        else if (memcmp(ch, "MARK", 4) == 0 && len >= 2)
+        {
+            unsigned char n[2];
+            if (f.read((char *)n, 2))
+            {
+                auto count = be16(n);
+                for (int i = 0; i < count; ++i)
+                {
+                    // id, position, then a pascal string padded to an even length
+                    unsigned char m[7];
+                    if (!f.read((char *)m, 7))
+                        break;
+                    markers[be16(m)] = be32(m + 2);
+                    auto skip = m[6] + ((m[6] & 1) ? 0 : 1);
+                    f.seekg(skip, std::ios::cur);
+                }
+            }
+        }
+        else if (memcmp(ch, "INST", 4) == 0 && len >= 14)
+        {
+            unsigned char c[14];
+            if (f.read((char *)c, 14))
+            {
+                rootKey = c[0];
+                loopMode = be16(c + 8);
+                loopBegin = be16(c + 10);
+                loopEnd = be16(c + 12);
+            }
+        }
+
+        f.clear();
+        f.seekg(next);
+    }
+
+    if (!haveComm || e.channels <= 0 || e.sampleRate <= 0)
+    {
+        e.channels = e.sampleRate = e.bitDepth = -1;
+        e.frames = -1;
+        return false;
+    }
+
+    e.rootKey = rootKey;
+    auto b = markers.find(loopBegin), en = markers.find(loopEnd);
+    if (loopMode && b != markers.end() && en != markers.end())
+    {
+        e.loopStart = b->second;
+        e.loopEnd = (int64_t)en->second + 1;
+    }
+    return true;
+}
+
+bool readFlacHeader(std::ifstream &f, CatalogueEntry &e)
+{
+    // "fLaC" then the STREAMINFO block, which the format requires to come first
+    unsigned char b[4 + 4 + 34];
+    if (!f.read((char *)b, sizeof(b)) || memcmp(b, "fLaC", 4) != 0 || (b[4] & 0x7F) != 0)
+        return false;
+
+    auto *si = b + 8;
+    auto rate = ((uint32_t)si[10] << 12) | ((uint32_t)si[11] << 4) | (si[12] >> 4);
+    if (rate == 0)
+        return false;
+    e.sampleRate = (int32_t)rate;
+    e.channels = ((si[12] >> 1) & 0x7) + 1;
+    e.bitDepth = (((si[12] & 0x1) << 4) | (si[13] >> 4)) + 1;
+    auto total = ((uint64_t)(si[13] & 0xF) << 32) | be32(si + 14);
+    // zero means the encoder didn't know
+    e.frames = total ? (int64_t)total : -1;
+    return true;
+}
+} // namespace
+
+bool CatalogueEntry::readSampleHeader()
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open())
+        return false;
+
+    if (extensionMatches(path, ".wav"))
+        return readWaveHeader(f, *this);
+    if (extensionMatches(path, ".aif") || extensionMatches(path, ".aiff"))
+        return readAiffHeader(f, *this);
+    if (extensionMatches(path, ".flac"))
+        return readFlacHeader(f, *this);
+    return false;
+}
+} // namespace scxt::browser
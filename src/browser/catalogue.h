@@ -0,0 +1,102 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_BROWSER_CATALOGUE_H
+#define SCXT_SRC_BROWSER_CATALOGUE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "filesystem/import.h"
+
+namespace scxt::browser
+{
+/*
+ * A row of the browser catalogue: a directory or loadable file under one of the device
+ * locations, along with whatever a header only parse could tell us about it. The crawler
+ * in BrowserDB keeps these current; the browser reads them back a directory at a time.
+ * Anything we couldn't read (everything audio for a directory or an sfz, the length of an
+ * mp3) is -1. Loop ends are the first frame after the loop, as the loaders report them.
+ */
+struct CatalogueEntry
+{
+    enum Kind : int32_t
+    {
+        DIRECTORY = 0,
+        SINGLE_SAMPLE = 1,
+        MULTI_SAMPLE = 2,
+        SHORTCIRCUIT_FORMAT = 3
+    };
+
+    fs::path path;
+    Kind kind{SINGLE_SAMPLE};
+    int64_t size{0}, mtime{0};
+
+    int64_t frames{-1};
+    int32_t sampleRate{-1}, channels{-1}, bitDepth{-1};
+    int32_t rootKey{-1};
+    int64_t loopStart{-1}, loopEnd{-1};
+
+    /*
+     * Fill in the audio fields from the leading chunks of a wav, aiff or flac without
+     * reading any of the sample data. Returns false for formats we don't read this way
+     * (which leaves the fields alone) or a header which doesn't parse.
+     */
+    bool readSampleHeader();
+
+    // In seconds, or -1 if we don't know the length or rate
+    double duration() const
+    {
+        return frames >= 0 && sampleRate > 0 ? (double)frames / sampleRate : -1.0;
+    }
+};
+
+/*
+ * A search of the catalogue. Every field set narrows it: text is split into words and
+ * each has to start a word of the file name ("kick 808" finds "808_Kick_Hard.wav"),
+ * folder keeps to anything under that directory, and formats are lower case extensions
+ * without the dot. Directories only turn up if asked for by kind.
+ *
+ * Results come back in name (then path) order, limit at a time. For the next page pass
+ * the last entry of this one as after; that keeps deep pages as quick as the first.
+ */
+struct CatalogueQuery
+{
+    std::string text;
+    std::optional<fs::path> folder;
+    std::optional<CatalogueEntry::Kind> kind;
+    std::vector<std::string> formats;
+    std::optional<double> minDuration, maxDuration;
+    std::optional<int32_t> rootKey, sampleRate, channels;
+
+    int limit{100};
+    std::optional<CatalogueEntry> after;
+};
+} // namespace scxt::browser
+
+#endif // SCXT_SRC_BROWSER_CATALOGUE_H
@@ -0,0 +1,308 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "missing_sample_search.h"
+#include "browser_db.h"
+#include "infrastructure/content_hash.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace scxt::browser
+{
+namespace
+{
+using hashKind_t = infrastructure::ContentHashKind;
+static constexpr hashKind_t hashKinds[]{hashKind_t::XXH3_128, hashKind_t::MD5};
+
+// Legacy ids and the like have something in the md5 slot which was never a hash
+bool isContentHash(const std::string &h)
+{
+    return h.size() == 32 &&
+           std::all_of(h.begin(), h.end(), [](auto c) { return std::isxdigit((unsigned char)c); });
+}
+
+struct Candidate
+{
+    fs::path path;
+    std::string name;
+    int64_t size;
+};
+
+struct Search
+{
+    BrowserDB &db;
+    const std::vector<MissingSampleQuery> &queries;
+    MissingSampleSearchControl *control;
+    std::vector<std::optional<fs::path>> res;
+    std::mutex resLock;
+
+    Search(BrowserDB &d, const std::vector<MissingSampleQuery> &q, MissingSampleSearchControl *c)
+        : db(d), queries(q), control(c), res(q.size())
+    {
+    }
+
+    bool cancelled() const { return control && control->cancel; }
+    void progress(const std::string &s) const
+    {
+        if (control && control->onProgress)
+            control->onProgress(s);
+    }
+
+    bool unresolvedHashed(size_t i) const
+    {
+        return !res[i].has_value() && isContentHash(queries[i].contentHash);
+    }
+
+    // A file we should hash for query i: the same size if we know it, else the same name
+    bool worthHashing(size_t i, const Candidate &c) const
+    {
+        const auto &q = queries[i];
+        return q.fileSize >= 0 ? c.size == q.fileSize : c.name == q.fileName;
+    }
+
+    // Files whose hash the identity cache has, and which haven't changed since
+    void resolveFromIdentityCache()
+    {
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            if (!unresolvedHashed(i))
+                continue;
+            for (const auto &p : db.getPathsWithContentHash(queries[i].contentHash))
+            {
+                for (auto k : hashKinds)
+                {
+                    auto h = db.getCachedContentHash(p, k);
+                    if (h.has_value() && *h == queries[i].contentHash)
+                        res[i] = p;
+                }
+                if (res[i].has_value())
+                    break;
+            }
+        }
+    }
+
+    /*
+     * Hash whichever candidates some unresolved query wants on a few threads, resolving the
+     * queries whose hash comes up; then give the unhashed queries any unique name match.
+     */
+    void resolveFrom(const std::vector<Candidate> &candidates)
+    {
+        std::unordered_map<std::string, std::vector<size_t>> byHash;
+        std::vector<const Candidate *> toHash;
+        for (size_t i = 0; i < queries.size(); ++i)
+            if (unresolvedHashed(i))
+                byHash[queries[i].contentHash].push_back(i);
+        for (const auto &c : candidates)
+        {
+            for (const auto &[h, qs] : byHash)
+            {
+                if (std::any_of(qs.begin(), qs.end(), [&](auto i) { return worthHashing(i, c); }))
+                {
+                    toHash.push_back(&c);
+                    break;
+                }
+            }
+        }
+
+        if (!toHash.empty())
+            progress("Checking " + std::to_string(toHash.size()) + " candidate files");
+
+        std::atomic<size_t> next{0};
+        auto hasher = [&]() {
+            for (auto n = next++; n < toHash.size() && !cancelled(); n = next++)
+            {
+                const auto &p = toHash[n]->path;
+                for (auto k : hashKinds)
+                {
+                    auto h = db.getCachedContentHash(p, k).value_or("");
+                    if (h.empty())
+                    {
+                        h = infrastructure::createContentHashFromFile(k, p);
+                        if (!h.empty())
+                            db.storeContentHash(p, k, h);
+                    }
+                    auto f = byHash.find(h);
+                    if (f == byHash.end())
+                        continue;
+                    std::lock_guard<std::mutex> g(resLock);
+                    for (auto i : f->second)
+                        if (!res[i].has_value())
+                            res[i] = p;
+                    break;
+                }
+            }
+        };
+        auto nThreads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8);
+        nThreads = std::min(nThreads, toHash.size());
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < nThreads; ++t)
+            threads.emplace_back(hasher);
+        hasher();
+        for (auto &t : threads)
+            t.join();
+
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            const auto &q = queries[i];
+            if (res[i].has_value() || isContentHash(q.contentHash))
+                continue;
+            const Candidate *only{nullptr};
+            int count{0};
+            for (const auto &c : candidates)
+            {
+                if (c.name == q.fileName && (q.fileSize < 0 || c.size == q.fileSize))
+                {
+                    only = &c;
+                    count++;
+                }
+            }
+            if (count == 1)
+                res[i] = only->path;
+        }
+    }
+
+    bool anyUnresolved() const
+    {
+        return std::any_of(res.begin(), res.end(), [](auto &r) { return !r.has_value(); });
+    }
+};
+
+// Walk root for the regular files with one of these names or sizes, skipping hidden
+// directories and (as recursive_directory_iterator does by default) symlinked ones
+void crawlForCandidates(const fs::path &root, const std::unordered_set<std::string> &names,
+                        const std::unordered_set<int64_t> &sizes, std::vector<Candidate> &into,
+                        const Search &search)
+{
+    std::error_code ec;
+    auto it = fs::recursive_directory_iterator(
+        root, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator() && !search.cancelled();
+         it.increment(ec))
+    {
+        auto name = it->path().filename().u8string();
+        std::error_code fec;
+        if (it->is_directory(fec))
+        {
+            if (!name.empty() && name[0] == '.')
+                it.disable_recursion_pending();
+            continue;
+        }
+        if (!it->is_regular_file(fec))
+            continue;
+        auto size = (int64_t)it->file_size(fec);
+        if (fec)
+            continue;
+        if (names.count(name) || sizes.count(size))
+            into.push_back({it->path(), name, size});
+    }
+}
+} // namespace
+
+std::vector<std::optional<fs::path>>
+findMissingSamples(BrowserDB &db, const std::vector<MissingSampleQuery> &queries,
+                   const std::vector<fs::path> &crawlRoots, MissingSampleSearchControl *control)
+{
+    Search search(db, queries, control);
+    search.progress("Looking up " + std::to_string(queries.size()) + " missing samples");
+    search.resolveFromIdentityCache();
+
+    // The catalogue
+    if (search.anyUnresolved() && !search.cancelled())
+    {
+        std::vector<Candidate> candidates;
+        std::unordered_set<std::string> seen;
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            if (search.res[i].has_value())
+                continue;
+            for (const auto &e :
+                 db.getCatalogueEntriesNamedOrSized(queries[i].fileName, queries[i].fileSize))
+            {
+                auto ps = e.path.u8string();
+                if (seen.insert(ps).second)
+                    candidates.push_back({e.path, e.path.filename().u8string(), e.size});
+            }
+        }
+        search.resolveFrom(candidates);
+    }
+
+    // and then the disk, leaving out roots inside other roots
+    if (search.anyUnresolved() && !crawlRoots.empty() && !search.cancelled())
+    {
+        std::unordered_set<std::string> names;
+        std::unordered_set<int64_t> sizes;
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            if (search.res[i].has_value())
+                continue;
+            names.insert(queries[i].fileName);
+            if (queries[i].fileSize >= 0)
+                sizes.insert(queries[i].fileSize);
+        }
+
+        auto roots = crawlRoots;
+        std::sort(roots.begin(), roots.end(),
+                  [](const auto &a, const auto &b) { return a.u8string() < b.u8string(); });
+        std::vector<fs::path> outer;
+        for (const auto &r : roots)
+        {
+            auto inside = std::any_of(outer.begin(), outer.end(), [&r](const auto &o) {
+                auto rel = r.lexically_relative(o);
+                return !rel.empty() && rel.begin()->u8string() != "..";
+            });
+            if (!inside)
+                outer.push_back(r);
+        }
+
+        search.progress("Searching " + std::to_string(outer.size()) + " folders on disk");
+        std::vector<std::vector<Candidate>> found(outer.size());
+        std::vector<std::thread> crawlers;
+        for (size_t r = 0; r < outer.size(); ++r)
+            crawlers.emplace_back(
+                [&, r]() { crawlForCandidates(outer[r], names, sizes, found[r], search); });
+        for (auto &t : crawlers)
+            t.join();
+
+        std::vector<Candidate> candidates;
+        for (auto &f : found)
+            candidates.insert(candidates.end(), f.begin(), f.end());
+        search.resolveFrom(candidates);
+    }
+
+    for (size_t i = 0; i < queries.size(); ++i)
+        if (search.res[i].has_value())
+            SCLOG("Found missing " << queries[i].fileName << " at " << search.res[i]->u8string());
+    return search.res;
+}
+} // namespace scxt::browser
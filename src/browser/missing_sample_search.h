@@ -0,0 +1,85 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_BROWSER_MISSING_SAMPLE_SEARCH_H
+#define SCXT_SRC_BROWSER_MISSING_SAMPLE_SEARCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "filesystem/import.h"
+
+namespace scxt::browser
+{
+struct BrowserDB;
+
+/*
+ * What we know of a sample a patch couldn't find: the content hash from the md5 slot of
+ * its SampleID, the file name it had, and its size if the patch was saved recently enough
+ * to record it.
+ */
+struct MissingSampleQuery
+{
+    std::string contentHash;
+    std::string fileName;
+    int64_t fileSize{-1};
+};
+
+/*
+ * Lets a caller follow and stop a search running on another thread. onProgress gets a
+ * line describing each stage, on the searching thread. Setting cancel makes the search
+ * return soon after with whatever it has found so far.
+ */
+struct MissingSampleSearchControl
+{
+    std::function<void(const std::string &)> onProgress{nullptr};
+    std::atomic<bool> cancel{false};
+};
+
+/*
+ * Find files for a batch of missing samples. First the database: paths the identity cache
+ * has hashed to the content hash, then catalogue files of the same name or size, hashed to
+ * check them. Whatever is left we look for by crawling crawlRoots, a thread per root,
+ * hashing only the files whose size matches (or, with no size, whose name does) on a few
+ * threads. Hashes go to the identity cache so a second search is cheap.
+ *
+ * We don't know which ContentHashKind a patch was saved with so candidates are hashed
+ * XXH3_128 and then MD5. Samples without a real content hash (legacy ids) are only matched
+ * by name, and only if there is a single file of that name (and size, if known).
+ *
+ * The result has an entry per query, empty where we found nothing.
+ */
+std::vector<std::optional<fs::path>>
+findMissingSamples(BrowserDB &, const std::vector<MissingSampleQuery> &,
+                   const std::vector<fs::path> &crawlRoots,
+                   MissingSampleSearchControl *control = nullptr);
+} // namespace scxt::browser
+
+#endif // SCXT_SRC_BROWSER_MISSING_SAMPLE_SEARCH_H
@@ -26,6 +26,8 @@
  */
 
 #include "generator.h"
+#include "loop_splice.h"
+#include "packed_int24.h"
 #include "infrastructure/sse_include.h"
 
 #include "resampling.h"
@@ -33,6 +35,7 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 
 #include "sst/basic-blocks/mechanics/simd-ops.h"
 #include "utils.h"
@@ -41,7 +44,7 @@
 
 /*
  * This is the Generator, the core class which moves from the sample data to an output
- * stream. It handles looping, fades, interpolation methods, f32 vs i16 and more.
+ * stream. It handles looping, fades, interpolation methods, f32 vs i24 vs i16 and more.
  *
  * There's three "big ideas" you need to udnerstand it
  *
@@ -87,7 +90,12 @@
  *
  * The processors also have the opportunity to have a fade region where they
  * cross fade between two sets of FIR-wide sample inputs aligned in the same
- * fashion using the fade value defined below.
+ * fashion using the fade value defined in loop_splice.h.
+ *
+ * Forward loops usually skip both the shuffling and the fade though. When the voice
+ * hands us a LoopSplice for this loop, the end of the loop (crossfade and wrap
+ * included) has been prepared ahead of time and the read pointer simply moves over
+ * into that buffer for those frames.
  *
  * And everything is templated so we can constexpr out the code we don't need
  * and use a function pointer at voice on with the appropriate compile time config.
@@ -101,19 +109,6 @@ constexpr float I16InvScale = (1.f / (16384.f * 32768.f));
 constexpr float I16InvScale2 = (1.f / (32768.f));
 const __m128 I16InvScale_m128 = _mm_set1_ps(I16InvScale);
 
-inline float getFadeGainToAmp(float g)
-{
-    // return std::cbrt(g);
-    // return 4.f / 3.f * (1 - 1 / ((1 + g) * (1 + g)));
-    return 2 * (1 - 1 / (1 + g));
-}
-inline float getFadeGain(int32_t samplePos, int32_t x1, int32_t x2)
-{
-    assert(x1 <= samplePos && samplePos <= x2);
-    auto gain = ((float)(x1 - samplePos)) / (x1 - x2);
-    return gain;
-}
-
 template <InterpolationTypes KT, typename T> struct KernelOp
 {
 };
@@ -153,6 +148,14 @@ template <> struct KernelOp<InterpolationTypes::Sinc, int16_t>
             KernelProcessor<InterpolationTypes::Sinc, int16_t, NUM_CHANNELS, LOOP_ACTIVE> &ks);
 };
 
+template <> struct KernelOp<InterpolationTypes::Sinc, PackedInt24>
+{
+    template <int NUM_CHANNELS, bool LOOP_ACTIVE>
+    static void
+    Process(GeneratorState *__restrict GD,
+            KernelProcessor<InterpolationTypes::Sinc, PackedInt24, NUM_CHANNELS, LOOP_ACTIVE> &ks);
+};
+
 template <InterpolationTypes KT, typename T, int NUM_CHANNELS, bool LOOP_ACTIVE>
 struct KernelProcessor
 {
@@ -179,6 +182,29 @@ float NormalizeSampleToF32(float val) { return val; }
 
 float NormalizeSampleToF32(int16_t val) { return val * I16InvScale2; }
 
+float NormalizeSampleToF32(PackedInt24 val) { return val.toInt32() * I24InvScale; }
+
+/*
+ * Unpack the 16 packed 24 bit samples of a sinc window into four float vectors (in
+ * int24 units). We load exactly the 48 bytes of the window, realign them so each
+ * vector starts on a sample, then shuffle each sample into the top three bytes of a
+ * 32 bit lane so an arithmetic shift does the sign extension.
+ */
+inline void UnpackI24x16(const PackedInt24 *__restrict src, __m128 out[4])
+{
+    const auto *p = (const uint8_t *)src;
+    const __m128i toHighBytes =
+        _mm_setr_epi8(-128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11);
+
+    auto a = _mm_loadu_si128((const __m128i *)p);
+    auto b = _mm_loadu_si128((const __m128i *)(p + 16));
+    auto c = _mm_loadu_si128((const __m128i *)(p + 32));
+
+    __m128i q[4]{a, _mm_alignr_epi8(b, a, 12), _mm_alignr_epi8(c, b, 8), _mm_srli_si128(c, 4)};
+    for (int k = 0; k < 4; ++k)
+        out[k] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_shuffle_epi8(q[k], toHighBytes), 8));
+}
+
 template <typename T>
 template <int NUM_CHANNELS, bool LOOP_ACTIVE>
 void KernelOp<InterpolationTypes::ZeroOrderHold, T>::Process(
@@ -523,23 +549,80 @@ void KernelOp<InterpolationTypes::Sinc, int16_t>::Process(
     }
 }
 
+template <int NUM_CHANNELS, bool LOOP_ACTIVE>
+void KernelOp<InterpolationTypes::Sinc, PackedInt24>::Process(
+    GeneratorState *__restrict GD,
+    KernelProcessor<InterpolationTypes::Sinc, PackedInt24, NUM_CHANNELS, LOOP_ACTIVE> &ks)
+{
+    auto m0{ks.m0};
+    auto i{ks.i};
+
+    // int24 path. Unpack to float then the same SSE FIR as the float32 path
+    __m128 lipol0, tmp[4];
+    lipol0 = _mm_setzero_ps();
+    lipol0 = _mm_cvtsi32_ss(lipol0, ks.SampleSubPos & 0xffff);
+    lipol0 = _mm_shuffle_ps(lipol0, lipol0, _MM_SHUFFLE(0, 0, 0, 0));
+    tmp[0] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&sincTable.SincOffsetF32[m0]), lipol0),
+                        *((__m128 *)&sincTable.SincTableF32[m0]));
+    tmp[1] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&sincTable.SincOffsetF32[m0 + 4]), lipol0),
+                        *((__m128 *)&sincTable.SincTableF32[m0 + 4]));
+    tmp[2] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&sincTable.SincOffsetF32[m0 + 8]), lipol0),
+                        *((__m128 *)&sincTable.SincTableF32[m0 + 8]));
+    tmp[3] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&sincTable.SincOffsetF32[m0 + 12]), lipol0),
+                        *((__m128 *)&sincTable.SincTableF32[m0 + 12]));
+
+    auto fir = [&tmp](const PackedInt24 *src) {
+        __m128 s4[4];
+        UnpackI24x16(src, s4);
+        auto r = _mm_mul_ps(tmp[0], s4[0]);
+        r = _mm_add_ps(r, _mm_mul_ps(tmp[1], s4[1]));
+        r = _mm_add_ps(r, _mm_mul_ps(tmp[2], s4[2]));
+        r = _mm_add_ps(r, _mm_mul_ps(tmp[3], s4[3]));
+        r = _mm_hadd_ps(r, r);
+        r = _mm_hadd_ps(r, r);
+        return _mm_cvtss_f32(r) * I24InvScale;
+    };
+
+    for (int c = 0; c < NUM_CHANNELS; ++c)
+        ks.Output[c][i] = fir(ks.ReadSample[c]);
+
+    if constexpr (LOOP_ACTIVE)
+    {
+        if (ks.fadeActive)
+        {
+            auto fadeGain(
+                getFadeGain(ks.SamplePos, GD->loopUpperBound - ks.loopFade, GD->loopUpperBound));
+            auto aOut = getFadeGainToAmp(1.f - fadeGain);
+            fadeGain = getFadeGainToAmp(fadeGain);
+
+            for (int c = 0; c < NUM_CHANNELS; ++c)
+                ks.Output[c][i] = ks.Output[c][i] * aOut + fir(ks.ReadFadeSample[c]) * fadeGain;
+        }
+    }
+}
+
 template <int compoundConfig>
 void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO);
 
-int toLoopValue(bool active, bool forward, bool whileGated, bool isFloat, bool isStereo)
+/*
+ * The compound config packs the four bool flags into the low bits and the sample
+ * format above them, so there are exactly 16 * numGeneratorSampleFormats generators.
+ */
+int toLoopValue(bool active, bool forward, bool whileGated, GeneratorSampleFormat format,
+                bool isStereo)
 {
-    return ((isStereo * 1) << 4) + ((isFloat * 1) << 3) + ((active * 1) << 2) +
+    return ((int)format << 4) + ((isStereo * 1) << 3) + ((active * 1) << 2) +
            ((forward * 1) << 1) + (whileGated * 1);
 }
 
-constexpr std::array<bool, 5> fromLoopValue(int lv)
+constexpr std::array<int, 5> fromLoopValue(int lv)
 {
     bool whileGated = (lv & (1 << 0));
     bool forward = (lv & (1 << 1));
     bool active = (lv & (1 << 2));
-    bool isfl = (lv & (1 << 3));
-    bool stereo = (lv & (1 << 4));
-    return {active, forward, whileGated, isfl, stereo};
+    bool stereo = (lv & (1 << 3));
+    int format = lv >> 4;
+    return {active, forward, whileGated, format, stereo};
 }
 
 namespace detail
@@ -554,23 +637,27 @@ template <size_t... Is> auto generatorGet(size_t ft, std::index_sequence<Is...>)
 }
 } // namespace detail
 
-GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, bool loopActive, bool loopForward,
-                                     bool loopWhileGated)
+GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, GeneratorSampleFormat format, bool loopActive,
+                                     bool loopForward, bool loopWhileGated)
 {
-    auto loopValue = toLoopValue(loopActive, loopForward, loopWhileGated, Float, Stereo);
-    assert(loopValue >= 0 && loopValue < (1 << 5));
-    return detail::generatorGet(loopValue, std::make_index_sequence<(1 << 5)>());
+    static constexpr size_t numGenerators{16 * numGeneratorSampleFormats};
+    auto loopValue = toLoopValue(loopActive, loopForward, loopWhileGated, format, Stereo);
+    assert(loopValue >= 0 && loopValue < numGenerators);
+    return detail::generatorGet(loopValue, std::make_index_sequence<numGenerators>());
 }
 
 template <int loopValue>
 void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
 {
     static constexpr auto mode = fromLoopValue(loopValue);
-    static constexpr auto loopActive = std::get<0>(mode);
-    static constexpr auto loopForward = std::get<1>(mode);
-    static constexpr auto loopWhileGated = std::get<2>(mode);
-    static constexpr auto fp = std::get<3>(mode);
-    static constexpr auto stereo = std::get<4>(mode);
+    static constexpr bool loopActive = std::get<0>(mode);
+    static constexpr bool loopForward = std::get<1>(mode);
+    static constexpr bool loopWhileGated = std::get<2>(mode);
+    static constexpr auto format = (GeneratorSampleFormat)std::get<3>(mode);
+    static constexpr bool stereo = std::get<4>(mode);
+
+    using sample_t = std::conditional_t<
+        format == SF_F32, float, std::conditional_t<format == SF_I24, PackedInt24, int16_t>>;
 
     int SamplePos = GD->samplePos;
     int SampleSubPos = GD->sampleSubPos;
@@ -581,10 +668,8 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
     int RatioSign = Ratio < 0 ? -1 : 1;
     Ratio = std::abs(Ratio);
     int Direction = GD->direction * RatioSign;
-    int16_t *__restrict SampleDataL;
-    int16_t *__restrict SampleDataR;
-    float *__restrict SampleDataFL;
-    float *__restrict SampleDataFR;
+    sample_t *__restrict SampleDataL;
+    sample_t *__restrict SampleDataR;
     float *__restrict OutputL;
     float *__restrict OutputR;
 
@@ -594,105 +679,86 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
     bool fadeActive =
         SamplePos > (GD->loopUpperBound - loopFade) && SamplePos <= GD->loopUpperBound;
 
+    // A gated loop which has been released plays on past the loop end, so not from the splice
+    const LoopSplice *splice{nullptr};
+    if constexpr (loopActive && loopForward)
+    {
+        if (IO->loopSplice && (!loopWhileGated || GD->gated) &&
+            IO->loopSplice->matches(GD->loopLowerBound, GD->loopUpperBound, loopFade))
+        {
+            splice = IO->loopSplice;
+            fadeActive = false;
+        }
+    }
+    const int32_t spliceFrom = splice ? splice->spliceFrom : std::numeric_limits<int32_t>::max();
+    sample_t *spliceL = splice ? (sample_t *)splice->data[0].get() : nullptr;
+    sample_t *spliceR = splice && stereo ? (sample_t *)splice->data[1].get() : nullptr;
+
     GD->positionWithinLoop = 0.f;
     GD->isInLoop = false;
 
-    if (fp)
-        SampleDataFL = (float *)IO->sampleDataL;
-    else
-        SampleDataL = (short *)IO->sampleDataL;
+    SampleDataL = (sample_t *)IO->sampleDataL;
     OutputL = IO->outputL;
     if (stereo)
     {
-        if (fp)
-            SampleDataFR = (float *)IO->sampleDataR;
-        SampleDataR = (short *)IO->sampleDataR;
+        SampleDataR = (sample_t *)IO->sampleDataR;
         OutputR = IO->outputR;
     }
 
     static constexpr int resampFIRSize{16};
-    int16_t *__restrict readSampleL = nullptr;
-    int16_t *__restrict readSampleR = nullptr;
-    int16_t *__restrict readFadeSampleL = nullptr;
-    int16_t *__restrict readFadeSampleR = nullptr;
-    int16_t loopEndBufferL[resampFIRSize], loopEndBufferR[resampFIRSize];
-    float *__restrict readSampleLF32 = nullptr;
-    float *__restrict readSampleRF32 = nullptr;
-    float *__restrict readFadeSampleLF32 = nullptr;
-    float *__restrict readFadeSampleRF32 = nullptr;
-    float loopEndBufferLF32[resampFIRSize], loopEndBufferRF32[resampFIRSize];
-
-    if (fp)
-    {
-        // See comment above - the generator wants an FIRoffset centered data set
-        readSampleLF32 = SampleDataFL + SamplePos - FIRoffset;
-        if (stereo)
-            readSampleRF32 = SampleDataFR + SamplePos - FIRoffset;
+    sample_t *__restrict readSampleL = nullptr;
+    sample_t *__restrict readSampleR = nullptr;
+    sample_t *__restrict readFadeSampleL = nullptr;
+    sample_t *__restrict readFadeSampleR = nullptr;
+    sample_t loopEndBufferL[resampFIRSize], loopEndBufferR[resampFIRSize];
+
+    // See comment above - the generator wants an FIRoffset centered data set
+    readSampleL = SampleDataL + SamplePos - FIRoffset;
+    if (stereo)
+        readSampleR = SampleDataR + SamplePos - FIRoffset;
 
-        if constexpr (loopActive)
+    if constexpr (loopActive)
+    {
+        if (fadeActive)
         {
-            if (fadeActive)
-            {
-                auto fadeSamplePos{GD->loopLowerBound - (GD->loopUpperBound - SamplePos)};
-                readFadeSampleLF32 = SampleDataFL + fadeSamplePos - FIRoffset;
-                if (stereo)
-                    readFadeSampleRF32 = SampleDataFR + fadeSamplePos - FIRoffset;
-            }
-
-            if (SamplePos >= WaveSize - resampFIRSize && SamplePos <= GD->loopUpperBound)
-            {
-                for (int k = 0; k < resampFIRSize; ++k)
-                {
-                    auto q = k + SamplePos - FIRoffset;
-                    if (q >= GD->loopUpperBound || q >= WaveSize)
-                        q -= LoopOffset;
-                    loopEndBufferLF32[k] = SampleDataFL[q];
-                    if (stereo)
-                        loopEndBufferRF32[k] = SampleDataFR[q];
-                }
-                readSampleLF32 = loopEndBufferLF32;
-                if (stereo)
-                    readSampleRF32 = loopEndBufferRF32;
-            }
+            auto fadeSamplePos{GD->loopLowerBound - (GD->loopUpperBound - SamplePos)};
+            readFadeSampleL = SampleDataL + fadeSamplePos - FIRoffset;
+            if (stereo)
+                readFadeSampleR = SampleDataR + fadeSamplePos - FIRoffset;
         }
-    }
-    else
-    {
-        readSampleL = SampleDataL + SamplePos - FIRoffset;
-        if (stereo)
-            readSampleR = SampleDataR + SamplePos - FIRoffset;
 
-        if constexpr (loopActive)
+        if (SamplePos >= spliceFrom && SamplePos <= GD->loopUpperBound)
         {
-            if (fadeActive)
-            {
-                auto fadeSamplePos{GD->loopLowerBound - (GD->loopUpperBound - SamplePos)};
-                readFadeSampleL = SampleDataL + fadeSamplePos - FIRoffset;
-                if (stereo)
-                    readFadeSampleR = SampleDataR + fadeSamplePos - FIRoffset;
-            }
-
-            if (SamplePos >= WaveSize - resampFIRSize && SamplePos <= GD->loopUpperBound)
+            readSampleL = spliceL + (SamplePos - spliceFrom);
+            if (stereo)
+                readSampleR = spliceR + (SamplePos - spliceFrom);
+        }
+        else if (SamplePos >= WaveSize - resampFIRSize && SamplePos <= GD->loopUpperBound)
+        {
+            for (int k = 0; k < resampFIRSize; ++k)
             {
-                for (int k = 0; k < resampFIRSize; ++k)
-                {
-                    auto q = k + SamplePos - FIRoffset;
-                    if (q >= GD->loopUpperBound || q >= WaveSize)
-                        q -= LoopOffset;
+                auto q = k + SamplePos - FIRoffset;
+                if (q >= GD->loopUpperBound || q >= WaveSize)
+                    q -= LoopOffset;
 
-                    loopEndBufferL[k] = SampleDataL[q];
-                    if (stereo)
-                        loopEndBufferR[k] = SampleDataR[q];
-                }
-                readSampleL = loopEndBufferL;
+                loopEndBufferL[k] = SampleDataL[q];
                 if (stereo)
-                    readSampleR = loopEndBufferR;
+                    loopEndBufferR[k] = SampleDataR[q];
             }
+            readSampleL = loopEndBufferL;
+            if (stereo)
+                readSampleR = loopEndBufferR;
         }
     }
 
     int NSamples = GD->blockSize;
 
+    // Stepping frame by frame every kernel just reads the frames out, so skip the sinc (this
+    // is what a voice reading an EngineRateRendition at its root key does)
+    auto interpolationType = GD->interpolationType;
+    if (Ratio == (1 << 24) && SampleSubPos == 0)
+        interpolationType = InterpolationTypes::ZeroOrderHold;
+
     int i{0};
     for (i = 0; i < NSamples && !IsFinished; i++)
     {
@@ -708,66 +774,50 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
         {fade},    fadeActive,   loopFade,    {OutputL}, IO};                                      \
     ks.ProcessKernel(GD);
 
-        using type_from_cond = typename std::conditional<fp, float, int16_t>::type;
-        type_from_cond *readL, *readFadeL, *readR, *readFadeR;
-        if constexpr (fp)
-        {
-            readL = readSampleLF32;
-            readR = readSampleRF32;
-            readFadeL = readFadeSampleLF32;
-            readFadeR = readFadeSampleRF32;
-        }
-        else
-        {
-            readL = readSampleL;
-            readR = readSampleR;
-            readFadeL = readFadeSampleL;
-            readFadeR = readFadeSampleR;
-        }
-
         // 2. Resample
         unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
         if (stereo)
         {
-            switch (GD->interpolationType)
+            switch (interpolationType)
             {
             case InterpolationTypes::Sinc:
             {
-                KPStereo(InterpolationTypes::Sinc, type_from_cond, 2, readL, readR, readFadeL,
-                         readFadeR);
+                KPStereo(InterpolationTypes::Sinc, sample_t, 2, readSampleL, readSampleR,
+                         readFadeSampleL, readFadeSampleR);
                 break;
             }
             case InterpolationTypes::Linear:
             {
-                KPStereo(InterpolationTypes::Linear, type_from_cond, 2, readL, readR, readFadeL,
-                         readFadeR);
+                KPStereo(InterpolationTypes::Linear, sample_t, 2, readSampleL, readSampleR,
+                         readFadeSampleL, readFadeSampleR);
                 break;
             }
             case InterpolationTypes::ZeroOrderHold:
             {
-                KPStereo(InterpolationTypes::ZeroOrderHold, type_from_cond, 2, readL, readR,
-                         readFadeL, readFadeR);
+                KPStereo(InterpolationTypes::ZeroOrderHold, sample_t, 2, readSampleL,
+                         readSampleR, readFadeSampleL, readFadeSampleR);
                 break;
             }
             }
         }
         else
         {
-            switch (GD->interpolationType)
+            switch (interpolationType)
             {
             case InterpolationTypes::Sinc:
             {
-                KPMono(InterpolationTypes::Sinc, type_from_cond, 1, readL, readFadeL);
+                KPMono(InterpolationTypes::Sinc, sample_t, 1, readSampleL, readFadeSampleL);
                 break;
             }
             case InterpolationTypes::Linear:
             {
-                KPMono(InterpolationTypes::Linear, type_from_cond, 1, readL, readFadeL);
+                KPMono(InterpolationTypes::Linear, sample_t, 1, readSampleL, readFadeSampleL);
                 break;
             }
             case InterpolationTypes::ZeroOrderHold:
             {
-                KPMono(InterpolationTypes::ZeroOrderHold, type_from_cond, 1, readL, readFadeL);
+                KPMono(InterpolationTypes::ZeroOrderHold, sample_t, 1, readSampleL,
+                       readFadeSampleL);
                 break;
             }
             }
@@ -818,18 +868,9 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
                     IsFinished = true;
             }
 
-            if constexpr (fp)
-            {
-                readSampleLF32 = SampleDataFL + SamplePos - FIRoffset;
-                if (stereo)
-                    readSampleRF32 = SampleDataFR + SamplePos - FIRoffset;
-            }
-            else
-            {
-                readSampleL = SampleDataL + SamplePos - FIRoffset;
-                if (stereo)
-                    readSampleR = SampleDataR + SamplePos - FIRoffset;
-            }
+            readSampleL = SampleDataL + SamplePos - FIRoffset;
+            if (stereo)
+                readSampleR = SampleDataR + SamplePos - FIRoffset;
         }
         else if constexpr (!loopWhileGated && loopForward)
         {
@@ -948,70 +989,41 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
 
         if constexpr (loopActive)
         {
-            if constexpr (fp)
+            if (SamplePos >= spliceFrom && SamplePos <= GD->loopUpperBound)
             {
-                if (SamplePos >= WaveSize - resampFIRSize && SamplePos <= GD->loopUpperBound)
-                {
-                    for (int k = 0; k < resampFIRSize; ++k)
-                    {
-                        auto q = k + SamplePos - FIRoffset;
-                        if (q >= GD->loopUpperBound || q >= WaveSize)
-                            q -= LoopOffset;
-                        loopEndBufferLF32[k] = SampleDataFL[q];
-                        if (stereo)
-                            loopEndBufferRF32[k] = SampleDataFR[q];
-                    }
-                    readSampleLF32 = loopEndBufferLF32;
-                    if (stereo)
-                        readSampleRF32 = loopEndBufferRF32;
-                }
-                else
+                readSampleL = spliceL + (SamplePos - spliceFrom);
+                if (stereo)
+                    readSampleR = spliceR + (SamplePos - spliceFrom);
+            }
+            // we need both checks because if we are just doing a post-release playdown
+            // we don't want to re-pad
+            else if (SamplePos >= WaveSize - resampFIRSize && SamplePos <= GD->loopUpperBound)
+            {
+                for (int k = 0; k < resampFIRSize; ++k)
                 {
-                    readSampleLF32 = SampleDataFL + SamplePos - FIRoffset;
+                    auto q = k + SamplePos - FIRoffset;
+                    if (q >= GD->loopUpperBound || q >= WaveSize)
+                        q -= LoopOffset;
+                    loopEndBufferL[k] = SampleDataL[q];
                     if (stereo)
-                        readSampleRF32 = SampleDataFR + SamplePos - FIRoffset;
-
-                    if (fadeActive)
-                    {
-                        auto fadeSamplePos{GD->loopLowerBound - (GD->loopUpperBound - SamplePos)};
-                        readFadeSampleLF32 = SampleDataFL + fadeSamplePos - FIRoffset;
-                        if (stereo)
-                            readFadeSampleRF32 = SampleDataFR + fadeSamplePos - FIRoffset;
-                    }
+                        loopEndBufferR[k] = SampleDataR[q];
                 }
+                readSampleL = loopEndBufferL;
+                if (stereo)
+                    readSampleR = loopEndBufferR;
             }
             else
             {
-                // we need both checks because if we are just doing a post-release playdown
-                // we don't want to re-pad
-                if (SamplePos >= WaveSize - resampFIRSize && SamplePos <= GD->loopUpperBound)
-                {
-                    for (int k = 0; k < resampFIRSize; ++k)
-                    {
-                        auto q = k + SamplePos - FIRoffset;
-                        if (q >= GD->loopUpperBound || q >= WaveSize)
-                            q -= LoopOffset;
-                        loopEndBufferL[k] = SampleDataL[q];
-                        if (stereo)
-                            loopEndBufferR[k] = SampleDataR[q];
-                    }
-                    readSampleL = loopEndBufferL;
-                    if (stereo)
-                        readSampleR = loopEndBufferR;
-                }
-                else
+                readSampleL = SampleDataL + SamplePos - FIRoffset;
+                if (stereo)
+                    readSampleR = SampleDataR + SamplePos - FIRoffset;
+
+                if (fadeActive)
                 {
-                    readSampleL = SampleDataL + SamplePos - FIRoffset;
+                    auto fadeSamplePos{GD->loopLowerBound - (GD->loopUpperBound - SamplePos)};
+                    readFadeSampleL = SampleDataL + fadeSamplePos - FIRoffset;
                     if (stereo)
-                        readSampleR = SampleDataR + SamplePos - FIRoffset;
-
-                    if (fadeActive)
-                    {
-                        auto fadeSamplePos{GD->loopLowerBound - (GD->loopUpperBound - SamplePos)};
-                        readFadeSampleL = SampleDataL + fadeSamplePos - FIRoffset;
-                        if (stereo)
-                            readFadeSampleR = SampleDataR + fadeSamplePos - FIRoffset;
-                    }
+                        readFadeSampleR = SampleDataR + fadeSamplePos - FIRoffset;
                 }
             }
         }
@@ -98,6 +98,8 @@ struct GeneratorState
     InterpolationTypes interpolationType{InterpolationTypes::Sinc};
 };
 
+struct LoopSplice;
+
 struct GeneratorIO
 {
     float *__restrict outputL{nullptr};
@@ -105,12 +107,26 @@ struct GeneratorIO
     void *__restrict sampleDataL{nullptr};
     void *__restrict sampleDataR{nullptr};
     int waveSize{0};
+    // If set, and it matches the loop in the state, forward loops read their end from here
+    const LoopSplice *loopSplice{nullptr};
+};
+
+/*
+ * The in-memory format of the sample data the generator reads. I24 data is
+ * an array of PackedInt24 (see packed_int24.h).
+ */
+enum GeneratorSampleFormat
+{
+    SF_I16 = 0,
+    SF_F32 = 1,
+    SF_I24 = 2,
+    numGeneratorSampleFormats
 };
 
 typedef void (*GeneratorFPtr)(GeneratorState *__restrict, GeneratorIO *__restrict);
 // TODO Loop Mode should be an enum
-GeneratorFPtr GetFPtrGeneratorSample(bool isStereo, bool isFloat, bool loopActive, bool loopForward,
-                                     bool loopWhileGated);
+GeneratorFPtr GetFPtrGeneratorSample(bool isStereo, GeneratorSampleFormat format, bool loopActive,
+                                     bool loopForward, bool loopWhileGated);
 
 } // namespace scxt::dsp
 #endif // SCXT_SRC_DSP_GENERATOR_H
@@ -0,0 +1,125 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+
+#include "loop_splice.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "packed_int24.h"
+#include "resampling.h"
+#include "sample_conversion.h"
+#include "infrastructure/resident_memory.h"
+
+namespace scxt::dsp
+{
+namespace
+{
+template <typename T>
+void splice(T *__restrict dst, const T *__restrict src, int32_t spliceFrom, int32_t lower,
+            int32_t upper, int32_t fade)
+{
+    auto loopLength = std::max(1, upper - lower);
+    auto fadeStart = upper - fade;
+    for (int32_t n = spliceFrom - FIRoffset; n <= upper + FIRoffset; ++n, ++dst)
+    {
+        if (n >= upper)
+        {
+            // past the loop point we are back at the start of the loop
+            auto m = n - loopLength;
+            while (m >= upper)
+                m -= loopLength;
+            *dst = src[m];
+        }
+        else if (n > fadeStart)
+        {
+            auto inGain = getFadeGain(n, fadeStart, upper);
+            auto outAmp = getFadeGainToAmp(1.f - inGain);
+            auto inAmp = getFadeGainToAmp(inGain);
+            *dst = sample_conversion::fromNativeFloat<T>(
+                sample_conversion::toNativeFloat(src[n]) * outAmp +
+                sample_conversion::toNativeFloat(src[n - loopLength]) * inAmp);
+        }
+        else
+        {
+            *dst = src[n];
+        }
+    }
+}
+} // namespace
+
+std::shared_ptr<const LoopSplice> LoopSplice::build(GeneratorSampleFormat format, int channels,
+                                                    void *const sampleData[2], int32_t waveSize,
+                                                    int32_t loopLowerBound,
+                                                    int32_t loopUpperBound, int32_t loopFade)
+{
+    if (channels < 1 || channels > 2 || loopLowerBound < 0 || loopUpperBound <= loopLowerBound ||
+        loopUpperBound > waveSize || loopFade < 0 || loopFade > loopUpperBound - loopLowerBound ||
+        loopFade > loopLowerBound)
+        return nullptr;
+
+    auto res = std::make_shared<LoopSplice>();
+    res->format = format;
+    res->channels = channels;
+    res->loopLowerBound = loopLowerBound;
+    res->loopUpperBound = loopUpperBound;
+    res->loopFade = loopFade;
+    res->spliceFrom = std::max(0, loopUpperBound - loopFade - (int32_t)FIRoffset);
+
+    size_t frames = loopUpperBound - res->spliceFrom + 2 * FIRoffset + 1;
+    size_t bps = format == SF_F32 ? sizeof(float)
+                 : format == SF_I24 ? sizeof(PackedInt24)
+                                    : sizeof(int16_t);
+    for (int c = 0; c < channels; ++c)
+    {
+        if (!sampleData[c])
+            return nullptr;
+        res->data[c] = infrastructure::ResidentMemory::instance().allocate(frames * bps);
+        if (!res->data[c])
+            return nullptr;
+
+        auto *d = res->data[c].get();
+        switch (format)
+        {
+        case SF_F32:
+            splice((float *)d, (const float *)sampleData[c], res->spliceFrom, loopLowerBound,
+                   loopUpperBound, loopFade);
+            break;
+        case SF_I24:
+            splice((PackedInt24 *)d, (const PackedInt24 *)sampleData[c], res->spliceFrom,
+                   loopLowerBound, loopUpperBound, loopFade);
+            break;
+        default:
+            splice((int16_t *)d, (const int16_t *)sampleData[c], res->spliceFrom,
+                   loopLowerBound, loopUpperBound, loopFade);
+            break;
+        }
+    }
+    return res;
+}
+} // namespace scxt::dsp
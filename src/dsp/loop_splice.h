@@ -0,0 +1,94 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_DSP_LOOP_SPLICE_H
+#define SCXT_SRC_DSP_LOOP_SPLICE_H
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+#include "generator.h"
+
+namespace scxt::dsp
+{
+/*
+ * The loop crossfade curve. getFadeGain is how far samplePos is through [x1, x2] and
+ * getFadeGainToAmp shapes that into the gain of the incoming side.
+ */
+inline float getFadeGainToAmp(float g)
+{
+    // return std::cbrt(g);
+    // return 4.f / 3.f * (1 - 1 / ((1 + g) * (1 + g)));
+    return 2 * (1 - 1 / (1 + g));
+}
+inline float getFadeGain(int32_t samplePos, int32_t x1, int32_t x2)
+{
+    assert(x1 <= samplePos && samplePos <= x2);
+    auto gain = ((float)(x1 - samplePos)) / (x1 - x2);
+    return gain;
+}
+
+/*
+ * A forward loop, pre-spliced. Rather than crossfading and building FIR-wide wraparound
+ * temporaries as it plays, a forward looping generator reads the end of the loop from
+ * here: the frames leading up to loopUpperBound with the crossfade into the loop start
+ * already mixed in, followed by the start of the loop, so every FIR window near the loop
+ * point is contiguous. The buffer is in the sample's own format.
+ *
+ * data[c] holds frames spliceFrom - FIRoffset to loopUpperBound + FIRoffset (inclusive),
+ * so for spliceFrom <= samplePos <= loopUpperBound the generator's FIRoffset centred
+ * read pointer is just data[c] + samplePos - spliceFrom.
+ *
+ * These are built on the serial thread (the zone keeps one per variant) and are
+ * immutable once built. loopFade is the effective fade, as the generator clamps it.
+ */
+struct LoopSplice
+{
+    GeneratorSampleFormat format{SF_F32};
+    int channels{1};
+    int32_t loopLowerBound{0}, loopUpperBound{0}, loopFade{0};
+    int32_t spliceFrom{0};
+    std::shared_ptr<void> data[2];
+
+    bool matches(int32_t lower, int32_t upper, int32_t fade) const
+    {
+        return loopLowerBound == lower && loopUpperBound == upper && loopFade == fade;
+    }
+
+    /*
+     * sampleData are the generator's pointers (the first frame, with FIRoffset pad
+     * frames either side). Returns nullptr if the loop doesn't fit in waveSize frames.
+     */
+    static std::shared_ptr<const LoopSplice> build(GeneratorSampleFormat format, int channels,
+                                                   void *const sampleData[2], int32_t waveSize,
+                                                   int32_t loopLowerBound, int32_t loopUpperBound,
+                                                   int32_t loopFade);
+};
+} // namespace scxt::dsp
+
+#endif // SCXT_SRC_DSP_LOOP_SPLICE_H
@@ -0,0 +1,61 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_DSP_PACKED_INT24_H
+#define SCXT_SRC_DSP_PACKED_INT24_H
+
+#include <cstdint>
+
+namespace scxt::dsp
+{
+/*
+ * A 24 bit sample stored as three little endian bytes with no padding, so an array
+ * of these is exactly the layout of a 24 bit PCM wav data chunk. We keep 24 bit
+ * sources in this form rather than widening them to float, which saves a quarter
+ * of the memory, and the generator unpacks them as it reads.
+ */
+struct PackedInt24
+{
+    uint8_t b[3];
+
+    int32_t toInt32() const
+    {
+        int32_t v = b[0] | (b[1] << 8) | (b[2] << 16);
+        return (v ^ 0x800000) - 0x800000;
+    }
+
+    static PackedInt24 fromInt32(int32_t v)
+    {
+        return {{(uint8_t)(v & 0xFF), (uint8_t)((v >> 8) & 0xFF), (uint8_t)((v >> 16) & 0xFF)}};
+    }
+};
+static_assert(sizeof(PackedInt24) == 3, "PackedInt24 must be tightly packed");
+
+static constexpr float I24InvScale = 1.f / 8388608.f;
+} // namespace scxt::dsp
+
+#endif // SCXT_SRC_DSP_PACKED_INT24_H
@@ -26,65 +26,290 @@
  */
 
 #include "sample_analytics.h"
-#include <limits>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
+#include <thread>
+
+#include "infrastructure/sse_include.h"
 
 namespace scxt::dsp::sample_analytics
 {
-float computePeak(const std::shared_ptr<sample::Sample> &s)
+namespace
+{
+static constexpr size_t analysisBlockSize{1024};
+
+/*
+ * Fill out with samples [start, start + n) of the channel in float, or return a pointer
+ * straight into the data for F32 samples where there is nothing to do.
+ */
+const float *channelBlockAsFloat(sample::Sample &s, int ch, size_t start, size_t n, float *out)
+{
+    switch (s.bitDepth)
+    {
+    case sample::Sample::BD_I16:
+    {
+        // 32767 rather than 32768 so full scale int16 reads as a peak of 1
+        static constexpr float scale{1.f / std::numeric_limits<int16_t>::max()};
+        const auto mscale = _mm_set1_ps(scale);
+        auto *d = s.GetSamplePtrI16(ch) + start;
+        size_t i{0};
+        for (; i + 8 <= n; i += 8)
+        {
+            auto x = _mm_loadu_si128((const __m128i *)(d + i));
+            auto lo = _mm_cvtepi16_epi32(x);
+            auto hi = _mm_cvtepi16_epi32(_mm_srli_si128(x, 8));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), mscale));
+            _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), mscale));
+        }
+        for (; i < n; ++i)
+            out[i] = d[i] * scale;
+        return out;
+    }
+    case sample::Sample::BD_I24:
+    {
+        auto *d = s.GetSamplePtrI24(ch) + start;
+        for (size_t i = 0; i < n; ++i)
+            out[i] = d[i].toInt32() * I24InvScale;
+        return out;
+    }
+    case sample::Sample::BD_F32:
+        return s.GetSamplePtrF32(ch) + start;
+    }
+    return out;
+}
+
+/*
+ * The BS.1770 K weighting pre-filter (a high shelf then a high pass), with the
+ * coefficients derived for the sample rate the same way libebur128 does.
+ */
+struct KWeighting
 {
-    float peak = 0.0f;
-    for (size_t i = 0; i < s->getSampleLength(); i++)
+    double b[2][3], a[2][3];
+    double z[2][2]{{0, 0}, {0, 0}};
+
+    explicit KWeighting(double sampleRate)
     {
-        for (int chan = 0; chan < s->channels; chan++)
+        double f0 = 1681.974450955533, G = 3.999843853973347, Q = 0.7071752369554196;
+        double K = std::tan(M_PI * f0 / sampleRate);
+        double Vh = std::pow(10.0, G / 20.0);
+        double Vb = std::pow(Vh, 0.4996667741545416);
+        double a0 = 1.0 + K / Q + K * K;
+        b[0][0] = (Vh + Vb * K / Q + K * K) / a0;
+        b[0][1] = 2.0 * (K * K - Vh) / a0;
+        b[0][2] = (Vh - Vb * K / Q + K * K) / a0;
+        a[0][1] = 2.0 * (K * K - 1.0) / a0;
+        a[0][2] = (1.0 - K / Q + K * K) / a0;
+
+        f0 = 38.13547087602444;
+        Q = 0.5003270373238773;
+        K = std::tan(M_PI * f0 / sampleRate);
+        a0 = 1.0 + K / Q + K * K;
+        b[1][0] = 1.0;
+        b[1][1] = -2.0;
+        b[1][2] = 1.0;
+        a[1][1] = 2.0 * (K * K - 1.0) / a0;
+        a[1][2] = (1.0 - K / Q + K * K) / a0;
+    }
+
+    inline double step(double x)
+    {
+        for (int s = 0; s < 2; ++s)
         {
-            float sample = 0.0;
-            switch (s->bitDepth)
+            auto y = b[s][0] * x + z[s][0];
+            z[s][0] = b[s][1] * x - a[s][1] * y + z[s][1];
+            z[s][1] = b[s][2] * x - a[s][2] * y;
+            x = y;
+        }
+        return x;
+    }
+};
+
+double gatedLoudness(const std::vector<double> &subBlockEnergy, size_t subBlockSize,
+                     size_t totalFrames)
+{
+    static constexpr double absoluteGate{-70.0};
+    auto loudness = [](double z) { return -0.691 + 10.0 * std::log10(std::max(z, 1e-20)); };
+
+    // 400ms blocks overlapping by 75% are four consecutive 100ms sub blocks. Anything
+    // shorter than one block is measured as a single block.
+    std::vector<double> z;
+    auto fullSubBlocks = totalFrames / subBlockSize;
+    for (size_t j = 0; j + 4 <= fullSubBlocks; ++j)
+    {
+        auto e = subBlockEnergy[j] + subBlockEnergy[j + 1] + subBlockEnergy[j + 2] +
+                 subBlockEnergy[j + 3];
+        z.push_back(e / (4.0 * subBlockSize));
+    }
+    if (z.empty() && totalFrames > 0)
+    {
+        double e{0};
+        for (auto v : subBlockEnergy)
+            e += v;
+        z.push_back(e / totalFrames);
+    }
+
+    auto gatedMean = [&z, &loudness](double gate) {
+        double sum{0};
+        size_t n{0};
+        for (auto v : z)
+        {
+            if (loudness(v) > gate)
             {
-            case sample::Sample::BD_I16:
-                sample = static_cast<float>(s->GetSamplePtrI16(chan)[i]) /
-                         std::numeric_limits<int16_t>::max();
-                break;
-            case sample::Sample::BD_F32:
-                sample = s->GetSamplePtrF32(chan)[i];
-                break;
+                sum += v;
+                n++;
             }
-            peak = std::max(peak, std::abs(sample));
         }
-    }
-    return peak;
+        return n ? sum / n : 0.0;
+    };
+
+    auto absMean = gatedMean(absoluteGate);
+    if (absMean <= 0)
+        return absoluteGate;
+    auto relMean = gatedMean(loudness(absMean) - 10.0);
+    if (relMean <= 0)
+        return absoluteGate;
+    return std::max(loudness(relMean), absoluteGate);
 }
+} // namespace
 
-float computeRMS(const std::shared_ptr<sample::Sample> &s)
+sample::Sample::Analytics computeAnalytics(sample::Sample &s)
 {
-    float ms = 0.0f;
-    const float divisor_recip =
-        1.0f / (static_cast<float>(s->channels) * static_cast<float>(s->getSampleLength()));
-    for (size_t i = 0; i < s->getSampleLength(); i++)
+    sample::Sample::Analytics res;
+    size_t len = s.playableLength(); // just the resident part if the sample is evicted
+    if (len == 0 || s.channels == 0 || !s.sampleData[0])
+        return res;
+
+    const auto signMask = _mm_set1_ps(-0.f);
+    alignas(16) float scratch[analysisBlockSize];
+
+    // The K weighting filter isn't defined below a few kHz; hand built samples which never
+    // set a rate just don't get a loudness
+    bool measureLoudness = s.sample_rate >= 8000;
+    auto subBlockSize = std::max((size_t)1, (size_t)s.sample_rate / 10);
+    std::vector<double> subBlockEnergy((len + subBlockSize - 1) / subBlockSize, 0.0);
+
+    float peak{0.f};
+    double sum{0.}, sumSq{0.};
+    for (int ch = 0; ch < s.channels; ++ch)
     {
-        for (int chan = 0; chan < s->channels; chan++)
+        KWeighting kw(s.sample_rate);
+        for (size_t start = 0; start < len; start += analysisBlockSize)
         {
-            float sample = 0.0;
-            switch (s->bitDepth)
+            auto n = std::min(analysisBlockSize, len - start);
+            auto *d = channelBlockAsFloat(s, ch, start, n, scratch);
+
+            auto mPeak = _mm_setzero_ps();
+            auto mSum = _mm_setzero_ps();
+            auto mSumSq = _mm_setzero_ps();
+            size_t i{0};
+            for (; i + 4 <= n; i += 4)
             {
-            case sample::Sample::BD_I16:
-                sample = static_cast<float>(s->GetSamplePtrI16(chan)[i]) /
-                         std::numeric_limits<int16_t>::max();
-                break;
-            case sample::Sample::BD_F32:
-                sample = s->GetSamplePtrF32(chan)[i];
-                break;
+                auto x = _mm_loadu_ps(d + i);
+                mPeak = _mm_max_ps(mPeak, _mm_andnot_ps(signMask, x));
+                mSum = _mm_add_ps(mSum, x);
+                mSumSq = _mm_add_ps(mSumSq, _mm_mul_ps(x, x));
+            }
+            alignas(16) float p[4], su[4], sq[4];
+            _mm_store_ps(p, mPeak);
+            _mm_store_ps(su, mSum);
+            _mm_store_ps(sq, mSumSq);
+            double blockSum = (su[0] + su[1]) + (su[2] + su[3]);
+            double blockSumSq = (sq[0] + sq[1]) + (sq[2] + sq[3]);
+            peak = std::max({peak, p[0], p[1], p[2], p[3]});
+            for (; i < n; ++i)
+            {
+                peak = std::max(peak, std::fabs(d[i]));
+                blockSum += d[i];
+                blockSumSq += d[i] * d[i];
+            }
+            sum += blockSum;
+            sumSq += blockSumSq;
+
+            // The K weighting recursion can't be vectorised along time, but the block
+            // is in cache from the pass above
+            for (i = 0; measureLoudness && i < n; ++i)
+            {
+                auto y = kw.step(d[i]);
+                subBlockEnergy[(start + i) / subBlockSize] += y * y;
             }
-            ms += std::pow(sample, 2.0f) * divisor_recip;
         }
     }
 
-    if (s->getSampleLength() > 0)
+    auto count = (double)len * s.channels;
+    res.peak = peak;
+    res.rms = (float)std::sqrt(sumSq / count);
+    res.dcOffset = (float)(sum / count);
+    if (measureLoudness)
+        res.integratedLoudness = (float)gatedLoudness(subBlockEnergy, subBlockSize, len);
+    return res;
+}
+
+sample::Sample::Analytics getAnalytics(sample::Sample &s)
+{
+    auto cached = s.getCachedAnalytics();
+    if (cached)
+        return *cached;
+    // the data is mid swap; eviction analyses first so this is very unlikely
+    if (s.dataSwapInFlight)
+        return {};
+
+    auto res = computeAnalytics(s);
+    // An evicted sample only has its preload to measure, so don't keep that as the answer
+    if (!s.isEvicted())
+        s.setCachedAnalytics(std::make_shared<const sample::Sample::Analytics>(res));
+    return res;
+}
+
+void analyseSamples(const std::vector<std::shared_ptr<sample::Sample>> &samples,
+                    size_t maxThreads)
+{
+    std::vector<sample::Sample *> todo;
+    for (const auto &s : samples)
+    {
+        if (s && !s->getCachedAnalytics() &&
+            std::find(todo.begin(), todo.end(), s.get()) == todo.end())
+            todo.push_back(s.get());
+    }
+    if (todo.empty())
+        return;
+
+    if (maxThreads == 0)
+        maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    auto nThreads = std::min(maxThreads, todo.size());
+
+    std::atomic<size_t> next{0};
+    auto worker = [&todo, &next]() {
+        for (auto i = next++; i < todo.size(); i = next++)
+            getAnalytics(*todo[i]);
+    };
+
+    if (nThreads == 1)
     {
-        return std::sqrt(ms);
+        worker();
+        return;
     }
 
-    // What should the RMS of an empty sample be?
-    return 0.0f;
+    std::vector<std::thread> workers;
+    workers.reserve(nThreads);
+    for (size_t t = 0; t < nThreads; ++t)
+        workers.emplace_back(worker);
+    for (auto &w : workers)
+        w.join();
+}
+
+float computePeak(const std::shared_ptr<sample::Sample> &s) { return getAnalytics(*s).peak; }
+
+float computeRMS(const std::shared_ptr<sample::Sample> &s) { return getAnalytics(*s).rms; }
+
+float computeDCOffset(const std::shared_ptr<sample::Sample> &s)
+{
+    return getAnalytics(*s).dcOffset;
+}
+
+float computeIntegratedLoudness(const std::shared_ptr<sample::Sample> &s)
+{
+    return getAnalytics(*s).integratedLoudness;
 }
 } // namespace scxt::dsp::sample_analytics
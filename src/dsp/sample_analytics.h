@@ -28,12 +28,30 @@
 #define SCXT_SRC_DSP_SAMPLE_ANALYTICS_H
 
 #include <memory>
+#include <vector>
 #include <sample/sample.h>
 
 namespace scxt::dsp::sample_analytics
 {
+/*
+ * Sample analytics are computed in a single SIMD pass over the data and cached on the
+ * sample, so after the first request (or an analyseSamples batch) these are all just
+ * reads. Loading doesn't analyse; the SampleManager only forces it before an eviction.
+ */
+sample::Sample::Analytics computeAnalytics(sample::Sample &s); // always does the pass
+sample::Sample::Analytics getAnalytics(sample::Sample &s);     // cached
+
+/*
+ * Analyse every sample in the batch which doesn't already have analytics, across a pool
+ * of up to maxThreads workers (0 for one per core). Returns once they are all done.
+ */
+void analyseSamples(const std::vector<std::shared_ptr<sample::Sample>> &samples,
+                    size_t maxThreads = 0);
+
 float computePeak(const std::shared_ptr<sample::Sample> &s);
 float computeRMS(const std::shared_ptr<sample::Sample> &s);
+float computeDCOffset(const std::shared_ptr<sample::Sample> &s);
+float computeIntegratedLoudness(const std::shared_ptr<sample::Sample> &s);
 }; // namespace scxt::dsp::sample_analytics
 
-#endif // SCXT_SRC_DSP_SAMPLE_ANALYTICS_H
\ No newline at end of file
+#endif // SCXT_SRC_DSP_SAMPLE_ANALYTICS_H
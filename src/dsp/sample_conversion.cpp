@@ -0,0 +1,373 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "sample_conversion.h"
+
+#include <cstring>
+
+#include "infrastructure/sse_include.h"
+#include "sst/basic-blocks/mechanics/endian-ops.h"
+
+namespace scxt::dsp::sample_conversion
+{
+namespace mech = sst::basic_blocks::mechanics;
+
+namespace
+{
+inline const uint8_t *at(const void *src, size_t i, size_t stride)
+{
+    return (const uint8_t *)src + i * stride;
+}
+
+inline __m128i load(const uint8_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+
+/*
+ * The vector loops load whole registers, which can run a few bytes past the
+ * last sample of the channel (into the other channel or off the end of the data
+ * chunk), and the 24 bit ones store 4 bytes more than they convert. So stop the
+ * vector loop a few samples short and let the scalar loop finish up.
+ */
+static constexpr size_t tailGuard{4};
+inline bool vectorLoopOK(size_t i, size_t V, size_t n) { return i + V + tailGuard <= n; }
+
+static constexpr float I32InvScale{4.6566128730772E-10f};
+
+template <bool bigEndian>
+void i16ToI16Impl(const void *src, size_t srcStride, int16_t *dst, size_t n)
+{
+    auto swap16 = [](__m128i x) {
+        if constexpr (bigEndian)
+            return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        else
+            return x;
+    };
+
+    size_t i{0};
+    if (srcStride == 2)
+    {
+        for (; vectorLoopOK(i, 8, n); i += 8)
+            _mm_storeu_si128((__m128i *)(dst + i), swap16(load(at(src, i, 2))));
+    }
+    else if (srcStride == 4)
+    {
+        for (; vectorLoopOK(i, 8, n); i += 8)
+        {
+            // keep the first 16 bits of each frame, sign extended so the pack is exact
+            auto a = load(at(src, i, 4));
+            auto b = load(at(src, i + 4, 4));
+            a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+            _mm_storeu_si128((__m128i *)(dst + i), swap16(_mm_packs_epi32(a, b)));
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        int16_t v;
+        memcpy(&v, at(src, i, srcStride), sizeof(v));
+        if constexpr (bigEndian)
+            dst[i] = mech::endian_read_int16BE(v);
+        else
+            dst[i] = mech::endian_read_int16LE(v);
+    }
+}
+
+template <bool bigEndian>
+void i24ToI24Impl(const void *src, size_t srcStride, PackedInt24 *dst, size_t n)
+{
+    auto *d = (uint8_t *)dst;
+    size_t i{0};
+    if (srcStride == 3)
+    {
+        // only big endian gets here; four samples per load, byte reversed
+        const auto mono =
+            _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, -128, -128, -128, -128);
+        for (; vectorLoopOK(i, 4, n); i += 4)
+            _mm_storeu_si128((__m128i *)(d + 3 * i), _mm_shuffle_epi8(load(at(src, i, 3)), mono));
+    }
+    else if (srcStride == 6)
+    {
+        // two frames per load with our sample at bytes 0-2 and 6-8 of each
+        __m128i lo, hi;
+        if constexpr (bigEndian)
+        {
+            lo = _mm_setr_epi8(2, 1, 0, 8, 7, 6, -128, -128, -128, -128, -128, -128, -128, -128,
+                               -128, -128);
+            hi = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, 2, 1, 0, 8, 7, 6, -128, -128,
+                               -128, -128);
+        }
+        else
+        {
+            lo = _mm_setr_epi8(0, 1, 2, 6, 7, 8, -128, -128, -128, -128, -128, -128, -128, -128,
+                               -128, -128);
+            hi = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, 0, 1, 2, 6, 7, 8, -128, -128,
+                               -128, -128);
+        }
+        for (; vectorLoopOK(i, 4, n); i += 4)
+        {
+            auto a = _mm_shuffle_epi8(load(at(src, i, 6)), lo);
+            auto b = _mm_shuffle_epi8(load(at(src, i + 2, 6)), hi);
+            _mm_storeu_si128((__m128i *)(d + 3 * i), _mm_or_si128(a, b));
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        auto *s = at(src, i, srcStride);
+        if constexpr (bigEndian)
+        {
+            dst[i].b[0] = s[2];
+            dst[i].b[1] = s[1];
+            dst[i].b[2] = s[0];
+        }
+        else
+        {
+            memcpy(&dst[i], s, sizeof(PackedInt24));
+        }
+    }
+}
+
+template <bool bigEndian>
+void i32ToF32Impl(const void *src, size_t srcStride, float *dst, size_t n)
+{
+    const auto scale = _mm_set1_ps(I32InvScale);
+    const auto bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    auto cvt = [&](__m128i x) {
+        if constexpr (bigEndian)
+            x = _mm_shuffle_epi8(x, bswap);
+        return _mm_mul_ps(_mm_cvtepi32_ps(x), scale);
+    };
+
+    size_t i{0};
+    if (srcStride == 4)
+    {
+#if defined(__AVX2__)
+        if constexpr (!bigEndian)
+        {
+            const auto scale8 = _mm256_set1_ps(I32InvScale);
+            for (; vectorLoopOK(i, 8, n); i += 8)
+            {
+                auto x = _mm256_loadu_si256((const __m256i *)at(src, i, 4));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale8));
+            }
+        }
+#endif
+        for (; vectorLoopOK(i, 4, n); i += 4)
+            _mm_storeu_ps(dst + i, cvt(load(at(src, i, 4))));
+    }
+    else if (srcStride == 8)
+    {
+        for (; vectorLoopOK(i, 4, n); i += 4)
+        {
+            // our samples are the even 32 bit lanes
+            auto a = _mm_castsi128_ps(load(at(src, i, 8)));
+            auto b = _mm_castsi128_ps(load(at(src, i + 2, 8)));
+            auto even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            _mm_storeu_ps(dst + i, cvt(_mm_castps_si128(even)));
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        int32_t v;
+        memcpy(&v, at(src, i, srcStride), sizeof(v));
+        if constexpr (bigEndian)
+            dst[i] = I32InvScale * (float)mech::endian_read_int32BE(v);
+        else
+            dst[i] = I32InvScale * (float)mech::endian_read_int32LE(v);
+    }
+}
+} // namespace
+
+void i8ToI16(const void *src, size_t srcStride, int16_t *dst, size_t n, bool isUnsigned)
+{
+    const auto flip = _mm_set1_epi8(isUnsigned ? (char)0x80 : 0);
+    size_t i{0};
+    if (srcStride == 1)
+    {
+        for (; vectorLoopOK(i, 16, n); i += 16)
+        {
+            // a byte in the top half of a 16 bit lane is the << 8
+            auto x = _mm_xor_si128(load(at(src, i, 1)), flip);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi8(_mm_setzero_si128(), x));
+            _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpackhi_epi8(_mm_setzero_si128(), x));
+        }
+    }
+    else if (srcStride == 2)
+    {
+        for (; vectorLoopOK(i, 8, n); i += 8)
+        {
+            auto x = _mm_xor_si128(load(at(src, i, 2)), flip);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_slli_epi16(x, 8));
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        auto v = *at(src, i, srcStride);
+        if (isUnsigned)
+            dst[i] = (int16_t)((v - 128) * 256);
+        else
+            dst[i] = (int16_t)((int8_t)v * 256);
+    }
+}
+
+void i16ToI16(const void *src, size_t srcStride, int16_t *dst, size_t n, bool bigEndian)
+{
+    if (srcStride == sizeof(int16_t) && !bigEndian)
+    {
+        memcpy(dst, src, n * sizeof(int16_t));
+        return;
+    }
+    if (bigEndian)
+        i16ToI16Impl<true>(src, srcStride, dst, n);
+    else
+        i16ToI16Impl<false>(src, srcStride, dst, n);
+}
+
+void i24ToI24(const void *src, size_t srcStride, PackedInt24 *dst, size_t n, bool bigEndian)
+{
+    if (srcStride == sizeof(PackedInt24) && !bigEndian)
+    {
+        // A mono LE source is already in our storage layout
+        memcpy(dst, src, n * sizeof(PackedInt24));
+        return;
+    }
+    if (bigEndian)
+        i24ToI24Impl<true>(src, srcStride, dst, n);
+    else
+        i24ToI24Impl<false>(src, srcStride, dst, n);
+}
+
+void i32ToF32(const void *src, size_t srcStride, float *dst, size_t n, bool bigEndian)
+{
+    if (bigEndian)
+        i32ToF32Impl<true>(src, srcStride, dst, n);
+    else
+        i32ToF32Impl<false>(src, srcStride, dst, n);
+}
+
+void f32ToF32(const void *src, size_t srcStride, float *dst, size_t n)
+{
+    if (srcStride == sizeof(float))
+    {
+        memcpy(dst, src, n * sizeof(float));
+        return;
+    }
+
+    size_t i{0};
+    if (srcStride == 8)
+    {
+        for (; vectorLoopOK(i, 4, n); i += 4)
+        {
+            auto a = _mm_loadu_ps((const float *)at(src, i, 8));
+            auto b = _mm_loadu_ps((const float *)at(src, i + 2, 8));
+            _mm_storeu_ps(dst + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        }
+    }
+    for (; i < n; ++i)
+        memcpy(dst + i, at(src, i, srcStride), sizeof(float));
+}
+
+void f64ToF32(const void *src, size_t srcStride, float *dst, size_t n)
+{
+    auto loadpd = [src, srcStride](size_t i) {
+        return _mm_loadu_pd((const double *)at(src, i, srcStride));
+    };
+
+    size_t i{0};
+    if (srcStride == 8)
+    {
+#if defined(__AVX__)
+        for (; vectorLoopOK(i, 4, n); i += 4)
+            _mm_storeu_ps(dst + i,
+                          _mm256_cvtpd_ps(_mm256_loadu_pd((const double *)at(src, i, 8))));
+#endif
+        for (; vectorLoopOK(i, 4, n); i += 4)
+            _mm_storeu_ps(dst + i,
+                          _mm_movelh_ps(_mm_cvtpd_ps(loadpd(i)), _mm_cvtpd_ps(loadpd(i + 2))));
+    }
+    else if (srcStride == 16)
+    {
+        for (; vectorLoopOK(i, 4, n); i += 4)
+        {
+            // each load is one frame, so gather the low doubles pairwise
+            auto a = _mm_unpacklo_pd(loadpd(i), loadpd(i + 1));
+            auto b = _mm_unpacklo_pd(loadpd(i + 2), loadpd(i + 3));
+            _mm_storeu_ps(dst + i, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+        }
+    }
+    for (; i < n; ++i)
+    {
+        double v;
+        memcpy(&v, at(src, i, srcStride), sizeof(v));
+        dst[i] = (float)v;
+    }
+}
+
+void planarI32ToI16(const int32_t *src, int16_t *dst, size_t n)
+{
+    size_t i{0};
+    for (; vectorLoopOK(i, 8, n); i += 8)
+    {
+        auto a = _mm_loadu_si128((const __m128i *)(src + i));
+        auto b = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a, b));
+    }
+    for (; i < n; ++i)
+        dst[i] = (int16_t)src[i];
+}
+
+void planarI32ToI24(const int32_t *src, PackedInt24 *dst, size_t n)
+{
+    const auto low3 =
+        _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+    auto *d = (uint8_t *)dst;
+    size_t i{0};
+    for (; vectorLoopOK(i, 4, n); i += 4)
+    {
+        auto x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(d + 3 * i), _mm_shuffle_epi8(x, low3));
+    }
+    for (; i < n; ++i)
+        dst[i] = PackedInt24::fromInt32(src[i]);
+}
+
+void planarI32ToF32(const int32_t *src, float *dst, size_t n, int bitsPerSample)
+{
+    const float sc = 1.f / (float)(1ULL << (bitsPerSample - 1));
+    const auto scale = _mm_set1_ps(sc);
+    size_t i{0};
+    for (; vectorLoopOK(i, 4, n); i += 4)
+    {
+        auto x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+    for (; i < n; ++i)
+        dst[i] = src[i] * sc;
+}
+} // namespace scxt::dsp::sample_conversion
@@ -0,0 +1,85 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_DSP_SAMPLE_CONVERSION_H
+#define SCXT_SRC_DSP_SAMPLE_CONVERSION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "packed_int24.h"
+
+/*
+ * Deinterleave-and-convert kernels for the sample loaders. Each reads n samples
+ * of one channel from src, one every srcStride bytes (so the channel offset is
+ * in src and the frame size is the stride), and writes them densely to dst.
+ *
+ * Mono (stride == sample size) and stereo (stride == 2 * sample size) sources take
+ * the SSE path, any other stride falls back to a scalar loop. AVX2 variants are
+ * compiled in where the build target allows it.
+ */
+namespace scxt::dsp::sample_conversion
+{
+void i8ToI16(const void *src, size_t srcStride, int16_t *dst, size_t n, bool isUnsigned);
+void i16ToI16(const void *src, size_t srcStride, int16_t *dst, size_t n, bool bigEndian);
+void i24ToI24(const void *src, size_t srcStride, PackedInt24 *dst, size_t n, bool bigEndian);
+void i32ToF32(const void *src, size_t srcStride, float *dst, size_t n, bool bigEndian);
+void f32ToF32(const void *src, size_t srcStride, float *dst, size_t n);
+void f64ToF32(const void *src, size_t srcStride, float *dst, size_t n);
+
+/*
+ * FLAC hands us one already deinterleaved int32 buffer per channel with the
+ * sample in the low bits, so these are plain narrowing conversions.
+ */
+void planarI32ToI16(const int32_t *src, int16_t *dst, size_t n);
+void planarI32ToI24(const int32_t *src, PackedInt24 *dst, size_t n);
+void planarI32ToF32(const int32_t *src, float *dst, size_t n, int bitsPerSample);
+
+/*
+ * Data derived from a sample (loop splices, mipmaps, engine rate renditions) is worked
+ * out in float in the sample's own units, so an int16 of 1000 is 1000.f, and rounded
+ * back into the sample's format with clamping.
+ */
+inline float toNativeFloat(float v) { return v; }
+inline float toNativeFloat(int16_t v) { return v; }
+inline float toNativeFloat(PackedInt24 v) { return (float)v.toInt32(); }
+
+template <typename T> inline T fromNativeFloat(float v);
+template <> inline float fromNativeFloat<float>(float v) { return v; }
+template <> inline int16_t fromNativeFloat<int16_t>(float v)
+{
+    return (int16_t)std::clamp(std::lround(v), -32768L, 32767L);
+}
+template <> inline PackedInt24 fromNativeFloat<PackedInt24>(float v)
+{
+    return PackedInt24::fromInt32((int32_t)std::clamp(std::lround(v), -8388608L, 8388607L));
+}
+} // namespace scxt::dsp::sample_conversion
+
+#endif // SCXT_SRC_DSP_SAMPLE_CONVERSION_H
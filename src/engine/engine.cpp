@@ -40,7 +40,7 @@
 #include "sample/exs_support/exs_import.h"
 #include "sample/multisample_support/multisample_import.h"
 #include "infrastructure/user_defaults.h"
-#include "infrastructure/md5support.h"
+#include "infrastructure/resident_memory.h"
 #include "browser/browser.h"
 #include "browser/browser_db.h"
 
@@ -77,6 +77,7 @@ Engine::Engine()
     tuning::equalTuning.init();
 
     sampleManager = std::make_unique<sample::SampleManager>(messageController->threadingChecker);
+    previewStream = std::make_unique<sample::PreviewStream>();
     patch = std::make_unique<Patch>();
     patch->parentEngine = this;
 
@@ -101,6 +102,31 @@ Engine::Engine()
         [](auto em, auto t) { SCLOG("Defaults Parse Error :" << em << " " << t << std::endl); });
 
     browserDb = std::make_unique<browser::BrowserDB>(*tdp);
+    sampleManager->setIdentityCache(browserDb.get());
+    if (defaults->getUserDefaultValue(infrastructure::DefaultKeys::useFastSampleContentHash,
+                                      false))
+    {
+        sampleManager->contentHashKind = infrastructure::ContentHashKind::XXH3_128;
+    }
+    sampleManager->useSharedSampleStore = defaults->getUserDefaultValue(
+        infrastructure::DefaultKeys::shareSamplesAcrossInstances, false);
+    sampleManager->runOnAudioThread = [this](auto onAudio, auto thenOnSerial) {
+        messageController->scheduleAudioThreadCallback(
+            [onAudio](auto &) { onAudio(); }, [thenOnSerial](const auto &) { thenOnSerial(); });
+    };
+    if (defaults->getUserDefaultValue(infrastructure::DefaultKeys::lockSampleMemory, false))
+    {
+        // Process wide; samples loaded from here on are prefaulted and locked
+        infrastructure::ResidentMemory::instance().setEnabled(true);
+    }
+    sampleManager->renderAtEngineRate = defaults->getUserDefaultValue(
+        infrastructure::DefaultKeys::renderSamplesAtEngineRate, false);
+    auto budgetMB =
+        defaults->getUserDefaultValue(infrastructure::DefaultKeys::sampleMemoryBudgetMB, 0);
+    if (budgetMB > 0)
+    {
+        sampleManager->setMemoryBudget((uint64_t)budgetMB * 1024 * 1024);
+    }
     browser = std::make_unique<browser::Browser>(
         *browserDb, *defaults, useTDP,
         [this](const auto &a, const auto &b) { messageController->reportErrorToClient(a, b); });
@@ -144,6 +170,8 @@ Engine::~Engine()
             v = nullptr;
         }
     }
+    // A missing sample search posts back to the message controller, so stop it first
+    browser->stopMissingSampleSearch();
     messageController->stop();
     sampleManager->purgeUnreferencedSamples();
 
@@ -327,6 +355,10 @@ bool Engine::processAudio()
 
     getPatch()->process(*this);
 
+    // The browser preview goes straight to the main output, after the bus effects
+    previewStream->processBlockAdding(getPatch()->busses.mainBus.output[0],
+                                      getPatch()->busses.mainBus.output[1], blockSize);
+
     auto &bl = sharedUIMemoryState.busVULevels;
     const auto &bs = getPatch()->busses;
     for (int c = 0; c < 2; ++c)
@@ -371,7 +403,7 @@ bool Engine::processAudio()
                 itm.group = v->zonePath.group;
                 itm.zone = v->zonePath.zone;
                 itm.sample = v->sampleIndex;
-                itm.samplePos = v->GD.samplePos;
+                itm.samplePos = v->samplePosInSample();
                 itm.midiNote = v->originalMidiKey;
                 itm.midiChannel = v->channel;
                 itm.gated = v->isGated;
@@ -533,6 +565,7 @@ void Engine::loadSampleIntoZone(const fs::path &p, int16_t partID, int16_t group
                                  (Zone::SampleInformationRead)(Zone::LOOP | Zone::ENDPOINTS));
         },
         [p = partID, g = groupID, z = zoneID](auto &e) {
+            e.refreshLoopSplices({(size_t)p, (size_t)g, (size_t)z});
             e.getSelectionManager()->selectAction({p, g, z, true, true, true});
         });
 }
@@ -549,6 +582,7 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
         // TODO ok this refresh and restart is a bit unsatisfactory
         messageController->stopAudioThreadThenRunOnSerial([this, p](const auto &) {
             loadSf2MultiSampleIntoSelectedPart(p);
+            prepareAllLoopSplices();
             messageController->restartAudioThreadFromSerial();
             serializationSendToClient(messaging::client::s2c_send_pgz_structure,
                                       getPartGroupZoneStructure(), *messageController);
@@ -560,6 +594,7 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
         // TODO ok this refresh and restart is a bit unsatisfactory
         messageController->stopAudioThreadThenRunOnSerial([this, p](const auto &) {
             auto res = sfz_support::importSFZ(p, *this);
+            prepareAllLoopSplices();
             if (!res)
                 messageController->reportErrorToClient("SFZ Import Failed", "Dunno why");
             messageController->restartAudioThreadFromSerial();
@@ -573,6 +608,7 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
         // TODO ok this refresh and restart is a bit unsatisfactory
         messageController->stopAudioThreadThenRunOnSerial([this, p](const auto &) {
             auto res = exs_support::importEXS(p, *this);
+            prepareAllLoopSplices();
             if (!res)
                 messageController->reportErrorToClient("EXS Import Failed", "Dunno why");
             messageController->restartAudioThreadFromSerial();
@@ -585,6 +621,7 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
     {
         messageController->stopAudioThreadThenRunOnSerial([this, p](const auto &) {
             auto res = multisample_support::importMultisample(p, *this);
+            prepareAllLoopSplices();
             if (!res)
                 messageController->reportErrorToClient("SFZ Import Failed", "Dunno why");
             messageController->restartAudioThreadFromSerial();
@@ -615,6 +652,7 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
     zptr->mapping.velocityRange = vrange;
     zptr->mapping.rootKey = rootKey;
     zptr->attachToSample(*sampleManager);
+    zptr->prepareLoopSplices();
 
     // Drop into selected group logic goes here
     auto [sp, sg] = selectionManager->bestPartGroupForNewSample(*this);
@@ -637,6 +675,49 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
         });
 }
 
+void Engine::refreshLoopSplices(const pathToZone_t &path) const
+{
+    assert(messageController->threadingChecker.isSerialThread());
+
+    const auto &zone = zoneByPath(path);
+    if (!zone)
+        return;
+
+    // The audio thread swaps these in, leaving the old splices in here to be released
+    // along with the callback back on this thread
+    auto splices =
+        std::make_shared<std::array<std::shared_ptr<const dsp::LoopSplice>, maxVariantsPerZone>>();
+    for (int i = 0; i < maxVariantsPerZone; ++i)
+        (*splices)[i] = Zone::makeLoopSplice(zone->variantData.variants[i],
+                                             zone->samplePointers[i]);
+
+    messageController->scheduleAudioThreadCallback(
+        [p = path.part, g = path.group, z = path.zone, splices](auto &e) {
+            auto &zone = e.getPatch()->getPart(p)->getGroup(g)->getZone(z);
+            for (int i = 0; i < maxVariantsPerZone; ++i)
+            {
+                auto old = zone->loopSplices[i].get();
+                std::swap(zone->loopSplices[i], (*splices)[i]);
+                if (!old)
+                    continue;
+                // Voices mid loop on the old splice fall back to crossfading as they play
+                for (auto vp : zone->voiceWeakPointers)
+                {
+                    if (vp && vp->GDIO.loopSplice == old)
+                        vp->GDIO.loopSplice = nullptr;
+                }
+            }
+        });
+}
+
+void Engine::prepareAllLoopSplices()
+{
+    for (auto &part : *patch)
+        for (auto &group : *part)
+            for (auto &zone : *group)
+                zone->prepareLoopSplices();
+}
+
 void Engine::createEmptyZone(scxt::engine::KeyboardRange krange, scxt::engine::VelocityRange vrange)
 {
     assert(messageController->threadingChecker.isSerialThread());
@@ -703,7 +784,7 @@ void Engine::loadSf2MultiSampleIntoSelectedPart(const fs::path &p)
     {
         auto riff = std::make_unique<RIFF::File>(p.u8string());
         auto sf = std::make_unique<sf2::File>(riff.get());
-        auto md5 = infrastructure::createMD5SumFromFile(p);
+        auto md5 = sampleManager->contentHashForFile(p);
 
         auto pt = getSelectionManager()->selectedPart;
 
@@ -913,6 +994,9 @@ void Engine::loadSf2MultiSampleIntoSelectedPart(const fs::path &p)
 void Engine::onSampleRateChanged()
 {
     patch->setSampleRate(sampleRate);
+    previewStream->setEngineSampleRate(sampleRate);
+    // Renditions at the old rate are replaced as voices ask for them
+    sampleManager->engineSampleRate = sampleRate;
 
     messageController->forceStatusUpdate = true;
 }
@@ -1126,6 +1210,7 @@ void Engine::setMacro01ValueFromPlugin(int part, int index, float value01)
     assert(part >= 0 && part < scxt::numParts);
     assert(index >= 0 && index < scxt::macrosPerPart);
     getPatch()->getPart(part)->macros[index].setValue01(value01);
+    getPatch()->getPart(part)->markStreamDirty();
 
     scxt::messaging::audio::AudioToSerialization a2s;
     a2s.id = messaging::audio::a2s_macro_updated;
@@ -40,6 +40,7 @@
 
 #include "sample/sample.h"
 #include "sample/sample_manager.h"
+#include "sample/preview_stream.h"
 
 #include <filesystem>
 #include <memory>
@@ -89,6 +90,10 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
     const std::unique_ptr<Patch> &getPatch() const { return patch; }
     const std::unique_ptr<sample::SampleManager> &getSampleManager() const { return sampleManager; }
     const std::unique_ptr<browser::Browser> &getBrowser() const { return browser; }
+    const std::unique_ptr<sample::PreviewStream> &getPreviewStream() const
+    {
+        return previewStream;
+    }
 
     std::unique_ptr<infrastructure::DefaultsProvider> defaults;
 
@@ -417,6 +422,14 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
 
     void loadSf2MultiSampleIntoSelectedPart(const fs::path &);
 
+    /*
+     * Rebuild the loop splices for a live zone from its current variants. The build
+     * happens here on the serialization thread and the audio thread swaps them in.
+     * prepareAllLoopSplices is for when the audio thread is stopped, after an import.
+     */
+    void refreshLoopSplices(const pathToZone_t &) const;
+    void prepareAllLoopSplices();
+
     /*
      * OnRegister generate and send all the metdata the client needs
      */
@@ -532,6 +545,7 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
     std::unique_ptr<sample::SampleManager> sampleManager;
     std::unique_ptr<browser::BrowserDB> browserDb;
     std::unique_ptr<browser::Browser> browser;
+    std::unique_ptr<sample::PreviewStream> previewStream;
     std::array<voice::Voice *, maxVoices> voices;
     std::array<std::unique_ptr<voice::modulation::MatrixEndpoints>, maxVoices> allEndpoints;
     std::unique_ptr<uint8_t[]> voiceInPlaceBuffer{nullptr};
@@ -119,7 +119,12 @@ template <bool OS> void Group::processWithOS(scxt::engine::Engine &e)
 
     namespace blk = sst::basic_blocks::mechanics;
 
+    // A glide lands its value over a few blocks with no message left to mark the part, so
+    // mark it when it gets there
+    auto wasGliding = mUILag.active;
     mUILag.process();
+    if (wasGliding && !mUILag.active)
+        markStreamDirty();
 
     // TODO these memsets are probably gratuitous
     memset(output, 0, sizeof(output));
@@ -330,6 +335,8 @@ template <bool OS> void Group::processWithOS(scxt::engine::Engine &e)
         }
         else
         {
+            if (mUILag.active)
+                markStreamDirty();
             mUILag.instantlySnap();
             parentPart->removeActiveGroup();
             ringoutMax = 0;
@@ -397,6 +404,12 @@ void Group::removeActiveZone(engine::Zone *zwp)
     rescanWeakRefs++;
 }
 
+void Group::markStreamDirty()
+{
+    if (parentPart)
+        parentPart->markStreamDirty();
+}
+
 void Group::postZoneTraversalRemoveHandler()
 {
     /*
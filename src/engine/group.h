@@ -76,6 +76,9 @@ struct Group : MoveableOnly<Group>,
     std::string name{};
     Part *parentPart{nullptr};
 
+    // Forwards to the parent part, which is the granularity of the DAW stream cache
+    void markStreamDirty();
+
     struct GroupOutputInfo
     {
         float amplitude{1.f}, pan{0.f}, velocitySensitivity{0.6f};
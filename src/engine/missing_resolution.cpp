@@ -27,6 +27,7 @@
 
 #include "missing_resolution.h"
 #include "messaging/messaging.h"
+#include "browser/browser.h"
 
 namespace scxt::engine
 {
@@ -134,14 +135,14 @@ void resolveMultiFileMissingWorkItem(engine::Engine &e, const MissingResolutionW
                         std::optional<SampleID> nid;
                         if (isSF2)
                         {
-                            nid = e.getSampleManager()->loadSampleFromSF2(
-                                p, nullptr, v.sampleID.multiAddress[0], v.sampleID.multiAddress[1],
-                                v.sampleID.multiAddress[2]);
+                            const auto &ma = v.sampleID.getMultiAddress();
+                            nid = e.getSampleManager()->loadSampleFromSF2(p, nullptr, ma[0],
+                                                                          ma[1], ma[2]);
                         }
                         if (isMultiSample)
                         {
                             nid = e.getSampleManager()->loadSampleFromMultiSample(
-                                p, v.sampleID.multiAddress[2], mwi.missingID);
+                                p, v.sampleID.getMultiAddress()[2], mwi.missingID);
                         }
                         if (nid.has_value())
                         {
@@ -161,4 +162,49 @@ void resolveMultiFileMissingWorkItem(engine::Engine &e, const MissingResolutionW
     }
 }
 
+std::vector<browser::MissingSampleQuery>
+missingSampleQueriesFor(const engine::Engine &e, const std::vector<MissingResolutionWorkItem> &mwis)
+{
+    std::vector<browser::MissingSampleQuery> queries;
+    queries.reserve(mwis.size());
+    for (const auto &mwi : mwis)
+    {
+        auto smp = e.getSampleManager()->getSample(mwi.missingID);
+        queries.push_back({mwi.missingID.getMD5(), mwi.path.filename().u8string(),
+                           smp ? smp->fileSize : -1});
+    }
+    return queries;
+}
+
+int autoResolveMissingWorkItems(engine::Engine &e)
+{
+    auto mwis = collectMissingResolutionWorkItems(e);
+    if (mwis.empty())
+        return 0;
+
+    auto found = e.getBrowser()->findMissingSamples(missingSampleQueriesFor(e, mwis));
+    return applyMissingSampleResolutions(e, mwis, found);
+}
+
+int applyMissingSampleResolutions(engine::Engine &e,
+                                  const std::vector<MissingResolutionWorkItem> &mwis,
+                                  const std::vector<std::optional<fs::path>> &found)
+{
+    assert(found.size() == mwis.size());
+    int resolved{0};
+    for (size_t i = 0; i < mwis.size() && i < found.size(); ++i)
+    {
+        if (!found[i].has_value())
+            continue;
+
+        if (mwis[i].isMultiUsed)
+            resolveMultiFileMissingWorkItem(e, mwis[i], *found[i]);
+        else
+            resolveSingleFileMissingWorkItem(e, mwis[i], *found[i]);
+        resolved++;
+    }
+    SCLOG("Auto-resolved " << resolved << " of " << mwis.size() << " missing samples");
+    return resolved;
+}
+
 } // namespace scxt::engine
\ No newline at end of file
@@ -28,7 +28,9 @@
 #ifndef SCXT_SRC_ENGINE_MISSING_RESOLUTION_H
 #define SCXT_SRC_ENGINE_MISSING_RESOLUTION_H
 
+#include <optional>
 #include "selection/selection_manager.h"
+#include "browser/missing_sample_search.h"
 #include "engine.h"
 
 namespace scxt::engine
@@ -47,6 +49,22 @@ void resolveSingleFileMissingWorkItem(engine::Engine &e, const MissingResolution
 
 void resolveMultiFileMissingWorkItem(engine::Engine &e, const MissingResolutionWorkItem &mwi,
                                      const fs::path &p);
+
+/*
+ * Look for every missing sample in the browser database and device locations at once and
+ * resolve the ones we find. Returns how many work items were resolved. This runs the search
+ * inline; the auto resolve message instead runs it with Browser::findMissingSamplesInBackground
+ * and hands the result to applyMissingSampleResolutions on the serial thread.
+ */
+int autoResolveMissingWorkItems(engine::Engine &e);
+
+std::vector<browser::MissingSampleQuery>
+missingSampleQueriesFor(const engine::Engine &e, const std::vector<MissingResolutionWorkItem> &);
+
+// found[i] is where mwis[i] turned up, if anywhere. Returns how many were resolved.
+int applyMissingSampleResolutions(engine::Engine &e,
+                                  const std::vector<MissingResolutionWorkItem> &mwis,
+                                  const std::vector<std::optional<fs::path>> &found);
 } // namespace scxt::engine
 
 #endif // MISSING_RESOLUTION_H
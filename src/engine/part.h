@@ -27,6 +27,7 @@
 #ifndef SCXT_SRC_ENGINE_PART_H
 #define SCXT_SRC_ENGINE_PART_H
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <optional>
@@ -82,11 +83,12 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
     void process(Engine &onto);
 
     // TODO: editable name
-    std::string getName() const
+    std::string getName() const { return nameFor(configuration); }
+    static std::string nameFor(const PartConfiguration &c)
     {
-        return fmt::format("Part ch={}", (configuration.channel == PartConfiguration::omniChannel
+        return fmt::format("Part ch={}", (c.channel == PartConfiguration::omniChannel
                                               ? "OMNI"
-                                              : std::to_string(configuration.channel + 1)));
+                                              : std::to_string(c.channel + 1)));
     }
 
     // TODO: Multiple outputs
@@ -177,6 +179,14 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
 
     std::array<Macro, macrosPerPart> macros;
 
+    /**
+     * Anything which changes the streamed state of this part, its groups or its
+     * zones marks it dirty, so a DAW save can reuse the last serialized form of
+     * every part whose generation hasn't moved. Marks can come from the audio thread.
+     */
+    void markStreamDirty() { streamGeneration++; }
+    uint64_t getStreamGeneration() const { return streamGeneration; }
+
     // TODO: A group by ID which throws an SCXTError
     typedef std::vector<std::unique_ptr<Group>> groupContainer_t;
 
@@ -210,6 +220,7 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
 
   private:
     groupContainer_t groups;
+    std::atomic<uint64_t> streamGeneration{0};
 };
 } // namespace scxt::engine
 
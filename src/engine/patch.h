@@ -225,6 +225,12 @@ struct Patch : MoveableOnly<Patch>, SampleRateSupport
 
     const partContainer_t &getParts() const { return parts; }
 
+    void markAllPartsStreamDirty()
+    {
+        for (auto &p : parts)
+            p->markStreamDirty();
+    }
+
   private:
     partContainer_t parts;
 };
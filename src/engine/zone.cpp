@@ -60,7 +60,12 @@ template <bool OS> void Zone::processWithOS(scxt::engine::Engine &onto)
     // TODO these memsets are probably gratuitous
     memset(output, 0, sizeof(output));
 
+    // A glide lands its value over a few blocks with no message left to mark the part, so
+    // mark it when it gets there
+    auto wasGliding = mUILag.active;
     mUILag.process();
+    if (wasGliding && !mUILag.active)
+        markStreamDirty();
 
     std::array<voice::Voice *, maxVoices> toCleanUp;
     size_t cleanupIdx{0};
@@ -140,6 +145,8 @@ void Zone::removeVoice(voice::Voice *v)
             activeVoices--;
             if (activeVoices == 0)
             {
+                if (mUILag.active)
+                    markStreamDirty();
                 mUILag.instantlySnap();
                 parentGroup->removeActiveZone(this);
             }
@@ -209,6 +216,7 @@ void Zone::setupOnUnstream(const engine::Engine &e)
 
         attachToSample(*(e.getSampleManager()), i, Zone::NONE);
     }
+    prepareLoopSplices();
     for (int p = 0; p < processorCount; ++p)
     {
         setupProcessorControlDescriptions(p, processorStorage[p].type);
@@ -271,6 +279,49 @@ bool Zone::attachToSample(const sample::SampleManager &manager, int index, int s
     return samplePointers[index] != nullptr;
 }
 
+std::shared_ptr<const dsp::LoopSplice>
+Zone::makeLoopSplice(const SingleVariant &v, const std::shared_ptr<sample::Sample> &s)
+{
+    if (!s || s->isMissingPlaceholder || s->isEvicted() || !v.active || !v.loopActive ||
+        v.loopDirection != FORWARD_ONLY)
+        return nullptr;
+
+    auto format = dsp::SF_I16;
+    if (s->bitDepth == sample::Sample::BD_F32)
+        format = dsp::SF_F32;
+    else if (s->bitDepth == sample::Sample::BD_I24)
+        format = dsp::SF_I24;
+    void *data[2]{nullptr, nullptr};
+    for (int c = 0; c < std::min((int)s->channels, 2); ++c)
+    {
+        switch (format)
+        {
+        case dsp::SF_F32:
+            data[c] = s->GetSamplePtrF32(c);
+            break;
+        case dsp::SF_I24:
+            data[c] = s->GetSamplePtrI24(c);
+            break;
+        default:
+            data[c] = s->GetSamplePtrI16(c);
+            break;
+        }
+    }
+
+    // The same clamp the generator applies to the fade
+    int32_t lower = v.startLoop, upper = v.endLoop;
+    int32_t fade = std::min((int32_t)v.loopFade, lower - (int32_t)v.startSample);
+    fade = std::min(fade, upper - lower);
+    return dsp::LoopSplice::build(format, s->channels, data, s->playableLength(), lower, upper,
+                                  fade);
+}
+
+void Zone::prepareLoopSplices()
+{
+    for (int i = 0; i < maxVariantsPerZone; ++i)
+        loopSplices[i] = makeLoopSplice(variantData.variants[i], samplePointers[i]);
+}
+
 std::string Zone::toStringVariantPlaybackMode(const Zone::VariantPlaybackMode &p)
 {
     switch (p)
@@ -370,6 +421,12 @@ Zone::LoopDirection Zone::fromStringLoopDirection(const std::string &s)
 
 void Zone::onSampleRateChanged() { mUILag.setRate(120, blockSize, sampleRate); }
 
+void Zone::markStreamDirty()
+{
+    if (parentGroup)
+        parentGroup->markStreamDirty();
+}
+
 void Zone::terminateAllVoices()
 {
     std::array<voice::Voice *, maxVoices> toCleanUp{};
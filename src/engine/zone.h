@@ -44,6 +44,7 @@
 
 #include <fmt/core.h>
 #include "dsp/generator.h"
+#include "dsp/loop_splice.h"
 #include "bus.h"
 
 namespace scxt::voice
@@ -142,6 +143,17 @@ struct Zone : MoveableOnly<Zone>, HasGroupZoneProcessors<Zone>, SampleRateSuppor
     } variantData;
 
     std::array<std::shared_ptr<sample::Sample>, maxVariantsPerZone> samplePointers;
+
+    /*
+     * Pre-spliced loop ends (see dsp/loop_splice.h) for the variants with forward loops.
+     * They are built on the serial thread; a voice whose loop doesn't match its variant's
+     * splice just crossfades as it plays. prepareLoopSplices is for zones the audio thread
+     * can't see yet; live zones go through Engine::refreshLoopSplices.
+     */
+    std::array<std::shared_ptr<const dsp::LoopSplice>, maxVariantsPerZone> loopSplices;
+    static std::shared_ptr<const dsp::LoopSplice>
+    makeLoopSplice(const SingleVariant &, const std::shared_ptr<sample::Sample> &);
+    void prepareLoopSplices();
     int8_t sampleIndex{-1};
 
     int numAvail{0};
@@ -226,6 +238,9 @@ struct Zone : MoveableOnly<Zone>, HasGroupZoneProcessors<Zone>, SampleRateSuppor
 
     Group *parentGroup{nullptr};
 
+    // Forwards to the parent part, which is the granularity of the DAW stream cache
+    void markStreamDirty();
+
     bool isActive() { return activeVoices != 0; }
     uint32_t activeVoices{0};
     std::array<voice::Voice *, maxVoices> voiceWeakPointers;
@@ -0,0 +1,554 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "infrastructure/bulk_file_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+#if WINDOWS
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if LINUX && SCXT_USE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "utils.h"
+
+namespace scxt::infrastructure
+{
+namespace
+{
+using Result = BulkFileReader::Result;
+
+/*
+ * A file open for a whole-file read. The posix flavor uses pread so many of these
+ * can run on different threads without any seek state.
+ */
+#if WINDOWS
+struct OpenFile
+{
+    std::ifstream ifs;
+    size_t size{0};
+    bool isOpen{false};
+
+    OpenFile(const fs::path &p) : ifs(p, std::ios::binary | std::ios::ate)
+    {
+        if (!ifs.is_open())
+            return;
+        size = (size_t)ifs.tellg();
+        ifs.seekg(0);
+        isOpen = true;
+    }
+
+    bool readInto(uint8_t *dest)
+    {
+        ifs.read((char *)dest, size);
+        return (size_t)ifs.gcount() == size;
+    }
+};
+#else
+struct OpenFile
+{
+    int fd{-1};
+    size_t size{0};
+    bool isOpen{false};
+
+    OpenFile(const fs::path &p)
+    {
+        fd = open(p.u8string().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct stat sb;
+        if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode))
+            return;
+        size = (size_t)sb.st_size;
+        isOpen = true;
+#if LINUX
+        // We read front to back so let the kernel use its larger readahead window
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    ~OpenFile()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool readInto(uint8_t *dest)
+    {
+        size_t pos{0};
+        while (pos < size)
+        {
+            auto rd = pread(fd, dest + pos, size - pos, (off_t)pos);
+            if (rd < 0 && errno == EINTR)
+                continue;
+            if (rd <= 0)
+                return false;
+            pos += (size_t)rd;
+        }
+        return true;
+    }
+};
+#endif
+
+void adviseWillNeed(const fs::path &p)
+{
+#if LINUX
+    /*
+     * WILLNEED starts asynchronous readahead of the whole file into the page cache and
+     * returns, which is what lets us keep the device queue deep even though each
+     * worker is doing a simple blocking pread. The pages outlive the descriptor.
+     */
+    auto fd = open(p.u8string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+#endif
+}
+
+/*
+ * Reads the paths at the indices in todo, in that order. Positions (next, primed) are
+ * positions in todo rather than path indices so the io_uring path can hand us back an
+ * arbitrary set of files to finish.
+ */
+struct WorkerPipeline
+{
+    const std::vector<fs::path> &paths;
+    const std::vector<size_t> todo;
+    const BulkFileReader::Options &options;
+    const bool primeCache;
+
+    std::atomic<size_t> next{0}, primed{0};
+
+    std::mutex mutex;
+    std::condition_variable completedCV, budgetCV;
+    std::deque<Result> completed;
+    size_t bytesInFlight{0};
+    std::vector<size_t> reservedBytes;
+
+    WorkerPipeline(const std::vector<fs::path> &p, std::vector<size_t> t,
+                   const BulkFileReader::Options &o, bool prime)
+        : paths(p), todo(std::move(t)), options(o), primeCache(prime), reservedBytes(p.size(), 0)
+    {
+    }
+
+    void primeThrough(size_t target)
+    {
+        target = std::min(target, todo.size());
+        auto j = primed.load();
+        while (j < target)
+        {
+            if (primed.compare_exchange_weak(j, j + 1))
+            {
+                adviseWillNeed(paths[todo[j]]);
+                j++;
+            }
+        }
+    }
+
+    void reserve(size_t idx, size_t bytes)
+    {
+        std::unique_lock<std::mutex> g(mutex);
+        budgetCV.wait(g, [this, bytes]() {
+            return bytesInFlight == 0 || bytesInFlight + bytes <= options.maxBytesInFlight;
+        });
+        bytesInFlight += bytes;
+        reservedBytes[idx] = bytes;
+    }
+
+    void release(size_t idx)
+    {
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            bytesInFlight -= reservedBytes[idx];
+            reservedBytes[idx] = 0;
+        }
+        budgetCV.notify_all();
+    }
+
+    void worker()
+    {
+        while (true)
+        {
+            auto pos = next.fetch_add(1);
+            if (pos >= todo.size())
+                return;
+
+            if (primeCache)
+                primeThrough(pos + options.readaheadWindow);
+
+            auto i = todo[pos];
+            Result r;
+            r.index = i;
+            r.path = paths[i];
+            {
+                auto of = OpenFile(r.path);
+                if (of.isOpen)
+                {
+                    reserve(i, of.size);
+                    r.data.reset(new (std::nothrow) uint8_t[std::max(of.size, (size_t)1)]);
+                    if (r.data)
+                    {
+                        r.dataSize = of.size;
+                        r.isValid = of.readInto(r.data.get());
+                    }
+                }
+            }
+            if (!r.isValid)
+            {
+                r.data.reset();
+                r.dataSize = 0;
+            }
+
+            {
+                std::lock_guard<std::mutex> g(mutex);
+                completed.push_back(std::move(r));
+            }
+            completedCV.notify_one();
+        }
+    }
+
+    void run(const BulkFileReader::completion_t &onComplete)
+    {
+        if (todo.empty())
+            return;
+
+        auto remaining = todo.size();
+        auto nThreads = std::clamp(options.queueDepth, (size_t)1, (size_t)32);
+        nThreads = std::min(nThreads, remaining);
+
+        if (primeCache)
+            primeThrough(options.readaheadWindow);
+
+        std::vector<std::thread> workers;
+        workers.reserve(nThreads);
+        for (size_t t = 0; t < nThreads; ++t)
+            workers.emplace_back([this]() { worker(); });
+
+        for (size_t done = 0; done < remaining; ++done)
+        {
+            Result r;
+            {
+                std::unique_lock<std::mutex> g(mutex);
+                completedCV.wait(g, [this]() { return !completed.empty(); });
+                r = std::move(completed.front());
+                completed.pop_front();
+            }
+            onComplete(r);
+            // Once the callback is done with (or has taken) the buffer it no longer
+            // counts against what we are holding
+            release(r.index);
+        }
+
+        for (auto &w : workers)
+            w.join();
+    }
+};
+
+#if LINUX && SCXT_USE_LIBURING
+/*
+ * The io_uring path runs entirely on the calling thread: we keep up to queueDepth
+ * whole-file reads submitted, and as each completes either resubmit the remainder
+ * (for a short read) or hand it to the callback. It returns the indices of the paths
+ * it did not finish - everything if the ring can't be set up, whatever was in flight or
+ * not yet started if the ring fails under us, and any file whose read errored - so the
+ * worker path can read those. A problem with the ring never reports a file as unreadable.
+ */
+std::vector<size_t> readAllWithUring(const std::vector<fs::path> &paths,
+                                     const BulkFileReader::completion_t &onComplete,
+                                     const BulkFileReader::Options &options)
+{
+    std::vector<size_t> handBack;
+
+    struct InFlight
+    {
+        Result r;
+        int fd{-1};
+        size_t offset{0};
+    };
+
+    io_uring ring;
+    auto depth = (unsigned)std::clamp(options.queueDepth, (size_t)1, (size_t)4096);
+    if (io_uring_queue_init(depth, &ring, 0) < 0)
+    {
+        SCLOG("io_uring unavailable; falling back to readahead workers");
+        handBack.resize(paths.size());
+        std::iota(handBack.begin(), handBack.end(), 0);
+        return handBack;
+    }
+
+    // io_uring reads are limited to an unsigned length, so very large files go in pieces
+    static constexpr size_t maxChunk{1 << 30};
+
+    std::unordered_map<InFlight *, std::unique_ptr<InFlight>> live;
+    size_t nextPath{0}, bytesInFlight{0};
+    bool ringFailed{false};
+
+    // Reads we couldn't get a submission queue entry for, retried once a completion
+    // has made room
+    std::deque<InFlight *> unqueued;
+
+    auto queueChunk = [&](InFlight *f) {
+        auto *sqe = io_uring_get_sqe(&ring);
+        if (!sqe)
+        {
+            io_uring_submit(&ring);
+            sqe = io_uring_get_sqe(&ring);
+        }
+        if (!sqe)
+        {
+            unqueued.push_back(f);
+            return;
+        }
+        auto len = std::min(f->r.dataSize - f->offset, maxChunk);
+        io_uring_prep_read(sqe, f->fd, f->r.data.get() + f->offset, (unsigned)len, f->offset);
+        io_uring_sqe_set_data(sqe, f);
+    };
+
+    auto finish = [&](InFlight *f, bool ok) {
+        if (f->fd >= 0)
+            close(f->fd);
+        f->r.isValid = ok;
+        if (!ok)
+        {
+            f->r.data.reset();
+        }
+        bytesInFlight -= f->r.dataSize;
+        if (!ok)
+            f->r.dataSize = 0;
+        auto hold = std::move(live[f]);
+        live.erase(f);
+        onComplete(hold->r);
+    };
+
+    // Drop our read of f and let the workers read the file instead
+    auto giveBack = [&](InFlight *f) {
+        if (f->fd >= 0)
+            close(f->fd);
+        bytesInFlight -= f->r.dataSize;
+        handBack.push_back(f->r.index);
+        live.erase(f);
+    };
+
+    while (!ringFailed && (nextPath < paths.size() || !live.empty()))
+    {
+        while (nextPath < paths.size() && live.size() < depth)
+        {
+            auto f = std::make_unique<InFlight>();
+            f->r.index = nextPath;
+            f->r.path = paths[nextPath];
+
+            struct stat sb;
+            auto fd = open(f->r.path.u8string().c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0 || fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode))
+            {
+                if (fd >= 0)
+                    close(fd);
+                nextPath++;
+                onComplete(f->r);
+                continue;
+            }
+
+            auto sz = (size_t)sb.st_size;
+            if (!live.empty() && bytesInFlight + sz > options.maxBytesInFlight)
+            {
+                close(fd);
+                break;
+            }
+
+            f->fd = fd;
+            f->r.data.reset(new (std::nothrow) uint8_t[std::max(sz, (size_t)1)]);
+            if (!f->r.data)
+            {
+                close(fd);
+                nextPath++;
+                onComplete(f->r);
+                continue;
+            }
+            f->r.dataSize = sz;
+            bytesInFlight += sz;
+            nextPath++;
+
+            auto *fp = f.get();
+            live[fp] = std::move(f);
+            if (sz == 0)
+            {
+                finish(fp, true);
+                continue;
+            }
+            queueChunk(fp);
+        }
+
+        if (live.empty())
+            continue;
+
+        for (auto n = unqueued.size(); n > 0; --n)
+        {
+            auto *f = unqueued.front();
+            unqueued.pop_front();
+            queueChunk(f);
+        }
+        if (unqueued.size() == live.size())
+        {
+            // Nothing is actually in flight so there is no completion to wait for
+            ringFailed = true;
+            break;
+        }
+
+        if (io_uring_submit(&ring) < 0)
+        {
+            ringFailed = true;
+            break;
+        }
+
+        io_uring_cqe *cqe{nullptr};
+        auto wr = io_uring_wait_cqe(&ring, &cqe);
+        if (wr == -EINTR)
+            continue;
+        if (wr < 0)
+        {
+            ringFailed = true;
+            break;
+        }
+
+        auto *f = (InFlight *)io_uring_cqe_get_data(cqe);
+        auto res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+
+        if (res == -EINTR || res == -EAGAIN)
+        {
+            queueChunk(f);
+        }
+        else if (res < 0)
+        {
+            giveBack(f);
+        }
+        else if (res == 0)
+        {
+            // the file got shorter under us
+            finish(f, false);
+        }
+        else
+        {
+            f->offset += (size_t)res;
+            if (f->offset < f->r.dataSize)
+                queueChunk(f);
+            else
+                finish(f, true);
+        }
+    }
+
+    // Tearing the ring down cancels and reaps anything outstanding so after this the
+    // buffers in live are no longer being written to
+    io_uring_queue_exit(&ring);
+
+    if (ringFailed)
+    {
+        SCLOG("io_uring failed during bulk read; finishing with readahead workers");
+        while (!live.empty())
+            giveBack(live.begin()->first);
+        for (auto i = nextPath; i < paths.size(); ++i)
+            handBack.push_back(i);
+    }
+    if (!handBack.empty())
+        std::sort(handBack.begin(), handBack.end());
+    return handBack;
+}
+#endif
+} // namespace
+
+BulkFileReader::Backend BulkFileReader::backend()
+{
+#if LINUX && SCXT_USE_LIBURING
+    return IO_URING;
+#elif LINUX
+    return READAHEAD_WORKERS;
+#else
+    return PORTABLE_WORKERS;
+#endif
+}
+
+const char *BulkFileReader::backendName(Backend b)
+{
+    switch (b)
+    {
+    case IO_URING:
+        return "io_uring";
+    case READAHEAD_WORKERS:
+        return "readahead-workers";
+    case PORTABLE_WORKERS:
+        return "portable-workers";
+    }
+    return "unknown";
+}
+
+void BulkFileReader::readAll(const std::vector<fs::path> &paths, const completion_t &onComplete,
+                             const Options &options)
+{
+    if (paths.empty())
+        return;
+
+#if LINUX && SCXT_USE_LIBURING
+    auto todo = readAllWithUring(paths, onComplete, options);
+#else
+    std::vector<size_t> todo(paths.size());
+    std::iota(todo.begin(), todo.end(), 0);
+#endif
+
+    WorkerPipeline pipeline(paths, std::move(todo), options, backend() != PORTABLE_WORKERS);
+    pipeline.run(onComplete);
+}
+
+void BulkFileReader::evictFromPageCache(const fs::path &p)
+{
+#if LINUX
+    auto fd = open(p.u8string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#endif
+}
+
+} // namespace scxt::infrastructure
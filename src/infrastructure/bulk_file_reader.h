@@ -0,0 +1,110 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_INFRASTRUCTURE_BULK_FILE_READER_H
+#define SCXT_SRC_INFRASTRUCTURE_BULK_FILE_READER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "filesystem_import.h"
+
+namespace scxt::infrastructure
+{
+
+/**
+ * BulkFileReader reads a batch of whole files into memory with as many reads outstanding
+ * against the device as we can manage, rather than the one-file-at-a-time page faulting
+ * you get walking a FileMapView. The intent is that you hand it every file in a load
+ * batch (a session restore, a big drag and drop, an sfz import) and parse the buffers as
+ * they arrive.
+ *
+ * ```cpp
+ * BulkFileReader::readAll(paths, [](auto &r) {
+ *     if (r.isValid)
+ *         parse(r.path, r.data.get(), r.dataSize); // r.data is yours to keep or drop
+ * });
+ * ```
+ *
+ * The completion callback always runs on the thread which called readAll, in completion
+ * (not request) order; use Result::index to get back to the request. On linux we use
+ * io_uring if the build has liburing (SCXT_USE_LIBURING) and otherwise a pool of pread
+ * workers with posix_fadvise / readahead priming the page cache ahead of them. Other
+ * platforms get the worker pool with plain reads.
+ */
+struct BulkFileReader
+{
+    struct Result
+    {
+        size_t index{0};
+        fs::path path{};
+        std::unique_ptr<uint8_t[]> data{};
+        size_t dataSize{0};
+        bool isValid{false};
+    };
+    using completion_t = std::function<void(Result &)>;
+
+    struct Options
+    {
+        // How many reads we try to keep in flight at once
+        size_t queueDepth{64};
+        // Reads stall once this much data is read and not yet consumed by the callback.
+        // A single file larger than this is still read, just on its own.
+        size_t maxBytesInFlight{512 * 1024 * 1024};
+        // How many files beyond the current read position we ask the kernel to prefetch
+        // when we are using the readahead backend
+        size_t readaheadWindow{128};
+    };
+
+    enum Backend
+    {
+        IO_URING,
+        READAHEAD_WORKERS,
+        PORTABLE_WORKERS
+    };
+    static Backend backend();
+    static const char *backendName(Backend b);
+
+    static void readAll(const std::vector<fs::path> &paths, const completion_t &onComplete)
+    {
+        readAll(paths, onComplete, Options());
+    }
+    static void readAll(const std::vector<fs::path> &paths, const completion_t &onComplete,
+                        const Options &options);
+
+    /**
+     * Ask the OS to drop any cached pages for this file. This is here so benchmarks
+     * can compare backends from a cold cache; it is a no-op outside of linux and is
+     * advisory (dirty or mapped pages stay put) even there.
+     */
+    static void evictFromPageCache(const fs::path &p);
+};
+} // namespace scxt::infrastructure
+
+#endif // SCXT_SRC_INFRASTRUCTURE_BULK_FILE_READER_H
@@ -0,0 +1,83 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "content_hash.h"
+
+#include "file_map_view.h"
+#include "md5.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+namespace scxt::infrastructure
+{
+std::string contentHashKindName(ContentHashKind k)
+{
+    switch (k)
+    {
+    case ContentHashKind::MD5:
+        return "md5";
+    case ContentHashKind::XXH3_128:
+        return "xxh3-128";
+    }
+    return "unknown";
+}
+
+std::string createContentHash(ContentHashKind k, const void *data, size_t dataSize)
+{
+    switch (k)
+    {
+    case ContentHashKind::MD5:
+        return md5::MD5::Hash(data, dataSize);
+    case ContentHashKind::XXH3_128:
+    {
+        // canonical form is big endian high then low, matching xxhsum -H2 output
+        XXH128_canonical_t c;
+        XXH128_canonicalFromHash(&c, XXH3_128bits(data, dataSize));
+
+        static constexpr char hex[] = "0123456789abcdef";
+        std::string res(2 * sizeof(c.digest), '0');
+        for (size_t i = 0; i < sizeof(c.digest); ++i)
+        {
+            res[2 * i] = hex[c.digest[i] >> 4];
+            res[2 * i + 1] = hex[c.digest[i] & 0xF];
+        }
+        return res;
+    }
+    }
+    return {};
+}
+
+std::string createContentHashFromFile(ContentHashKind k, const fs::path &path)
+{
+    auto fmp = FileMapView(path);
+    if (!fmp.isMapped())
+        return {};
+
+    return createContentHash(k, fmp.data(), fmp.dataSize());
+}
+} // namespace scxt::infrastructure
@@ -0,0 +1,59 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_INFRASTRUCTURE_CONTENT_HASH_H
+#define SCXT_SRC_INFRASTRUCTURE_CONTENT_HASH_H
+
+#include <cstddef>
+#include <string>
+
+#include "filesystem_import.h"
+
+namespace scxt::infrastructure
+{
+/*
+ * Sample content identity is a 32 character hex string which fills the md5 slot in
+ * SampleID. Historically (and by default) it is an MD5. XXH3_128 is the 128 bit XXH3
+ * hash from libs/xxhash which runs many times faster than MD5 on large files; it is fine
+ * for telling sample files apart but offers no protection against deliberate collisions.
+ *
+ * The integer values here are stored in the browser database and in patches so don't
+ * renumber them. 1 was a pre-release home grown fast hash; don't reuse it.
+ */
+enum struct ContentHashKind : int
+{
+    MD5 = 0,
+    XXH3_128 = 2
+};
+
+std::string contentHashKindName(ContentHashKind k);
+
+std::string createContentHash(ContentHashKind k, const void *data, size_t dataSize);
+std::string createContentHashFromFile(ContentHashKind k, const fs::path &path);
+} // namespace scxt::infrastructure
+
+#endif // SCXT_SRC_INFRASTRUCTURE_CONTENT_HASH_H
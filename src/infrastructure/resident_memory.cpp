@@ -0,0 +1,221 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+
+#include "resident_memory.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#if WINDOWS
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "utils.h"
+
+namespace scxt::infrastructure
+{
+namespace
+{
+static constexpr size_t hugePageSize{2 * 1024 * 1024};
+
+size_t pageSize()
+{
+#if WINDOWS
+    return 4096;
+#else
+    static size_t ps = (size_t)sysconf(_SC_PAGESIZE);
+    return ps;
+#endif
+}
+
+void *alignedAlloc(size_t alignment, size_t bytes)
+{
+#if WINDOWS
+    return _aligned_malloc(bytes, alignment);
+#else
+    void *res{nullptr};
+    if (posix_memalign(&res, alignment, bytes) != 0)
+        return nullptr;
+    return res;
+#endif
+}
+
+void alignedFree(void *d)
+{
+#if WINDOWS
+    _aligned_free(d);
+#else
+    free(d);
+#endif
+}
+} // namespace
+
+ResidentMemory &ResidentMemory::instance()
+{
+    static ResidentMemory res;
+    return res;
+}
+
+void ResidentMemory::setEnabled(bool e)
+{
+    enabled = e;
+    if (e)
+        SCLOG("Keeping sample memory resident. " << describe());
+}
+
+std::shared_ptr<void> ResidentMemory::allocate(size_t bytes)
+{
+    if (!enabled)
+    {
+        auto d = malloc(bytes);
+        if (!d)
+            return {};
+        return std::shared_ptr<void>(d, free);
+    }
+
+    /*
+     * Whole pages only, so no two buffers share a page and unlocking one never unlocks
+     * its neighbour. Big buffers get huge page alignment so THP can back them.
+     */
+    auto ps = pageSize();
+    auto alignment = bytes >= hugePageSize ? hugePageSize : ps;
+    auto size = (bytes + ps - 1) / ps * ps;
+    auto d = (uint8_t *)alignedAlloc(alignment, size);
+    if (!d)
+        return {};
+
+#if LINUX
+    if (alignment == hugePageSize)
+        madvise(d, size, MADV_HUGEPAGE);
+#endif
+    // Writing faults the pages in now rather than on the audio thread's first read
+    for (size_t i = 0; i < size; i += ps)
+        d[i] = 0;
+
+    auto locked = lockPages(d, size);
+    (locked ? lockedBytes : unlockedBytes) += size;
+    return std::shared_ptr<void>(d, [this, size, locked](void *p) {
+        if (locked)
+            unlockPages(p, size);
+        (locked ? lockedBytes : unlockedBytes) -= size;
+        alignedFree(p);
+    });
+}
+
+std::shared_ptr<void> ResidentMemory::lockRange(const void *data, size_t bytes)
+{
+    if (!enabled || !data || bytes == 0)
+        return {};
+
+    auto ps = pageSize();
+    auto start = (const uint8_t *)((uintptr_t)data / ps * ps);
+    auto size = (size_t)((const uint8_t *)data + bytes - start);
+
+#if LINUX
+    madvise((void *)start, size, MADV_WILLNEED);
+#endif
+    auto locked = lockPages(start, size);
+    if (!locked)
+    {
+        // Read only memory, so read a byte a page to fault it in
+        uint8_t sum{0};
+        for (size_t i = 0; i < size; i += ps)
+            sum += ((volatile const uint8_t *)start)[i];
+        (void)sum;
+    }
+    (locked ? lockedBytes : unlockedBytes) += size;
+
+    return std::shared_ptr<void>((void *)start, [this, size, locked](void *p) {
+        if (locked)
+            unlockPages(p, size);
+        (locked ? lockedBytes : unlockedBytes) -= size;
+    });
+}
+
+bool ResidentMemory::lockPages(const void *data, size_t bytes)
+{
+#if LINUX
+    auto limit = report().lockLimit;
+    if (limit > 0 && lockedBytes + bytes > limit)
+    {
+        if (!warnedAboutLimit.exchange(true))
+            SCLOG("Sample memory lock limit reached; further samples are prefaulted but not "
+                  "locked. "
+                  << describe());
+        return false;
+    }
+    if (mlock(data, bytes) != 0)
+    {
+        if (!warnedAboutLimit.exchange(true))
+            SCLOG("mlock refused; further samples are prefaulted but not locked. "
+                  << describe());
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ResidentMemory::unlockPages(const void *data, size_t bytes)
+{
+#if LINUX
+    munlock(data, bytes);
+#endif
+}
+
+ResidentMemory::Report ResidentMemory::report() const
+{
+    Report res;
+    res.lockedBytes = lockedBytes;
+    res.unlockedBytes = unlockedBytes;
+#if LINUX
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_MEMLOCK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+        res.lockLimit = rl.rlim_cur;
+#endif
+    return res;
+}
+
+std::string ResidentMemory::describe() const
+{
+    auto r = report();
+    std::ostringstream oss;
+    oss << "locked=" << r.lockedBytes << " prefaulted-unlocked=" << r.unlockedBytes
+        << " limit=";
+    if (r.lockLimit)
+        oss << r.lockLimit;
+    else
+        oss << "unlimited";
+    return oss.str();
+}
+} // namespace scxt::infrastructure
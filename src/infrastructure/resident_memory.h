@@ -0,0 +1,92 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_INFRASTRUCTURE_RESIDENT_MEMORY_H
+#define SCXT_SRC_INFRASTRUCTURE_RESIDENT_MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace scxt::infrastructure
+{
+/*
+ * Keeps sample memory resident so the audio thread never takes a page fault (or worse,
+ * waits on the disk) the first time a cold region plays. It is process wide and off by
+ * default; engines turn it on from the lockSampleMemory user default.
+ *
+ * When enabled, buffers from allocate() are aligned so the large ones can be backed by
+ * transparent huge pages, touched page by page so they fault in at allocation, and
+ * mlock'ed. lockRange() does the same for memory we don't own, like a file mapping.
+ * If the lock is refused (usually RLIMIT_MEMLOCK is too low) the memory is still
+ * prefaulted, just not locked, and the report says how much that was.
+ *
+ * Locking is only implemented on Linux; elsewhere enabling this just prefaults.
+ */
+struct ResidentMemory
+{
+    static ResidentMemory &instance();
+
+    void setEnabled(bool e);
+    bool isEnabled() const { return enabled; }
+
+    /*
+     * An uninitialised buffer of at least bytes, unlocked and freed with its last
+     * reference. When disabled this is just a malloc.
+     */
+    std::shared_ptr<void> allocate(size_t bytes);
+
+    /*
+     * Prefault and (if we can) lock [data, data + bytes). The range stays locked until
+     * the returned token is released. Returns nullptr when disabled.
+     */
+    std::shared_ptr<void> lockRange(const void *data, size_t bytes);
+
+    struct Report
+    {
+        uint64_t lockedBytes{0};
+        uint64_t unlockedBytes{0}; // prefaulted but the lock was refused
+        uint64_t lockLimit{0};     // RLIMIT_MEMLOCK, or 0 for unlimited or unknown
+    };
+    Report report() const;
+    std::string describe() const;
+
+  private:
+    ResidentMemory() = default;
+
+    bool lockPages(const void *data, size_t bytes);
+    void unlockPages(const void *data, size_t bytes);
+
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> lockedBytes{0}, unlockedBytes{0};
+    std::atomic<bool> warnedAboutLimit{false};
+};
+} // namespace scxt::infrastructure
+
+#endif // SCXT_SRC_INFRASTRUCTURE_RESIDENT_MEMORY_H
@@ -42,6 +42,11 @@ enum DefaultKeys
     colormapPathIfFile,
     welcomeScreenSeen,
     playModeExpanded,
+    useFastSampleContentHash,
+    sampleMemoryBudgetMB, // 0 for no budget
+    shareSamplesAcrossInstances,
+    lockSampleMemory,
+    renderSamplesAtEngineRate,
 
     nKeys // must be last K?
 };
@@ -67,6 +72,16 @@ inline std::string defaultKeyToString(DefaultKeys k)
         return "welcomeScreenSeen";
     case playModeExpanded:
         return "playModeExpanded";
+    case useFastSampleContentHash:
+        return "useFastSampleContentHash";
+    case sampleMemoryBudgetMB:
+        return "sampleMemoryBudgetMB";
+    case shareSamplesAcrossInstances:
+        return "shareSamplesAcrossInstances";
+    case lockSampleMemory:
+        return "lockSampleMemory";
+    case renderSamplesAtEngineRate:
+        return "renderSamplesAtEngineRate";
     default:
         std::terminate(); // for now
     }
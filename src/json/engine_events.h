@@ -0,0 +1,274 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_JSON_ENGINE_EVENTS_H
+#define SCXT_SRC_JSON_ENGINE_EVENTS_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+namespace scxt::json
+{
+enum struct EngineEventLevel
+{
+    ENGINE,
+    PATCH,
+    PARTS,
+    PART,
+    GROUPS,
+    GROUP,
+    ZONES
+};
+
+/*
+ * A tao::json events consumer which walks a streamed engine without making a value of the
+ * whole of it. The patch, its parts, their groups and those groups' zones are walked; every
+ * other member, and each zone, is made into a value with a Builder (in the engine a
+ * tao::json::events::to_basic_value) and handed to the Sink as soon as it is whole:
+ *
+ *   sink.begin(level) and sink.end(level) around the patch, each part and each group
+ *   sink.member(level, key, value) for the other members of those and of the engine
+ *   sink.zone(value) for each zone, in order
+ *
+ * With walkPatch false the patch is skipped, so only the engine members arrive; with it true
+ * only the patch does. Members arrive in stream order, which need not be the order things
+ * are unstreamed in, so a sink applies a part or group's members at its end(). A stream
+ * of a lone part, as part files hold, is walked by starting at Level::PART.
+ */
+template <typename Builder, typename Sink> struct EngineEventWalker
+{
+    using Level = EngineEventLevel;
+
+    EngineEventWalker(Sink &s, bool wp, Level top = Level::ENGINE)
+        : sink(s), walkPatch(wp), topLevel(top)
+    {
+    }
+
+    void null()
+    {
+        scalar([](auto &b) { b.null(); });
+    }
+    void boolean(bool v)
+    {
+        scalar([v](auto &b) { b.boolean(v); });
+    }
+    template <typename T> void number(T v)
+    {
+        scalar([v](auto &b) { b.number(v); });
+    }
+    template <typename T> void string(T &&v)
+    {
+        scalar([&v](auto &b) { b.string(std::forward<T>(v)); });
+    }
+    template <typename T> void binary(T &&v)
+    {
+        scalar([&v](auto &b) { b.binary(std::forward<T>(v)); });
+    }
+
+    void begin_array(std::size_t sz = 0)
+    {
+        open(false, [sz](auto &b) { b.begin_array(sz); });
+    }
+    void element()
+    {
+        if (mode == Mode::BUILD)
+            builder->element();
+    }
+    void end_array(std::size_t sz = 0)
+    {
+        close([sz](auto &b) { b.end_array(sz); });
+    }
+
+    void begin_object(std::size_t sz = 0)
+    {
+        open(true, [sz](auto &b) { b.begin_object(sz); });
+    }
+    template <typename T> void key(T &&k)
+    {
+        if (mode == Mode::BUILD)
+            builder->key(std::forward<T>(k));
+        else if (mode == Mode::WALK)
+            currentKey = std::string(std::forward<T>(k));
+    }
+    void member()
+    {
+        if (mode == Mode::BUILD)
+            builder->member();
+    }
+    void end_object(std::size_t sz = 0)
+    {
+        close([sz](auto &b) { b.end_object(sz); });
+    }
+
+  private:
+    enum struct Mode
+    {
+        WALK,
+        BUILD,
+        SKIP
+    };
+
+    Sink &sink;
+    bool walkPatch{false};
+    Level topLevel{Level::ENGINE};
+
+    std::vector<Level> levels;
+    std::string currentKey;
+
+    Mode mode{Mode::WALK};
+    int depth{0};
+    std::optional<Builder> builder;
+
+    static bool isArray(Level l)
+    {
+        return l == Level::PARTS || l == Level::GROUPS || l == Level::ZONES;
+    }
+
+    // The level the value about to start opens, if it is one we walk rather than build
+    std::optional<Level> walkedLevel() const
+    {
+        if (levels.empty())
+            return topLevel;
+
+        switch (levels.back())
+        {
+        case Level::ENGINE:
+            if (walkPatch && currentKey == "patch")
+                return Level::PATCH;
+            break;
+        case Level::PATCH:
+            if (currentKey == "parts")
+                return Level::PARTS;
+            break;
+        case Level::PARTS:
+            return Level::PART;
+        case Level::PART:
+            if (currentKey == "groups")
+                return Level::GROUPS;
+            break;
+        case Level::GROUPS:
+            return Level::GROUP;
+        case Level::GROUP:
+            if (currentKey == "zones")
+                return Level::ZONES;
+            break;
+        case Level::ZONES:
+            break;
+        }
+        return std::nullopt;
+    }
+
+    template <typename F> void scalar(F &&f)
+    {
+        if (mode == Mode::WALK)
+        {
+            if (walkedLevel().has_value())
+                throw SCXTError("Malformed engine stream: '" + currentKey +
+                                "' is not an object or array");
+            startValue();
+        }
+        if (mode == Mode::BUILD)
+            f(*builder);
+        if (depth == 0)
+            finishValue();
+    }
+
+    template <typename F> void open(bool isObject, F &&f)
+    {
+        if (mode == Mode::WALK)
+        {
+            auto next = walkedLevel();
+            if (next.has_value())
+            {
+                if (isArray(*next) == isObject)
+                    throw SCXTError("Malformed engine stream: '" + currentKey +
+                                    "' has the wrong type");
+                levels.push_back(*next);
+                if (!isArray(*next) && *next != Level::ENGINE)
+                    sink.begin(*next);
+                return;
+            }
+            startValue();
+        }
+        if (mode == Mode::BUILD)
+            f(*builder);
+        depth++;
+    }
+
+    template <typename F> void close(F &&f)
+    {
+        if (mode == Mode::WALK)
+        {
+            auto l = levels.back();
+            levels.pop_back();
+            if (!isArray(l) && l != Level::ENGINE)
+                sink.end(l);
+            return;
+        }
+        if (mode == Mode::BUILD)
+            f(*builder);
+        depth--;
+        if (depth == 0)
+            finishValue();
+    }
+
+    void startValue()
+    {
+        depth = 0;
+        mode = Mode::SKIP;
+        if (levels.back() != Level::ENGINE || (!walkPatch && currentKey != "patch"))
+        {
+            mode = Mode::BUILD;
+            builder.emplace();
+        }
+    }
+
+    void finishValue()
+    {
+        if (mode != Mode::BUILD)
+        {
+            mode = Mode::WALK;
+            return;
+        }
+
+        auto v = std::move(builder->value);
+        builder.reset();
+        mode = Mode::WALK;
+        if (levels.back() == Level::ZONES)
+            sink.zone(std::move(v));
+        else
+            sink.member(levels.back(), currentKey, std::move(v));
+    }
+};
+} // namespace scxt::json
+
+#endif // SCXT_SRC_JSON_ENGINE_EVENTS_H
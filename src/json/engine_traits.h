@@ -31,6 +31,9 @@
 #include <tao/json/to_string.hpp>
 #include <tao/json/from_string.hpp>
 #include <tao/json/contrib/traits.hpp>
+#include <tao/json/events/from_value.hpp>
+#include <tao/json/events/virtual_base.hpp>
+#include <tao/json/msgpack/from_string.hpp>
 
 #include "stream.h"
 #include "extensions.h"
@@ -58,6 +61,108 @@
 
 namespace scxt::json
 {
+/*
+ * Patches, parts and groups hold their children as values. While a ChildEventsGuard is alive
+ * they hold them as opaque pointers instead, which produce each child's events only when the
+ * value is written out through tao::json::events. So writing a multi this way never holds
+ * more than one zone's value at a time. Such a value is only good to write, and only while
+ * the engine is as it was.
+ */
+struct ChildEventsGuard
+{
+    static inline thread_local bool active{false};
+
+    bool pActive{false};
+    ChildEventsGuard() : pActive(active) { active = true; }
+    ~ChildEventsGuard() { active = pActive; }
+};
+
+template <typename T> void produceChildEvents(tao::json::events::virtual_base &c, const void *p)
+{
+    tao::json::events::from_value(c, scxt_value(*static_cast<const T *>(p)));
+}
+
+template <typename V, typename C> V childValues(const C &children)
+{
+    if (!ChildEventsGuard::active)
+        return V(children);
+
+    V res = tao::json::empty_array;
+    for (const auto &c : children)
+    {
+        using child_t = std::decay_t<decltype(*c)>;
+        auto &cv = res.get_array().emplace_back();
+        cv.set_opaque_ptr(c.get(), &produceChildEvents<child_t>);
+    }
+    return res;
+}
+
+/*
+ * While a DAWStreamCacheGuard is alive the Patch trait puts in each part as an opaque pointer
+ * to the cache's msgpack for it, which produces the part's events from there as the value is
+ * written. streamEngineStateForDAW brings the cache up to date first.
+ */
+struct DAWStreamCacheGuard
+{
+    static inline thread_local const DAWStreamCache *active{nullptr};
+
+    const DAWStreamCache *pActive{nullptr};
+    explicit DAWStreamCacheGuard(const DAWStreamCache &c) : pActive(active) { active = &c; }
+    ~DAWStreamCacheGuard() { active = pActive; }
+};
+
+inline void produceMsgpackEvents(tao::json::events::virtual_base &c, const void *p)
+{
+    const auto &s = *static_cast<const std::string *>(p);
+    tao::json::msgpack::events::from_string(c, s.data(), s.size());
+}
+
+template <typename V> V partValues(const engine::Patch &patch)
+{
+    auto *cache = DAWStreamCacheGuard::active;
+    if (!cache)
+        return childValues<V>(patch.getParts());
+
+    V res = tao::json::empty_array;
+    for (int i = 0; i < numParts; ++i)
+    {
+        const auto &part = patch.getPart(i);
+        const auto &entry = cache->parts[i];
+        auto &pv = res.get_array().emplace_back();
+        if (entry.has_value() && entry->id == part->id)
+            pv.set_opaque_ptr(&entry->msgpack, &produceMsgpackEvents);
+        else
+            pv = V(*part);
+    }
+    return res;
+}
+
+/*
+ * Samples need to be there before the patch and the patch before selection. The patch is
+ * whatever unstreamPatch does, so unstreamEngineState can stream it from the msgpack events
+ * (see json/stream.cpp) rather than from v.
+ */
+template <typename V, typename F>
+void unstreamEngineAround(const V &v, engine::Engine &to, F unstreamPatch)
+{
+    assert(to.getMessageController()->threadingChecker.isSerialThread());
+    auto sv{0};
+    findIf(v, "streamingVersion", sv);
+    SCLOG("Unstreaming engine state. Stream version : " << scxt::humanReadableVersion(sv));
+
+    engine::Engine::UnstreamGuard sg(sv);
+
+    findIf(v, "sampleManager", *(to.getSampleManager()));
+    unstreamPatch();
+    findIf(v, "selectionManager", *(to.getSelectionManager()));
+
+    // Now we need to restore the bus effects
+    to.getPatch()->setupBussesOnUnstream(to);
+
+    // and finally set the sample rate
+    to.getPatch()->setSampleRate(to.getSampleRate());
+}
+
 SC_STREAMDEF(scxt::engine::Engine, SC_FROM({
                  if (SC_STREAMING_FOR_IN_PROCESS)
                  {
@@ -78,30 +183,11 @@ SC_STREAMDEF(scxt::engine::Engine, SC_FROM({
                       {"sampleManager", from.getSampleManager()}};
              }),
              SC_TO({
-                 assert(to.getMessageController()->threadingChecker.isSerialThread());
-                 auto sv{0};
-                 findIf(v, "streamingVersion", sv);
-                 SCLOG("Unstreaming engine state. Stream version : "
-                       << scxt::humanReadableVersion(sv));
-
-                 engine::Engine::UnstreamGuard sg(sv);
-
-                 // Order matters here. Samples need to be there before the patch and patch
-                 // before selection
-
-                 findIf(v, "sampleManager", *(to.getSampleManager()));
-                 findIf(v, "patch", *(to.getPatch()));
-                 findIf(v, "selectionManager", *(to.getSelectionManager()));
-
-                 // Now we need to restore the bus effects
-                 to.getPatch()->setupBussesOnUnstream(to);
-
-                 // and finally set the sample rate
-                 to.getPatch()->setSampleRate(to.getSampleRate());
+                 unstreamEngineAround(v, to, [&v, &to]() { findIf(v, "patch", *(to.getPatch())); });
              }))
 
 SC_STREAMDEF(scxt::engine::Patch, SC_FROM({
-                 v = {{"parts", from.getParts()}, {"busses", from.busses}};
+                 v = {{"parts", partValues<val_t>(from)}, {"busses", from.busses}};
              }),
              SC_TO({
                  auto &patch = to;
@@ -172,9 +258,25 @@ SC_STREAMDEF(scxt::engine::Part::ZoneMappingItem,
                  findIf(v, "features", to.features);
              }))
 
+// Everything in a part but its groups
+template <typename V> void unstreamPartSettings(const V &v, engine::Part &part)
+{
+    if (SC_UNSTREAMING_FROM_PRIOR_TO(0x2024'08'18))
+    {
+        findIf(v, "channel", part.configuration.channel);
+    }
+    else
+    {
+        findIf(v, "config", part.configuration);
+    }
+    findIf(v, "macros", part.macros);
+}
+
 SC_STREAMDEF(
     scxt::engine::Part, SC_FROM({
-        v = {{"config", from.configuration}, {"groups", from.getGroups()}, {"macros", from.macros}};
+        v = {{"config", from.configuration},
+             {"groups", childValues<val_t>(from.getGroups())},
+             {"macros", from.macros}};
         if (SC_STREAMING_FOR_PART)
         {
             addToObject<val_t>(v, "streamingVersion", currentStreamingVersion);
@@ -209,15 +311,7 @@ SC_STREAMDEF(
             sg = std::make_unique<engine::Engine::UnstreamGuard>(partStreamingVersion);
         }
 
-        if (SC_UNSTREAMING_FROM_PRIOR_TO(0x2024'08'18))
-        {
-            findIf(v, "channel", part.configuration.channel);
-        }
-        else
-        {
-            findIf(v, "config", part.configuration);
-        }
-        findIf(v, "macros", part.macros);
+        unstreamPartSettings(v, part);
         auto vzones = v.at("groups").get_array();
         for (const auto vz : vzones)
         {
@@ -244,8 +338,30 @@ SC_STREAMDEF(scxt::engine::Group::GroupOutputInfo, SC_FROM({
                  result.routeTo = (engine::BusAddress)(rt);
              }));
 
+// Everything in a group but its zones
+template <typename V> void unstreamGroupSettings(const V &v, engine::Group &group)
+{
+    findIf(v, "name", group.name);
+    findIf(v, "gegStorage", group.gegStorage);
+    findIf(v, "outputInfo", group.outputInfo);
+    findIf(v, "processorStorage", group.processorStorage);
+    findIf(v, "routingTable", group.routingTable);
+    findIfArray(v, "modulatorStorage", group.modulatorStorage);
+}
+
+template <typename V> void unstreamZoneInto(const V &vz, engine::Group &group)
+{
+    auto idx = group.addZone(std::make_unique<scxt::engine::Zone>()) - 1;
+    vz.to(*(group.getZone(idx)));
+    if (group.parentPart && group.parentPart->parentPatch &&
+        group.parentPart->parentPatch->parentEngine)
+    {
+        group.getZone(idx)->setupOnUnstream(*(group.parentPart->parentPatch->parentEngine));
+    }
+}
+
 SC_STREAMDEF(scxt::engine::Group, SC_FROM({
-                 v = {{"zones", t.getZones()},
+                 v = {{"zones", childValues<val_t>(t.getZones())},
                       {"name", t.getName()},
                       {"outputInfo", t.outputInfo},
                       {"routingTable", t.routingTable},
@@ -255,25 +371,13 @@ SC_STREAMDEF(scxt::engine::Group, SC_FROM({
              }),
              SC_TO({
                  auto &group = to;
-                 findIf(v, "name", group.name);
-                 findIf(v, "gegStorage", group.gegStorage);
-                 findIf(v, "outputInfo", group.outputInfo);
-                 findIf(v, "processorStorage", group.processorStorage);
-                 findIf(v, "routingTable", group.routingTable);
-                 findIfArray(v, "modulatorStorage", group.modulatorStorage);
+                 unstreamGroupSettings(v, group);
                  group.clearZones();
 
                  auto vzones = v.at("zones").get_array();
                  for (const auto vz : vzones)
                  {
-                     auto idx = group.addZone(std::make_unique<scxt::engine::Zone>()) - 1;
-                     vz.to(*(group.getZone(idx)));
-                     if (group.parentPart && group.parentPart->parentPatch &&
-                         group.parentPart->parentPatch->parentEngine)
-                     {
-                         group.getZone(idx)->setupOnUnstream(
-                             *(group.parentPart->parentPatch->parentEngine));
-                     }
+                     unstreamZoneInto(vz, group);
                  }
                  group.setupOnUnstream(*(group.parentPart->parentPatch->parentEngine));
              }));
@@ -119,6 +119,10 @@ SC_STREAMDEF(sample::Sample::SampleFileAddress, SC_FROM({
                      addToObject<val_t>(v, "instrument", from.instrument);
                      addToObject<val_t>(v, "region", from.region);
                  }
+                 if (from.fileSize >= 0)
+                     addToObject<val_t>(v, "fileSize", from.fileSize);
+                 if (from.contentHashKind != infrastructure::ContentHashKind::MD5)
+                     addToObject<val_t>(v, "hashKind", (int)from.contentHashKind);
              }),
              SC_TO({
                  findOrSet(v, "type", sample::Sample::WAV_FILE, to.type);
@@ -129,13 +133,20 @@ SC_STREAMDEF(sample::Sample::SampleFileAddress, SC_FROM({
                  findOrSet(v, "preset", 0, to.preset); // 0 here since we forgot to stream for a bit
                  findOrSet(v, "instrument", -1, to.instrument);
                  findOrSet(v, "region", -1, to.region);
+                 findOrSet(v, "fileSize", (int64_t)-1, to.fileSize);
+                 int hk{(int)infrastructure::ContentHashKind::MD5};
+                 findIf(v, "hashKind", hk);
+                 to.contentHashKind = (infrastructure::ContentHashKind)hk;
              }));
 
 SC_STREAMDEF(scxt::sample::SampleManager, SC_FROM({
                  v = {{"sampleAddresses", from.getSampleAddressesAndIDs()}};
              }),
              SC_TO({
+                 // embedded samples arrive before the unstream and are wanted after it
+                 auto embedded = to.takeEmbeddedSamples();
                  to.reset();
+                 to.provideEmbeddedSamples(embedded);
                  sample::SampleManager::sampleAddressesAndIds_t res;
                  findIf(v, "sampleAddresses", res);
                  to.restoreFromSampleAddressesAndIDs(res);
@@ -30,9 +30,11 @@
 #include <tao/json/to_string.hpp>
 #include <tao/json/from_string.hpp>
 #include <tao/json/contrib/traits.hpp>
+#include <tao/json/msgpack/to_string.hpp>
 
 #include "scxt_traits.h"
 #include "engine_traits.h"
+#include "engine_events.h"
 #include "messaging/messaging.h"
 
 namespace scxt::json
@@ -70,20 +72,140 @@ std::string streamEngineState(const engine::Engine &e, bool pretty)
     return streamValue(json::scxt_value(e), pretty);
 }
 
-void unstreamEngineState(engine::Engine &e, const std::string &data, bool msgPack)
+std::string streamEngineStateForDAW(const engine::Engine &e, DAWStreamCache &cache)
+{
+    assert(SC_STREAMING_FOR_DAW);
+
+    cache.lastReserializedCount = 0;
+    for (const auto &[idx, part] : sst::cpputils::enumerate(e.getPatch()->getParts()))
+    {
+        auto &entry = cache.parts[idx];
+        // Read the generation before streaming, so an edit landing mid-stream leaves the
+        // entry stale and it is made again next time
+        auto gen = part->getStreamGeneration();
+        if (!entry.has_value() || !(entry->id == part->id) || entry->generation != gen)
+        {
+            entry = DAWStreamCache::PartEntry{
+                part->id, gen, tao::json::msgpack::to_string(json::scxt_value(*part))};
+            cache.lastReserializedCount++;
+        }
+    }
+
+    DAWStreamCacheGuard cg(cache);
+    return tao::json::to_string(json::scxt_value(e));
+}
+
+namespace
+{
+/*
+ * Applies what an EngineEventWalker hands over to the engine as it comes. Parts and groups
+ * collect their other members and apply them when they end, whichever side of their children
+ * those were streamed.
+ */
+struct EngineUnstreamSink
+{
+    engine::Engine &engine;
+
+    scxt_value engineRest{tao::json::empty_object};
+    scxt_value patchRest{tao::json::empty_object};
+    scxt_value partRest{tao::json::empty_object};
+    scxt_value groupRest{tao::json::empty_object};
+
+    int partIndex{0};
+    engine::Part *part{nullptr};
+    engine::Group *group{nullptr};
+
+    scxt_value &restFor(EngineEventLevel l)
+    {
+        switch (l)
+        {
+        case EngineEventLevel::PATCH:
+            return patchRest;
+        case EngineEventLevel::PART:
+            return partRest;
+        case EngineEventLevel::GROUP:
+            return groupRest;
+        default:
+            return engineRest;
+        }
+    }
+
+    void begin(EngineEventLevel l)
+    {
+        restFor(l) = tao::json::empty_object;
+        switch (l)
+        {
+        case EngineEventLevel::PATCH:
+            engine.getPatch()->resetToBlankPatch();
+            partIndex = 0;
+            break;
+        case EngineEventLevel::PART:
+            if (partIndex >= numParts)
+                throw SCXTError("Malformed engine stream: more than " + std::to_string(numParts) +
+                                " parts");
+            part = engine.getPatch()->getPart(partIndex++).get();
+            part->clearGroups();
+            break;
+        case EngineEventLevel::GROUP:
+            group = part->getGroup(part->addGroup() - 1).get();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void member(EngineEventLevel l, const std::string &key, scxt_value &&v)
+    {
+        restFor(l).get_object().emplace(key, std::move(v));
+    }
+
+    void zone(scxt_value &&v) { unstreamZoneInto(v, *group); }
+
+    void end(EngineEventLevel l)
+    {
+        switch (l)
+        {
+        case EngineEventLevel::PATCH:
+            findIf(patchRest, "busses", engine.getPatch()->busses);
+            break;
+        case EngineEventLevel::PART:
+            unstreamPartSettings(partRest, *part);
+            break;
+        case EngineEventLevel::GROUP:
+            unstreamGroupSettings(groupRest, *group);
+            group->setupOnUnstream(engine);
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+using EngineUnstreamWalker =
+    EngineEventWalker<tao::json::events::to_basic_value<scxt_traits>, EngineUnstreamSink>;
+} // namespace
+
+void unstreamEngineState(engine::Engine &e, std::string_view data, bool msgPack)
 {
     e.clearAll();
     if (msgPack)
     {
-        tao::json::events::transformer<tao::json::events::to_basic_value<scxt_traits>> consumer;
-        tao::json::msgpack::events::from_string(consumer, data);
-        auto jv = std::move(consumer.value);
-        jv.to(e);
+        /*
+         * The samples need restoring before the patch but stream after it, so walk the data
+         * once for the engine members and again for the patch, a zone at a time.
+         */
+        EngineUnstreamSink sink{e};
+        EngineUnstreamWalker settings(sink, false);
+        tao::json::msgpack::events::from_string(settings, data.data(), data.size());
+        unstreamEngineAround(sink.engineRest, e, [&sink, data]() {
+            EngineUnstreamWalker patch(sink, true);
+            tao::json::msgpack::events::from_string(patch, data.data(), data.size());
+        });
     }
     else
     {
         tao::json::events::transformer<tao::json::events::to_basic_value<scxt_traits>> consumer;
-        tao::json::events::from_string(consumer, data);
+        tao::json::events::from_string(consumer, data.data(), data.size());
         auto jv = std::move(consumer.value);
         jv.to(e);
     }
@@ -91,20 +213,20 @@ void unstreamEngineState(engine::Engine &e, const std::string &data, bool msgPac
     e.sendFullRefreshToClient();
 }
 
-void unstreamPartState(engine::Engine &e, int part, const std::string &data, bool msgPack)
+void unstreamPartState(engine::Engine &e, int part, std::string_view data, bool msgPack)
 {
     e.getPatch()->getPart(part)->clearGroups();
     if (msgPack)
     {
         tao::json::events::transformer<tao::json::events::to_basic_value<scxt_traits>> consumer;
-        tao::json::msgpack::events::from_string(consumer, data);
+        tao::json::msgpack::events::from_string(consumer, data.data(), data.size());
         auto jv = std::move(consumer.value);
         jv.to(*(e.getPatch()->getPart(part)));
     }
     else
     {
         tao::json::events::transformer<tao::json::events::to_basic_value<scxt_traits>> consumer;
-        tao::json::events::from_string(consumer, data);
+        tao::json::events::from_string(consumer, data.data(), data.size());
         auto jv = std::move(consumer.value);
         jv.to(*(e.getPatch()->getPart(part)));
     }
@@ -28,6 +28,9 @@
 #ifndef SCXT_SRC_JSON_STREAM_H
 #define SCXT_SRC_JSON_STREAM_H
 
+#include <array>
+#include <optional>
+#include <string_view>
 #include "engine/patch.h"
 #include "engine/engine.h"
 #include "configuration.h"
@@ -36,9 +39,39 @@ namespace scxt::json
 {
 std::string streamPatch(const engine::Patch &p, bool pretty = false);
 std::string streamEngineState(const engine::Engine &e, bool pretty = false);
-void unstreamEngineState(engine::Engine &e, const std::string &jsonData, bool msgPack = false);
-void unstreamPartState(engine::Engine &e, int part, const std::string &jsonData,
+// The data need only live for the call, so can be a view of a mapped file
+void unstreamEngineState(engine::Engine &e, std::string_view jsonData, bool msgPack = false);
+void unstreamPartState(engine::Engine &e, int part, std::string_view jsonData,
                        bool msgPack = false);
+
+/*
+ * Hosts ask for state far more often than it changes, so the DAW stream keeps each
+ * part serialized (as msgpack) with the stream generation it was made at, and the
+ * engine state streams each part from there, reserializing only the parts marked
+ * dirty since.
+ */
+struct DAWStreamCache
+{
+    struct PartEntry
+    {
+        PartID id;
+        uint64_t generation{0};
+        std::string msgpack;
+    };
+    std::array<std::optional<PartEntry>, numParts> parts;
+
+    // How many parts the last stream had to reserialize; useful for tests and profiling
+    int lastReserializedCount{0};
+
+    void clear()
+    {
+        for (auto &p : parts)
+            p.reset();
+    }
+};
+
+// Call under a FOR_DAW StreamGuard. Produces the same document as streamEngineState
+std::string streamEngineStateForDAW(const engine::Engine &e, DAWStreamCache &cache);
 } // namespace scxt::json
 
 #endif // SHORTCIRCUIT_STREAM_H
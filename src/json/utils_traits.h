@@ -72,14 +72,19 @@ template <int idType> struct scxt_traits<ID<idType>>
 };
 
 SC_STREAMDEF(scxt::SampleID,
-             SC_FROM(v = {{"m", from.md5}, {"a", from.multiAddress}, {"p", from.pathHash}});
+             SC_FROM(v = {{"m", from.getMD5()},
+                          {"a", from.getMultiAddress()},
+                          {"p", from.getPathHash()}});
              , SC_TO(
                    auto vs = v.find("m"); if (vs) {
                        std::string m5;
                        vs->to(m5);
-                       strncpy(to.md5, m5.c_str(), scxt::SampleID::md5len + 1);
-                       findIf(v, "a", to.multiAddress);
-                       findIf(v, "p", to.pathHash);
+                       auto ma = to.getMultiAddress();
+                       auto ph = to.getPathHash();
+                       findIf(v, "a", ma);
+                       findIf(v, "p", ph);
+                       to.setAsMD5WithAddress(m5, ma[0], ma[1], ma[2]);
+                       to.setPathHash(ph);
                    } else {
                        std::string legType{"t"}, legID{"i"};
                        if (SC_UNSTREAMING_FROM_PRIOR_TO(0x2024'08'06))
@@ -54,6 +54,9 @@ enum AudioToSerializationMessageId
     a2s_processor_refresh,
     a2s_macro_updated,
     a2s_delete_this_pointer,
+    a2s_sample_reload_request,
+    a2s_sample_mipmap_request,
+    a2s_sample_rendition_request,
 };
 
 /**
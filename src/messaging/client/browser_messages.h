@@ -48,6 +48,12 @@ inline void doAddBrowserDeviceLocation(const fs::path &p, const engine::Engine &
 CLIENT_TO_SERIAL(AddBrowserDeviceLocation, c2s_add_browser_device_location, std::string,
                  doAddBrowserDeviceLocation(fs::path(fs::u8path(payload)), engine, cont));
 
+// Previews stream on their own thread (see sample::PreviewStream) so these just hand it the path
+CLIENT_TO_SERIAL(StartBrowserPreview, c2s_start_browser_preview, std::string,
+                 engine.getPreviewStream()->start(fs::path(fs::u8path(payload))));
+CLIENT_TO_SERIAL(StopBrowserPreview, c2s_stop_browser_preview, bool,
+                 engine.getPreviewStream()->stop());
+
 SERIAL_TO_CLIENT(RefreshBrowser, s2c_refresh_browser, bool, onBrowserRefresh)
 
 } // namespace scxt::messaging::client
@@ -67,6 +67,7 @@ enum ClientToSerializationMessagesIds
     // Stream and IO Messages
     c2s_unstream_engine_state,
     c2s_save_multi,
+    c2s_save_monolith,
     c2s_save_selected_part,
 
     c2s_load_multi,
@@ -137,6 +138,8 @@ enum ClientToSerializationMessagesIds
     c2s_set_mixer_send_storage,
 
     c2s_add_browser_device_location,
+    c2s_start_browser_preview,
+    c2s_stop_browser_preview,
 
     c2s_request_debug_action,
 
@@ -153,6 +156,9 @@ enum ClientToSerializationMessagesIds
     c2s_send_full_part_config,
 
     c2s_resolve_sample,
+    c2s_auto_resolve_missing_samples,
+    c2s_auto_resolve_missing_samples_progress,
+    c2s_apply_auto_resolved_samples,
 
     // part activation
     c2s_activate_next_part,
@@ -216,6 +222,58 @@ inline bool cacheSerializationMessagesAbsentClient(SerializationToClientMessageI
     return false;
 }
 
+/*
+ * Does executing this message mean we have to treat every part as changed for the
+ * DAW stream cache (see Part::markStreamDirty)? Messages which leave the parts alone,
+ * and the frequent value edits which go through the detail:: update helpers or set
+ * macros and so mark exactly the parts they change, return false. Anything else is
+ * assumed to edit anything, so new messages are safe by default.
+ */
+inline bool clientMessageMayDirtyAnyPart(ClientToSerializationMessagesIds id)
+{
+    switch (id)
+    {
+    case c2s_register_client:
+    case c2s_save_multi:
+    case c2s_save_monolith:
+    case c2s_save_selected_part:
+    case c2s_apply_select_action:
+    case c2s_apply_multi_select_action:
+    case c2s_select_part:
+    case c2s_set_othertab_selection:
+    case c2s_request_pgz_structure:
+    case c2s_noteonoff:
+    case c2s_add_browser_device_location:
+    case c2s_start_browser_preview:
+    case c2s_stop_browser_preview:
+    case c2s_macro_begin_end_edit:
+        return false;
+
+    case c2s_update_zone_or_group_eg_float_value:
+    case c2s_update_zone_or_group_modstorage_float_value:
+    case c2s_update_zone_or_group_modstorage_bool_value:
+    case c2s_update_zone_or_group_modstorage_int16_t_value:
+    case c2s_update_zone_mapping_float:
+    case c2s_update_zone_mapping_int16_t:
+    case c2s_update_zone_variants_int16_t:
+    case c2s_update_zone_output_float_value:
+    case c2s_update_zone_output_int16_t_value:
+    case c2s_update_group_output_float_value:
+    case c2s_update_group_output_int16_t_value:
+    case c2s_update_group_output_bool_value:
+    case c2s_update_single_processor_float_value:
+    case c2s_update_single_processor_bool_value:
+    case c2s_update_single_processor_int32_t_value:
+    case c2s_set_macro_full_state:
+    case c2s_set_macro_value:
+        return false;
+
+    default:
+        break;
+    }
+    return true;
+}
+
 typedef uint8_t unimpl_t;
 template <ClientToSerializationMessagesIds id> struct ClientToSerializationType
 {
@@ -228,6 +286,8 @@ template <SerializationToClientMessageIds id> struct SerializationToClientType
 };
 
 template <typename T> void clientSendToSerialization(const T &message, MessageController &mc);
+// The same, from a worker thread the engine owns (the queue is locked so any thread may post)
+template <typename T> void workerSendToSerialization(const T &message, MessageController &mc);
 template <typename T>
 void serializationSendToClient(SerializationToClientMessageIds id, const T &payload,
                                messaging::MessageController &mc);
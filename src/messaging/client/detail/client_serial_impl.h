@@ -179,6 +179,14 @@ inline void clientSendToSerialization(const T &msg, messaging::MessageController
     mc.sendRawFromClient(res);
 }
 
+template <typename T>
+inline void workerSendToSerialization(const T &msg, messaging::MessageController &mc)
+{
+    auto mw = detail::MessageWrapper(msg);
+    detail::client_message_value v = mw;
+    mc.sendRawFromClient(encoder::to_string(v));
+}
+
 template <typename T>
 inline void serializationSendToClient(SerializationToClientMessageIds id, const T &msg,
                                       messaging::MessageController &mc)
@@ -229,10 +237,18 @@ inline void serializationThreadExecuteClientMessage(const std::string &msgView,
     int idv{-1};
     o["id"].to(idv);
 
+    auto dirtiesParts = clientMessageMayDirtyAnyPart((ClientToSerializationMessagesIds)idv);
+    mc.executingMessageWhichMayDirtyAnyPart = dirtiesParts;
     detail::executeOnSerializationFor(
         (ClientToSerializationMessagesIds)idv, jv, e, mc,
         std::make_index_sequence<(
             size_t)ClientToSerializationMessagesIds::num_clientToSerializationMessages>());
+    mc.executingMessageWhichMayDirtyAnyPart = false;
+
+    // Catches the edits made directly on this thread. Ones made by scheduled audio
+    // thread callbacks mark again when those callbacks return.
+    if (dirtiesParts)
+        e.getPatch()->markAllPartsStreamDirty();
 }
 
 template <typename Client>
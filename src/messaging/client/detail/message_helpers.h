@@ -68,6 +68,7 @@ updateZoneLeadMemberValue(M m, const diffMsg_t<VT> &payload, const engine::Engin
                 {
                     *(VT *)(((uint8_t *)&dat) + d) = v;
                 }
+                zn->markStreamDirty();
             },
             responseCB);
     }
@@ -107,6 +108,7 @@ inline void updateZoneMemberValue(M m, const diffMsg_t<VT> &payload, const engin
                     {
                         *(VT *)(((uint8_t *)&dat) + d) = v;
                     }
+                    zn->markStreamDirty();
                 }
             },
             responseCB);
@@ -147,6 +149,7 @@ inline void updateGroupMemberValue(M m, const diffMsg_t<VT> &payload, const engi
                     {
                         *(VT *)(((uint8_t *)&dat) + d) = v;
                     }
+                    grp->markStreamDirty();
                 }
             },
             responseCB);
@@ -194,6 +197,9 @@ inline void updateZoneIndexedMemberValue(
                 }
                 if (onEngineExtra)
                     onEngineExtra(eng, zs);
+                // mark after the extra work, which can adjust the values further
+                for (const auto &[p, g, z] : zs)
+                    eng.getPatch()->getPart(p)->markStreamDirty();
             },
             responseCB);
     }
@@ -232,6 +238,9 @@ inline void updateGroupIndexedMemberValue(
                 }
                 if (onEngineExtra)
                     onEngineExtra(eng, gs);
+                // mark after the extra work, which can adjust the values further
+                for (const auto &[p, g, z] : gs)
+                    eng.getPatch()->getPart(p)->markStreamDirty();
             },
             responseCB);
     }
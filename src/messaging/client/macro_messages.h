@@ -53,6 +53,7 @@ inline void updateMacroFullState(const macroFullState_t &t, const engine::Engine
             engine::Macro macroCopy = macro;
             macroCopy.setValueConstrained(v);
             e.getPatch()->getPart(part)->macros[index] = macroCopy;
+            e.getPatch()->getPart(part)->markStreamDirty();
             SCLOG("Setting part/index macro to "
                   << SCD(part) << SCD(index) << SCD(macroCopy.name)
                   << SCD(e.getPatch()->getPart(part)->macros[index].name));
@@ -94,6 +95,7 @@ inline void updateMacroValue(const macroValue_t &t, const engine::Engine &engine
             // Set the value
             auto &macro = e.getPatch()->getPart(part)->macros[index];
             macro.setValueConstrained(value);
+            e.getPatch()->getPart(part)->markStreamDirty();
         },
         [part = p, index = i](auto &e) {
             // a separate perhaps dropped message to update plugins
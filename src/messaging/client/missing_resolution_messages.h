@@ -34,6 +34,7 @@
 #include "json/datamodel_traits.h"
 #include "selection/selection_manager.h"
 #include "engine/missing_resolution.h"
+#include "browser/browser.h"
 #include "client_macros.h"
 
 namespace scxt::messaging::client
@@ -62,5 +63,71 @@ inline void doResolveSample(const resolveSamplePayload_t &payload, engine::Engin
 CLIENT_TO_SERIAL(ResolveSample, c2s_resolve_sample, resolveSamplePayload_t,
                  doResolveSample(payload, engine, cont));
 
+/*
+ * Auto resolve hashes and crawls on the browser's search thread, which posts its progress and
+ * then what it found back here as the two messages below; the resolution itself happens on
+ * the serial thread like any other.
+ */
+inline void doAutoResolveMissingSamplesProgress(const std::string &msg,
+                                                messaging::MessageController &cont)
+{
+    cont.updateClientActivityNotification(msg, -1);
+}
+CLIENT_TO_SERIAL(AutoResolveMissingSamplesProgress, c2s_auto_resolve_missing_samples_progress,
+                 std::string, doAutoResolveMissingSamplesProgress(payload, cont));
+
+// The found paths line up with the work items; an empty one was not found
+using applyAutoResolvedPayload_t =
+    std::tuple<std::vector<engine::MissingResolutionWorkItem>, std::vector<std::string>>;
+inline void doApplyAutoResolvedSamples(const applyAutoResolvedPayload_t &payload,
+                                       engine::Engine &e, messaging::MessageController &cont)
+{
+    const auto &[mwis, paths] = payload;
+    std::vector<std::optional<fs::path>> found;
+    found.reserve(paths.size());
+    for (const auto &p : paths)
+    {
+        if (p.empty())
+            found.emplace_back(std::nullopt);
+        else
+            found.emplace_back(fs::path(fs::u8path(p)));
+    }
+    engine::applyMissingSampleResolutions(e, mwis, found);
+    e.getSampleManager()->purgeUnreferencedSamples();
+    e.sendFullRefreshToClient();
+    cont.updateClientActivityNotification("", 0);
+}
+CLIENT_TO_SERIAL(ApplyAutoResolvedSamples, c2s_apply_auto_resolved_samples,
+                 applyAutoResolvedPayload_t, doApplyAutoResolvedSamples(payload, engine, cont));
+
+inline void doAutoResolveMissingSamples(engine::Engine &e, messaging::MessageController &cont)
+{
+    auto mwis = engine::collectMissingResolutionWorkItems(e);
+    if (mwis.empty())
+        return;
+
+    auto *mc = &cont;
+    auto started = e.getBrowser()->findMissingSamplesInBackground(
+        engine::missingSampleQueriesFor(e, mwis),
+        [mc](const auto &msg)
+        { workerSendToSerialization(AutoResolveMissingSamplesProgress(msg), *mc); },
+        [mc, mwis](const auto &found)
+        {
+            std::vector<std::string> paths;
+            paths.reserve(found.size());
+            for (const auto &f : found)
+                paths.push_back(f.has_value() ? f->u8string() : std::string());
+            workerSendToSerialization(
+                ApplyAutoResolvedSamples(applyAutoResolvedPayload_t{mwis, paths}), *mc);
+        });
+
+    if (started)
+        cont.updateClientActivityNotification("Searching for missing samples", 1);
+    else
+        SCLOG("Missing sample search already running; ignoring auto resolve request");
+}
+CLIENT_TO_SERIAL(AutoResolveMissingSamples, c2s_auto_resolve_missing_samples, bool,
+                 doAutoResolveMissingSamples(engine, cont));
+
 } // namespace scxt::messaging::client
 #endif // MISSING_RESOLUTION_MESSAGES_H
@@ -40,6 +40,13 @@ inline void doSaveMulti(const std::string &s, engine::Engine &engine, MessageCon
     // engine.getBrowser()->doSomething;
 }
 CLIENT_TO_SERIAL(SaveMulti, c2s_save_multi, std::string, doSaveMulti(payload, engine, cont));
+
+inline void doSaveMonolith(const std::string &s, engine::Engine &engine, MessageController &cont)
+{
+    patch_io::saveMulti(fs::path(fs::u8path(s)), engine, true);
+}
+CLIENT_TO_SERIAL(SaveMonolith, c2s_save_monolith, std::string,
+                 doSaveMonolith(payload, engine, cont));
 CLIENT_TO_SERIAL(LoadMulti, c2s_load_multi, std::string,
                  patch_io::loadMulti(fs::path(fs::u8path(payload)), engine));
 
@@ -33,6 +33,7 @@
 #include "json/engine_traits.h"
 #include "json/datamodel_traits.h"
 #include "selection/selection_manager.h"
+#include "dsp/sample_analytics.h"
 
 namespace scxt::messaging::client
 {
@@ -103,10 +104,15 @@ inline void doUpdateLeadZoneSingleVariant(const updateLeadZoneSingleVariantPaylo
     if (sz.has_value())
     {
         auto [ps, gs, zs] = *sz;
-        cont.scheduleAudioThreadCallback([p = ps, g = gs, z = zs, sampv = samples](auto &eng) {
-            auto &[idx, smp] = sampv;
-            eng.getPatch()->getPart(p)->getGroup(g)->getZone(z)->variantData.variants[idx] = smp;
-        });
+        cont.scheduleAudioThreadCallback(
+            [p = ps, g = gs, z = zs, sampv = samples](auto &eng) {
+                auto &[idx, smp] = sampv;
+                eng.getPatch()->getPart(p)->getGroup(g)->getZone(z)->variantData.variants[idx] =
+                    smp;
+            },
+            [p = ps, g = gs, z = zs](const auto &eng) {
+                eng.refreshLoopSplices({(size_t)p, (size_t)g, (size_t)z});
+            });
     }
 }
 CLIENT_TO_SERIAL(UpdateLeadZoneSingleVariant, c2s_update_lead_zone_single_variant,
@@ -122,6 +128,11 @@ inline void doNormalizeVariantAmplitude(const normalizeVariantAmplitudePayload_t
     if (sz.has_value())
     {
         auto [ps, gs, zs] = *sz;
+
+        // Make sure the level analysis is cached here so the audio thread only reads it
+        const auto &zp = engine.getPatch()->getPart(ps)->getGroup(gs)->getZone(zs)->samplePointers;
+        dsp::sample_analytics::analyseSamples({zp.begin(), zp.end()});
+
         cont.scheduleAudioThreadCallback([p = ps, g = gs, z = zs, sampv = samples](auto &eng) {
             auto &[idx, use_peak] = sampv;
             eng.getPatch()->getPart(p)->getGroup(g)->getZone(z)->setNormalizedSampleLevel(use_peak,
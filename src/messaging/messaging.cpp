@@ -89,6 +89,24 @@ void MessageController::parseAudioMessageOnSerializationThread(
         }
     }
     break;
+    case audio::a2s_sample_reload_request:
+    {
+        assert(as.payloadType == audio::AudioToSerialization::VOID_STAR);
+        engine.getSampleManager()->reloadEvictedSample((sample::Sample *)as.payload.p);
+    }
+    break;
+    case audio::a2s_sample_mipmap_request:
+    {
+        assert(as.payloadType == audio::AudioToSerialization::VOID_STAR);
+        engine.getSampleManager()->buildMipmapFor((sample::Sample *)as.payload.p);
+    }
+    break;
+    case audio::a2s_sample_rendition_request:
+    {
+        assert(as.payloadType == audio::AudioToSerialization::VOID_STAR);
+        engine.getSampleManager()->buildRenditionFor((sample::Sample *)as.payload.p);
+    }
+    break;
     case audio::a2s_none:
         break;
     }
@@ -136,7 +154,20 @@ MessageController::AudioThreadCallback *MessageController::getAudioThreadCallbac
 void MessageController::returnAudioThreadCallback(AudioThreadCallback *r)
 {
     assert(threadingChecker.isSerialThread());
-    r->execCompleteOnSer(engine);
+    if (r->dirtiesAllParts)
+    {
+        // work the completion schedules inherits the mark
+        auto pre = executingMessageWhichMayDirtyAnyPart;
+        executingMessageWhichMayDirtyAnyPart = true;
+        r->execCompleteOnSer(engine);
+        executingMessageWhichMayDirtyAnyPart = pre;
+        engine.getPatch()->markAllPartsStreamDirty();
+    }
+    else
+    {
+        r->execCompleteOnSer(engine);
+    }
+    r->dirtiesAllParts = false;
     cbStore.push(r);
 }
 
@@ -162,6 +193,7 @@ void MessageController::scheduleAudioThreadFunctionCallback(
     {
         auto pt = getAudioThreadCallback();
         pt->setFunction(cb);
+        pt->dirtiesAllParts = executingMessageWhichMayDirtyAnyPart;
         if (sercb)
             pt->setSerialCompleteFunction(sercb);
         else
@@ -291,6 +291,10 @@ struct MessageController : MoveableOnly<MessageController>
                 serialOnComplete(e);
         }
 
+        // Scheduled while handling a message which may change any part, so once both
+        // halves have run every part is marked dirty for the DAW stream cache
+        bool dirtiesAllParts{false};
+
       private:
         std::function<void(engine::Engine &)> f{nullptr};
         std::function<void(const engine::Engine &)> serialOnComplete{nullptr};
@@ -304,6 +308,14 @@ struct MessageController : MoveableOnly<MessageController>
      */
     ThreadingChecker threadingChecker;
 
+    /*
+     * True while the serialization thread executes a client message for which
+     * clientMessageMayDirtyAnyPart holds, or the completion of work it scheduled.
+     * Audio thread callbacks scheduled in that window mark every part dirty once they
+     * complete, since that is when the edits they make have actually landed.
+     */
+    bool executingMessageWhichMayDirtyAnyPart{false};
+
     /*
      * A convenience function to report an error to the UI
      */
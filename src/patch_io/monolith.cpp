@@ -0,0 +1,253 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "monolith.h"
+
+#include <cstring>
+
+#include "infrastructure/resident_memory.h"
+#include "dsp/resampling.h"
+#include "json/scxt_traits.h"
+#include "json/utils_traits.h"
+#include "json/sample_traits.h"
+
+namespace scxt::patch_io
+{
+namespace
+{
+// What the embedded samples play from: the mapped file, and its data locked resident
+struct MonolithMapping
+{
+    std::shared_ptr<RIFFMappedReader> file;
+    std::shared_ptr<void> residency;
+};
+
+static constexpr char zeros[monolithDataAlignment]{};
+
+void padTo(std::ostream &os, size_t alignment)
+{
+    auto at = (size_t)os.tellp();
+    auto pad = (alignment - at % alignment) % alignment;
+    os.write(zeros, pad);
+}
+} // namespace
+
+std::vector<std::shared_ptr<sample::Sample>>
+addMonolithSampleChunks(RIFFStreamWriter &f,
+                        const std::vector<std::shared_ptr<sample::Sample>> &samples,
+                        const monolithDataSource_t &dataFor)
+{
+    json::scxt_value index = tao::json::empty_array;
+    std::vector<std::shared_ptr<sample::Sample>> notEmbedded;
+
+    f.addChunk('scsd', [&samples, &dataFor, &index, &notEmbedded](std::ostream &os) {
+        auto chunkStart = (size_t)os.tellp();
+        for (const auto &s : samples)
+        {
+            auto d = dataFor(s);
+            if (!d || !d->sampleData[0] || (s->channels == 2 && !d->sampleData[1]))
+            {
+                notEmbedded.push_back(s);
+                continue;
+            }
+
+            auto bps = sample::Sample::bitDepthByteSize(s->bitDepth);
+            auto padBytes = dsp::FIRoffset * bps;
+            auto dataBytes = (size_t)s->sample_length * bps;
+
+            json::scxt_value offsets = tao::json::empty_array;
+            for (int c = 0; c < s->channels; ++c)
+            {
+                padTo(os, monolithDataAlignment);
+                offsets.get_array().emplace_back((uint64_t)((size_t)os.tellp() - chunkStart));
+                // the pads are written as zeros rather than trusting what is in memory
+                os.write(zeros, padBytes);
+                os.write((const char *)d->sampleData[c] + padBytes, dataBytes);
+                os.write(zeros, padBytes);
+            }
+
+            const auto &m = s->meta;
+            json::scxt_value meta = {{"loopPresent", m.loop_present},
+                                     {"loopStart", m.loop_start},
+                                     {"loopEnd", m.loop_end},
+                                     {"rootKeyPresent", m.rootkey_present},
+                                     {"rootKey", (int)m.key_root},
+                                     {"keyPresent", m.key_present},
+                                     {"keyLow", (int)m.key_low},
+                                     {"keyHigh", (int)m.key_high},
+                                     {"velPresent", m.vel_present},
+                                     {"velLow", (int)m.vel_low},
+                                     {"velHigh", (int)m.vel_high},
+                                     {"playModePresent", m.playmode_present},
+                                     {"playMode", (int)m.playmode},
+                                     {"detune", m.detune}};
+            index.get_array().emplace_back(
+                json::scxt_value{{"id", json::scxt_value(s->id)},
+                                 {"address", json::scxt_value(s->getSampleFileAddress())},
+                                 {"displayName", s->displayName},
+                                 {"name", std::string(s->name)},
+                                 {"bitDepth", (int)s->bitDepth},
+                                 {"channels", (int)s->channels},
+                                 {"frames", s->sample_length},
+                                 {"sampleRate", s->sample_rate},
+                                 {"offsets", offsets},
+                                 {"meta", meta}});
+        }
+    });
+    f.addChunk('scsx', tao::json::to_string(index));
+    return notEmbedded;
+}
+
+bool hasMonolithSamples(const RIFFMappedReader &f)
+{
+    return f.getChunk('scsd').has_value() && f.getChunk('scsx').has_value();
+}
+
+std::vector<std::shared_ptr<sample::Sample>>
+readMonolithSamples(const std::shared_ptr<RIFFMappedReader> &f)
+{
+    std::vector<std::shared_ptr<sample::Sample>> res;
+    auto data = f->getChunk('scsd');
+    auto idx = f->getChunk('scsx');
+    if (!data.has_value() || !idx.has_value())
+        return res;
+
+    auto mapping = std::make_shared<MonolithMapping>();
+    mapping->file = f;
+    mapping->residency =
+        infrastructure::ResidentMemory::instance().lockRange(data->data(), data->size());
+
+    tao::json::events::transformer<tao::json::events::to_basic_value<json::scxt_traits>> consumer;
+    try
+    {
+        tao::json::events::from_string(consumer, idx->data(), idx->size());
+    }
+    catch (const std::exception &e)
+    {
+        SCLOG("Unable to read monolith sample index [" << e.what() << "]");
+        return res;
+    }
+    auto jv = std::move(consumer.value);
+    if (!jv.is_array())
+        return res;
+
+    for (const auto &ev : jv.get_array())
+    {
+        try
+        {
+            auto s = std::make_shared<sample::Sample>();
+            sample::Sample::SampleFileAddress addr;
+            int bd{-1}, channels{0};
+            std::vector<uint64_t> offsets;
+            ev.at("id").to(s->id);
+            ev.at("address").to(addr);
+            ev.at("bitDepth").to(bd);
+            ev.at("channels").to(channels);
+            ev.at("frames").to(s->sample_length);
+            ev.at("sampleRate").to(s->sample_rate);
+            ev.at("offsets").to(offsets);
+            json::findIf(ev, "displayName", s->displayName);
+
+            if (bd < sample::Sample::BD_I16 || bd > sample::Sample::BD_F32 || channels < 1 ||
+                channels > 2 || (int)offsets.size() != channels || s->sample_rate == 0)
+            {
+                SCLOG("Skipping damaged monolith sample " << s->id.to_string());
+                continue;
+            }
+
+            auto bitDepth = (sample::Sample::BitDepth)bd;
+            auto channelBytes = ((size_t)s->sample_length + dsp::FIRipol_N) *
+                                sample::Sample::bitDepthByteSize(bitDepth);
+            void *chan[2]{nullptr, nullptr};
+            bool inRange{true};
+            for (int c = 0; c < channels; ++c)
+            {
+                inRange = inRange && offsets[c] + channelBytes <= data->size();
+                if (inRange)
+                    chan[c] = (void *)(data->data() + offsets[c]);
+                inRange = inRange && (uintptr_t)chan[c] % monolithDataAlignment == 0;
+            }
+
+            s->type = addr.type;
+            s->mFileName = addr.path;
+            s->md5Sum = addr.md5sum;
+            s->contentHashKind = addr.contentHashKind;
+            s->preset = addr.preset;
+            s->instrument = addr.instrument;
+            s->region = addr.region;
+            s->fileSize = addr.fileSize;
+            s->channels = (uint8_t)channels;
+            s->InvSampleRate = 1.f / s->sample_rate;
+
+            std::string name;
+            json::findIf(ev, "name", name);
+            strncpy(s->name, name.c_str(), sizeof(s->name) - 1);
+
+            if (auto *mv = ev.find("meta"))
+            {
+                auto &m = s->meta;
+                int rootKey{0}, keyLow{0}, keyHigh{0}, velLow{0}, velHigh{0}, playMode{0};
+                json::findIf(*mv, "loopPresent", m.loop_present);
+                json::findIf(*mv, "loopStart", m.loop_start);
+                json::findIf(*mv, "loopEnd", m.loop_end);
+                json::findIf(*mv, "rootKeyPresent", m.rootkey_present);
+                json::findIf(*mv, "rootKey", rootKey);
+                json::findIf(*mv, "keyPresent", m.key_present);
+                json::findIf(*mv, "keyLow", keyLow);
+                json::findIf(*mv, "keyHigh", keyHigh);
+                json::findIf(*mv, "velPresent", m.vel_present);
+                json::findIf(*mv, "velLow", velLow);
+                json::findIf(*mv, "velHigh", velHigh);
+                json::findIf(*mv, "playModePresent", m.playmode_present);
+                json::findIf(*mv, "playMode", playMode);
+                json::findIf(*mv, "detune", m.detune);
+                m.key_root = (char)rootKey;
+                m.key_low = (char)keyLow;
+                m.key_high = (char)keyHigh;
+                m.vel_low = (char)velLow;
+                m.vel_high = (char)velHigh;
+                m.playmode = (sample::Sample::PlayMode)playMode;
+            }
+
+            if (!inRange || !s->referenceMappedData(mapping, chan, bitDepth))
+            {
+                SCLOG("Monolith data for " << s->id.to_string() << " is out of place");
+                continue;
+            }
+            s->Embedded = true;
+            s->sample_loaded = true;
+            res.push_back(s);
+        }
+        catch (const std::exception &e)
+        {
+            SCLOG("Skipping unreadable monolith sample [" << e.what() << "]");
+        }
+    }
+    SCLOG("Monolith has " << res.size() << " embedded samples");
+    return res;
+}
+} // namespace scxt::patch_io
@@ -0,0 +1,78 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_PATCH_IO_MONOLITH_H
+#define SCXT_SRC_PATCH_IO_MONOLITH_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "riff_stream.h"
+#include "sample/sample.h"
+
+namespace scxt::patch_io
+{
+/*
+ * A monolith is a multi saved with its sample data inside it, for when the patch has to
+ * work without the sample library (a touring rig, say) and recall fast.
+ *
+ * Every channel of every embedded sample goes into the 'scsd' chunk exactly as the
+ * generator reads it from memory: the sample's own bit depth, FIRoffset silent frames
+ * either side, starting on a page boundary. The 'scsx' chunk indexes that with all the
+ * metadata loading the file would have worked out. Loading maps the file and points the
+ * samples at the mapping, so nothing is decoded or copied and the OS pages data in as it
+ * plays. The samples keep their original addresses, so saving again as a plain multi
+ * refers to the files as before.
+ *
+ * RIFF sizes are 32 bit, so a monolith can't hold more than 4GB of sample data.
+ */
+static constexpr size_t monolithDataAlignment{4096};
+
+/*
+ * dataFor gives the sample to take each one's data from (SampleManager::fullDataFor, so an
+ * evicted sample is read back one at a time while it is written rather than all at once).
+ * Returns the samples it couldn't get data for, which stay references to their files.
+ */
+using monolithDataSource_t =
+    std::function<std::shared_ptr<const sample::Sample>(const std::shared_ptr<sample::Sample> &)>;
+std::vector<std::shared_ptr<sample::Sample>>
+addMonolithSampleChunks(RIFFStreamWriter &, const std::vector<std::shared_ptr<sample::Sample>> &,
+                        const monolithDataSource_t &dataFor);
+
+bool hasMonolithSamples(const RIFFMappedReader &);
+
+/*
+ * The embedded samples, ready to hand to SampleManager::provideEmbeddedSamples. They hold
+ * the reader, and so the mapping, alive. Any we can't use (a damaged index, say) are left
+ * out and load from their addresses as usual.
+ */
+std::vector<std::shared_ptr<sample::Sample>>
+readMonolithSamples(const std::shared_ptr<RIFFMappedReader> &);
+} // namespace scxt::patch_io
+
+#endif // SCXT_SRC_PATCH_IO_MONOLITH_H
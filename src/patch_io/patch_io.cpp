@@ -25,7 +25,10 @@
  * https://github.com/surge-synthesizer/shortcircuit-xt
  */
 
+#include <algorithm>
 #include <fstream>
+#include <sstream>
+#include <unordered_set>
 
 #include "tao/json/msgpack/consume_string.hpp"
 #include "tao/json/msgpack/from_binary.hpp"
@@ -35,14 +38,15 @@
 #include "tao/json/msgpack/to_stream.hpp"
 #include "tao/json/msgpack/to_string.hpp"
 
-#include "RIFF.h" // from libgig
-
 #include "utils.h"
 #include "patch_io.h"
+#include "riff_stream.h"
+#include "monolith.h"
 #include "engine/engine.h"
 #include "messaging/messaging.h"
 
 #include "json/engine_traits.h"
+#include "json/engine_events.h"
 
 #include "cmrc/cmrc.hpp"
 
@@ -50,66 +54,303 @@ CMRC_DECLARE(scxt_resources_core);
 
 namespace scxt::patch_io
 {
-void addSCManifest(const std::unique_ptr<RIFF::File> &f, const std::string &type)
+void addSCManifest(RIFFStreamWriter &f, const std::string &type)
 {
     std::map<std::string, std::string> manifest;
     manifest["version"] = "1";
     manifest["type"] = type;
-    auto mmsg = tao::json::to_string(json::scxt_value(manifest));
-    auto c = f->AddSubChunk('scmf', mmsg.size());
-    auto d = (uint8_t *)c->LoadChunkData();
-    memcpy(d, mmsg.data(), mmsg.size());
+    f.addChunk('scmf', tao::json::to_string(json::scxt_value(manifest)));
 }
 
-std::unordered_map<std::string, std::string> readSCManifest(const std::unique_ptr<RIFF::File> &f)
+std::unordered_map<std::string, std::string> readSCManifest(const RIFFMappedReader &f)
 {
-    auto c1 = f->GetSubChunk('scmf');
-    std::string s((char *)c1->LoadChunkData(), c1->GetSize());
+    std::unordered_map<std::string, std::string> manifest;
+    auto c = f.getChunk('scmf');
+    if (!c.has_value())
+        return manifest;
 
     tao::json::events::transformer<tao::json::events::to_basic_value<json::scxt_traits>> consumer;
-    tao::json::events::from_string(consumer, s);
+    tao::json::events::from_string(consumer, c->data(), c->size());
     auto jv = std::move(consumer.value);
-    std::unordered_map<std::string, std::string> manifest;
     jv.to(manifest);
 
     return manifest;
 }
 
-void addSCDataChunk(const std::unique_ptr<RIFF::File> &f, const std::string &msg)
+/*
+ * The patch data goes as msgpack events straight into the file. Under the ChildEventsGuard
+ * each part, group and zone is turned into a value only as it is written, so saving never
+ * holds a value of the whole patch.
+ */
+template <typename T> void addSCDataChunk(RIFFStreamWriter &f, const T &t)
+{
+    f.addChunk('scdt', [&t](std::ostream &os) {
+        json::ChildEventsGuard cg;
+        tao::json::msgpack::to_stream(os, json::scxt_value(t));
+    });
+}
+
+PatchSummary summarizePatch(const scxt::engine::Engine &e, const std::string &type, int onlyPart)
+{
+    PatchSummary res;
+    res.type = type;
+    res.zoneCount = 0;
+    res.sampleBytes = 0;
+
+    std::unordered_set<std::string> seen;
+    for (int i = 0; i < numParts; ++i)
+    {
+        if (onlyPart >= 0 && i != onlyPart)
+            continue;
+        const auto &part = e.getPatch()->getPart(i);
+        if (part->getGroups().empty())
+            continue;
+        res.partNames.push_back(part->getName());
+        for (const auto &g : part->getGroups())
+        {
+            for (const auto &z : g->getZones())
+            {
+                res.zoneCount++;
+                for (const auto &v : z->variantData.variants)
+                {
+                    if (!v.active || !seen.insert(v.sampleID.to_string()).second)
+                        continue;
+                    res.sampleIDs.push_back(v.sampleID);
+                    auto smp = e.getSampleManager()->getSample(v.sampleID);
+                    if (smp)
+                        res.sampleBytes += (int64_t)smp->getDataSize();
+                }
+            }
+        }
+    }
+    return res;
+}
+
+void addSCSummaryChunk(RIFFStreamWriter &f, const PatchSummary &summary)
+{
+    json::scxt_value names = tao::json::empty_array;
+    for (const auto &n : summary.partNames)
+        names.get_array().emplace_back(n);
+    json::scxt_value ids = tao::json::empty_array;
+    for (const auto &id : summary.sampleIDs)
+        ids.get_array().emplace_back(json::scxt_value(id));
+
+    json::scxt_value v = {{"version", 1},
+                          {"partNames", names},
+                          {"zoneCount", summary.zoneCount},
+                          {"sampleIDs", ids},
+                          {"sampleBytes", summary.sampleBytes}};
+    f.addChunk('scsm', tao::json::to_string(v));
+}
+
+namespace
+{
+/*
+ * Works the summary out of the patch data of a file saved before the 'scsm' chunk, with a
+ * value made only of each zone in turn and of each part's config. Sample sizes need the
+ * samples loaded, so sampleBytes stays at -1.
+ */
+struct LegacySummarySink
+{
+    PatchSummary &summary;
+    std::unordered_set<std::string> seen;
+    bool partHasGroups{false};
+    json::scxt_value partConfig;
+
+    void begin(json::EngineEventLevel l)
+    {
+        if (l == json::EngineEventLevel::PART)
+        {
+            partHasGroups = false;
+            partConfig = tao::json::empty_object;
+        }
+        else if (l == json::EngineEventLevel::GROUP)
+        {
+            partHasGroups = true;
+        }
+    }
+
+    void member(json::EngineEventLevel l, const std::string &key, json::scxt_value &&v)
+    {
+        if (l == json::EngineEventLevel::PART && key == "config")
+            partConfig = std::move(v);
+    }
+
+    void zone(json::scxt_value &&v)
+    {
+        summary.zoneCount++;
+        auto *vd = v.find("variantData");
+        if (!vd)
+            vd = v.find("sampleData");
+        auto *vars = vd ? vd->find("variants") : nullptr;
+        if (!vars && vd)
+            vars = vd->find("samples");
+        if (!vars || !vars->is_array())
+            return;
+        for (const auto &sv : vars->get_array())
+        {
+            auto *a = sv.find("active");
+            auto *id = sv.find("id");
+            if (!a || !a->is_boolean() || !a->get_boolean() || !id)
+                continue;
+            SampleID sid;
+            id->to(sid);
+            if (seen.insert(sid.to_string()).second)
+                summary.sampleIDs.push_back(sid);
+        }
+    }
+
+    void end(json::EngineEventLevel l)
+    {
+        if (l != json::EngineEventLevel::PART || !partHasGroups)
+            return;
+        engine::Part::PartConfiguration cfg;
+        if (partConfig.is_object())
+            partConfig.to(cfg);
+        summary.partNames.push_back(engine::Part::nameFor(cfg));
+    }
+};
+
+void summarizeLegacyData(const RIFFMappedReader &f, PatchSummary &res)
+{
+    auto data = f.getChunk('scdt');
+    if (!data.has_value())
+        return;
+
+    PatchSummary walked;
+    walked.zoneCount = 0;
+    LegacySummarySink sink{walked};
+    json::EngineEventWalker<tao::json::events::to_basic_value<json::scxt_traits>,
+                            LegacySummarySink>
+        walker(sink, true,
+               res.type == "part" ? json::EngineEventLevel::PART : json::EngineEventLevel::ENGINE);
+    tao::json::msgpack::events::from_string(walker, data->data(), data->size());
+
+    res.partNames = std::move(walked.partNames);
+    res.zoneCount = walked.zoneCount;
+    res.sampleIDs = std::move(walked.sampleIDs);
+}
+} // namespace
+
+std::optional<PatchSummary> readPatchSummary(const fs::path &p)
 {
-    auto c = f->AddSubChunk('scdt', msg.size());
-    auto d = (uint8_t *)c->LoadChunkData();
-    memcpy(d, msg.data(), msg.size());
+    try
+    {
+        RIFFMappedReader f(p);
+        if (!f.isValid() || !f.getChunk('scmf').has_value())
+            return std::nullopt;
+
+        PatchSummary res;
+        res.path = p;
+        auto manifest = readSCManifest(f);
+        res.type = manifest["type"];
+
+        auto c = f.getChunk('scsm');
+        if (!c.has_value())
+        {
+            try
+            {
+                summarizeLegacyData(f, res);
+            }
+            catch (const std::exception &e)
+            {
+                SCLOG("Unable to summarize patch data in " << p.u8string() << " [" << e.what()
+                                                          << "]");
+            }
+            return res;
+        }
+        tao::json::events::transformer<tao::json::events::to_basic_value<json::scxt_traits>>
+            consumer;
+        tao::json::events::from_string(consumer, c->data(), c->size());
+        auto jv = std::move(consumer.value);
+
+        if (auto *n = jv.find("partNames"))
+            for (const auto &pn : n->get_array())
+                res.partNames.push_back(pn.get_string());
+        if (auto *z = jv.find("zoneCount"))
+            z->to(res.zoneCount);
+        if (auto *ids = jv.find("sampleIDs"))
+        {
+            for (const auto &iv : ids->get_array())
+            {
+                SampleID id;
+                iv.to(id);
+                res.sampleIDs.push_back(id);
+            }
+        }
+        if (auto *b = jv.find("sampleBytes"))
+            b->to(res.sampleBytes);
+        return res;
+    }
+    catch (const std::exception &e)
+    {
+        SCLOG("Unable to read patch summary from " << p.u8string() << " [" << e.what() << "]");
+    }
+    return std::nullopt;
 }
 
-std::string readSCDataChunk(const std::unique_ptr<RIFF::File> &f)
+/*
+ * Evicted samples, and ones the audio thread is swapping data in or out of, are embedded too;
+ * addMonolithSampleChunks gets their data through SampleManager::fullDataFor as it writes.
+ */
+std::vector<std::shared_ptr<sample::Sample>> samplesToEmbed(const sample::SampleManager &sm)
 {
-    auto cp = f->GetSubChunk('scdt');
-    return std::string((char *)cp->LoadChunkData(), cp->GetSize());
+    std::vector<std::shared_ptr<sample::Sample>> res;
+    for (auto it = sm.samplesBegin(); it != sm.samplesEnd(); ++it)
+    {
+        const auto &s = it->second;
+        if (s->isMissingPlaceholder)
+            continue;
+        if (!s->dataSwapInFlight && !s->isEvicted() && !s->sampleData[0])
+            continue;
+        res.push_back(s);
+    }
+    // A stable order, so saving an unchanged multi writes the same file
+    std::sort(res.begin(), res.end(),
+              [](const auto &a, const auto &b) { return a->id.to_string() < b->id.to_string(); });
+    return res;
 }
 
-bool saveMulti(const fs::path &p, const scxt::engine::Engine &e)
+bool saveMulti(const fs::path &p, const scxt::engine::Engine &e, bool embedSamples)
 {
-    SCLOG("Saving Multi to " << p.u8string());
+    SCLOG("Saving " << (embedSamples ? "Monolith" : "Multi") << " to " << p.u8string());
 
     try
     {
         auto sg = scxt::engine::Engine::StreamGuard(engine::Engine::FOR_MULTI);
-        auto msg = tao::json::msgpack::to_string(json::scxt_value(e));
 
-        auto f = std::make_unique<RIFF::File>('SCXT');
-        f->SetByteOrder(RIFF::endian_little);
+        RIFFStreamWriter f(p, 'SCXT');
         addSCManifest(f, "multi");
-        addSCDataChunk(f, msg);
+        addSCSummaryChunk(f, summarizePatch(e, "multi", -1));
+        addSCDataChunk(f, e);
+        std::vector<std::shared_ptr<sample::Sample>> notEmbedded;
+        if (embedSamples)
+        {
+            auto &sm = e.getSampleManager();
+            notEmbedded = addMonolithSampleChunks(
+                f, samplesToEmbed(*sm), [&sm](const auto &s) { return sm->fullDataFor(s); });
+        }
 
-        // TODO: If embeeding samples, add a list here with them
-        f->Save(p.u8string());
+        auto res = f.finish();
+        if (res && !notEmbedded.empty())
+        {
+            std::ostringstream oss;
+            oss << "The monolith was saved, but these samples could not be read to embed, so it "
+                   "refers to their files instead:\n";
+            for (const auto &s : notEmbedded)
+            {
+                SCLOG("Not embedding unreadable sample " << s->getPath().u8string());
+                oss << "\n" << s->getPath().u8string();
+            }
+            e.getMessageController()->reportErrorToClient("Samples Not Embedded", oss.str());
+        }
+        return res;
     }
-    catch (const RIFF::Exception &e)
+    catch (const std::exception &err)
     {
-        SCLOG(e.Message);
+        SCLOG("Unable to save multi [" << err.what() << "]");
     }
-    return true;
+    return false;
 }
 
 bool savePart(const fs::path &p, const scxt::engine::Engine &e, int part)
@@ -119,34 +360,34 @@ bool savePart(const fs::path &p, const scxt::engine::Engine &e, int part)
     try
     {
         auto sg = scxt::engine::Engine::StreamGuard(engine::Engine::FOR_PART);
-        auto msg = tao::json::msgpack::to_string(json::scxt_value(*(e.getPatch()->getPart(part))));
 
-        auto f = std::make_unique<RIFF::File>('SCXT');
-        f->SetByteOrder(RIFF::endian_little);
+        RIFFStreamWriter f(p, 'SCXT');
         addSCManifest(f, "part");
-        addSCDataChunk(f, msg);
+        addSCSummaryChunk(f, summarizePatch(e, "part", part));
+        addSCDataChunk(f, *(e.getPatch()->getPart(part)));
 
         // TODO: If embeeding samples, add a list here with them
-        f->Save(p.u8string());
+        return f.finish();
     }
-    catch (const RIFF::Exception &e)
+    catch (const std::exception &err)
     {
-        SCLOG(e.Message);
+        SCLOG("Unable to save part [" << err.what() << "]");
     }
-    return true;
+    return false;
 }
 
 bool initFromResourceBundle(scxt::engine::Engine &engine)
 {
     SCLOG("Init From Resource Bundle");
 
-    std::string payload;
+    // The resource is compiled in, so we can unstream from it where it sits
+    std::string_view payload;
 
     try
     {
         auto fs = cmrc::scxt_resources_core::get_filesystem();
         auto fntf = fs.open("InitSettings.dat");
-        payload = std::string(fntf.begin(), fntf.end());
+        payload = std::string_view(fntf.begin(), fntf.size());
     }
     catch (std::exception &e)
     {
@@ -190,26 +431,29 @@ bool loadMulti(const fs::path &p, scxt::engine::Engine &engine)
 {
     SCLOG("loadMulti " << p.u8string());
 
-    std::string payload;
-    try
-    {
-        auto f = std::make_unique<RIFF::File>(p.u8string());
-        auto manifest = readSCManifest(f);
-        payload = readSCDataChunk(f);
-    }
-    catch (const RIFF::Exception &e)
+    // Parse the data chunk in place in the mapped file, which the reader keeps alive until
+    // the serial thread is done with it
+    auto f = std::make_shared<RIFFMappedReader>(p);
+    auto data = f->isValid() ? f->getChunk('scdt') : std::nullopt;
+    if (!data.has_value())
     {
-        SCLOG("RIFF::Exception " << e.Message);
+        SCLOG("Unable to read patch data from " << p.u8string());
         return false;
     }
+    auto manifest = readSCManifest(*f);
+    auto payload = *data;
+    auto embedded = hasMonolithSamples(*f) ? readMonolithSamples(f)
+                                           : std::vector<std::shared_ptr<sample::Sample>>();
 
     auto &cont = engine.getMessageController();
     if (cont->isAudioRunning)
     {
-        cont->stopAudioThreadThenRunOnSerial([payload, &nonconste = engine](auto &e) {
+        cont->stopAudioThreadThenRunOnSerial([f, payload, embedded,
+                                              &nonconste = engine](auto &e) {
             try
             {
                 nonconste.stopAllSounds();
+                nonconste.getSampleManager()->provideEmbeddedSamples(embedded);
                 scxt::json::unstreamEngineState(nonconste, payload, true);
                 auto &cont = *e.getMessageController();
                 cont.restartAudioThreadFromSerial();
@@ -225,6 +469,7 @@ bool loadMulti(const fs::path &p, scxt::engine::Engine &engine)
         try
         {
             engine.stopAllSounds();
+            engine.getSampleManager()->provideEmbeddedSamples(embedded);
             scxt::json::unstreamEngineState(engine, payload, true);
         }
         catch (std::exception &err)
@@ -239,23 +484,22 @@ bool loadPartInto(const fs::path &p, scxt::engine::Engine &engine, int part)
 {
     SCLOG("loadPart " << p.u8string() << " " << part);
 
-    std::string payload;
-    try
-    {
-        auto f = std::make_unique<RIFF::File>(p.u8string());
-        auto manifest = readSCManifest(f);
-        payload = readSCDataChunk(f);
-    }
-    catch (const RIFF::Exception &e)
+    // Parse the data chunk in place in the mapped file, which the reader keeps alive until
+    // the serial thread is done with it
+    auto f = std::make_shared<RIFFMappedReader>(p);
+    auto data = f->isValid() ? f->getChunk('scdt') : std::nullopt;
+    if (!data.has_value())
     {
-        SCLOG("RIFF::Exception " << e.Message);
+        SCLOG("Unable to read patch data from " << p.u8string());
         return false;
     }
+    auto manifest = readSCManifest(*f);
+    auto payload = *data;
 
     auto &cont = engine.getMessageController();
     if (cont->isAudioRunning)
     {
-        cont->stopAudioThreadThenRunOnSerial([payload, part, &nonconste = engine](auto &e) {
+        cont->stopAudioThreadThenRunOnSerial([f, payload, part, &nonconste = engine](auto &e) {
             try
             {
                 nonconste.stopAllSounds();
@@ -30,10 +30,15 @@
 
 #include "engine/patch.h"
 #include "engine/part.h"
+#include "patch_summary.h"
 
 namespace scxt::patch_io
 {
-bool saveMulti(const fs::path &toFile, const scxt::engine::Engine &);
+/*
+ * With embedSamples this writes a monolith, carrying the loaded sample data with the
+ * multi (see monolith.h). loadMulti reads either.
+ */
+bool saveMulti(const fs::path &toFile, const scxt::engine::Engine &, bool embedSamples = false);
 bool loadMulti(const fs::path &fromFile, scxt::engine::Engine &);
 bool savePart(const fs::path &toFile, const scxt::engine::Engine &, int part);
 bool loadPartInto(const fs::path &fromFile, scxt::engine::Engine &, int part);
@@ -0,0 +1,67 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_PATCH_IO_PATCH_SUMMARY_H
+#define SCXT_SRC_PATCH_IO_PATCH_SUMMARY_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "filesystem/import.h"
+#include "utils.h"
+
+namespace scxt::patch_io
+{
+/*
+ * What a patch holds, written into the patch file beside the manifest when we save so the
+ * browser can list and filter patches, and show what they would cost in memory, without
+ * unstreaming them. The names are those of the parts with groups in them; the sample ids
+ * are the distinct samples of the active zone variants and sampleBytes the size of their
+ * data once loaded. For files saved before the summary existed the names, zone count and
+ * sample ids are worked out from the patch data instead; their sampleBytes stays at -1.
+ */
+struct PatchSummary
+{
+    fs::path path;
+    std::string type;
+    std::vector<std::string> partNames;
+    int32_t zoneCount{-1};
+    std::vector<SampleID> sampleIDs;
+    int64_t sampleBytes{-1};
+};
+
+/*
+ * Reads just the manifest and summary chunks of a patch file, so is cheap enough to run
+ * over a whole library. Files without a summary chunk have their patch data walked a zone
+ * at a time; if that fails only the type is filled in. Returns nullopt if this isn't a
+ * patch file we can read.
+ */
+std::optional<PatchSummary> readPatchSummary(const fs::path &fromFile);
+} // namespace scxt::patch_io
+
+#endif // SCXT_SRC_PATCH_IO_PATCH_SUMMARY_H
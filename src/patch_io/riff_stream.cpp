@@ -0,0 +1,204 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "riff_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "utils.h"
+
+namespace scxt::patch_io
+{
+namespace
+{
+uint32_t get32(const uint8_t *d)
+{
+    return d[0] | (d[1] << 8) | (d[2] << 16) | ((uint32_t)d[3] << 24);
+}
+} // namespace
+
+RIFFStreamWriter::RIFFStreamWriter(const fs::path &to, uint32_t formType) : target(to)
+{
+    partial = to;
+    partial += ".saving";
+    os.open(partial, std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+    {
+        SCLOG("Unable to open " << partial.u8string() << " for writing");
+        failed = true;
+        return;
+    }
+    os.write("RIFF", 4);
+    put32(0); // patched in finish
+    put32(formType);
+}
+
+RIFFStreamWriter::~RIFFStreamWriter()
+{
+    if (!finished)
+    {
+        os.close();
+        std::error_code ec;
+        fs::remove(partial, ec);
+    }
+}
+
+void RIFFStreamWriter::put32(uint32_t v)
+{
+    char b[4]{(char)(v & 0xFF), (char)((v >> 8) & 0xFF), (char)((v >> 16) & 0xFF),
+              (char)((v >> 24) & 0xFF)};
+    os.write(b, 4);
+}
+
+void RIFFStreamWriter::beginChunk(uint32_t id)
+{
+    put32(id);
+    chunkStart = os.tellp();
+    put32(0);
+}
+
+void RIFFStreamWriter::endChunk()
+{
+    if (!os.good())
+    {
+        failed = true;
+        return;
+    }
+    std::streamoff end = os.tellp();
+    auto size = end - chunkStart - 4;
+    if (size > std::numeric_limits<uint32_t>::max())
+    {
+        SCLOG("Chunk of " << size << " bytes is too large for a RIFF file");
+        failed = true;
+        return;
+    }
+    os.seekp(chunkStart);
+    put32((uint32_t)size);
+    os.seekp(end);
+    if (size & 1)
+        os.put(0);
+}
+
+void RIFFStreamWriter::addChunk(uint32_t id, const std::string &data)
+{
+    addChunk(id, [&data](std::ostream &o) { o.write(data.data(), data.size()); });
+}
+
+void RIFFStreamWriter::addChunk(uint32_t id, const std::function<void(std::ostream &)> &writeBody)
+{
+    if (failed)
+        return;
+    beginChunk(id);
+    writeBody(os);
+    endChunk();
+}
+
+bool RIFFStreamWriter::finish()
+{
+    if (finished)
+        return !failed;
+    finished = true;
+
+    failed = failed || !os.good();
+    if (!failed)
+    {
+        std::streamoff end = os.tellp();
+        if (end - 8 > std::numeric_limits<uint32_t>::max())
+        {
+            SCLOG("Patch of " << end << " bytes is too large for a RIFF file");
+            failed = true;
+        }
+        else
+        {
+            os.seekp(4);
+            put32((uint32_t)(end - 8));
+        }
+    }
+    os.close();
+    failed = failed || os.fail();
+
+    std::error_code ec;
+    if (!failed)
+    {
+        fs::rename(partial, target, ec);
+        if (ec)
+        {
+            SCLOG("Unable to move " << partial.u8string() << " to " << target.u8string() << " : "
+                                    << ec.message());
+            failed = true;
+        }
+    }
+    if (failed)
+        fs::remove(partial, ec);
+    return !failed;
+}
+
+RIFFMappedReader::RIFFMappedReader(const fs::path &from)
+{
+    std::error_code ec;
+    if (!fs::is_regular_file(from, ec))
+        return;
+
+    view = std::make_unique<infrastructure::FileMapView>(from);
+    if (!view->isMapped() || view->dataSize() < 12)
+        return;
+
+    auto d = (const uint8_t *)view->data();
+    if (memcmp(d, "RIFF", 4) != 0)
+        return;
+
+    auto end = std::min((size_t)get32(d + 4) + 8, view->dataSize());
+    formType = get32(d + 8);
+
+    size_t pos = 12;
+    while (pos + 8 <= end)
+    {
+        auto id = get32(d + pos);
+        size_t size = get32(d + pos + 4);
+        if (pos + 8 + size > end)
+        {
+            SCLOG("Truncated chunk in " << from.u8string());
+            return;
+        }
+        chunks.emplace_back(id, std::string_view((const char *)d + pos + 8, size));
+        pos += 8 + size + (size & 1);
+    }
+    valid = true;
+}
+
+std::optional<std::string_view> RIFFMappedReader::getChunk(uint32_t id) const
+{
+    for (const auto &[cid, data] : chunks)
+    {
+        if (cid == id)
+            return data;
+    }
+    return std::nullopt;
+}
+} // namespace scxt::patch_io
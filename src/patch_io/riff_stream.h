@@ -0,0 +1,95 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_PATCH_IO_RIFF_STREAM_H
+#define SCXT_SRC_PATCH_IO_RIFF_STREAM_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "filesystem/import.h"
+#include "infrastructure/file_map_view.h"
+
+namespace scxt::patch_io
+{
+/*
+ * Writes a flat RIFF file, byte for byte as libgig's RIFF::File lays out our patches
+ * (little endian, ids written as the native multi-character constant, odd chunks padded),
+ * but straight to disk so a chunk can be streamed in without first building it in memory.
+ * The file is written beside the target and only moved over it by finish(), so a save
+ * which fails part way leaves the old file alone.
+ */
+struct RIFFStreamWriter
+{
+    RIFFStreamWriter(const fs::path &to, uint32_t formType);
+    ~RIFFStreamWriter();
+
+    void addChunk(uint32_t id, const std::string &data);
+    // For chunks we don't know the size of until they are written
+    void addChunk(uint32_t id, const std::function<void(std::ostream &)> &writeBody);
+
+    bool finish();
+
+  private:
+    void put32(uint32_t v);
+    void beginChunk(uint32_t id);
+    void endChunk();
+
+    fs::path target, partial;
+    std::ofstream os;
+    std::streamoff chunkStart{0};
+    bool failed{false}, finished{false};
+};
+
+/*
+ * A RIFF file mapped into memory, with the chunks at the top level found in place. Our
+ * data chunk can be many megabytes and this lets us parse it where it sits rather than
+ * copying it out. The views are valid for the life of the reader.
+ */
+struct RIFFMappedReader
+{
+    explicit RIFFMappedReader(const fs::path &from);
+
+    bool isValid() const { return valid; }
+    uint32_t getFormType() const { return formType; }
+    std::optional<std::string_view> getChunk(uint32_t id) const;
+
+  private:
+    std::unique_ptr<infrastructure::FileMapView> view;
+    std::vector<std::pair<uint32_t, std::string_view>> chunks;
+    uint32_t formType{0};
+    bool valid{false};
+};
+} // namespace scxt::patch_io
+
+#endif // SCXT_SRC_PATCH_IO_RIFF_STREAM_H
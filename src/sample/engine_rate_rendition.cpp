@@ -0,0 +1,185 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "engine_rate_rendition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "sample.h"
+#include "dsp/resampling.h"
+#include "dsp/sample_conversion.h"
+#include "infrastructure/resident_memory.h"
+
+namespace scxt::sample
+{
+namespace
+{
+/*
+ * A Blackman-Harris windowed sinc, tabulated at phasesPerFrame points per input frame
+ * across its whole width and linearly interpolated between them. The cutoff sits a little
+ * under the lower of the two Nyquists, and the kernel widens in proportion when we go
+ * down in rate so its transition band stays the same width at the output.
+ */
+struct ResampleKernel
+{
+    static constexpr int halfTaps{48};
+    static constexpr int phasesPerFrame{512};
+    static constexpr double passband{0.94};
+
+    int halfWidth{halfTaps}; // in input frames
+    std::vector<float> table;
+
+    explicit ResampleKernel(double ratio)
+    {
+        auto scale = std::min(1.0, ratio);
+        auto cutoff = passband * scale;
+        halfWidth = (int)std::ceil(halfTaps / scale);
+
+        table.resize(2 * halfWidth * phasesPerFrame + 2);
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            auto d = (double)i / phasesPerFrame - halfWidth;
+            auto u = d / halfWidth;
+            if (std::fabs(u) >= 1.0)
+            {
+                table[i] = 0.f;
+                continue;
+            }
+            auto x = M_PI * cutoff * d;
+            auto sinc = (d == 0.0) ? 1.0 : std::sin(x) / x;
+            auto win = 0.35875 + 0.48829 * std::cos(M_PI * u) + 0.14128 * std::cos(2 * M_PI * u) +
+                       0.01168 * std::cos(3 * M_PI * u);
+            table[i] = (float)(cutoff * sinc * win);
+        }
+    }
+};
+
+template <typename T>
+bool resample(EngineRateRendition &res, const T *const data[2], uint32_t length)
+{
+    ResampleKernel kernel(res.ratio);
+    const auto hw = kernel.halfWidth;
+    const auto P = ResampleKernel::phasesPerFrame;
+    const auto *tab = kernel.table.data();
+
+    std::vector<float> src(length + 4 * hw);
+    for (int c = 0; c < res.channels; ++c)
+    {
+        // zero padded both sides so the window never needs bounds checks
+        std::fill(src.begin(), src.end(), 0.f);
+        for (uint32_t i = 0; i < length; ++i)
+            src[i + 2 * hw] = dsp::sample_conversion::toNativeFloat(data[c][i]);
+
+        auto frames = res.length + dsp::FIRipol_N;
+        res.owner[c] = infrastructure::ResidentMemory::instance().allocate(sizeof(T) * frames);
+        if (!res.owner[c])
+            return false;
+        auto *d = (T *)res.owner[c].get();
+        memset((void *)d, 0, dsp::FIRoffset * sizeof(T));
+        memset((void *)(d + dsp::FIRoffset + res.length), 0, dsp::FIRoffset * sizeof(T));
+        d += dsp::FIRoffset;
+        res.sampleData[c] = d;
+
+        for (uint32_t m = 0; m < res.length; ++m)
+        {
+            auto t = m / res.ratio;
+            auto i0 = (int64_t)std::floor(t);
+            auto frac = t - i0;
+
+            // the first tap is input frame i0 - hw + 1, at a distance of frac + hw - 1
+            auto pos = (frac + 2 * hw - 1) * P;
+            auto ib = (int64_t)pos;
+            auto f = (float)(pos - ib);
+            const auto *x = src.data() + 2 * hw + i0 - hw + 1;
+            float acc{0.f};
+            for (int j = 0; j < 2 * hw; ++j)
+            {
+                auto *k = tab + ib - j * P;
+                acc += x[j] * (k[0] + (k[1] - k[0]) * f);
+            }
+            d[m] = dsp::sample_conversion::fromNativeFloat<T>(acc);
+        }
+    }
+    return true;
+}
+} // namespace
+
+size_t EngineRateRendition::sizeInBytes() const
+{
+    size_t bps = format == dsp::SF_F32   ? sizeof(float)
+                 : format == dsp::SF_I24 ? sizeof(dsp::PackedInt24)
+                                         : sizeof(int16_t);
+    return (length + dsp::FIRipol_N) * bps * channels;
+}
+
+std::shared_ptr<const EngineRateRendition> EngineRateRendition::build(Sample &s,
+                                                                      double engineRate)
+{
+    if (s.isEvicted() || s.channels < 1 || s.channels > 2 || s.sample_length == 0 ||
+        s.sample_rate <= 0 || engineRate <= 0 || s.sample_rate == engineRate)
+        return nullptr;
+
+    auto res = std::make_shared<EngineRateRendition>();
+    res->sampleRate = engineRate;
+    res->ratio = engineRate / s.sample_rate;
+    res->channels = s.channels;
+    res->length = (uint32_t)std::floor((s.sample_length - 1) * res->ratio) + 1;
+
+    bool ok{false};
+    switch (s.bitDepth)
+    {
+    case Sample::BD_F32:
+    {
+        res->format = dsp::SF_F32;
+        const float *d[2]{s.GetSamplePtrF32(0), s.GetSamplePtrF32(1)};
+        ok = resample(*res, d, s.sample_length);
+    }
+    break;
+    case Sample::BD_I24:
+    {
+        res->format = dsp::SF_I24;
+        const dsp::PackedInt24 *d[2]{s.GetSamplePtrI24(0), s.GetSamplePtrI24(1)};
+        ok = resample(*res, d, s.sample_length);
+    }
+    break;
+    case Sample::BD_I16:
+    {
+        res->format = dsp::SF_I16;
+        const int16_t *d[2]{s.GetSamplePtrI16(0), s.GetSamplePtrI16(1)};
+        ok = resample(*res, d, s.sample_length);
+    }
+    break;
+    }
+
+    if (!ok)
+        return nullptr;
+    return res;
+}
+} // namespace scxt::sample
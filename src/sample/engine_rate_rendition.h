@@ -0,0 +1,72 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_ENGINE_RATE_RENDITION_H
+#define SCXT_SRC_SAMPLE_ENGINE_RATE_RENDITION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "dsp/generator.h"
+
+namespace scxt::sample
+{
+struct Sample;
+
+/*
+ * A copy of a sample resampled offline to the engine's rate. A voice playing a 44.1k
+ * sample in a 48k engine otherwise runs the sinc at a ratio of 0.91875 for every note;
+ * reading this instead, a note at the root plays at a ratio of exactly 1 (which the
+ * generator copies rather than interpolates) and anything else resamples from a source
+ * which is already band limited for the engine.
+ *
+ * The data is in the sample's own format, laid out like Sample data with FIRoffset pad
+ * frames either side. Frame n here is frame n / ratio of the sample. The SampleManager
+ * builds these when renderAtEngineRate is on, at load or when a voice finds the engine
+ * rate has changed, and they are immutable after.
+ */
+struct EngineRateRendition
+{
+    double sampleRate{0};   // the engine rate this was made for
+    double ratio{1};        // frames here per frame of the sample
+    dsp::GeneratorSampleFormat format{dsp::SF_F32};
+    int channels{0};
+    uint32_t length{0};
+    void *sampleData[2]{nullptr, nullptr}; // the first frame, as the generator wants
+    std::shared_ptr<void> owner[2];
+
+    size_t sizeInBytes() const;
+
+    /*
+     * Returns nullptr if the sample is already at engineRate, or has no data resident.
+     */
+    static std::shared_ptr<const EngineRateRendition> build(Sample &s, double engineRate);
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_ENGINE_RATE_RENDITION_H
@@ -559,14 +559,20 @@ bool importEXS(const fs::path &p, engine::Engine &e)
     std::unordered_map<int, SampleID> exsIndexToSampleId;
     std::vector<SampleID> sampleIDByOrder;
 
+    std::vector<fs::path> samplePaths;
     for (auto &s : samples)
     {
-        auto p = fs::path{s.filePath} / s.fileName;
-        auto lsid = e.getSampleManager()->loadSampleByPath(p);
+        samplePaths.push_back(fs::path{s.filePath} / s.fileName);
+    }
+    auto loadedIds = e.getSampleManager()->loadSamplesByPath(samplePaths);
+
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const auto &lsid = loadedIds[i];
         if (lsid.has_value())
         {
             sampleIDByOrder.push_back(*lsid);
-            exsIndexToSampleId[s.within.index] = *lsid;
+            exsIndexToSampleId[samples[i].within.index] = *lsid;
         }
     }
 
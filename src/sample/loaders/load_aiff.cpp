@@ -26,16 +26,20 @@
  */
 
 #include "riff_memfile.h"
+#include "pcm_header.h"
 #include <cassert>
 #include <cmath>
+#include <cstring>
 
 #include "sample/sample.h"
 
 namespace scxt::sample
 {
+namespace loaders
+{
 #define UnsignedToFloat(u) (((double)((long)(u - 2147483647L - 1))) + 2147483648.0)
 
-double ConvertFromIeeeExtended(unsigned char *bytes /* LCN */)
+double ConvertFromIeeeExtended(const unsigned char *bytes /* LCN */)
 {
     double f;
     int expon;
@@ -71,6 +75,70 @@ double ConvertFromIeeeExtended(unsigned char *bytes /* LCN */)
         return f;
 }
 
+std::optional<PCMHeader> parseAiffHeader(const void *data, size_t size)
+{
+    auto *d = (const unsigned char *)data;
+    auto be32 = [](const unsigned char *b) {
+        return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+    };
+
+    if (size < 12 || memcmp(d, "FORM", 4) != 0 ||
+        (memcmp(d + 8, "AIFF", 4) != 0 && memcmp(d + 8, "AIFC", 4) != 0))
+        return std::nullopt;
+
+    PCMHeader res;
+    res.firstChunkOffset = 12;
+    res.bigEndian = true;
+
+    // COMM and SSND can come in either order, with anything else around them
+    bool haveComm{false}, haveData{false};
+    size_t pos{12};
+    while (pos + 8 <= size && !(haveComm && haveData))
+    {
+        auto len = (size_t)be32(d + pos + 4);
+        auto body = pos + 8;
+        if (memcmp(d + pos, "COMM", 4) == 0 && !haveComm && len >= 18 && body + 18 <= size)
+        {
+            auto *comm = d + body;
+            res.channels = (comm[0] << 8) | comm[1];
+            res.frames = be32(comm + 2);
+            res.bitsPerSample = (comm[6] << 8) | comm[7];
+            res.sampleRate = ConvertFromIeeeExtended(comm + 8);
+            // AIFC says how the data is stored after that
+            if (len >= 22 && body + 22 <= size)
+            {
+                auto *ct = comm + 18;
+                if (memcmp(ct, "sowt", 4) == 0)
+                    res.bigEndian = false;
+                else if (memcmp(ct, "fl32", 4) == 0 || memcmp(ct, "FL32", 4) == 0)
+                    res.isFloat = true;
+                else if (memcmp(ct, "NONE", 4) != 0 && memcmp(ct, "twos", 4) != 0)
+                    return std::nullopt;
+            }
+            haveComm = true;
+        }
+        else if (memcmp(d + pos, "SSND", 4) == 0 && !haveData && len >= 8 && body + 8 <= size)
+        {
+            // the data starts offset bytes after the offset and block size
+            auto offset = (size_t)be32(d + body);
+            if (offset > len - 8)
+                return std::nullopt;
+            res.dataOffset = body + 8 + offset;
+            res.dataBytes = len - 8 - offset;
+            haveData = true;
+        }
+        pos = body + len + (len & 1);
+    }
+
+    auto bits = res.bitsPerSample;
+    if (!haveComm || !haveData || res.channels <= 0 || res.sampleRate <= 0 || bits < 8 ||
+        bits > 32 || (res.isFloat && bits != 32))
+        return std::nullopt;
+    res.bytesPerSample = (bits + 7) / 8;
+    return res;
+}
+} // namespace loaders
+
 #pragma pack(push, 1)
 
 struct aiff_CommonChunk
@@ -110,76 +178,44 @@ struct aiff_INST_chunk
 
 bool Sample::parse_aiff(void *data, size_t filesize)
 {
+    auto hdr = loaders::parseAiffHeader(data, filesize);
+    // We only convert integer data
+    if (!hdr || hdr->isFloat || hdr->channels > 2 ||
+        hdr->dataOffset + (size_t)hdr->frames * hdr->bytesPerSample * hdr->channels > filesize)
+        return false;
+
     int datasize;
     scxt::sample::loaders::RIFFMemFile mf(data, filesize);
     mf.useWaveEndian = false;
-    if (!mf.iff_descend_FORM('AIFF', &datasize))
-        return false;
-    off_t wr = mf.TellI();
-
-    if (!mf.iff_descend('COMM', &datasize))
-        return false;
-    aiff_CommonChunk cc;
-    // read header
-    mf.Read(&cc, sizeof(cc));
-    channels = sst::basic_blocks::mechanics::swap_endian_16(cc.numChannels);
-    if (channels > 2)
-        return false;
-    int nsamples = sst::basic_blocks::mechanics::swap_endian_32(cc.numSampleFrames);
-    int bitdepth = sst::basic_blocks::mechanics::swap_endian_16(cc.sampleSize);
-
-    if (!SetMeta(channels, ConvertFromIeeeExtended(cc.sampleRate), nsamples))
-        return false;
+    off_t wr = hdr->firstChunkOffset;
 
-    // load sample data
-    mf.SeekI(wr);
-    if (!mf.iff_descend('SSND', &datasize))
+    channels = hdr->channels;
+    int nsamples = (int)hdr->frames;
+    if (!SetMeta(channels, hdr->sampleRate, nsamples))
         return false;
-    uint32_t offset = sst::basic_blocks::mechanics::swap_endian_32(mf.ReadDWORD());
-    uint32_t blocksize = sst::basic_blocks::mechanics::swap_endian_32(mf.ReadDWORD());
-    mf.SeekI(offset, scxt::sample::loaders::mf_FromCurrent); // skip comment
-
-    unsigned char *loaddata = (unsigned char *)mf.ReadPtr(datasize - 8);
 
-    if (bitdepth == 32)
+    unsigned char *loaddata = (unsigned char *)data + hdr->dataOffset;
+    auto bytes = hdr->bytesPerSample;
+    auto stride = bytes * channels;
+    auto be = hdr->bigEndian;
+    for (int c = 0; c < channels; ++c)
     {
-        if (channels == 2)
+        auto *cd = loaddata + c * bytes;
+        switch (bytes)
         {
-            load_data_i32BE(0, loaddata, nsamples, 8);
-            load_data_i32BE(1, loaddata + 4, nsamples, 8);
+        case 1:
+            load_data_i8(c, cd, nsamples, stride);
+            break;
+        case 2:
+            be ? load_data_i16BE(c, cd, nsamples, stride) : load_data_i16(c, cd, nsamples, stride);
+            break;
+        case 3:
+            be ? load_data_i24BE(c, cd, nsamples, stride) : load_data_i24(c, cd, nsamples, stride);
+            break;
+        case 4:
+            be ? load_data_i32BE(c, cd, nsamples, stride) : load_data_i32(c, cd, nsamples, stride);
+            break;
         }
-        else
-            load_data_i32BE(0, loaddata, nsamples, 4);
-    }
-    else if (bitdepth == 24)
-    {
-        if (channels == 2)
-        {
-            load_data_i24BE(0, loaddata, nsamples, 6);
-            load_data_i24BE(1, loaddata + 3, nsamples, 6);
-        }
-        else
-            load_data_i24BE(0, loaddata, nsamples, 3);
-    }
-    else if (bitdepth == 16)
-    {
-        if (channels == 2)
-        {
-            load_data_i16BE(0, loaddata, nsamples, 4);
-            load_data_i16BE(1, loaddata + 2, nsamples, 4);
-        }
-        else
-            load_data_i16BE(0, loaddata, nsamples, 2);
-    }
-    else if (bitdepth == 8)
-    {
-        if (channels == 2)
-        {
-            load_data_i8(0, loaddata, nsamples, 2);
-            load_data_i8(1, loaddata + 1, nsamples, 2);
-        }
-        else
-            load_data_i8(0, loaddata, nsamples, 1);
     }
 
     this->sample_loaded = (sampleData[0] != 0);
@@ -30,6 +30,7 @@
 #include "FLAC++/decoder.h"
 #include "FLAC++/metadata.h"
 #include "riff_wave.h" // this lets us unpack smpl chunks
+#include "dsp/sample_conversion.h"
 
 namespace scxt::sample
 {
@@ -51,45 +52,27 @@ class SampleFLACDecoder : public FLAC::Decoder::File
     virtual ::FLAC__StreamDecoderWriteStatus write_callback(const ::FLAC__Frame *frame,
                                                             const FLAC__int32 *const buffer[])
     {
+        namespace conv = dsp::sample_conversion;
+        auto n = frame->header.blocksize;
         if (bitDepth == 16 && sample->bitDepth == Sample::BD_I16)
         {
             for (int c = 0; c < sample->channels; ++c)
-            {
-                auto sdata = sample->GetSamplePtrI16(c);
-                for (int i = 0; i < frame->header.blocksize; i++)
-                {
-                    sdata[i + streamPos] = (FLAC__int16)buffer[c][i];
-                }
-            }
-            streamPos += frame->header.blocksize;
+                conv::planarI32ToI16(buffer[c], sample->GetSamplePtrI16(c) + streamPos, n);
+            streamPos += n;
             return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
         }
-        else if (bitDepth == 24 && sample->bitDepth == Sample::BD_F32)
+        else if (bitDepth == 24 && sample->bitDepth == Sample::BD_I24)
         {
             for (int c = 0; c < sample->channels; ++c)
-            {
-                auto sdata = sample->GetSamplePtrF32(c);
-                for (int i = 0; i < frame->header.blocksize; i++)
-                {
-                    sdata[i + streamPos] = buffer[c][i] * 1.f / (1 << 24);
-                }
-            }
-            streamPos += frame->header.blocksize;
-
+                conv::planarI32ToI24(buffer[c], sample->GetSamplePtrI24(c) + streamPos, n);
+            streamPos += n;
             return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
         }
         else if (bitDepth == 32 && sample->bitDepth == Sample::BD_F32)
         {
             for (int c = 0; c < sample->channels; ++c)
-            {
-                auto sdata = sample->GetSamplePtrF32(c);
-                for (int i = 0; i < frame->header.blocksize; i++)
-                {
-                    sdata[i + streamPos] = (double)(buffer[c][i] * 1.0) / (1L << 32);
-                }
-            }
-            streamPos += frame->header.blocksize;
-
+                conv::planarI32ToF32(buffer[c], sample->GetSamplePtrF32(c) + streamPos, n, 32);
+            streamPos += n;
             return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
         }
 
@@ -109,7 +92,8 @@ class SampleFLACDecoder : public FLAC::Decoder::File
 
             sample->sample_rate = sample_rate;
             sample->channels = channels;
-            sample->bitDepth = (bps <= 16 ? Sample::BD_I16 : Sample::BD_F32);
+            sample->bitDepth =
+                (bps <= 16 ? Sample::BD_I16 : (bps == 24 ? Sample::BD_I24 : Sample::BD_F32));
             sample->sample_length = total_samples;
 
             if (bps == 16)
@@ -126,7 +110,21 @@ class SampleFLACDecoder : public FLAC::Decoder::File
                 isValid = true;
                 bitDepth = 16;
             }
-            else if (bps == 24 || bps == 32)
+            else if (bps == 24)
+            {
+                if (channels == 1)
+                {
+                    sample->allocateI24(0, total_samples);
+                }
+                else if (channels == 2)
+                {
+                    sample->allocateI24(0, total_samples);
+                    sample->allocateI24(1, total_samples);
+                }
+                isValid = true;
+                bitDepth = bps;
+            }
+            else if (bps == 32)
             {
                 if (channels == 1)
                 {
@@ -33,6 +33,49 @@
 #include "minimp3_ex.h"
 namespace scxt::sample
 {
+namespace detail
+{
+bool unpackMP3Info(Sample *s, mp3dec_file_info_t &info)
+{
+    if (info.channels < 1 || info.channels > 2)
+    {
+        free(info.buffer);
+        return false;
+    }
+
+    s->sample_rate = info.hz;
+    s->channels = info.channels;
+    s->sample_length = info.samples / info.channels;
+    s->bitDepth = Sample::BD_I16;
+
+    if (s->channels == 1)
+    {
+        s->allocateI16(0, s->sample_length);
+        auto *dat = s->GetSamplePtrI16(0);
+        memcpy(dat, info.buffer, s->sample_length * sizeof(mp3d_sample_t));
+    }
+    else
+    {
+        s->allocateI16(0, s->sample_length);
+        s->allocateI16(1, s->sample_length);
+
+        auto *dat0 = s->GetSamplePtrI16(0);
+        auto *dat1 = s->GetSamplePtrI16(1);
+
+        // de-interleave by hand I guess
+        for (int i = 0; i < s->sample_length; ++i)
+        {
+            dat0[i] = info.buffer[i * 2];
+            dat1[i] = info.buffer[i * 2 + 1];
+        }
+    }
+
+    free(info.buffer);
+
+    return true;
+}
+} // namespace detail
+
 bool Sample::parseMP3(const fs::path &p)
 {
     mp3dec_t mp3d;
@@ -55,44 +98,26 @@ bool Sample::parseMP3(const fs::path &p)
     }
 #endif
 
-    if (info.channels < 1 || info.channels > 2)
-        return false;
-
-    sample_rate = info.hz;
-    channels = info.channels;
-    sample_length = info.samples / info.channels;
-    bitDepth = BD_I16;
+    return detail::unpackMP3Info(this, info);
+}
 
-    if (channels == 1)
-    {
-        allocateI16(0, sample_length);
-        auto *dat = GetSamplePtrI16(0);
-        memcpy(dat, info.buffer, sample_length * sizeof(mp3d_sample_t));
-    }
-    else
+bool Sample::parseMP3(const uint8_t *data, size_t dataSize)
+{
+    mp3dec_t mp3d;
+    mp3dec_file_info_t info;
+    if (mp3dec_load_buf(&mp3d, data, dataSize, &info, nullptr, nullptr))
     {
-        allocateI16(0, sample_length);
-        allocateI16(1, sample_length);
-
-        auto *dat0 = GetSamplePtrI16(0);
-        auto *dat1 = GetSamplePtrI16(1);
-
-        // de-interleave by hand I guess
-        for (int i = 0; i < sample_length; ++i)
-        {
-            dat0[i] = info.buffer[i * 2];
-            dat1[i] = info.buffer[i * 2 + 1];
-        }
+        SCLOG("Failed to parse MP3");
+        return false;
     }
 
-    free(info.buffer);
-
-    return true;
+    return detail::unpackMP3Info(this, info);
 }
 } // namespace scxt::sample
 #else
 namespace scxt::sample
 {
 bool Sample::parseMP3(const fs::path &p) { return false; }
+bool Sample::parseMP3(const uint8_t *data, size_t dataSize) { return false; }
 } // namespace scxt::sample
 #endif
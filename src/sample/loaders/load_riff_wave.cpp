@@ -31,9 +31,11 @@
 // #include <mmreg.h>
 #include "riff_memfile.h"
 #include "riff_wave.h"
+#include "pcm_header.h"
 // #include "sampler_state.h"
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 
 namespace scxt::sample
 {
@@ -122,163 +124,154 @@ bool Sample::save_wave_file(const fs::path &filename)
     return true;
 }
 
-// TODO [prior] parse INAM etc etc metadata
-bool Sample::parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk)
+namespace loaders
 {
-    size_t datasize;
-    scxt::sample::loaders::RIFFMemFile mf(data, filesize);
-    if (!skip_riffchunk && !mf.riff_descend_RIFF_or_LIST('WAVE', &datasize))
+std::optional<PCMHeader> parseWaveHeader(const void *data, size_t size, bool skipRiffChunk)
+{
+    auto *d = (const unsigned char *)data;
+    auto le32 = [](const unsigned char *b) {
+        return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) |
+               ((uint32_t)b[3] << 24);
+    };
+
+    PCMHeader res;
+    size_t pos{0};
+    if (!skipRiffChunk)
     {
-        SCLOG("Failed to load wave: not a WAVE LIST");
-        return false;
+        if (size < 12 || memcmp(d, "RIFF", 4) != 0 || memcmp(d + 8, "WAVE", 4) != 0)
+        {
+            SCLOG("Failed to load wave: not a WAVE LIST");
+            return std::nullopt;
+        }
+        pos = 12;
     }
+    res.firstChunkOffset = pos;
 
-    loaders::wavheader wh;
-    off_t wr = mf.TellI();
-    if (!mf.riff_descend('fmt ', &datasize))
+    // fmt and data can come in either order, with anything else around them
+    wavheader wh{};
+    uint16_t format{0};
+    bool haveFmt{false}, haveData{false};
+    while (pos + 8 <= size && !(haveFmt && haveData))
     {
-        SCLOG("Failed to load wav: No 'fmt ' chunk found");
-        return false;
+        auto len = (size_t)le32(d + pos + 4);
+        auto body = pos + 8;
+        if (memcmp(d + pos, "fmt ", 4) == 0 && !haveFmt && len >= sizeof(wh) &&
+            body + sizeof(wh) <= size)
+        {
+            memcpy(&wh, d + body, sizeof(wh));
+            haveFmt = true;
+            format = (uint16_t)wh.wFormatTag;
+            // WAVE_FORMAT_EXTENSIBLE keeps the real format in the first two bytes of the
+            // sub format guid, 8 bytes after the cbSize which follows the header
+            auto ext = body + sizeof(wh) + 8;
+            if (format == 0xFFFE && len >= sizeof(wh) + 10 && ext + 2 <= size)
+                format = (uint16_t)(d[ext] | (d[ext + 1] << 8));
+        }
+        else if (memcmp(d + pos, "data", 4) == 0 && !haveData)
+        {
+            res.dataOffset = body;
+            res.dataBytes = len;
+            haveData = true;
+        }
+        pos = body + len + (len & 1);
     }
 
-    // read header
-    mf.Read(&wh, sizeof(loaders::wavheader));
-
-    if (!wh.nSamplesPerSec)
+    if (!haveFmt)
     {
-        SCLOG("Failed to load wav: header samples per second == 0");
-        return false;
+        SCLOG("Failed to load wav: No 'fmt ' chunk found");
+        return std::nullopt;
     }
-    if (!wh.nChannels)
+    if (!haveData)
     {
-        SCLOG("Failed to load wav: channels == 0");
-        return false;
+        SCLOG("Failed to load wav: no 'data' chunk");
+        return std::nullopt;
     }
-    if (!wh.wBitsPerSample)
+    if (wh.nSamplesPerSec <= 0 || wh.nChannels <= 0)
     {
-        SCLOG("Failed to load wav: bits per sample == 0");
-        return false;
+        SCLOG("Failed to load wav: " << SCD(wh.nSamplesPerSec) << SCD(wh.nChannels));
+        return std::nullopt;
     }
-
-    mf.SeekI(wr);
-    if (!mf.riff_descend('data', &datasize))
+    auto bits = (int)wh.wBitsPerSample;
+    if (bits % 8 != 0 || !((format == WAVE_FORMAT_PCM && bits >= 8 && bits <= 32) ||
+                           (format == WAVE_FORMAT_IEEE_FLOAT && (bits == 32 || bits == 64))))
     {
-        SCLOG("Failed to load wav: no 'data' chunk");
-        return false;
+        SCLOG("Failed to load wav: " << SCD(format) << SCD(bits)
+                                     << " must be 8, 16, 24 or 32 bit PCM or 32 or 64 bit float");
+        return std::nullopt;
     }
 
-    int32_t WaveDataSize = datasize;
-    if (!WaveDataSize)
+    res.channels = wh.nChannels;
+    res.sampleRate = wh.nSamplesPerSec;
+    res.bitsPerSample = bits;
+    res.bytesPerSample = bits / 8;
+    res.isFloat = format == WAVE_FORMAT_IEEE_FLOAT;
+    res.unsigned8 = true;
+    res.frames = res.dataBytes / (res.bytesPerSample * res.channels);
+    if (res.frames == 0)
     {
         SCLOG("Failed to load wav: datasize is zero");
-        return false;
+        return std::nullopt;
     }
-    int32_t WaveDataSamples = 8 * WaveDataSize / (wh.wBitsPerSample * wh.nChannels);
+    return res;
+}
+} // namespace loaders
 
-    /*SCLOG("Loaded wav file " << SCD(wh.nChannels) << SCD(wh.nSamplesPerSec)
-                             << SCD(wh.wBitsPerSample) << SCD(WaveDataSamples)); */
+// TODO [prior] parse INAM etc etc metadata
+bool Sample::parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk)
+{
+    auto hdr = loaders::parseWaveHeader(data, filesize, skip_riffchunk);
+    if (!hdr)
+        return false;
 
-    /* get pointer to the sampledata */
+    size_t datasize;
+    scxt::sample::loaders::RIFFMemFile mf(data, filesize);
+    off_t wr = hdr->firstChunkOffset;
 
-    unsigned char *loaddata = (unsigned char *)mf.ReadPtr(WaveDataSize);
-    if (!loaddata)
+    if (hdr->dataOffset + hdr->dataBytes > filesize)
     {
-        SCLOG("Failed to load wav: read of " << WaveDataSize << " returned a null");
+        SCLOG("Failed to load wav: data chunk of " << hdr->dataBytes << " runs past the file");
         return false;
     }
-    if (!SetMeta(wh.nChannels, wh.nSamplesPerSec, WaveDataSamples))
+    unsigned char *loaddata = (unsigned char *)data + hdr->dataOffset;
+    int32_t WaveDataSamples = (int32_t)hdr->frames;
+
+    if (!SetMeta(hdr->channels, hdr->sampleRate, WaveDataSamples))
     {
         SCLOG("Failed to load wav: setMeta failed with "
-              << SCD(wh.nChannels) << SCD(wh.nSamplesPerSec) << SCD(WaveDataSamples));
+              << SCD(hdr->channels) << SCD(hdr->sampleRate) << SCD(WaveDataSamples));
         return false;
     }
 
-    if (wh.wFormatTag == WAVE_FORMAT_PCM)
+    auto bytes = hdr->bytesPerSample;
+    auto stride = bytes * channels;
+    for (int c = 0; c < channels; ++c)
     {
-        if (wh.wBitsPerSample == 8)
+        auto *cd = loaddata + c * bytes;
+        if (hdr->isFloat)
         {
-            if (channels == 2)
-            {
-                load_data_ui8(0, loaddata, WaveDataSamples, 2);
-                load_data_ui8(1, loaddata + 1, WaveDataSamples, 2);
-            }
+            if (bytes == 8)
+                load_data_f64(c, cd, WaveDataSamples, stride);
             else
-                load_data_ui8(0, loaddata, WaveDataSamples, 1);
-        }
-        else if (wh.wBitsPerSample == 16)
-        {
-            if (channels == 2)
-            {
-                load_data_i16(0, loaddata, WaveDataSamples, 4);
-                load_data_i16(1, loaddata + 2, WaveDataSamples, 4);
-            }
-            else
-                load_data_i16(0, loaddata, WaveDataSamples, 2);
-        }
-        else if (wh.wBitsPerSample == 24)
-        {
-            if (channels == 2)
-            {
-                load_data_i24(0, loaddata, WaveDataSamples, 6);
-                load_data_i24(1, loaddata + 3, WaveDataSamples, 6);
-            }
-            else
-                load_data_i24(0, loaddata, WaveDataSamples, 3);
-        }
-        else if (wh.wBitsPerSample == 32)
-        {
-            if (channels == 2)
-            {
-                load_data_i32(0, loaddata, WaveDataSamples, 8);
-                load_data_i32(1, loaddata + 4, WaveDataSamples, 8);
-            }
-            else
-                load_data_i32(0, loaddata, WaveDataSamples, 4);
+                load_data_f32(c, cd, WaveDataSamples, stride);
         }
         else
         {
-            SCLOG("Failed to load: " << SCD(wh.wBitsPerSample)
-                                     << " must be 8, 16, 24 or 32 for PCM");
-            return false;
-        }
-    }
-    else if (wh.wFormatTag == WAVE_FORMAT_IEEE_FLOAT)
-    {
-        if (wh.wBitsPerSample == 32)
-        {
-            if (channels == 2)
+            switch (bytes)
             {
-                load_data_f32(0, loaddata, WaveDataSamples, 8);
-                load_data_f32(1, loaddata + 4, WaveDataSamples, 8);
+            case 1:
+                load_data_ui8(c, cd, WaveDataSamples, stride);
+                break;
+            case 2:
+                load_data_i16(c, cd, WaveDataSamples, stride);
+                break;
+            case 3:
+                load_data_i24(c, cd, WaveDataSamples, stride);
+                break;
+            case 4:
+                load_data_i32(c, cd, WaveDataSamples, stride);
+                break;
             }
-            else
-                load_data_f32(0, loaddata, WaveDataSamples, 4);
         }
-        else if (wh.wBitsPerSample == 64)
-        {
-            if (channels == 2)
-            {
-                load_data_f64(0, loaddata, WaveDataSamples, 16);
-                load_data_f64(1, loaddata + 8, WaveDataSamples, 16);
-            }
-            else
-                load_data_f64(0, loaddata, WaveDataSamples, 8);
-        }
-        else
-        {
-            SCLOG("Failed to load wav: " << SCD(wh.wBitsPerSample)
-                                         << " must be 32 or 64 for FLOAT wav");
-            return false;
-        }
-    }
-    else
-    {
-        SCLOG("Failed to load wav: Format Tag 0x"
-              << std::hex << std::setw(4) << std::setfill('0') << wh.wFormatTag
-              << " must be IEEE FLOAT (0x" << std::hex << std::setw(4) << std::setfill('0')
-              << WAVE_FORMAT_IEEE_FLOAT << ") or PCM (0x" << std::hex << std::setw(4)
-              << std::setfill('0') << WAVE_FORMAT_PCM << ")");
-        return false;
     }
     this->sample_loaded = true;
 
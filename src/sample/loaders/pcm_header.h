@@ -0,0 +1,70 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_LOADERS_PCM_HEADER_H
+#define SCXT_SRC_SAMPLE_LOADERS_PCM_HEADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace scxt::sample::loaders
+{
+/*
+ * Where the frames of a wave or AIFF file are and how they are stored, from walking its
+ * chunks. The loaders convert the frames from here and the browser preview streams them,
+ * so both take exactly the same files. dataBytes is what the file claims, which a
+ * truncated file may not have.
+ */
+struct PCMHeader
+{
+    size_t dataOffset{0}; // from the start of the file
+    size_t dataBytes{0};
+    uint64_t frames{0};
+    int channels{0};
+    double sampleRate{0};
+    int bitsPerSample{0};
+    int bytesPerSample{0};
+    bool isFloat{false};
+    bool bigEndian{false};
+    bool unsigned8{false}; // wave 8 bit data is offset, AIFF 8 bit data signed
+
+    // the first chunk inside the RIFF or FORM, where the loaders look for metadata
+    size_t firstChunkOffset{0};
+};
+
+// PCM up to 32 bit and IEEE float 32 or 64 bit, WAVE_FORMAT_EXTENSIBLE included
+std::optional<PCMHeader> parseWaveHeader(const void *data, size_t size,
+                                         bool skipRiffChunk = false);
+// Integer AIFF up to 32 bit, and AIFC as NONE, twos, sowt or fl32
+std::optional<PCMHeader> parseAiffHeader(const void *data, size_t size);
+
+// The 80 bit float AIFF stores its sample rate as
+double ConvertFromIeeeExtended(const unsigned char *bytes);
+} // namespace scxt::sample::loaders
+
+#endif // SCXT_SRC_SAMPLE_LOADERS_PCM_HEADER_H
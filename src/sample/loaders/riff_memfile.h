@@ -62,7 +62,8 @@ class RIFFMemFile
         size = 0;
         loc = 0;
     }
-    RIFFMemFile(const void *data, int datasize)
+    // Offsets are size_t throughout; the RIFF chunk sizes themselves are 32 bit
+    RIFFMemFile(const void *data, size_t datasize)
     {
         assert(data);
         assert(datasize);
@@ -32,7 +32,6 @@
 
 #include <miniz.h>
 #include "messaging/messaging.h"
-#include "infrastructure/md5support.h"
 
 namespace scxt::multisample_support
 {
@@ -47,7 +46,7 @@ bool importMultisample(const fs::path &p, engine::Engine &engine)
     if (!status)
         return false;
 
-    auto md5 = infrastructure::createMD5SumFromFile(p);
+    auto md5 = engine.getSampleManager()->contentHashForFile(p);
 
     // Step one: Build a zip file to index map
     std::map<std::string, int> fileToIndex;
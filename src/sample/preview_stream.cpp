@@ -0,0 +1,517 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "preview_stream.h"
+#include "sample.h"
+#include "loaders/pcm_header.h"
+#include "infrastructure/file_map_view.h"
+#include "dsp/sample_conversion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if SCXT_USE_FLAC
+#include "FLAC++/decoder.h"
+#endif
+
+#if SCXT_USE_MP3
+#include "minimp3_ex.h"
+#endif
+
+namespace scxt::sample
+{
+namespace
+{
+/*
+ * Interleaved integer or float frames read out of the mapped file, which the OS pages in
+ * as we go; the data part of a wave or an AIFF once the loaders' header parsing has told
+ * us where it is and what it holds.
+ */
+struct PCMDecoder : PreviewStream::Decoder
+{
+    std::unique_ptr<infrastructure::FileMapView> view;
+    const unsigned char *at{nullptr};
+    int bytesPerSample{2};
+    bool isFloat{false}, bigEndian{false}, unsigned8{false};
+    uint64_t framesLeft{0};
+
+    float value(const unsigned char *b) const
+    {
+        unsigned char s[8];
+        for (int i = 0; i < bytesPerSample; ++i)
+            s[i] = bigEndian ? b[bytesPerSample - 1 - i] : b[i];
+
+        if (isFloat)
+        {
+            if (bytesPerSample == 8)
+            {
+                double d;
+                memcpy(&d, s, 8);
+                return (float)d;
+            }
+            float v;
+            memcpy(&v, s, 4);
+            return v;
+        }
+        switch (bytesPerSample)
+        {
+        case 1:
+            return unsigned8 ? (s[0] - 128) / 128.f : (int8_t)s[0] / 128.f;
+        case 2:
+            return (int16_t)(s[0] | (s[1] << 8)) / 32768.f;
+        case 3:
+            return (int32_t)((s[0] << 8) | (s[1] << 16) | ((uint32_t)s[2] << 24)) / 2147483648.f;
+        case 4:
+            return (int32_t)(s[0] | (s[1] << 8) | (s[2] << 16) | ((uint32_t)s[3] << 24)) /
+                   2147483648.f;
+        }
+        return 0.f;
+    }
+
+    size_t read(float *L, float *R, size_t maxFrames) override
+    {
+        auto frameBytes = (size_t)(bytesPerSample * channels);
+        auto n = (size_t)std::min<uint64_t>(maxFrames, framesLeft);
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto *fr = at + i * frameBytes;
+            L[i] = value(fr);
+            R[i] = channels > 1 ? value(fr + bytesPerSample) : L[i];
+        }
+        at += n * frameBytes;
+        framesLeft -= n;
+        return n;
+    }
+};
+
+using headerParser_t = std::optional<loaders::PCMHeader> (*)(const void *, size_t);
+std::unique_ptr<PreviewStream::Decoder> openPCM(const fs::path &p, headerParser_t parse)
+{
+    auto view = std::make_unique<infrastructure::FileMapView>(p);
+    if (!view->isMapped())
+        return nullptr;
+    auto hdr = parse(view->data(), view->dataSize());
+    if (!hdr || hdr->dataOffset > view->dataSize())
+        return nullptr;
+
+    auto res = std::make_unique<PCMDecoder>();
+    res->channels = hdr->channels;
+    res->sampleRate = hdr->sampleRate;
+    res->bytesPerSample = hdr->bytesPerSample;
+    res->isFloat = hdr->isFloat;
+    res->bigEndian = hdr->bigEndian;
+    res->unsigned8 = hdr->unsigned8;
+    // play what is there of a truncated file
+    auto frameBytes = (uint64_t)hdr->bytesPerSample * hdr->channels;
+    res->framesLeft = std::min(hdr->frames, (view->dataSize() - hdr->dataOffset) / frameBytes);
+    res->at = (const unsigned char *)view->data() + hdr->dataOffset;
+    res->view = std::move(view);
+    return res;
+}
+
+std::unique_ptr<PreviewStream::Decoder> openWave(const fs::path &p)
+{
+    return openPCM(p, [](const void *d, size_t s) { return loaders::parseWaveHeader(d, s); });
+}
+
+std::unique_ptr<PreviewStream::Decoder> openAiff(const fs::path &p)
+{
+    return openPCM(p, loaders::parseAiffHeader);
+}
+
+#if SCXT_USE_FLAC
+// libFLAC hands us a frame per process_single, which we keep and hand out as asked
+struct FlacDecoder : PreviewStream::Decoder, FLAC::Decoder::File
+{
+    std::vector<float> pendL, pendR;
+    size_t pendPos{0};
+    int bits{16};
+    bool haveInfo{false};
+
+    size_t read(float *L, float *R, size_t maxFrames) override
+    {
+        size_t n{0};
+        while (n < maxFrames)
+        {
+            if (pendPos == pendL.size())
+            {
+                pendL.clear();
+                pendR.clear();
+                pendPos = 0;
+                if (get_state() == FLAC__STREAM_DECODER_END_OF_STREAM || !process_single())
+                    break;
+                continue;
+            }
+            auto c = std::min(maxFrames - n, pendL.size() - pendPos);
+            memcpy(L + n, pendL.data() + pendPos, c * sizeof(float));
+            memcpy(R + n, pendR.data() + pendPos, c * sizeof(float));
+            pendPos += c;
+            n += c;
+        }
+        return n;
+    }
+
+  protected:
+    ::FLAC__StreamDecoderWriteStatus write_callback(const ::FLAC__Frame *frame,
+                                                    const FLAC__int32 *const buffer[]) override
+    {
+        auto n = frame->header.blocksize;
+        auto scale = std::ldexp(1.f, 1 - bits);
+        pendL.resize(n);
+        pendR.resize(n);
+        pendPos = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            pendL[i] = buffer[0][i] * scale;
+            pendR[i] = channels > 1 ? buffer[1][i] * scale : pendL[i];
+        }
+        return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+    }
+    void metadata_callback(const ::FLAC__StreamMetadata *metadata) override
+    {
+        if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO)
+        {
+            sampleRate = metadata->data.stream_info.sample_rate;
+            channels = metadata->data.stream_info.channels;
+            bits = metadata->data.stream_info.bits_per_sample;
+            haveInfo = true;
+        }
+    }
+    void error_callback(::FLAC__StreamDecoderErrorStatus status) override {}
+};
+
+std::unique_ptr<PreviewStream::Decoder> openFlac(const fs::path &p)
+{
+    auto res = std::make_unique<FlacDecoder>();
+    if (res->init(p.u8string()) != FLAC__STREAM_DECODER_INIT_STATUS_OK ||
+        !res->process_until_end_of_metadata() || !res->haveInfo || res->channels <= 0)
+        return nullptr;
+    return res;
+}
+#endif
+
+#if SCXT_USE_MP3
+struct MP3Decoder : PreviewStream::Decoder
+{
+    mp3dec_ex_t dec{};
+    bool isOpen{false};
+    std::vector<mp3d_sample_t> buf;
+
+    ~MP3Decoder()
+    {
+        if (isOpen)
+            mp3dec_ex_close(&dec);
+    }
+
+    size_t read(float *L, float *R, size_t maxFrames) override
+    {
+        buf.resize(maxFrames * channels);
+        auto n = mp3dec_ex_read(&dec, buf.data(), buf.size()) / channels;
+        for (size_t i = 0; i < n; ++i)
+        {
+            L[i] = buf[i * channels] / 32768.f;
+            R[i] = channels > 1 ? buf[i * channels + 1] / 32768.f : L[i];
+        }
+        return n;
+    }
+};
+
+std::unique_ptr<PreviewStream::Decoder> openMP3(const fs::path &p)
+{
+    auto res = std::make_unique<MP3Decoder>();
+    int flags = MP3D_SEEK_TO_SAMPLE;
+#ifdef MP3D_DO_NOT_SCAN
+    // we read in order so don't need the length, which means a pass over the whole file
+    flags |= MP3D_DO_NOT_SCAN;
+#endif
+#if WIN32
+    int count =
+        MultiByteToWideChar(CP_UTF8, 0, p.u8string().c_str(), p.u8string().length(), NULL, 0);
+    std::wstring wstr(count, 0);
+    MultiByteToWideChar(CP_UTF8, 0, p.u8string().c_str(), p.u8string().length(), &wstr[0], count);
+    res->isOpen = mp3dec_ex_open_w(&res->dec, wstr.c_str(), flags) == 0;
+#else
+    res->isOpen = mp3dec_ex_open(&res->dec, p.u8string().c_str(), flags) == 0;
+#endif
+    if (!res->isOpen || res->dec.info.channels < 1 || res->dec.info.channels > 2)
+        return nullptr;
+    res->channels = res->dec.info.channels;
+    res->sampleRate = res->dec.info.hz;
+    return res;
+}
+#endif
+
+/*
+ * Whatever we can't stream we load whole, as a sample no manager knows about. The hash we
+ * hand load is a placeholder so it doesn't hash a file we are about to throw away.
+ */
+struct SampleDecoder : PreviewStream::Decoder
+{
+    Sample sample;
+    size_t pos{0};
+
+    template <typename T> void convert(T *src, float *dst, size_t n, float scale)
+    {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = dsp::sample_conversion::toNativeFloat(src[pos + i]) * scale;
+    }
+
+    size_t read(float *L, float *R, size_t maxFrames) override
+    {
+        auto n = std::min(maxFrames, (size_t)sample.sample_length - pos);
+        for (int c = 0; c < std::min(channels, 2); ++c)
+        {
+            auto *d = c == 0 ? L : R;
+            switch (sample.bitDepth)
+            {
+            case Sample::BD_I16:
+                convert(sample.GetSamplePtrI16(c), d, n, 1.f / 32768.f);
+                break;
+            case Sample::BD_I24:
+                convert(sample.GetSamplePtrI24(c), d, n, 1.f / 8388608.f);
+                break;
+            case Sample::BD_F32:
+                convert(sample.GetSamplePtrF32(c), d, n, 1.f);
+                break;
+            }
+        }
+        if (channels == 1)
+            memcpy(R, L, n * sizeof(float));
+        pos += n;
+        return n;
+    }
+};
+
+std::unique_ptr<PreviewStream::Decoder> openSample(const fs::path &p)
+{
+    auto res = std::make_unique<SampleDecoder>();
+    if (!res->sample.load(p, "preview") || res->sample.channels < 1)
+        return nullptr;
+    res->channels = res->sample.channels;
+    res->sampleRate = res->sample.sample_rate;
+    return res;
+}
+} // namespace
+
+std::unique_ptr<PreviewStream::Decoder> PreviewStream::openDecoder(const fs::path &p)
+{
+    std::unique_ptr<Decoder> res;
+    if (extensionMatches(p, ".wav"))
+        res = openWave(p);
+    else if (extensionMatches(p, ".aif") || extensionMatches(p, ".aiff"))
+        res = openAiff(p);
+#if SCXT_USE_FLAC
+    else if (extensionMatches(p, ".flac"))
+        res = openFlac(p);
+#endif
+#if SCXT_USE_MP3
+    else if (extensionMatches(p, ".mp3"))
+        res = openMP3(p);
+#endif
+
+    if (!res)
+        res = openSample(p);
+    return res;
+}
+
+PreviewStream::PreviewStream()
+{
+    for (auto &r : ring)
+    {
+        r = std::make_unique<float[]>(ringFrames);
+        std::fill(r.get(), r.get() + ringFrames, 0.f);
+    }
+    decodeThread = std::thread([this]() { decodeLoop(); });
+}
+
+PreviewStream::~PreviewStream()
+{
+    {
+        std::lock_guard<std::mutex> g(requestLock);
+        keepRunning = false;
+        requestedGeneration++;
+    }
+    requestCV.notify_all();
+    decodeThread.join();
+}
+
+void PreviewStream::start(const fs::path &p)
+{
+    {
+        std::lock_guard<std::mutex> g(requestLock);
+        requestedPath = p;
+        requestedGeneration++;
+    }
+    requestCV.notify_all();
+}
+
+void PreviewStream::stop()
+{
+    {
+        std::lock_guard<std::mutex> g(requestLock);
+        requestedPath.clear();
+        finishedGeneration = ++requestedGeneration;
+    }
+    requestCV.notify_all();
+}
+
+bool PreviewStream::isPlaying() const { return requestedGeneration != finishedGeneration; }
+
+void PreviewStream::markFinished(uint64_t gen)
+{
+    // Only ever forwards, so a stop which got in first isn't undone
+    auto f = finishedGeneration.load();
+    while (f < gen && !finishedGeneration.compare_exchange_weak(f, gen))
+        ;
+}
+
+void PreviewStream::decodeLoop()
+{
+    while (true)
+    {
+        fs::path p;
+        uint64_t gen;
+        {
+            std::unique_lock<std::mutex> lk(requestLock);
+            requestCV.wait(lk, [this]() {
+                return !keepRunning || requestedGeneration != handledGeneration;
+            });
+            if (!keepRunning)
+                return;
+            p = requestedPath;
+            gen = requestedGeneration;
+            handledGeneration = gen;
+        }
+        if (p.empty())
+            continue;
+
+        auto d = openDecoder(p);
+        if (!d || d->sampleRate <= 0)
+        {
+            SCLOG("Unable to preview " << p.u8string());
+            markFinished(gen);
+            continue;
+        }
+        stream(*d, gen);
+    }
+}
+
+void PreviewStream::stream(Decoder &d, uint64_t gen)
+{
+    auto wp = writePos.load(std::memory_order_relaxed);
+    streamStart.store(wp, std::memory_order_relaxed);
+    streamEnd.store(UINT64_MAX, std::memory_order_relaxed);
+    streamRate.store(d.sampleRate, std::memory_order_relaxed);
+    streamGeneration.store(gen, std::memory_order_release);
+
+    float bl[decodeFrames], br[decodeFrames];
+    static constexpr uint64_t mask{ringFrames - 1};
+    while (requestedGeneration.load(std::memory_order_acquire) == gen)
+    {
+        // Until the audio thread moves to this stream its read position is in the last one,
+        // so what that left unplayed counts against our space as well
+        if (ringFrames - (wp - readPos.load(std::memory_order_acquire)) < decodeFrames)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+
+        auto n = d.read(bl, br, decodeFrames);
+        if (n == 0)
+        {
+            streamEnd.store(wp, std::memory_order_release);
+            return;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            ring[0][(wp + i) & mask] = bl[i];
+            ring[1][(wp + i) & mask] = br[i];
+        }
+        wp += n;
+        writePos.store(wp, std::memory_order_release);
+    }
+}
+
+void PreviewStream::processBlockAdding(float *L, float *R, size_t frames)
+{
+    auto gen = requestedGeneration.load(std::memory_order_acquire);
+    if (gen == finishedGeneration.load(std::memory_order_acquire) ||
+        streamGeneration.load(std::memory_order_acquire) != gen)
+        return;
+
+    if (playingGeneration != gen)
+    {
+        playingGeneration = gen;
+        readPos.store(streamStart.load(std::memory_order_relaxed), std::memory_order_release);
+        phase = 0;
+        primed = false;
+    }
+
+    // End before write so that if we see the end we see all the frames before it
+    auto end = streamEnd.load(std::memory_order_acquire);
+    auto wp = writePos.load(std::memory_order_acquire);
+    auto rp = readPos.load(std::memory_order_relaxed);
+    if (!primed)
+    {
+        if (wp - rp < prefillFrames && end == UINT64_MAX)
+            return;
+        primed = true;
+    }
+
+    static constexpr uint64_t mask{ringFrames - 1};
+    auto ratio = streamRate.load(std::memory_order_relaxed) / engineRate;
+    auto amp = amplitude.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < frames; ++i)
+    {
+        if (rp >= end)
+        {
+            markFinished(gen);
+            break;
+        }
+        // Out of frames before the end means the decoder is behind; drop out until it isn't
+        if (rp + 1 >= wp && end == UINT64_MAX)
+            break;
+
+        // A preview doesn't need the sinc, so this is a linear interpolation
+        auto f = (float)phase;
+        for (int c = 0; c < 2; ++c)
+        {
+            auto a = ring[c][rp & mask];
+            auto b = rp + 1 < end ? ring[c][(rp + 1) & mask] : 0.f;
+            (c == 0 ? L : R)[i] += amp * (a + f * (b - a));
+        }
+        phase += ratio;
+        auto adv = (uint64_t)phase;
+        rp += adv;
+        phase -= adv;
+    }
+    readPos.store(rp, std::memory_order_release);
+}
+} // namespace scxt::sample
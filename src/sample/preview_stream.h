@@ -0,0 +1,124 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_PREVIEW_STREAM_H
+#define SCXT_SRC_SAMPLE_PREVIEW_STREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "filesystem/import.h"
+#include "utils.h"
+
+namespace scxt::sample
+{
+/*
+ * Plays a file from the browser without loading it as a sample. A decode thread reads the
+ * file a block at a time into a ring which the audio thread plays out of, resampled to the
+ * engine rate, so audio starts once prefillFrames have decoded rather than the whole file,
+ * and the file never goes near the SampleManager (no hash, no id, nothing kept once the
+ * preview ends). Wave and AIFF stream straight off the disk, flac and mp3 a frame at a
+ * time through their decoders; anything else we can load is loaded whole as a standalone
+ * sample on the decode thread.
+ *
+ * start and stop can be called from any thread and take effect on the next audio block:
+ * each bumps a generation which the audio thread compares before it reads anything, and
+ * the decode thread between blocks, so the old file is abandoned at once.
+ */
+struct PreviewStream : MoveableOnly<PreviewStream>
+{
+    static constexpr size_t ringFrames{1 << 16};
+    static constexpr size_t decodeFrames{1024};
+    static constexpr size_t prefillFrames{4096};
+
+    PreviewStream();
+    ~PreviewStream();
+
+    void start(const fs::path &);
+    void stop();
+    // A preview has been started and hasn't stopped or played to its end
+    bool isPlaying() const;
+
+    void setEngineSampleRate(double sr) { engineRate = sr; }
+    std::atomic<float> amplitude{0.5f};
+
+    // Audio thread. Mixes the preview into L and R.
+    void processBlockAdding(float *L, float *R, size_t frames);
+
+    /*
+     * A file read in order a block at a time. read returns the frames it wrote, 0 at the
+     * end; mono files write the same data to both sides.
+     */
+    struct Decoder
+    {
+        virtual ~Decoder() = default;
+        virtual size_t read(float *L, float *R, size_t maxFrames) = 0;
+
+        double sampleRate{0};
+        int channels{0};
+    };
+    static std::unique_ptr<Decoder> openDecoder(const fs::path &);
+
+  private:
+    void decodeLoop();
+    void stream(Decoder &, uint64_t generation);
+    void markFinished(uint64_t generation);
+
+    std::thread decodeThread;
+    std::mutex requestLock;
+    std::condition_variable requestCV;
+    // guarded by requestLock
+    fs::path requestedPath;
+    uint64_t handledGeneration{0};
+    bool keepRunning{true};
+
+    // Bumped by start and stop, under requestLock. A generation is done when it is finished.
+    std::atomic<uint64_t> requestedGeneration{0}, finishedGeneration{0};
+
+    // The decode thread publishes the start, rate and (once it gets there) end of the stream
+    // before its generation. Positions count frames since we were made; the ring slot is
+    // position & (ringFrames - 1).
+    std::atomic<uint64_t> streamGeneration{0};
+    std::atomic<uint64_t> streamStart{0}, streamEnd{0};
+    std::atomic<double> streamRate{48000};
+    std::atomic<uint64_t> writePos{0}, readPos{0};
+    std::atomic<double> engineRate{48000};
+    std::unique_ptr<float[]> ring[2];
+
+    // audio thread only
+    uint64_t playingGeneration{0};
+    double phase{0};
+    bool primed{false};
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_PREVIEW_STREAM_H
@@ -25,12 +25,19 @@
  * https://github.com/surge-synthesizer/shortcircuit-xt
  */
 
+#include <algorithm>
 #include <sstream>
+#include <limits>
 #include "sst/basic-blocks/mechanics/endian-ops.h"
 #include "infrastructure/file_map_view.h"
-#include "infrastructure/md5support.h"
+#include "infrastructure/resident_memory.h"
 #include "dsp/resampling.h"
+#include "dsp/sample_conversion.h"
 #include "sample.h"
+#include "waveform_pyramid.h"
+#include "sample_mipmap.h"
+#include "engine_rate_rendition.h"
+#include "loaders/riff_memfile.h"
 
 namespace scxt::sample
 {
@@ -38,29 +45,35 @@ namespace scxt::sample
 // Fine in a cpp
 using namespace sst::basic_blocks::mechanics;
 
-Sample::~Sample()
-{
-    if (sampleData[0])
-        free(sampleData[0]);
-    if (sampleData[1])
-        free(sampleData[1]);
-}
+Sample::~Sample() {}
 
-bool Sample::load(const fs::path &path)
+bool Sample::load(const fs::path &path, const std::string &knownContentHash,
+                  infrastructure::ContentHashKind hashKind)
 {
     if (!fs::exists(path))
         return false;
 
-    md5Sum = infrastructure::createMD5SumFromFile(path);
+    auto fmv = std::make_unique<infrastructure::FileMapView>(path);
+    if (!fmv->isMapped())
+        return false;
+
+    return loadFromMemory(path, fmv->data(), fmv->dataSize(), knownContentHash, hashKind);
+}
+
+bool Sample::loadFromMemory(const fs::path &path, void *data, size_t datasize,
+                            const std::string &knownContentHash,
+                            infrastructure::ContentHashKind hashKind)
+{
+    if (knownContentHash.empty())
+        md5Sum = infrastructure::createContentHash(hashKind, data, datasize);
+    else
+        md5Sum = knownContentHash;
+    contentHashKind = hashKind;
     id.setPathHash(path.u8string().c_str());
 
     // If you add a type here add it in Browser::isLoadableFile also to stay in sync
     if (extensionMatches(path, ".wav"))
     {
-        auto fmv = std::make_unique<infrastructure::FileMapView>(path);
-        auto data = fmv->data();
-        auto datasize = fmv->dataSize();
-
         clear_data(); // clear to a more predictable state
 
         bool r = parse_riff_wave(data, datasize);
@@ -92,7 +105,7 @@ bool Sample::load(const fs::path &path)
     }
     else if (extensionMatches(path, ".mp3"))
     {
-        if (parseMP3(path))
+        if (parseMP3((const uint8_t *)data, datasize))
         {
             sample_loaded = true;
             type = MP3_FILE;
@@ -106,10 +119,6 @@ bool Sample::load(const fs::path &path)
     }
     else if (extensionMatches(path, ".aif") || extensionMatches(path, ".aiff"))
     {
-        auto fmv = std::make_unique<infrastructure::FileMapView>(path);
-        auto data = fmv->data();
-        auto datasize = fmv->dataSize();
-
         clear_data(); // clear to a more predictable state
 
         bool r = parse_aiff(data, datasize);
@@ -127,7 +136,90 @@ bool Sample::load(const fs::path &path)
     return false;
 }
 
-bool Sample::loadFromSF2(const fs::path &p, sf2::File *f, int sampleIndex)
+std::shared_ptr<SF2SampleMapping> SF2SampleMapping::map(const fs::path &path)
+{
+    auto view = std::make_shared<infrastructure::FileMapView>(path);
+    // A RIFF can't be bigger than its 32 bit size says
+    if (!view->isMapped() || view->dataSize() < 12 ||
+        view->dataSize() > (size_t)std::numeric_limits<uint32_t>::max() + 8)
+        return nullptr;
+
+    // RIFF 'sfbk' -> LIST 'sdta' -> 'smpl'
+    loaders::RIFFMemFile mf(view->data(), view->dataSize());
+    size_t sz{0};
+    if (!mf.riff_descend_RIFF_or_LIST('sfbk', &sz) || !mf.riff_descend_RIFF_or_LIST('sdta', &sz) ||
+        !mf.riff_descend('smpl', &sz))
+        return nullptr;
+
+    // the mapping is only page aligned, but the chunk offsets in an sfbk are all even
+    auto smpl = mf.GetPtr();
+    if (((uintptr_t)smpl & 1) || mf.TellI() + sz > view->dataSize())
+        return nullptr;
+
+    auto res = std::make_shared<SF2SampleMapping>();
+    res->view = view;
+    res->smpl = (const int16_t *)smpl;
+    res->smplFrames = sz / sizeof(int16_t);
+    res->residency = infrastructure::ResidentMemory::instance().lockRange(smpl, sz);
+    return res;
+}
+
+bool Sample::referenceMappedSF2Data(const std::shared_ptr<SF2SampleMapping> &m, size_t start,
+                                    size_t end)
+{
+    static constexpr size_t pad{scxt::dsp::FIRoffset};
+
+    // The generator reads FIRoffset frames either side of the data, which allocate* zeroes
+    // for us. Playing in place needs those to be silent in the file and inside the chunk.
+    // The SF2 spec puts 46 zero frames after every sample, so a well formed bank passes
+    // for everything but (usually) its very first sample.
+    if (!m || end <= start || end - start != sample_length || start < pad ||
+        end + pad > m->smplFrames)
+        return false;
+    for (size_t i = 0; i < pad; ++i)
+    {
+        if (m->smpl[start - 1 - i] != 0 || m->smpl[end + i] != 0)
+            return false;
+    }
+
+    void *base[2]{(void *)(m->smpl + start - pad), nullptr};
+    return referenceMappedData(m, base, BD_I16);
+}
+
+bool Sample::referenceMappedData(const std::shared_ptr<void> &owner, void *const data[2],
+                                 BitDepth bd)
+{
+    auto padBytes = scxt::dsp::FIRoffset * bitDepthByteSize(bd);
+    auto dataBytes = (size_t)sample_length * bitDepthByteSize(bd);
+    auto isSilent = [](const char *d, size_t n) {
+        return std::all_of(d, d + n, [](auto c) { return c == 0; });
+    };
+    if (!owner || channels < 1 || channels > 2)
+        return false;
+    for (int c = 0; c < channels; ++c)
+    {
+        auto d = (const char *)data[c];
+        if (!d || !isSilent(d, padBytes) || !isSilent(d + padBytes + dataBytes, padBytes))
+            return false;
+    }
+
+    for (int c = 0; c < 2; ++c)
+        sampleDataOwner[c].reset();
+    resetDataState();
+    for (int c = 0; c < 2; ++c)
+    {
+        auto d = c < channels ? data[c] : nullptr;
+        // aliasing constructor, so each channel keeps the whole mapping alive
+        sampleDataOwner[c] = d ? std::shared_ptr<void>(owner, d) : nullptr;
+        sampleData[c] = d;
+    }
+    bitDepth = bd;
+    dataIsMapped = true;
+    return true;
+}
+
+bool Sample::loadFromSF2(const fs::path &p, sf2::File *f, int sampleIndex,
+                         const std::shared_ptr<SF2SampleMapping> &mapping)
 {
     mFileName = p;
     preset = -1;
@@ -152,6 +244,9 @@ bool Sample::loadFromSF2(const fs::path &p, sf2::File *f, int sampleIndex)
     if (frameSize == 2 && channels == 1 && sfsample->SampleType == sf2::Sample::MONO_SAMPLE)
     {
         bitDepth = BD_I16;
+        if (mapping && referenceMappedSF2Data(mapping, sfsample->Start, sfsample->End))
+            return true;
+
         auto buf = sfsample->LoadSampleData();
         // >> 1 here because void* -> int16_t is byte to two bytes
         load_data_i16(0, buf.pStart, buf.Size >> 1, sfsample->GetFrameSize());
@@ -180,10 +275,12 @@ bool Sample::loadFromSF2(const fs::path &p, sf2::File *f, int sampleIndex)
     }
     else if (sfsample->GetFrameSize() == 3 && sfsample->GetChannelCount() == 1)
     {
-        bitDepth = BD_I16;
+        bitDepth = BD_I24;
         channels = 1;
         auto buf = sfsample->LoadSampleData();
-        load_data_i24(0, (void *)(buf.pStart), buf.Size, sfsample->GetFrameSize());
+        // buf.Size is in bytes, so / 3 for the frame count
+        load_data_i24(0, (void *)(buf.pStart), buf.Size / 3, sfsample->GetFrameSize());
+        sfsample->ReleaseSampleData();
         return true;
     }
 
@@ -211,171 +308,235 @@ float *Sample::GetSamplePtrF32(int Channel)
         return nullptr;
     return &((float *)sampleData[Channel])[scxt::dsp::FIRoffset];
 }
+dsp::PackedInt24 *Sample::GetSamplePtrI24(int Channel)
+{
+    if (bitDepth != BD_I24)
+        return nullptr;
+    if (!sampleData[Channel])
+        return nullptr;
+    return &((dsp::PackedInt24 *)sampleData[Channel])[scxt::dsp::FIRoffset];
+}
 
-// TODO: What the heck is this doing?
 bool Sample::allocateI16(int Channel, int Samples)
 {
+    return allocateChannel(Channel, Samples, BD_I16);
+}
+bool Sample::allocateF32(int Channel, int Samples)
+{
+    return allocateChannel(Channel, Samples, BD_F32);
+}
+bool Sample::allocateI24(int Channel, int Samples)
+{
+    static_assert(sizeof(dsp::PackedInt24) == bitDepthByteSize(BD_I24));
+    return allocateChannel(Channel, Samples, BD_I24);
+}
+
+bool Sample::allocateChannel(int channel, int samples, BitDepth bd)
+{
+    size_t bps = bitDepthByteSize(bd);
     // int samplesizewithmargin = Samples + 2*scxt::dsp::FIRipol_N + BLOCK_SIZE +
     // scxt::dsp::FIRoffset;
-    int samplesizewithmargin = Samples + scxt::dsp::FIRipol_N;
-    if (sampleData[Channel])
-        free(sampleData[Channel]);
-    sampleData[Channel] = malloc(sizeof(short) * samplesizewithmargin);
-    if (!sampleData[Channel])
+    int samplesizewithmargin = samples + scxt::dsp::FIRipol_N;
+    sampleDataOwner[channel].reset();
+    resetDataState();
+    sampleDataOwner[channel] =
+        infrastructure::ResidentMemory::instance().allocate(bps * samplesizewithmargin);
+    sampleData[channel] = sampleDataOwner[channel].get();
+    if (!sampleData[channel])
         return false;
-    bitDepth = BD_I16;
+    bitDepth = bd;
 
     // clear pre/post zero area
-    memset(sampleData[Channel], 0, scxt::dsp::FIRoffset * sizeof(short));
-    memset((char *)sampleData[Channel] + (Samples + scxt::dsp::FIRoffset) * sizeof(short), 0,
-           scxt::dsp::FIRoffset * sizeof(short));
+    memset(sampleData[channel], 0, scxt::dsp::FIRoffset * bps);
+    memset((char *)sampleData[channel] + (samples + scxt::dsp::FIRoffset) * bps, 0,
+           scxt::dsp::FIRoffset * bps);
 
     return true;
 }
-bool Sample::allocateF32(int Channel, int Samples)
+
+void Sample::resetDataState()
 {
-    int samplesizewithmargin = Samples + scxt::dsp::FIRipol_N;
-    if (sampleData[Channel])
-        free(sampleData[Channel]);
-    sampleData[Channel] = malloc(sizeof(float) * samplesizewithmargin);
-    if (!sampleData[Channel])
-        return false;
-    bitDepth = BD_F32;
+    setCachedAnalytics(nullptr);
+    std::atomic_store(&waveformPyramid, std::shared_ptr<const WaveformPyramid>());
+    dropDerivedData();
+    evictedToFrames = 0;
+    dataIsMapped = false;
+}
 
-    // clear pre/post zero area
-    memset(sampleData[Channel], 0, scxt::dsp::FIRoffset * sizeof(float));
-    memset((char *)sampleData[Channel] + (Samples + scxt::dsp::FIRoffset) * sizeof(float), 0,
-           scxt::dsp::FIRoffset * sizeof(float));
+std::shared_ptr<const WaveformPyramid> Sample::getWaveformPyramid()
+{
+    auto res = std::atomic_load(&waveformPyramid);
+    if (!res && !dataSwapInFlight)
+    {
+        res = WaveformPyramid::build(*this);
+        // built from just the preload of an evicted sample it only does for this request
+        if (!isEvicted())
+            std::atomic_store(&waveformPyramid, res);
+    }
+    return res;
+}
 
-    return true;
+void Sample::setMipmap(const std::shared_ptr<const SampleMipmap> &m)
+{
+    // Voices may already hold the old one, so it can't go while we are alive
+    assert(!mipmap || mipmap == m);
+    mipmap = m;
+    mipmapForAudio = m.get();
 }
 
-bool Sample::load_data_ui8(int channel, void *data, unsigned int samplesize, unsigned int stride)
+void Sample::setRendition(const std::shared_ptr<const EngineRateRendition> &r)
 {
-    allocateI16(channel, samplesize);
-    short *sampledata = GetSamplePtrI16(channel);
+    rendition = r;
+    renditionForAudio = r.get();
+    renditionRequested = false;
+}
 
-    for (int i = 0; i < samplesize; i++)
+// Everything derived from the data goes when a channel is reallocated
+void Sample::dropDerivedData()
+{
+    mipmapForAudio = nullptr;
+    mipmap.reset();
+    mipmapRequested = false;
+    renditionForAudio = nullptr;
+    rendition.reset();
+    renditionRequested = false;
+}
+
+void Sample::shareDataFrom(const Sample &other)
+{
+    for (int c = 0; c < 2; ++c)
     {
-        sampledata[i] = (((short)*((unsigned char *)data + i * stride)) - 128) << 8;
+        sampleDataOwner[c] = other.sampleDataOwner[c];
+        sampleData[c] = other.sampleData[c];
     }
+    setCachedAnalytics(other.getCachedAnalytics());
+    std::atomic_store(&waveformPyramid, std::atomic_load(&other.waveformPyramid));
+    if (other.mipmap)
+        setMipmap(other.mipmap);
+    if (other.rendition)
+        setRendition(other.rendition);
+    bitDepth = other.bitDepth;
+    channels = other.channels;
+    sample_length = other.sample_length;
+    evictedToFrames = other.evictedToFrames.load();
+    dataIsMapped = other.dataIsMapped;
+    sample_rate = other.sample_rate;
+    InvSampleRate = other.InvSampleRate;
+    meta = other.meta;
+    memcpy(name, other.name, sizeof(name));
+    sample_loaded = other.sample_loaded;
+}
+
+bool Sample::loadAsContentAliasOf(const Sample &donor, const fs::path &path)
+{
+    if (donor.isMissingPlaceholder || !donor.sampleData[0])
+        return false;
+
+    shareDataFrom(donor);
+
+    type = donor.type;
+    preset = donor.preset;
+    instrument = donor.instrument;
+    region = donor.region;
+    md5Sum = donor.md5Sum;
+    contentHashKind = donor.contentHashKind;
+    mFileName = path;
+    displayName = fmt::format("{}", path.filename().u8string());
+
+    id = donor.id;
+    id.setPathHash(path);
+
     return true;
 }
 
-bool Sample::load_data_i8(int channel, void *data, unsigned int samplesize, unsigned int stride)
+size_t Sample::channelDataSizeInBytes() const
 {
-    allocateI16(channel, samplesize);
-    short *sampledata = GetSamplePtrI16(channel);
+    return (playableLength() + scxt::dsp::FIRipol_N) * bitDepthByteSize(bitDepth);
+}
 
-    for (int i = 0; i < samplesize; i++)
-    {
-        sampledata[i] = ((short)*((char *)data + i * stride)) << 8;
-    }
+void Sample::markVoiceStarted()
+{
+    static std::atomic<uint64_t> playClock{0};
+    lastPlayedStamp = ++playClock;
+    playingVoices++;
+}
+
+bool Sample::load_data_ui8(int channel, void *data, unsigned int samplesize, unsigned int stride)
+{
+    if (!allocateI16(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i8ToI16(data, stride, GetSamplePtrI16(channel), samplesize, true);
     return true;
 }
 
-bool Sample::load_data_i16(int channel, void *data, unsigned int samplesize, unsigned int stride)
+bool Sample::load_data_i8(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateI16(channel, samplesize);
-    short *sampledata = GetSamplePtrI16(channel);
+    if (!allocateI16(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i8ToI16(data, stride, GetSamplePtrI16(channel), samplesize, false);
+    return true;
+}
 
-    for (int i = 0; i < samplesize; i++)
-    {
-        sampledata[i] = endian_read_int16LE(*(short *)((char *)data + i * stride));
-    }
+bool Sample::load_data_i16(int channel, void *data, unsigned int samplesize, unsigned int stride)
+{
+    if (!allocateI16(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i16ToI16(data, stride, GetSamplePtrI16(channel), samplesize, false);
     return true;
 }
 
 bool Sample::load_data_i16BE(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateI16(channel, samplesize);
-    short *sampledata = GetSamplePtrI16(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        sampledata[i] = endian_read_int16BE(*(short *)((char *)data + i * stride));
-    }
+    if (!allocateI16(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i16ToI16(data, stride, GetSamplePtrI16(channel), samplesize, true);
     return true;
 }
 bool Sample::load_data_i32(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        int x = endian_read_int32LE(*(int *)((char *)data + i * stride));
-        sampledata[i] = (4.6566128730772E-10f) * (float)x;
-    }
+    if (!allocateF32(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i32ToF32(data, stride, GetSamplePtrF32(channel), samplesize, false);
     return true;
 }
 
 bool Sample::load_data_i32BE(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        int x = endian_read_int32BE(*(int *)((char *)data + i * stride));
-        sampledata[i] = (4.6566128730772E-10f) * (float)x;
-    }
+    if (!allocateF32(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i32ToF32(data, stride, GetSamplePtrF32(channel), samplesize, true);
     return true;
 }
 
 bool Sample::load_data_i24(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        unsigned char *cval = (unsigned char *)data + i * stride;
-        int value = (cval[2] << 16) | (cval[1] << 8) | cval[0];
-        value -= (value & 0x800000) << 1;
-        sampledata[i] = 0.00000011920928955078f * float(value);
-        ;
-    }
+    if (!allocateI24(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i24ToI24(data, stride, GetSamplePtrI24(channel), samplesize, false);
     return true;
 }
 
 bool Sample::load_data_i24BE(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        unsigned char *cval = (unsigned char *)data + i * stride;
-        int value = (cval[0] << 16) | (cval[1] << 8) | cval[2];
-        value -= (value & 0x800000) << 1;
-        sampledata[i] = 0.00000011920928955078f * float(value);
-        ;
-    }
+    if (!allocateI24(channel, samplesize))
+        return false;
+    dsp::sample_conversion::i24ToI24(data, stride, GetSamplePtrI24(channel), samplesize, true);
     return true;
 }
 
 bool Sample::load_data_f32(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        sampledata[i] = (*(float *)((char *)data + i * stride));
-    }
+    if (!allocateF32(channel, samplesize))
+        return false;
+    dsp::sample_conversion::f32ToF32(data, stride, GetSamplePtrF32(channel), samplesize);
     return true;
 }
 
 bool Sample::load_data_f64(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
-
-    for (int i = 0; i < samplesize; i++)
-    {
-        sampledata[i] = (float)(*(double *)((char *)data + i * stride));
-    }
+    if (!allocateF32(channel, samplesize))
+        return false;
+    dsp::sample_conversion::f64ToF32(data, stride, GetSamplePtrF32(channel), samplesize);
     return true;
 }
 
@@ -443,6 +604,24 @@ void Sample::dumpInformationToLog()
         }
     }
     break;
+    case BD_I24:
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            auto *dat = GetSamplePtrI24(c);
+            auto mxv = std::numeric_limits<int32_t>::min();
+            auto mnv = std::numeric_limits<int32_t>::max();
+            for (int i = 0; i < sample_length; ++i)
+            {
+                mxv = std::max(mxv, dat[i].toInt32());
+                mnv = std::min(mnv, dat[i].toInt32());
+            }
+            SCLOG("Min/Max = " << mxv << " " << mnv);
+            SCLOG("Min/Max Float Scaled = " << mxv * dsp::I24InvScale << " "
+                                            << mnv * dsp::I24InvScale);
+        }
+    }
+    break;
     case BD_F32:
     {
         SCLOG("TODO: Implement Sapmle Scan for F32");
@@ -456,10 +635,12 @@ std::shared_ptr<Sample> Sample::createMissingPlaceholder(const Sample::SampleFil
     auto res = std::make_shared<Sample>();
     res->mFileName = a.path;
     res->md5Sum = a.md5sum;
+    res->contentHashKind = a.contentHashKind;
     res->type = a.type;
     res->preset = a.preset;
     res->instrument = a.instrument;
     res->region = a.region;
+    res->fileSize = a.fileSize;
     res->isMissingPlaceholder = true;
     res->displayName = fmt::format("Missing {}", a.path.filename().u8string());
 
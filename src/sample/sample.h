@@ -29,10 +29,31 @@
 
 #include "utils.h"
 #include "infrastructure/filesystem_import.h"
+#include "infrastructure/content_hash.h"
+#include "infrastructure/file_map_view.h"
+#include "dsp/packed_int24.h"
 #include "SF.h"
 
 namespace scxt::sample
 {
+struct WaveformPyramid;
+struct SampleMipmap;
+struct EngineRateRendition;
+
+/*
+ * An SF2 mapped into memory along with where its smpl chunk (every sample's 16 bit PCM,
+ * back to back) sits in the mapping. The SampleManager keeps one per open soundfont and
+ * mono 16 bit regions play straight out of it rather than being copied.
+ */
+struct SF2SampleMapping
+{
+    std::shared_ptr<infrastructure::FileMapView> view;
+    const int16_t *smpl{nullptr};
+    size_t smplFrames{0};
+    std::shared_ptr<void> residency; // holds smpl locked when ResidentMemory is enabled
+
+    static std::shared_ptr<SF2SampleMapping> map(const fs::path &path);
+};
 
 struct alignas(16) Sample : MoveableOnly<Sample>
 {
@@ -54,12 +75,29 @@ struct alignas(16) Sample : MoveableOnly<Sample>
 
     std::string displayName{};
     std::string getDisplayName() const { return displayName; }
-    bool load(const fs::path &path);
-    bool loadFromSF2(const fs::path &path, sf2::File *f, int sampleIndex);
+    /*
+     * If knownContentHash is non-empty (the SampleManager found it in the identity cache)
+     * we use it as the md5 rather than hashing the file contents again; otherwise we hash
+     * with the given kind. Either way the kind is the one md5Sum is recorded as.
+     */
+    bool load(const fs::path &path, const std::string &knownContentHash = {},
+              infrastructure::ContentHashKind = infrastructure::ContentHashKind::MD5);
+    /*
+     * Load from a buffer holding the entire content of the file at path, as handed
+     * back by the BulkFileReader. WAV, AIFF and MP3 parse straight from the buffer;
+     * FLAC still decodes from the path (the bulk read has warmed the cache for it).
+     */
+    bool loadFromMemory(const fs::path &path, void *data, size_t dataSize,
+                        const std::string &knownContentHash = {},
+                        infrastructure::ContentHashKind = infrastructure::ContentHashKind::MD5);
+    bool loadFromSF2(const fs::path &path, sf2::File *f, int sampleIndex,
+                     const std::shared_ptr<SF2SampleMapping> &mapping = nullptr);
 
     const fs::path &getPath() const { return mFileName; }
     std::string md5Sum{};
     std::string getMD5Sum() const { return md5Sum; }
+    // which hash md5Sum holds; resolving the sample later has to hash the same way
+    infrastructure::ContentHashKind contentHashKind{infrastructure::ContentHashKind::MD5};
 
     int preset{-1}, instrument{-1}, region{-1};
     int getCompoundPreset() const { return preset; }
@@ -74,9 +112,12 @@ struct alignas(16) Sample : MoveableOnly<Sample>
         int preset{-1};
         int instrument{-1};
         int region{-1};
+        int64_t fileSize{-1}; // of the file at path, if we knew it; for missing resolution
+        infrastructure::ContentHashKind contentHashKind{infrastructure::ContentHashKind::MD5};
     };
 
     bool isMissingPlaceholder{false};
+    int64_t fileSize{-1};
     static std::shared_ptr<Sample> createMissingPlaceholder(const SampleFileAddress &a);
 
     SampleFileAddress getSampleFileAddress() const
@@ -92,7 +133,9 @@ struct alignas(16) Sample : MoveableOnly<Sample>
                 getMD5Sum(),
                 getCompoundPreset(),
                 getCompoundInstrument(),
-                getCompoundRegion()};
+                getCompoundRegion(),
+                fileSize,
+                contentHashKind};
     }
 
     size_t getDataSize() const { return sample_length * bitDepthByteSize(bitDepth) * channels; }
@@ -101,18 +144,133 @@ struct alignas(16) Sample : MoveableOnly<Sample>
 
     bool parseFlac(const fs::path &p);
     bool parseMP3(const fs::path &p);
+    bool parseMP3(const uint8_t *data, size_t dataSize);
 
+    /*
+     * sampleData are the raw pointers the generator reads from. The buffers themselves
+     * are refcounted by sampleDataOwner so samples with identical content (the same file
+     * reached by two paths, say) can share one copy of the PCM while keeping their own
+     * path, id and display name. See SampleManager's content index.
+     */
     void *__restrict sampleData[2]{nullptr, nullptr};
+    std::shared_ptr<void> sampleDataOwner[2];
+    void shareDataFrom(const Sample &other);
+    bool loadAsContentAliasOf(const Sample &donor, const fs::path &path);
+    size_t channelDataSizeInBytes() const;
+
+    /*
+     * True when sampleData points into a read only file mapping (see SF2SampleMapping)
+     * rather than a buffer we allocated. That memory is the OS page cache, so it isn't
+     * counted against or evicted by the memory budget, and it must never be written.
+     */
+    bool dataIsMapped{false};
+
+    /*
+     * Level analysis of the sample data, in the generator's [-1,1) float scale. It is
+     * computed once, on first request, by dsp::sample_analytics and cached here; the cache
+     * is dropped whenever a channel is reallocated. Access is atomic so any thread can
+     * read it.
+     */
+    struct Analytics
+    {
+        float peak{0.f};
+        float rms{0.f};
+        float dcOffset{0.f};
+        float integratedLoudness{-70.f}; // LUFS per ITU-R BS.1770, clamped at the -70 gate
+    };
+    std::shared_ptr<const Analytics> getCachedAnalytics() const
+    {
+        return std::atomic_load(&analytics);
+    }
+    void setCachedAnalytics(std::shared_ptr<const Analytics> a)
+    {
+        std::atomic_store(&analytics, std::move(a));
+    }
+
+    /*
+     * The min/max pyramid for drawing this sample's waveform, built on first request (or
+     * by the SampleManager just before it evicts the data). Like the analytics it is
+     * dropped when a channel is reallocated. Null if it isn't built and can't be yet,
+     * which is only while a data swap is in flight.
+     */
+    std::shared_ptr<const WaveformPyramid> getWaveformPyramid();
+
+    /*
+     * Half rate copies for voices transposed well up (see SampleMipmap). A voice which
+     * wants one and finds none sets mipmapRequested and asks the serialization thread,
+     * which builds it with SampleManager::buildMipmapFor. getMipmap is a plain atomic
+     * read for the audio thread. Once set the mipmap lives as long as the sample, unless
+     * a channel is reallocated, which only happens before any voice can see it.
+     */
+    const SampleMipmap *getMipmap() const { return mipmapForAudio.load(); }
+    std::shared_ptr<const SampleMipmap> getMipmapOwner() const { return mipmap; }
+    void setMipmap(const std::shared_ptr<const SampleMipmap> &m);
+    std::atomic<bool> mipmapRequested{false};
+
+    /*
+     * A copy at the engine's rate (see EngineRateRendition), when the SampleManager is
+     * asked to make them. Like the mipmap, voices read it with a plain atomic load and
+     * ask the serialization thread (setting renditionRequested) if it isn't there or was
+     * made for another rate. Replacing one is the SampleManager's business, since voices
+     * may still be playing the old one.
+     */
+    const EngineRateRendition *getRendition() const { return renditionForAudio.load(); }
+    std::shared_ptr<const EngineRateRendition> getRenditionOwner() const { return rendition; }
+    void setRendition(const std::shared_ptr<const EngineRateRendition> &r);
+    std::atomic<bool> renditionRequested{false};
+
+    /*
+     * Residency. When the SampleManager's memory budget evicts a sample it keeps all the
+     * metadata but only the first few hundred ms of data (with the usual FIR pads), and
+     * evictedToFrames says how many frames that is; it is zero when the sample is fully
+     * loaded. Anything reading the data must stay inside playableLength().
+     *
+     * Voices mark the sample as they start and stop on the audio thread; that is what
+     * the eviction LRU and the "is anyone holding the old data" checks run from.
+     */
+    std::atomic<uint32_t> evictedToFrames{0};
+    bool isEvicted() const { return evictedToFrames.load() != 0; }
+    /*
+     * Set by the SampleManager from when it queues an audio thread swap of this sample's
+     * data (an eviction or a reload) until that has run. The audio thread writes
+     * sampleData, sampleDataOwner and evictedToFrames in the swap, so while this is set
+     * nothing off the audio thread may read them.
+     */
+    std::atomic<bool> dataSwapInFlight{false};
+    uint32_t playableLength() const
+    {
+        auto e = evictedToFrames.load();
+        return e ? e : sample_length;
+    }
+    std::atomic<uint64_t> lastPlayedStamp{0};
+    std::atomic<int32_t> playingVoices{0};
+    std::atomic<bool> reloadRequested{false};
+    void markVoiceStarted();
+    void markVoiceEnded() { playingVoices--; }
 
     // TODO: Review evertyhing from here down before moving it above this comment
     bool parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk = false);
     bool parse_aiff(void *data, size_t filesize);
     short *GetSamplePtrI16(int Channel);
     float *GetSamplePtrF32(int Channel);
+    dsp::PackedInt24 *GetSamplePtrI24(int Channel);
     char *GetName();
 
   private:
+    std::shared_ptr<const Analytics> analytics;
+    std::shared_ptr<const WaveformPyramid> waveformPyramid;
+    std::shared_ptr<const SampleMipmap> mipmap;
+    std::atomic<const SampleMipmap *> mipmapForAudio{nullptr};
+    std::shared_ptr<const EngineRateRendition> rendition;
+    std::atomic<const EngineRateRendition *> renditionForAudio{nullptr};
+    void dropDerivedData();
+    // Forget everything worked out from the old data (analytics, pyramid, derived data,
+    // eviction and mapping) before new data goes in
+    void resetDataState();
+
     bool parse_sf2_sample(void *data, size_t filesize, unsigned int sampleid);
+    bool referenceMappedSF2Data(const std::shared_ptr<SF2SampleMapping> &mapping, size_t start,
+                                size_t end);
     bool parse_dls_sample(void *data, size_t filesize, unsigned int sampleid);
 
   public:
@@ -123,11 +281,12 @@ struct alignas(16) Sample : MoveableOnly<Sample>
     // public data
     enum BitDepth
     {
-        // Right now 8 -> I16 at load and 24 -> F32 at load and noone supports 12 so just make this
+        // Right now 8 -> I16 at load and noone supports 12 so just make this. 24 bit integer
+        // sources are kept packed (3 bytes a sample), 32 bit integer and float go to F32
         // BD_I8,
         // BD_I12,
         BD_I16,
-        // BD_I24,
+        BD_I24,
         BD_F32
     } bitDepth{BD_F32};
 
@@ -137,6 +296,8 @@ struct alignas(16) Sample : MoveableOnly<Sample>
         {
         case BD_I16:
             return "I16";
+        case BD_I24:
+            return "I24";
         case BD_F32:
             return "F32";
         default:
@@ -150,6 +311,8 @@ struct alignas(16) Sample : MoveableOnly<Sample>
         {
         case BD_I16:
             return 2;
+        case BD_I24:
+            return 3;
         case BD_F32:
             return 4;
         default:
@@ -214,10 +377,21 @@ struct alignas(16) Sample : MoveableOnly<Sample>
         // TODO: Figure Out and Implement clear_data
         // deletes sample data and marks sample as unused
     }
+    bool allocateChannel(int channel, int samples, BitDepth bd);
 
   public:
     bool allocateI16(int Channel, int Samples);
     bool allocateF32(int Channel, int Samples);
+    bool allocateI24(int Channel, int Samples);
+
+    /*
+     * Point the channels at data in memory owner keeps alive (a file mapping, usually)
+     * rather than a buffer of our own, setting dataIsMapped. Each channel must be laid out
+     * as allocate* lays it out, sample_length frames of bd with FIRoffset silent frames
+     * either side; if the pads aren't silent this returns false and changes nothing.
+     */
+    bool referenceMappedData(const std::shared_ptr<void> &owner, void *const data[2],
+                             BitDepth bd);
 
     bool load_data_ui8(int channel, void *data, unsigned int samplesize, unsigned int stride);
     bool load_data_i8(int channel, void *data, unsigned int samplesize, unsigned int stride);
@@ -25,18 +25,91 @@
  * https://github.com/surge-synthesizer/shortcircuit-xt
  */
 
+#include <algorithm>
 #include <cassert>
+#include <unordered_set>
 #include "sample_manager.h"
-#include "infrastructure/md5support.h"
+#include "shared_sample_store.h"
+#include "sample_mipmap.h"
+#include "engine_rate_rendition.h"
+#include "infrastructure/bulk_file_reader.h"
+#include "infrastructure/resident_memory.h"
+#include "browser/browser_db.h"
+#include "dsp/resampling.h"
+#include "dsp/sample_analytics.h"
 
 namespace scxt::sample
 {
 
+void SampleManager::provideEmbeddedSamples(const std::vector<std::shared_ptr<Sample>> &s)
+{
+    embeddedSamples.clear();
+    for (const auto &smp : s)
+        embeddedSamples[smp->id] = smp;
+}
+
+std::vector<std::shared_ptr<Sample>> SampleManager::takeEmbeddedSamples()
+{
+    std::vector<std::shared_ptr<Sample>> res;
+    for (auto &[id, smp] : embeddedSamples)
+        res.push_back(std::move(smp));
+    embeddedSamples.clear();
+    return res;
+}
+
 void SampleManager::restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds_t &r)
 {
+    auto embedded = std::move(embeddedSamples);
+    embeddedSamples.clear();
+    bool tookEmbedded{false};
+    auto takeEmbedded = [&embedded, &tookEmbedded, this](const SampleID &id) {
+        auto e = embedded.find(id);
+        if (e == embedded.end())
+            return false;
+        if (!getSample(id))
+        {
+            // no analytics or waveform here; they build when asked, so nothing is paged in
+            addSample(e->second);
+            addToContentIndex(e->second);
+            tookEmbedded = true;
+        }
+        return true;
+    };
+
+    // Read every plain sample file in one bulk batch first. The per-address loop
+    // below then finds them already loaded by path.
+    std::vector<fs::path> bulkPaths;
+    std::vector<infrastructure::ContentHashKind> bulkKinds;
     for (const auto &[id, addr] : r)
     {
-        if (!fs::exists(addr.path))
+        if (embedded.find(id) != embedded.end())
+            continue;
+        switch (addr.type)
+        {
+        case Sample::WAV_FILE:
+        case Sample::FLAC_FILE:
+        case Sample::MP3_FILE:
+        case Sample::AIFF_FILE:
+            if (fs::exists(addr.path))
+            {
+                bulkPaths.push_back(addr.path);
+                bulkKinds.push_back(addr.contentHashKind);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (bulkPaths.size() > 1)
+        loadSamplesByPath(bulkPaths, bulkKinds);
+
+    for (const auto &[id, addr] : r)
+    {
+        if (takeEmbedded(id))
+        {
+            continue;
+        }
+        else if (!fs::exists(addr.path))
         {
             addSampleAsMissing(id, addr);
         }
@@ -50,13 +123,13 @@ void SampleManager::restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds
             case Sample::MP3_FILE:
             case Sample::AIFF_FILE:
             {
-                nid = loadSampleByPath(addr.path);
+                nid = loadSampleByPath(addr.path, addr.contentHashKind);
             }
             break;
             case Sample::SF2_FILE:
             {
                 nid = loadSampleFromSF2(addr.path, nullptr, addr.preset, addr.instrument,
-                                        addr.region);
+                                        addr.region, addr.contentHashKind);
             }
             break;
             case Sample::MULTISAMPLE_FILE:
@@ -77,41 +150,157 @@ void SampleManager::restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds
             }
         }
     }
+    if (tookEmbedded)
+        updateSampleMemory();
 }
 
 SampleManager::~SampleManager() { SCLOG("Destroying Sample Manager"); }
 
-std::optional<SampleID> SampleManager::loadSampleByPath(const fs::path &p)
+std::optional<SampleID>
+SampleManager::loadSampleByPath(const fs::path &p,
+                                std::optional<infrastructure::ContentHashKind> hashKind)
 {
     assert(threadingChecker.isSerialThread());
+    auto kind = hashKind.value_or(contentHashKind);
+
+    auto already = idsByPath.find(p.u8string());
+    if (already != idsByPath.end())
+        return already->second;
 
-    for (const auto &[alreadyId, sm] : samples)
+    // A cached hash lets identical content at another path share its data without this
+    // file being parsed at all. On a miss, load hashes the buffer it parses from (so the
+    // file is only read once) and we can still share afterwards.
+    auto knownHash = cachedContentHashFor(p, kind);
+    auto sp = loadAsContentAlias(p, knownHash);
+    if (!sp)
     {
-        if (sm->getPath() == p)
+        sp = std::make_shared<Sample>();
+        if (!sp->load(p, knownHash, kind))
         {
-            return alreadyId;
+            SCLOG("Failed to load sample from '" << p.u8string() << "'");
+            return std::nullopt;
         }
+        if (knownHash.empty())
+        {
+            rememberContentHash(p, kind, sp->md5Sum);
+            if (auto alias = loadAsContentAlias(p, sp->md5Sum))
+                sp = alias;
+        }
+        SCLOG("Loading : " << p.u8string());
     }
 
-    auto sp = std::make_shared<Sample>();
+    addSample(sp);
+    addToContentIndex(sp);
+    SCLOG("        : " << sp->id.to_string());
+
+    updateSampleMemory();
+    return sp->id;
+}
 
-    if (!sp->load(p))
+std::vector<std::optional<SampleID>>
+SampleManager::loadSamplesByPath(const std::vector<fs::path> &paths,
+                                 const std::vector<infrastructure::ContentHashKind> &kinds)
+{
+    assert(threadingChecker.isSerialThread());
+    assert(kinds.empty() || kinds.size() == paths.size());
+    auto kindAt = [&kinds, this](size_t i) { return kinds.empty() ? contentHashKind : kinds[i]; };
+
+    std::vector<std::optional<SampleID>> res(paths.size());
+    std::vector<fs::path> toRead;
+    std::vector<size_t> toReadIndex;
+    std::unordered_map<std::string, size_t> firstIndexByPath;
+
+    for (size_t i = 0; i < paths.size(); ++i)
     {
-        SCLOG("Failed to load sample from '" << p.u8string() << "'");
-        return std::nullopt;
+        const auto &p = paths[i];
+        auto already = idsByPath.find(p.u8string());
+        if (already != idsByPath.end())
+        {
+            res[i] = already->second;
+            continue;
+        }
+
+        // The same path can show up more than once in a batch; only read it once
+        if (firstIndexByPath.find(p.u8string()) != firstIndexByPath.end())
+            continue;
+        firstIndexByPath[p.u8string()] = i;
+
+        // and if we already know the content we may not need to read it at all
+        auto alias = loadAsContentAlias(p, cachedContentHashFor(p, kindAt(i)));
+        if (alias)
+        {
+            addSample(alias);
+            addToContentIndex(alias);
+            res[i] = alias->id;
+            continue;
+        }
+
+        toRead.push_back(p);
+        toReadIndex.push_back(i);
     }
 
-    samples[sp->id] = sp;
-    SCLOG("Loading : " << p.u8string());
-    SCLOG("        : " << sp->id.to_string());
+    if (!toRead.empty())
+    {
+        SCLOG("Bulk reading " << toRead.size() << " samples with "
+                              << infrastructure::BulkFileReader::backendName(
+                                     infrastructure::BulkFileReader::backend()));
+    }
+
+    infrastructure::BulkFileReader::readAll(toRead, [&, this](auto &r) {
+        const auto &p = r.path;
+        if (!r.isValid)
+        {
+            SCLOG("Failed to read sample from '" << p.u8string() << "'");
+            return;
+        }
+
+        auto kind = kindAt(toReadIndex[r.index]);
+        auto knownHash = cachedContentHashFor(p, kind);
+        if (knownHash.empty())
+        {
+            knownHash = infrastructure::createContentHash(kind, r.data.get(), r.dataSize);
+            rememberContentHash(p, kind, knownHash);
+        }
+
+        // Two paths in the same batch can still have the same content
+        auto sp = loadAsContentAlias(p, knownHash);
+        if (!sp)
+        {
+            sp = std::make_shared<Sample>();
+            if (!sp->loadFromMemory(p, r.data.get(), r.dataSize, knownHash, kind))
+            {
+                SCLOG("Failed to load sample from '" << p.u8string() << "'");
+                return;
+            }
+        }
+
+        addSample(sp);
+        addToContentIndex(sp);
+        SCLOG("Loading : " << p.u8string());
+        SCLOG("        : " << sp->id.to_string());
+        res[toReadIndex[r.index]] = sp->id;
+    });
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (!res[i].has_value())
+        {
+            auto fi = firstIndexByPath.find(paths[i].u8string());
+            if (fi != firstIndexByPath.end())
+                res[i] = res[fi->second];
+        }
+    }
 
     updateSampleMemory();
-    return sp->id;
+    return res;
 }
 
-std::optional<SampleID> SampleManager::loadSampleFromSF2(const fs::path &p, sf2::File *f,
-                                                         int preset, int instrument, int region)
+std::optional<SampleID>
+SampleManager::loadSampleFromSF2(const fs::path &p, sf2::File *f, int preset, int instrument,
+                                 int region,
+                                 std::optional<infrastructure::ContentHashKind> hashKind)
 {
+    auto kind = hashKind.value_or(contentHashKind);
     if (!f)
     {
         if (sf2FilesByPath.find(p.u8string()) == sf2FilesByPath.end())
@@ -131,9 +320,11 @@ std::optional<SampleID> SampleManager::loadSampleFromSF2(const fs::path &p, sf2:
         }
         f = std::get<1>(sf2FilesByPath[p.u8string()]).get();
     }
+    auto mapping = sf2MappingFor(p);
 
-    if (sf2MD5ByPath.find(p.u8string()) == sf2MD5ByPath.end())
-        sf2MD5ByPath[p.u8string()] = infrastructure::createMD5SumFromFile(p);
+    auto &sf2MD5 = sf2MD5ByPath[p.u8string()][kind];
+    if (sf2MD5.empty())
+        sf2MD5 = contentHashForFile(p, kind);
 
     assert(f);
 
@@ -151,21 +342,45 @@ std::optional<SampleID> SampleManager::loadSampleFromSF2(const fs::path &p, sf2:
     {
         return std::nullopt;
     }
-    for (const auto &[id, sm] : samples)
+    auto sf2Ids = sf2IdsByPathAndRegion.find(p.u8string());
+    if (sf2Ids != sf2IdsByPathAndRegion.end())
     {
-        if (sm->type == Sample::SF2_FILE)
+        auto already = sf2Ids->second.find(sidx);
+        if (already != sf2Ids->second.end())
+            return already->second;
+    }
+
+    std::shared_ptr<Sample> sp;
+    {
+        // The same soundfont at another path can share the region data
+        SampleID contentId;
+        contentId.setAsMD5WithAddress(sf2MD5, -1, -1, sidx);
+        auto donor = findContentDonor(contentId);
+        if (donor)
         {
-            if (sm->getPath() == p && sm->getCompoundRegion() == sidx)
-                return id;
+            sp = std::make_shared<Sample>();
+            if (sp->loadAsContentAliasOf(*donor, p))
+            {
+                auto fnp = fs::path(fs::u8path(f->GetRiffFile()->GetFileName()));
+                sp->displayName = fmt::format("{} - ({} @ {})", f->GetSample(sidx)->Name,
+                                              fnp.filename().u8string(), sidx);
+            }
+            else
+            {
+                sp.reset();
+            }
         }
     }
 
-    auto sp = std::make_shared<Sample>();
-
-    if (!sp->loadFromSF2(p, f, sidx))
-        return {};
+    if (!sp)
+    {
+        sp = std::make_shared<Sample>();
+        if (!sp->loadFromSF2(p, f, sidx, mapping))
+            return {};
+    }
 
-    sp->md5Sum = sf2MD5ByPath[p.u8string()];
+    sp->md5Sum = sf2MD5;
+    sp->contentHashKind = kind;
     assert(!sp->md5Sum.empty());
     sp->id.setAsMD5WithAddress(sp->md5Sum, -1, -1, sidx);
     sp->id.setPathHash(p);
@@ -174,7 +389,8 @@ std::optional<SampleID> SampleManager::loadSampleFromSF2(const fs::path &p, sf2:
     SCLOG("        : " << sp->displayName);
     SCLOG("        : " << sp->id.to_string());
 
-    samples[sp->id] = sp;
+    addSample(sp);
+    addToContentIndex(sp);
     updateSampleMemory();
     return sp->id;
 }
@@ -212,12 +428,14 @@ std::optional<SampleID> SampleManager::setupSampleFromMultifile(const fs::path &
     auto sp = std::make_shared<Sample>();
     sp->id.setAsMD5WithAddress(md5, idx, -1, -1);
     sp->id.setPathHash(p);
+    sp->md5Sum = md5;
+    sp->contentHashKind = contentHashKind; // our callers hash with contentHashForFile
 
     sp->parse_riff_wave(data, dataSize);
     sp->type = Sample::MULTISAMPLE_FILE;
     sp->region = idx;
     sp->mFileName = p;
-    samples[sp->id] = sp;
+    addSample(sp);
     updateSampleMemory();
     return sp->id;
 }
@@ -242,7 +460,7 @@ std::optional<SampleID> SampleManager::loadSampleFromMultiSample(const fs::path
     sp->type = Sample::MULTISAMPLE_FILE;
     sp->region = idx;
     sp->mFileName = p;
-    samples[sp->id] = sp;
+    addSample(sp);
     updateSampleMemory();
 
     free(data);
@@ -253,6 +471,41 @@ std::optional<SampleID> SampleManager::loadSampleFromMultiSample(const fs::path
     return sp->id;
 }
 
+std::string SampleManager::contentHashForFile(const fs::path &p)
+{
+    return contentHashForFile(p, contentHashKind);
+}
+
+std::string SampleManager::contentHashForFile(const fs::path &p,
+                                              infrastructure::ContentHashKind kind)
+{
+    auto res = cachedContentHashFor(p, kind);
+    if (res.empty())
+    {
+        res = infrastructure::createContentHashFromFile(kind, p);
+        rememberContentHash(p, kind, res);
+    }
+    return res;
+}
+
+std::string SampleManager::cachedContentHashFor(const fs::path &p,
+                                                infrastructure::ContentHashKind kind) const
+{
+    if (!identityCache)
+        return {};
+    auto res = identityCache->getCachedContentHash(p, kind);
+    if (res.has_value())
+        return *res;
+    return {};
+}
+
+void SampleManager::rememberContentHash(const fs::path &p, infrastructure::ContentHashKind kind,
+                                        const std::string &h)
+{
+    if (identityCache && !h.empty())
+        identityCache->storeContentHash(p, kind, h);
+}
+
 void SampleManager::purgeUnreferencedSamples()
 {
     auto preSize{samples.size()};
@@ -269,6 +522,7 @@ void SampleManager::purgeUnreferencedSamples()
                 SCLOG("        : Missing Placeholder");
             }
 
+            removeFromLoadIndices(*b->second);
             b = samples.erase(b);
         }
         else
@@ -281,18 +535,614 @@ void SampleManager::purgeUnreferencedSamples()
     {
         SCLOG_WFUNC("PostPurge : Purged " << (preSize - samples.size()) << " Remaining "
                                           << samples.size());
+        rebuildContentIndex();
     }
     updateSampleMemory();
 }
 
+void SampleManager::addSample(const std::shared_ptr<Sample> &s)
+{
+    samples[s->id] = s;
+    if (!s->isMissingPlaceholder && s->fileSize < 0)
+    {
+        // Streamed with the address so a patch opened elsewhere can look for this by size
+        std::error_code ec;
+        auto sz = fs::file_size(s->getPath(), ec);
+        if (!ec)
+            s->fileSize = (int64_t)sz;
+    }
+    if (renderAtEngineRate && !s->isMissingPlaceholder)
+        updateRendition(s);
+    switch (s->type)
+    {
+    case Sample::SF2_FILE:
+        sf2IdsByPathAndRegion[s->getPath().u8string()][s->getCompoundRegion()] = s->id;
+        break;
+    case Sample::MULTISAMPLE_FILE:
+        // loaded by archive and index, never by path alone
+        break;
+    default:
+        idsByPath[s->getPath().u8string()] = s->id;
+        break;
+    }
+}
+
+void SampleManager::removeFromLoadIndices(const Sample &s)
+{
+    auto key = s.getPath().u8string();
+    if (s.type == Sample::SF2_FILE)
+    {
+        auto f = sf2IdsByPathAndRegion.find(key);
+        if (f == sf2IdsByPathAndRegion.end())
+            return;
+        auto r = f->second.find(s.getCompoundRegion());
+        if (r != f->second.end() && r->second == s.id)
+            f->second.erase(r);
+        if (f->second.empty())
+            sf2IdsByPathAndRegion.erase(f);
+    }
+    else
+    {
+        auto f = idsByPath.find(key);
+        if (f != idsByPath.end() && f->second == s.id)
+            idsByPath.erase(f);
+    }
+}
+
+void SampleManager::addIdAlias(const SampleID &from, const SampleID &to)
+{
+    auto target = resolveAlias(to);
+    assert(target != from);
+
+    auto prior = idAliases.find(from);
+    if (prior != idAliases.end())
+    {
+        aliasSources[prior->second].erase(from);
+    }
+    idAliases[from] = target;
+    aliasSources[target].insert(from);
+
+    // Anything which ended at from now ends at target
+    auto srcs = aliasSources.find(from);
+    if (srcs != aliasSources.end())
+    {
+        auto moved = std::move(srcs->second);
+        aliasSources.erase(srcs);
+        auto &targetSources = aliasSources[target];
+        for (const auto &src : moved)
+        {
+            idAliases[src] = target;
+            targetSources.insert(src);
+        }
+    }
+}
+
+SampleID SampleManager::contentKeyFor(const SampleID &id)
+{
+    auto res = id;
+    res.setPathHash((size_t)0);
+    return res;
+}
+
+std::shared_ptr<Sample> SampleManager::findContentDonor(const SampleID &id) const
+{
+    if (!id.isValid())
+        return {};
+    auto key = contentKeyFor(id);
+    auto it = contentIndex.find(key);
+    if (it != contentIndex.end())
+    {
+        // a sample mid swap can't lend its data; the caller reads the file instead
+        auto res = it->second.lock();
+        if (res && !res->dataSwapInFlight)
+            return res;
+        if (res)
+            return {};
+    }
+    if (useSharedSampleStore)
+        return SharedSampleStore::instance().findDonor(key);
+    return {};
+}
+
+std::shared_ptr<Sample> SampleManager::loadAsContentAlias(const fs::path &p,
+                                                          const std::string &contentHash) const
+{
+    if (contentHash.empty())
+        return {};
+
+    SampleID contentId;
+    contentId.setAsMD5(contentHash);
+    auto donor = findContentDonor(contentId);
+    if (!donor)
+        return {};
+
+    auto sp = std::make_shared<Sample>();
+    if (!sp->loadAsContentAliasOf(*donor, p))
+        return {};
+
+    SCLOG("Sharing : " << p.u8string());
+    SCLOG("   with : " << donor->getPath().u8string());
+    return sp;
+}
+
+void SampleManager::addToContentIndex(const std::shared_ptr<Sample> &s)
+{
+    // a swap only ever replaces data with data, so an in flight sample has some
+    auto inFlight = s->dataSwapInFlight.load();
+    if (s->isMissingPlaceholder || (!inFlight && !s->sampleData[0]))
+        return;
+    auto &entry = contentIndex[contentKeyFor(s->id)];
+    if (entry.expired())
+        entry = s;
+    if (useSharedSampleStore && !inFlight)
+        SharedSampleStore::instance().publish(contentKeyFor(s->id), *s);
+}
+
+void SampleManager::rebuildContentIndex()
+{
+    contentIndex.clear();
+    for (const auto &[id, s] : samples)
+    {
+        addToContentIndex(s);
+    }
+}
+
 void SampleManager::updateSampleMemory()
 {
+    releaseRetiredData();
+    sampleMemoryInBytes = computeSampleMemory();
+    if (memoryBudget > 0 && sampleMemoryInBytes > memoryBudget)
+        enforceMemoryBudget();
+}
+
+std::shared_ptr<SF2SampleMapping> SampleManager::sf2MappingFor(const fs::path &p)
+{
+    auto key = p.u8string();
+    auto it = sf2MappingsByPath.find(key);
+    if (it != sf2MappingsByPath.end())
+        return it->second;
+
+    // A failed map is remembered too, so we don't retry it for every region
+    auto res = SF2SampleMapping::map(p);
+    if (!res)
+        SCLOG("Unable to map smpl chunk of " << key << "; SF2 regions will be copied");
+    sf2MappingsByPath[key] = res;
+    return res;
+}
+
+uint64_t SampleManager::computeSampleMemory() const
+{
+    // Count each buffer once, however many samples share it
+    std::unordered_set<const void *> seen;
     uint64_t res = 0;
     for (const auto &[id, smp] : samples)
     {
-        res += smp->sample_length * smp->channels * (smp->bitDepth == Sample::BD_I16 ? 4 : 8);
+        // Mapped SF2 data is page cache, not ours. Data mid swap is counted when the
+        // swap completes, which recomputes this.
+        if (smp->dataIsMapped || smp->dataSwapInFlight)
+            continue;
+        for (int c = 0; c < std::min((int)smp->channels, 2); ++c)
+        {
+            const void *d = smp->sampleData[c];
+            if (d && seen.insert(d).second)
+            {
+                res += smp->channelDataSizeInBytes();
+            }
+        }
+    }
+    for (const auto &[id, smp] : samples)
+    {
+        auto mm = smp->getMipmap();
+        if (mm && seen.insert(mm).second)
+            res += mm->sizeInBytes();
+        auto r = smp->getRendition();
+        if (r && seen.insert(r).second)
+            res += r->sizeInBytes();
+    }
+    return res;
+}
+
+void SampleManager::setMemoryBudget(uint64_t bytes)
+{
+    memoryBudget = bytes;
+    updateSampleMemory();
+}
+
+size_t SampleManager::preloadFramesFor(const Sample &s) const
+{
+    return std::max((size_t)1, (size_t)s.sample_rate * preloadMilliseconds / 1000);
+}
+
+bool SampleManager::canReload(const Sample &s) const
+{
+    if (s.isMissingPlaceholder)
+        return false;
+
+    switch (s.type)
+    {
+    case Sample::WAV_FILE:
+    case Sample::FLAC_FILE:
+    case Sample::MP3_FILE:
+    case Sample::AIFF_FILE:
+        return true;
+    case Sample::SF2_FILE:
+        return sf2FilesByPath.find(s.getPath().u8string()) != sf2FilesByPath.end();
+    case Sample::MULTISAMPLE_FILE:
+    {
+        auto za = zipArchives.find(s.getPath().u8string());
+        return za != zipArchives.end() && za->second->isOpen;
+    }
+    }
+    return false;
+}
+
+std::shared_ptr<Sample> SampleManager::readSampleDataFor(const Sample &s)
+{
+    auto res = std::make_shared<Sample>();
+    switch (s.type)
+    {
+    case Sample::WAV_FILE:
+    case Sample::FLAC_FILE:
+    case Sample::MP3_FILE:
+    case Sample::AIFF_FILE:
+        if (!res->load(s.getPath(), s.getMD5Sum(), s.contentHashKind))
+            return {};
+        break;
+    case Sample::SF2_FILE:
+    {
+        auto sf = sf2FilesByPath.find(s.getPath().u8string());
+        if (sf == sf2FilesByPath.end() ||
+            !res->loadFromSF2(s.getPath(), std::get<1>(sf->second).get(),
+                              s.getCompoundRegion(), sf2MappingFor(s.getPath())))
+            return {};
+    }
+    break;
+    case Sample::MULTISAMPLE_FILE:
+    {
+        auto za = zipArchives.find(s.getPath().u8string());
+        if (za == zipArchives.end() || !za->second->isOpen)
+            return {};
+        size_t ssize;
+        auto data = mz_zip_reader_extract_to_heap(&za->second->zip_archive,
+                                                  s.getCompoundRegion(), &ssize, 0);
+        if (!data)
+            return {};
+        auto ok = res->parse_riff_wave(data, ssize);
+        free(data);
+        if (!ok)
+            return {};
+    }
+    break;
+    }
+
+    // If the file has changed under us since the first load, the metadata we kept is wrong
+    if (res->bitDepth != s.bitDepth || res->channels != s.channels ||
+        res->getSampleLength() != s.getSampleLength())
+    {
+        SCLOG("Sample changed on disk since load : " << s.getPath().u8string());
+        return {};
+    }
+    return res;
+}
+
+SampleManager::sampleGroup_t SampleManager::samplesSharingDataWith(const Sample &s) const
+{
+    sampleGroup_t res;
+    if (s.dataSwapInFlight)
+        return res;
+    for (const auto &[id, smp] : samples)
+    {
+        if (!smp->dataSwapInFlight && smp->sampleData[0] &&
+            smp->sampleData[0] == s.sampleData[0])
+            res.push_back(smp);
+    }
+    return res;
+}
+
+void SampleManager::enforceMemoryBudget()
+{
+    if (memoryBudget == 0)
+        return;
+
+    auto used = computeSampleMemory();
+    if (used <= memoryBudget)
+        return;
+
+    // Samples sharing a buffer only free it if they are all evicted, so gather by buffer
+    struct Candidate
+    {
+        sampleGroup_t group;
+        uint64_t lastPlayed{0};
+        bool unreferenced{true};
+    };
+    std::unordered_map<const void *, Candidate> candidates;
+    std::unordered_set<const void *> blocked;
+    for (const auto &[id, smp] : samples)
+    {
+        // a whole group goes in flight together, so this never splits one
+        if (smp->dataSwapInFlight)
+            continue;
+        const void *d = smp->sampleData[0];
+        if (!d || blocked.find(d) != blocked.end())
+            continue;
+
+        if (smp->dataIsMapped || smp->isEvicted() || smp->playingVoices > 0 || !canReload(*smp) ||
+            preloadFramesFor(*smp) >= smp->getSampleLength())
+        {
+            blocked.insert(d);
+            candidates.erase(d);
+            continue;
+        }
+
+        auto &c = candidates[d];
+        c.group.push_back(smp);
+        c.lastPlayed = std::max(c.lastPlayed, smp->lastPlayedStamp.load());
+        // one count for the sample map and one for the group we just added it to
+        c.unreferenced = c.unreferenced && smp.use_count() <= 2;
+    }
+
+    std::vector<Candidate *> order;
+    for (auto &[d, c] : candidates)
+        order.push_back(&c);
+    std::sort(order.begin(), order.end(), [](auto *a, auto *b) {
+        if (a->unreferenced != b->unreferenced)
+            return a->unreferenced;
+        return a->lastPlayed < b->lastPlayed;
+    });
+
+    for (auto *c : order)
+    {
+        if (used <= memoryBudget)
+            break;
+
+        const auto &lead = *c->group.front();
+        auto channels = std::min((int)lead.channels, 2);
+        auto fullSize = lead.channelDataSizeInBytes() * channels;
+        auto keptSize = (preloadFramesFor(lead) + dsp::FIRipol_N) *
+                        Sample::bitDepthByteSize(lead.bitDepth) * channels;
+
+        SCLOG("Evicting : " << lead.getPath().u8string());
+        evictSampleGroup(c->group);
+        used -= fullSize - keptSize;
+    }
+
+    if (used > memoryBudget)
+    {
+        SCLOG("Sample memory " << used << " still above budget " << memoryBudget
+                               << " after eviction");
+    }
+    sampleMemoryInBytes = used;
+}
+
+void SampleManager::evictSampleGroup(const sampleGroup_t &group)
+{
+    const auto &lead = *group.front();
+    auto frames = preloadFramesFor(lead);
+    auto bps = Sample::bitDepthByteSize(lead.bitDepth);
+    auto bytes = (frames + dsp::FIRipol_N) * bps;
+    auto kept = (frames + dsp::FIRoffset) * bps;
+
+    // Analytics and the waveform pyramid build when first asked for, from the whole of the
+    // data, which is about to go; so make sure they exist before it does
+    for (const auto &s : group)
+    {
+        dsp::sample_analytics::getAnalytics(*s);
+        s->getWaveformPyramid();
+    }
+
+    std::shared_ptr<void> preload[2];
+    for (int c = 0; c < std::min((int)lead.channels, 2); ++c)
+    {
+        preload[c] = infrastructure::ResidentMemory::instance().allocate(bytes);
+        auto *d = preload[c].get();
+        if (!d)
+            return;
+
+        // The leading pad and the first frames come straight across; the end is a zero pad
+        memcpy(d, lead.sampleData[c], kept);
+        memset((char *)d + kept, 0, bytes - kept);
+    }
+    swapSampleGroupData(group, preload, frames);
+}
+
+bool SampleManager::reloadEvictedSample(const Sample *which)
+{
+    assert(threadingChecker.isSerialThread());
+
+    std::shared_ptr<Sample> target;
+    for (const auto &[id, smp] : samples)
+    {
+        if (smp.get() == which)
+        {
+            target = smp;
+            break;
+        }
+    }
+
+    // Purged since a voice asked, or already on its way back in
+    if (!target || target->dataSwapInFlight || !target->isEvicted())
+        return false;
+
+    // Another instance may well still have it all resident
+    std::shared_ptr<Sample> fresh;
+    if (useSharedSampleStore)
+        fresh = SharedSampleStore::instance().findDonor(contentKeyFor(target->id));
+    if (!fresh || fresh->isEvicted())
+        fresh = readSampleDataFor(*target);
+    if (!fresh)
+    {
+        // Leave reloadRequested set so every note doesn't retry the read
+        SCLOG("Unable to reload evicted sample : " << target->getPath().u8string());
+        return false;
+    }
+
+    auto group = samplesSharingDataWith(*target);
+    swapSampleGroupData(group, fresh->sampleDataOwner, 0);
+    for (auto &s : group)
+        s->reloadRequested = false;
+
+    SCLOG("Reloaded : " << target->getPath().u8string());
+    return true;
+}
+
+std::shared_ptr<const Sample> SampleManager::fullDataFor(const std::shared_ptr<Sample> &s)
+{
+    assert(threadingChecker.isSerialThread());
+
+    // Mid swap the audio thread owns the data pointers, so read a copy for those too
+    if (!s->dataSwapInFlight && !s->isEvicted())
+        return s;
+
+    std::shared_ptr<Sample> fresh;
+    if (useSharedSampleStore)
+        fresh = SharedSampleStore::instance().findDonor(contentKeyFor(s->id));
+    if (!fresh || fresh->isEvicted() || fresh->dataSwapInFlight)
+        fresh = canReload(*s) ? readSampleDataFor(*s) : nullptr;
+    return fresh;
+}
+
+bool SampleManager::buildMipmapFor(const Sample *which)
+{
+    assert(threadingChecker.isSerialThread());
+
+    std::shared_ptr<Sample> target;
+    for (const auto &[id, smp] : samples)
+    {
+        if (smp.get() == which)
+        {
+            target = smp;
+            break;
+        }
+    }
+
+    if (!target || target->getMipmap())
+        return false;
+
+    // Mid swap the data can't be read; a later voice will ask again
+    if (target->dataSwapInFlight)
+    {
+        target->mipmapRequested = false;
+        return false;
+    }
+
+    // An evicted sample plays its preload at level 0 so let a later voice ask again
+    auto mm = SampleMipmap::build(*target);
+    if (!mm)
+    {
+        target->mipmapRequested = false;
+        return false;
     }
-    sampleMemoryInBytes = res;
+
+    for (auto &s : samplesSharingDataWith(*target))
+        s->setMipmap(mm);
+    updateSampleMemory();
+
+    SCLOG("Built " << mm->highestLevel() << " level mipmap ("
+                   << mm->sizeInBytes() / 1024 << "kb) : " << target->getPath().u8string());
+    return true;
+}
+
+bool SampleManager::buildRenditionFor(const Sample *which)
+{
+    assert(threadingChecker.isSerialThread());
+
+    std::shared_ptr<Sample> target;
+    for (const auto &[id, smp] : samples)
+    {
+        if (smp.get() == which)
+        {
+            target = smp;
+            break;
+        }
+    }
+
+    if (!target || !updateRendition(target))
+        return false;
+    updateSampleMemory();
+    return target->getRendition() != nullptr;
+}
+
+bool SampleManager::updateRendition(const std::shared_ptr<Sample> &target)
+{
+    auto rate = engineSampleRate.load();
+    auto current = target->getRendition();
+    if (!renderAtEngineRate || rate <= 0 || (current && current->sampleRate == rate))
+        return false;
+
+    // Mid swap the data can't be read; a later voice will ask again
+    if (target->dataSwapInFlight)
+    {
+        target->renditionRequested = false;
+        return false;
+    }
+
+    auto r = EngineRateRendition::build(*target, rate);
+    auto group = samplesSharingDataWith(*target);
+    if (current)
+    {
+        // Voices started at the old rate may still be reading it
+        RetiredData old;
+        old.users = group;
+        old.data[0] = std::shared_ptr<void>(target->getRenditionOwner(), nullptr);
+        retiredData.push_back(std::move(old));
+    }
+    for (auto &s : group)
+        s->setRendition(r);
+    return true;
+}
+
+void SampleManager::swapSampleGroupData(const sampleGroup_t &group,
+                                        const std::shared_ptr<void> (&data)[2],
+                                        uint32_t evictedToFrames)
+{
+    const auto *lead = group.front().get();
+
+    // Any voice which started on the old data keeps it alive until it stops
+    RetiredData old;
+    old.users = group;
+    old.data[0] = lead->sampleDataOwner[0];
+    old.data[1] = lead->sampleDataOwner[1];
+    retiredData.push_back(std::move(old));
+
+    auto swap = [group, d0 = data[0], d1 = data[1], evictedToFrames]() {
+        for (const auto &s : group)
+        {
+            s->sampleDataOwner[0] = d0;
+            s->sampleDataOwner[1] = d1;
+            s->sampleData[0] = d0.get();
+            s->sampleData[1] = d1.get();
+            s->evictedToFrames = evictedToFrames;
+        }
+    };
+
+    if (runOnAudioThread)
+    {
+        // Until the completion runs only the audio thread touches this group's data
+        for (const auto &s : group)
+            s->dataSwapInFlight = true;
+        runOnAudioThread(swap, [this, group]() {
+            for (const auto &s : group)
+                s->dataSwapInFlight = false;
+            updateSampleMemory();
+        });
+    }
+    else
+    {
+        swap();
+        releaseRetiredData();
+    }
+}
+
+void SampleManager::releaseRetiredData()
+{
+    auto idle = [](const RetiredData &r) {
+        for (const auto &s : r.users)
+            if (s->playingVoices > 0 || s->dataSwapInFlight)
+                return false;
+        return true;
+    };
+    retiredData.erase(std::remove_if(retiredData.begin(), retiredData.end(), idle),
+                      retiredData.end());
 }
 
 SampleManager::sampleAddressesAndIds_t
@@ -325,7 +1175,7 @@ void SampleManager::addSampleAsMissing(const SampleID &id, const Sample::SampleF
         SCLOG("Missing : " << f.path.u8string());
         SCLOG("        : " << ms->id.to_string());
 
-        samples[ms->id] = ms;
+        addSample(ms);
 
         if (ms->id != id)
         {
@@ -34,13 +34,23 @@
 #include "infrastructure/filesystem_import.h"
 
 #include <filesystem>
+#include <functional>
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
 #include <vector>
 #include <utility>
 #include "SF.h"
 #include <miniz.h>
 
+#include "infrastructure/content_hash.h"
+
+namespace scxt::browser
+{
+struct BrowserDB;
+}
+
 namespace scxt::sample
 {
 struct ZipArchiveHolder : scxt::MoveableOnly<ZipArchiveHolder>
@@ -81,11 +91,29 @@ struct SampleManager : MoveableOnly<SampleManager>
     std::optional<SampleID> loadSampleByFileAddressToID(const Sample::SampleFileAddress &,
                                                         const SampleID &);
 
-    std::optional<SampleID> loadSampleByPath(const fs::path &);
+    /*
+     * The optional hash kinds are the kind of content hash the caller expects the sample
+     * to be identified by (a patch being restored names the kind it was saved with).
+     * Without one we use contentHashKind.
+     */
+    std::optional<SampleID>
+    loadSampleByPath(const fs::path &,
+                     std::optional<infrastructure::ContentHashKind> = std::nullopt);
+    /*
+     * Load a batch of sample files at once, reading them all from disk in parallel
+     * through the BulkFileReader before parsing. Results line up with the input paths.
+     * Paths which are already loaded just return their existing ID. kinds is either
+     * empty or lines up with paths.
+     */
+    std::vector<std::optional<SampleID>>
+    loadSamplesByPath(const std::vector<fs::path> &,
+                      const std::vector<infrastructure::ContentHashKind> &kinds = {});
 
-    std::optional<SampleID> loadSampleFromSF2(const fs::path &,
-                                              sf2::File *f, // if this is null I will re-open it
-                                              int preset, int instrument, int region);
+    std::optional<SampleID>
+    loadSampleFromSF2(const fs::path &,
+                      sf2::File *f, // if this is null I will re-open it
+                      int preset, int instrument, int region,
+                      std::optional<infrastructure::ContentHashKind> = std::nullopt);
     int findSF2SampleIndexFor(sf2::File *, int preset, int instrument, int region);
 
     std::optional<SampleID> setupSampleFromMultifile(const fs::path &, const std::string &md5,
@@ -102,7 +130,9 @@ struct SampleManager : MoveableOnly<SampleManager>
         auto alias = idAliases.find(id);
         if (alias != idAliases.end())
         {
-            return getSample(alias->second);
+            p = samples.find(alias->second);
+            if (p != samples.end())
+                return p->second;
         }
         return {};
     }
@@ -122,23 +152,114 @@ struct SampleManager : MoveableOnly<SampleManager>
 
     void restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds_t &);
 
+    /*
+     * Samples carried inside a monolith patch, already playing out of its mapping. They
+     * are handed over before the patch unstreams; restoreFromSampleAddressesAndIDs takes
+     * the ones it is asked for instead of loading them from disk and forgets the rest.
+     */
+    void provideEmbeddedSamples(const std::vector<std::shared_ptr<Sample>> &);
+
     void purgeUnreferencedSamples();
 
     void reset()
     {
+        // Swaps still in flight hold their samples, and their completions release what is
+        // left of retiredData once no voice can reach it
         samples.clear();
+        embeddedSamples.clear();
+        zipArchives.clear();
+        idsByPath.clear();
+        sf2IdsByPathAndRegion.clear();
+        idAliases.clear();
+        aliasSources.clear();
+        contentIndex.clear();
         sf2FilesByPath.clear();
+        sf2MappingsByPath.clear();
         streamingVersion = 0x2112'01'01;
         updateSampleMemory();
     }
 
+    /*
+     * reset forgets samples provided with provideEmbeddedSamples too, so unstreaming takes
+     * them across the reset with this.
+     */
+    std::vector<std::shared_ptr<Sample>> takeEmbeddedSamples();
+
     uint64_t streamingVersion{0x2112'01'01}; // see comment in patch.h
 
+    /*
+     * When we have an identity cache (the engine points this at its BrowserDB) content
+     * hashes of unchanged files come from there rather than rehashing the file. New
+     * content is hashed with contentHashKind. Cache rows are per kind, so a lookup for an
+     * id of one kind never returns the hash of another.
+     */
+    void setIdentityCache(browser::BrowserDB *db) { identityCache = db; }
+    infrastructure::ContentHashKind contentHashKind{infrastructure::ContentHashKind::MD5};
+    std::string contentHashForFile(const fs::path &);
+    std::string contentHashForFile(const fs::path &, infrastructure::ContentHashKind);
+
+    /*
+     * When set, sample data is shared with every other SampleManager in the process which
+     * has it set too, through the SharedSampleStore. sampleMemoryInBytes still reports
+     * everything this manager's samples hold.
+     */
+    bool useSharedSampleStore{false};
+
     std::atomic<uint64_t> sampleMemoryInBytes{0};
 
-    void addIdAlias(const SampleID &from, const SampleID &to) { idAliases[from] = to; }
+    /*
+     * Sample memory budget. With a non zero budget, whenever sample memory goes over it
+     * the samples which aren't sounding are evicted, unreferenced ones first and then least
+     * recently played, until it fits. An evicted sample keeps its metadata and the first
+     * preloadMilliseconds of data; the first voice to play it again plays that and asks
+     * (via the serial thread) for reloadEvictedSample.
+     */
+    void setMemoryBudget(uint64_t bytes);
+    uint64_t getMemoryBudget() const { return memoryBudget; }
+    uint32_t preloadMilliseconds{500};
+    void enforceMemoryBudget();
+    bool reloadEvictedSample(const Sample *);
+
+    /*
+     * All of a sample's data, for writing it somewhere (a monolith, say) whatever the budget
+     * has done with it: the sample itself if its data is all in memory, otherwise a fresh
+     * copy nothing else holds, which goes when the caller drops it. Only its data and format
+     * are meant to be read; empty if the file can't be read any more.
+     */
+    std::shared_ptr<const Sample> fullDataFor(const std::shared_ptr<Sample> &);
+
+    /*
+     * Build the half rate mipmap (see SampleMipmap) for a sample a voice asked for one
+     * for, and hand it to every sample sharing that data. Mipmap memory counts towards
+     * sampleMemoryInBytes.
+     */
+    bool buildMipmapFor(const Sample *);
 
-    SampleID resolveAlias(const SampleID &a)
+    /*
+     * With renderAtEngineRate on, every sample not already at engineSampleRate gets an
+     * EngineRateRendition as it is added (if the rate is known by then) and voices ask
+     * for one through buildRenditionFor when the rate has moved since. The engine keeps
+     * engineSampleRate current; a replaced rendition is retired like swapped out data.
+     */
+    bool renderAtEngineRate{false};
+    std::atomic<double> engineSampleRate{0};
+    bool buildRenditionFor(const Sample *);
+
+    /*
+     * Voices pick data pointers up on the audio thread, so swapping data in or out of a
+     * sample has to happen there. The engine points this at its message controller (the
+     * second function runs back on the serial thread afterwards); if unset the swap just
+     * happens in place.
+     */
+    std::function<void(std::function<void()>, std::function<void()>)> runOnAudioThread{nullptr};
+
+    /*
+     * Aliases are kept flattened, so idAliases always maps straight to the end of the
+     * chain and resolving is a single lookup however many times a sample was re-pointed.
+     */
+    void addIdAlias(const SampleID &from, const SampleID &to);
+
+    SampleID resolveAlias(const SampleID &a) const
     {
         auto ap = idAliases.find(a);
         if (ap == idAliases.end())
@@ -146,7 +267,7 @@ struct SampleManager : MoveableOnly<SampleManager>
             return a;
         }
         assert(ap->second != a);
-        return resolveAlias(ap->second);
+        return ap->second;
     }
 
     using sampleMap_t = std::unordered_map<SampleID, std::shared_ptr<Sample>>;
@@ -156,15 +277,75 @@ struct SampleManager : MoveableOnly<SampleManager>
     sampleMap_t::const_iterator samplesEnd() const { return samples.cend(); }
 
   private:
+    browser::BrowserDB *identityCache{nullptr};
+    // empty if unknown
+    std::string cachedContentHashFor(const fs::path &, infrastructure::ContentHashKind) const;
+    void rememberContentHash(const fs::path &, infrastructure::ContentHashKind,
+                             const std::string &);
+
     void updateSampleMemory();
+    uint64_t computeSampleMemory() const;
+
+    uint64_t memoryBudget{0};
+    size_t preloadFramesFor(const Sample &) const;
+    bool canReload(const Sample &) const;
+    std::shared_ptr<Sample> readSampleDataFor(const Sample &);
+    using sampleGroup_t = std::vector<std::shared_ptr<Sample>>;
+    sampleGroup_t samplesSharingDataWith(const Sample &) const;
+    void evictSampleGroup(const sampleGroup_t &);
+    void swapSampleGroupData(const sampleGroup_t &, const std::shared_ptr<void> (&data)[2],
+                             uint32_t evictedToFrames);
+
+    // Data swapped out of samples is held until the swap has run and no voice which could
+    // have started on it is still playing
+    struct RetiredData
+    {
+        sampleGroup_t users;
+        std::shared_ptr<void> data[2];
+    };
+    std::vector<RetiredData> retiredData;
+    void releaseRetiredData();
     std::unordered_map<SampleID, SampleID> idAliases;
+    // the inverse of idAliases, so re-pointing the end of a chain can update its sources
+    std::unordered_map<SampleID, std::unordered_set<SampleID>> aliasSources;
 
     sampleMap_t samples;
+    sampleMap_t embeddedSamples;
+
+    /*
+     * Lookups from how a sample was loaded to its id, so a repeat load is a hash hit
+     * rather than a scan of every sample. Everything which adds to samples goes through
+     * addSample to keep these in step; purge and reset take entries out.
+     */
+    std::unordered_map<std::string, SampleID> idsByPath;
+    std::unordered_map<std::string, std::unordered_map<int, SampleID>> sf2IdsByPathAndRegion;
+    void addSample(const std::shared_ptr<Sample> &);
+    // (Re)build the rendition for the current engine rate; false if there was nothing to do
+    bool updateRendition(const std::shared_ptr<Sample> &);
+    void removeFromLoadIndices(const Sample &);
+
+    /*
+     * The content index maps a sample's content (its id without the path hash) to a
+     * live sample holding that content, so a load of the same content from another
+     * path shares that sample's data rather than loading it again.
+     */
+    static SampleID contentKeyFor(const SampleID &);
+    std::shared_ptr<Sample> findContentDonor(const SampleID &) const;
+    std::shared_ptr<Sample> loadAsContentAlias(const fs::path &,
+                                               const std::string &contentHash) const;
+    void addToContentIndex(const std::shared_ptr<Sample> &);
+    void rebuildContentIndex();
+    std::unordered_map<SampleID, std::weak_ptr<Sample>> contentIndex;
 
     std::unordered_map<std::string, std::tuple<std::unique_ptr<RIFF::File>,
                                                std::unique_ptr<sf2::File>>>
         sf2FilesByPath; // last is the md5sum
-    std::unordered_map<std::string, std::string> sf2MD5ByPath;
+    // keyed by path and then hash kind
+    std::unordered_map<std::string, std::map<infrastructure::ContentHashKind, std::string>>
+        sf2MD5ByPath;
+    // One mapping per soundfont, shared by every region playing out of it
+    std::unordered_map<std::string, std::shared_ptr<SF2SampleMapping>> sf2MappingsByPath;
+    std::shared_ptr<SF2SampleMapping> sf2MappingFor(const fs::path &);
 
     std::unordered_map<std::string, std::unique_ptr<ZipArchiveHolder>> zipArchives;
 };
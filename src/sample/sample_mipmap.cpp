@@ -0,0 +1,203 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "sample_mipmap.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "sample.h"
+#include "dsp/resampling.h"
+#include "dsp/sample_conversion.h"
+#include "infrastructure/resident_memory.h"
+
+namespace scxt::sample
+{
+namespace
+{
+/*
+ * A Blackman windowed half band lowpass. Every other tap but the centre is zero, so
+ * only the odd ones are kept: taps[i] is the weight of x[n - (2i + 1)] and x[n + 2i + 1].
+ */
+static constexpr int halfBandOddTaps{16};
+const std::array<float, halfBandOddTaps> &halfBandTaps()
+{
+    static const auto taps = []() {
+        std::array<double, halfBandOddTaps> w{};
+        double sum{0.5};
+        auto span = 2.0 * halfBandOddTaps;
+        for (int i = 0; i < halfBandOddTaps; ++i)
+        {
+            auto k = 2.0 * i + 1;
+            auto sinc = std::sin(M_PI * k / 2) / (M_PI * k);
+            auto win =
+                0.42 + 0.5 * std::cos(M_PI * k / span) + 0.08 * std::cos(2 * M_PI * k / span);
+            w[i] = sinc * win;
+            sum += 2 * w[i];
+        }
+        std::array<float, halfBandOddTaps> res{};
+        for (int i = 0; i < halfBandOddTaps; ++i)
+            res[i] = (float)(w[i] / sum);
+        return res;
+    }();
+    return taps;
+}
+
+std::vector<float> halve(const std::vector<float> &x)
+{
+    const auto &taps = halfBandTaps();
+    auto n = (int64_t)x.size();
+    std::vector<float> res((x.size() + 1) / 2);
+    auto at = [&](int64_t i) { return (i < 0 || i >= n) ? 0.f : x[i]; };
+    for (int64_t m = 0; m < (int64_t)res.size(); ++m)
+    {
+        auto c = 2 * m;
+        float v = 0.5f * x[c];
+        if (c >= 2 * halfBandOddTaps && c + 2 * halfBandOddTaps < n)
+        {
+            for (int i = 0; i < halfBandOddTaps; ++i)
+                v += taps[i] * (x[c - 2 * i - 1] + x[c + 2 * i + 1]);
+        }
+        else
+        {
+            for (int i = 0; i < halfBandOddTaps; ++i)
+                v += taps[i] * (at(c - 2 * i - 1) + at(c + 2 * i + 1));
+        }
+        res[m] = v;
+    }
+    return res;
+}
+
+template <typename T>
+bool buildLevels(SampleMipmap &res, const T *const data[2], uint32_t length, int upToLevel)
+{
+    std::vector<float> prior[2];
+    for (int c = 0; c < res.channels; ++c)
+    {
+        prior[c].resize(length);
+        for (uint32_t i = 0; i < length; ++i)
+            prior[c][i] = dsp::sample_conversion::toNativeFloat(data[c][i]);
+    }
+
+    for (int l = 1; l <= upToLevel; ++l)
+    {
+        // Not worth it once there's barely an FIR window left
+        if (prior[0].size() < 2 * dsp::FIRipol_N)
+            break;
+
+        SampleMipmap::Level level;
+        for (int c = 0; c < res.channels; ++c)
+        {
+            prior[c] = halve(prior[c]);
+            level.length = prior[c].size();
+
+            auto frames = level.length + dsp::FIRipol_N;
+            level.owner[c] =
+                infrastructure::ResidentMemory::instance().allocate(sizeof(T) * frames);
+            if (!level.owner[c])
+                return false;
+            auto *d = (T *)level.owner[c].get();
+            memset((void *)d, 0, dsp::FIRoffset * sizeof(T));
+            memset((void *)(d + dsp::FIRoffset + level.length), 0, dsp::FIRoffset * sizeof(T));
+            d += dsp::FIRoffset;
+            for (uint32_t i = 0; i < level.length; ++i)
+                d[i] = dsp::sample_conversion::fromNativeFloat<T>(prior[c][i]);
+            level.sampleData[c] = d;
+        }
+        res.levels.push_back(std::move(level));
+    }
+    return true;
+}
+} // namespace
+
+size_t SampleMipmap::sizeInBytes() const
+{
+    size_t bps = format == dsp::SF_F32   ? sizeof(float)
+                 : format == dsp::SF_I24 ? sizeof(dsp::PackedInt24)
+                                         : sizeof(int16_t);
+    size_t res{0};
+    for (const auto &l : levels)
+        res += (l.length + dsp::FIRipol_N) * bps * channels;
+    return res;
+}
+
+std::shared_ptr<const SampleMipmap> SampleMipmap::build(Sample &s, int upToLevel)
+{
+    if (s.isEvicted() || s.channels < 1 || s.channels > 2 || s.sample_length == 0)
+        return nullptr;
+
+    auto res = std::make_shared<SampleMipmap>();
+    res->channels = s.channels;
+    upToLevel = std::clamp(upToLevel, 0, maxLevel);
+
+    bool ok{false};
+    switch (s.bitDepth)
+    {
+    case Sample::BD_F32:
+    {
+        res->format = dsp::SF_F32;
+        const float *d[2]{s.GetSamplePtrF32(0), s.GetSamplePtrF32(1)};
+        ok = buildLevels(*res, d, s.sample_length, upToLevel);
+    }
+    break;
+    case Sample::BD_I24:
+    {
+        res->format = dsp::SF_I24;
+        const dsp::PackedInt24 *d[2]{s.GetSamplePtrI24(0), s.GetSamplePtrI24(1)};
+        ok = buildLevels(*res, d, s.sample_length, upToLevel);
+    }
+    break;
+    case Sample::BD_I16:
+    {
+        res->format = dsp::SF_I16;
+        const int16_t *d[2]{s.GetSamplePtrI16(0), s.GetSamplePtrI16(1)};
+        ok = buildLevels(*res, d, s.sample_length, upToLevel);
+    }
+    break;
+    }
+
+    if (!ok || res->levels.empty())
+        return nullptr;
+    return res;
+}
+
+int SampleMipmap::levelForRatio(int32_t ratio)
+{
+    // Step down while the ratio is more than half an octave above 1
+    static constexpr int32_t halfOctaveUp{(int32_t)(1.41421356 * (1 << 24))};
+    ratio = std::abs(ratio);
+    int res{0};
+    while (res < maxLevel && ratio > halfOctaveUp)
+    {
+        ratio >>= 1;
+        res++;
+    }
+    return res;
+}
+} // namespace scxt::sample
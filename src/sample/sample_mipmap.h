@@ -0,0 +1,83 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_SAMPLE_MIPMAP_H
+#define SCXT_SRC_SAMPLE_SAMPLE_MIPMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "dsp/generator.h"
+
+namespace scxt::sample
+{
+struct Sample;
+
+/*
+ * Band limited half rate copies of a sample, for voices transposed well above the root.
+ * Level 1 is the sample lowpassed below a quarter of its rate and decimated by two, level
+ * 2 the same again from level 1, and so on. A voice playing at a ratio of 5 reads level 2
+ * at 1.25 rather than striding five frames a step through level 0 (the sample itself),
+ * so it touches a quarter of the memory and the sinc isn't asked to alias.
+ *
+ * Each level is in the sample's own format and laid out like Sample data, with FIRoffset
+ * pad frames either side, so the generators play it unchanged. Frame n of level L lines
+ * up with frame n << L of the sample. They are built once for the sample content (the
+ * SampleManager does it when a voice first asks) and are immutable after.
+ */
+struct SampleMipmap
+{
+    static constexpr int maxLevel{3};
+
+    struct Level
+    {
+        uint32_t length{0};
+        void *sampleData[2]{nullptr, nullptr}; // the first frame, as the generator wants
+        std::shared_ptr<void> owner[2];
+    };
+
+    dsp::GeneratorSampleFormat format{dsp::SF_F32};
+    int channels{0};
+    std::vector<Level> levels; // levels[0] is level 1
+
+    int highestLevel() const { return (int)levels.size(); }
+    const Level &level(int l) const { return levels[l - 1]; }
+    size_t sizeInBytes() const;
+
+    static std::shared_ptr<const SampleMipmap> build(Sample &s, int upToLevel = maxLevel);
+
+    /*
+     * The level whose ratio is nearest 1 (in octaves) for a generator ratio in the usual
+     * 1 << 24 fixed point. 0 is the sample itself.
+     */
+    static int levelForRatio(int32_t ratio);
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_SAMPLE_MIPMAP_H
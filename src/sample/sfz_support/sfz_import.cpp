@@ -31,6 +31,7 @@
 #include "messaging/messaging.h"
 #include "engine/engine.h"
 #include <cctype>
+#include <optional>
 
 namespace scxt::sfz_support
 {
@@ -63,6 +64,60 @@ int parseMidiNote(const std::string &s)
     return std::atol(s.c_str());
 }
 
+/*
+ * The file a region plays: its own sample opcode or else its group's, looked up in the
+ * sample directory and then as written. Empty if there is no sample opcode or no such file.
+ */
+std::optional<fs::path> regionSamplePath(const SFZParser::opCodes_t &groupOpcodes,
+                                         const SFZParser::opCodes_t &regionOpcodes,
+                                         const fs::path &sampleDir)
+{
+    std::optional<std::string> sampleFileString;
+    for (const auto *ops : {&groupOpcodes, &regionOpcodes})
+    {
+        for (auto &oc : *ops)
+        {
+            if (oc.name == "sample")
+            {
+                sampleFileString = oc.value;
+            }
+        }
+    }
+    if (!sampleFileString.has_value() || sampleFileString->empty())
+        return std::nullopt;
+
+    // fs always works with / and on windows also works with back. Quotes are
+    // stripped by the parser now
+    std::replace(sampleFileString->begin(), sampleFileString->end(), '\\', '/');
+    auto sampleFile = fs::path{*sampleFileString};
+    auto samplePath = (sampleDir / sampleFile).lexically_normal();
+    if (fs::exists(samplePath))
+        return samplePath;
+    if (fs::exists(sampleFile))
+        return sampleFile;
+
+    SCLOG("Unable to find either '" << samplePath.u8string() << "' or '"
+                                    << sampleFile.u8string() << "'");
+    return std::nullopt;
+}
+
+// The directory a control header's default_path points samples at, if it has one
+std::optional<fs::path> controlSampleDir(const SFZParser::opCodes_t &controlOpcodes,
+                                         const fs::path &rootDir)
+{
+    std::optional<fs::path> res;
+    for (const auto &oc : controlOpcodes)
+    {
+        if (oc.name == "default_path")
+        {
+            auto vv = oc.value;
+            std::replace(vv.begin(), vv.end(), '\\', '/');
+            res = rootDir / vv;
+        }
+    }
+    return res;
+}
+
 bool importSFZ(const fs::path &f, engine::Engine &e)
 {
     assert(e.getMessageController()->threadingChecker.isSerialThread());
@@ -77,6 +132,34 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
 
     auto &part = e.getPatch()->getPart(pt);
 
+    /*
+     * Walk the regions once up front to gather every sample path and read them all in
+     * one bulk batch. The region loop below then just finds them already loaded.
+     */
+    {
+        std::vector<fs::path> bulkPaths;
+        auto bulkSampleDir = sampleDir;
+        SFZParser::opCodes_t groupOpcodes;
+        for (const auto &[r, list] : doc)
+        {
+            if (r.type == SFZParser::Header::control)
+            {
+                if (auto cd = controlSampleDir(list, rootDir))
+                    bulkSampleDir = *cd;
+            }
+            else if (r.type == SFZParser::Header::group)
+            {
+                groupOpcodes = list;
+            }
+            else if (r.type == SFZParser::Header::region)
+            {
+                if (auto sp = regionSamplePath(groupOpcodes, list, bulkSampleDir))
+                    bulkPaths.push_back(*sp);
+            }
+        }
+        e.getSampleManager()->loadSamplesByPath(bulkPaths);
+    }
+
     int groupId = -1;
     int firstGroupWithZonesAdded = -1;
     SFZParser::opCodes_t currentGroupOpcodes;
@@ -115,60 +198,22 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
             }
             auto &group = part->getGroup(groupId);
 
-            // Find the sample
-            std::string sampleFileString = "<-->";
-            for (auto &oc : currentGroupOpcodes)
-            {
-                if (oc.name == "sample")
-                {
-                    sampleFileString = oc.value;
-                }
-            }
-            for (auto &oc : list)
+            auto samplePath = regionSamplePath(currentGroupOpcodes, list, sampleDir);
+            if (!samplePath.has_value())
             {
-                if (oc.name == "sample")
-                {
-                    sampleFileString = oc.value;
-                }
+                return false;
             }
-            // fs always works with / and on windows also works with back. Quotes are
-            // stripped by the parser now
-            std::replace(sampleFileString.begin(), sampleFileString.end(), '\\', '/');
-            auto sampleFile = fs::path{sampleFileString};
-            auto samplePath = (sampleDir / sampleFile).lexically_normal();
 
             SampleID sid;
-            if (fs::exists(samplePath))
-            {
-                auto lsid = e.getSampleManager()->loadSampleByPath(samplePath);
-                if (lsid.has_value())
-                {
-                    sid = *lsid;
-                }
-                else
-                {
-                    SCLOG("Cannot load Sample : " << samplePath.u8string());
-                    break;
-                }
-            }
-            else if (fs::exists(sampleFile))
+            auto lsid = e.getSampleManager()->loadSampleByPath(*samplePath);
+            if (lsid.has_value())
             {
-                auto lsid = e.getSampleManager()->loadSampleByPath(sampleFile);
-                if (lsid.has_value())
-                {
-                    sid = *lsid;
-                }
-                else
-                {
-                    SCLOG("Cannot load Sample : " << sampleFile);
-                    return false;
-                }
+                sid = *lsid;
             }
             else
             {
-                SCLOG("Unable to load either '" << samplePath.u8string() << "' or '"
-                                                << sampleFile.u8string() << "'");
-                return false;
+                SCLOG("Cannot load Sample : " << samplePath->u8string());
+                break;
             }
 
             // OK so do we have a sequence position > 1
@@ -348,17 +393,14 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
         break;
         case SFZParser::Header::control:
         {
+            if (auto cd = controlSampleDir(list, rootDir))
+            {
+                sampleDir = *cd;
+                SCLOG("Control: Resetting sample dir to " << sampleDir);
+            }
             for (const auto &oc : list)
             {
-                if (oc.name == "default_path")
-                {
-                    auto vv = oc.value;
-                    std::replace(vv.begin(), vv.end(), '\\', '/');
-                    sampleDir = rootDir / vv;
-                    SCLOG("Control: Resetting sample dir to " << sampleDir);
-                    ;
-                }
-                else
+                if (oc.name != "default_path")
                 {
                     SCLOG("    Skipped OpCode <control>: " << oc.name << " -> " << oc.value);
                 }
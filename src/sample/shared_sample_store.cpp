@@ -0,0 +1,135 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "shared_sample_store.h"
+#include "sample.h"
+
+namespace scxt::sample
+{
+namespace
+{
+void copyIdentity(Sample &to, const Sample &from)
+{
+    to.type = from.type;
+    to.preset = from.preset;
+    to.instrument = from.instrument;
+    to.region = from.region;
+    to.md5Sum = from.md5Sum;
+    to.contentHashKind = from.contentHashKind;
+    to.mFileName = from.mFileName;
+    to.id = from.id;
+}
+} // namespace
+
+SharedSampleStore &SharedSampleStore::instance()
+{
+    static SharedSampleStore store;
+    return store;
+}
+
+void SharedSampleStore::publish(const SampleID &contentKey, const Sample &s)
+{
+    if (s.isMissingPlaceholder || s.isEvicted() || !s.sampleData[0])
+        return;
+
+    std::lock_guard<std::mutex> g(mutex);
+
+    // Dead entries only go away when something looks at them, so sweep every so often
+    if (++publishesSinceSweep > entries.size())
+        sweepLocked();
+
+    auto &e = entries[contentKey];
+    if (!e.data[0].expired())
+        return;
+
+    e.shape = std::make_shared<Sample>();
+    e.shape->shareDataFrom(s);
+    copyIdentity(*e.shape, s);
+    for (int c = 0; c < 2; ++c)
+    {
+        e.data[c] = s.sampleDataOwner[c];
+        e.shape->sampleDataOwner[c].reset();
+        e.shape->sampleData[c] = nullptr;
+    }
+}
+
+std::shared_ptr<Sample> SharedSampleStore::findDonor(const SampleID &contentKey)
+{
+    std::lock_guard<std::mutex> g(mutex);
+
+    auto it = entries.find(contentKey);
+    if (it == entries.end())
+        return {};
+
+    const auto &e = it->second;
+    std::shared_ptr<void> data[2]{e.data[0].lock(), e.data[1].lock()};
+    if (!data[0] || (e.shape->channels == 2 && !data[1]))
+    {
+        entries.erase(it);
+        return {};
+    }
+
+    auto res = std::make_shared<Sample>();
+    res->shareDataFrom(*e.shape);
+    copyIdentity(*res, *e.shape);
+    for (int c = 0; c < 2; ++c)
+    {
+        res->sampleDataOwner[c] = data[c];
+        res->sampleData[c] = data[c].get();
+    }
+    return res;
+}
+
+size_t SharedSampleStore::liveEntryCount()
+{
+    std::lock_guard<std::mutex> g(mutex);
+    sweepLocked();
+    return entries.size();
+}
+
+uint64_t SharedSampleStore::liveDataBytes()
+{
+    std::lock_guard<std::mutex> g(mutex);
+    sweepLocked();
+    uint64_t res{0};
+    for (const auto &[k, e] : entries)
+        res += e.shape->channelDataSizeInBytes() * std::min((int)e.shape->channels, 2);
+    return res;
+}
+
+void SharedSampleStore::sweepLocked()
+{
+    publishesSinceSweep = 0;
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.data[0].expired())
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+}
+} // namespace scxt::sample
@@ -0,0 +1,85 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_SHARED_SAMPLE_STORE_H
+#define SCXT_SRC_SAMPLE_SHARED_SAMPLE_STORE_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "utils.h"
+
+namespace scxt::sample
+{
+struct Sample;
+
+/*
+ * The SharedSampleStore lets every SampleManager in the process (one per plugin instance)
+ * share sample data, so thirty instances of the same kit hold its PCM once. It is keyed
+ * by content id (a SampleID with no path hash, see SampleManager::contentKeyFor).
+ *
+ * The store never owns data. It holds weak references to the buffers plus a data-less
+ * copy of the publishing sample's metadata, so buffers live exactly as long as some
+ * instance's sample uses them. Each instance still builds its own Sample (its own path,
+ * id, eviction state and so on) around the shared buffers, which nobody writes to.
+ *
+ * It is optional; engines only share through it with the shareSamplesAcrossInstances
+ * user default, which is off.
+ *
+ * All methods are thread safe.
+ */
+struct SharedSampleStore : MoveableOnly<SharedSampleStore>
+{
+    static SharedSampleStore &instance();
+
+    // Offer a loaded sample's data to the other instances. A live entry for the same
+    // content is left alone.
+    void publish(const SampleID &contentKey, const Sample &s);
+
+    // A sample holding the shared data for this content, to make an alias of, or null
+    std::shared_ptr<Sample> findDonor(const SampleID &contentKey);
+
+    size_t liveEntryCount();
+    uint64_t liveDataBytes();
+
+  private:
+    SharedSampleStore() = default;
+
+    struct Entry
+    {
+        std::weak_ptr<void> data[2];
+        std::shared_ptr<Sample> shape;
+    };
+    std::mutex mutex;
+    std::unordered_map<SampleID, Entry> entries;
+    size_t publishesSinceSweep{0};
+    void sweepLocked();
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_SHARED_SAMPLE_STORE_H
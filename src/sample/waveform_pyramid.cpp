@@ -0,0 +1,181 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "waveform_pyramid.h"
+#include <algorithm>
+#include <limits>
+
+#include "sample.h"
+
+namespace scxt::sample
+{
+namespace
+{
+template <typename D> struct Reader
+{
+    static constexpr bool isI24 = std::is_same_v<D, dsp::PackedInt24>;
+    const D *data;
+
+    // The UI has always normalised integer formats by their positive full scale
+    float at(size_t i) const
+    {
+        if constexpr (isI24)
+            return data[i].toInt32() * (1.f / 8388607.f);
+        else if constexpr (std::is_same_v<D, int16_t>)
+            return data[i] * (1.f / std::numeric_limits<int16_t>::max());
+        else
+            return data[i];
+    }
+
+    void scan(size_t start, size_t end, WaveformPyramid::MinMax &mm) const
+    {
+        for (auto i = start; i < end; ++i)
+        {
+            auto v = at(i);
+            mm.min = std::min(mm.min, v);
+            mm.max = std::max(mm.max, v);
+        }
+    }
+};
+
+template <typename F> auto withReader(Sample &s, int ch, F &&f)
+{
+    switch (s.bitDepth)
+    {
+    case Sample::BD_I16:
+        return f(Reader<int16_t>{s.GetSamplePtrI16(ch)});
+    case Sample::BD_I24:
+        return f(Reader<dsp::PackedInt24>{s.GetSamplePtrI24(ch)});
+    case Sample::BD_F32:
+    default:
+        return f(Reader<float>{s.GetSamplePtrF32(ch)});
+    }
+}
+
+WaveformPyramid::MinMax emptyMinMax()
+{
+    return {std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+}
+
+void merge(WaveformPyramid::MinMax &into, const WaveformPyramid::MinMax &from)
+{
+    into.min = std::min(into.min, from.min);
+    into.max = std::max(into.max, from.max);
+}
+} // namespace
+
+std::shared_ptr<const WaveformPyramid> WaveformPyramid::build(Sample &s)
+{
+    auto res = std::make_shared<WaveformPyramid>();
+    res->sampleLength = s.getSampleLength();
+    res->channels = std::min((int)s.channels, 2);
+
+    for (int ch = 0; ch < res->channels; ++ch)
+    {
+        if (!s.sampleData[ch])
+            break;
+
+        auto &levels = res->levels[ch];
+        auto nBlocks = (res->sampleLength + baseBlockSize - 1) / baseBlockSize;
+        if (nBlocks == 0)
+            continue;
+
+        levels.emplace_back(nBlocks);
+        withReader(s, ch, [&levels, len = (size_t)s.playableLength()](auto r) {
+            auto &base = levels[0];
+            for (size_t b = 0; b < base.size(); ++b)
+            {
+                // Blocks past the resident part of an evicted sample read as silence
+                auto mm = emptyMinMax();
+                r.scan(b * baseBlockSize, std::min((b + 1) * baseBlockSize, len), mm);
+                base[b] = b * baseBlockSize < len ? mm : MinMax{};
+            }
+        });
+
+        while (levels.back().size() > 1)
+        {
+            const auto &below = levels.back();
+            std::vector<MinMax> above((below.size() + 1) / 2);
+            for (size_t i = 0; i < above.size(); ++i)
+            {
+                above[i] = below[2 * i];
+                if (2 * i + 1 < below.size())
+                    merge(above[i], below[2 * i + 1]);
+            }
+            levels.push_back(std::move(above));
+        }
+    }
+    return res;
+}
+
+WaveformPyramid::MinMax WaveformPyramid::minMaxBetween(Sample &s, int ch, size_t start,
+                                                       size_t end) const
+{
+    end = std::min(end, sampleLength);
+    if (ch < 0 || ch >= channels || levels[ch].empty() || start >= end)
+        return {};
+
+    const auto &lv = levels[ch];
+    auto resident = (size_t)s.playableLength();
+    return withReader(s, ch, [&lv, resident, start, end](auto r) {
+        auto mm = emptyMinMax();
+
+        // Ragged ends are read from the sample, unless an evicted sample doesn't have
+        // them resident, in which case the whole base blocks they sit in stand in
+        auto part = [&](size_t from, size_t to) {
+            if (from >= to)
+                return;
+            if (to <= resident)
+                r.scan(from, to, mm);
+            else
+                for (auto b = from >> baseBlockShift; b <= (to - 1) >> baseBlockShift; ++b)
+                    merge(mm, lv[0][b]);
+        };
+
+        // Whole base blocks come from the pyramid
+        auto b0 = (start + baseBlockSize - 1) >> baseBlockShift;
+        auto b1 = end >> baseBlockShift;
+        if (b0 >= b1)
+        {
+            part(start, end);
+            return mm;
+        }
+
+        part(start, b0 << baseBlockShift);
+        part(b1 << baseBlockShift, end);
+
+        for (size_t l = 0; b0 < b1 && l < lv.size(); ++l, b0 >>= 1, b1 >>= 1)
+        {
+            if (b0 & 1)
+                merge(mm, lv[l][b0++]);
+            if (b1 & 1)
+                merge(mm, lv[l][--b1]);
+        }
+        return mm;
+    });
+}
+} // namespace scxt::sample
@@ -0,0 +1,73 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_WAVEFORM_PYRAMID_H
+#define SCXT_SRC_SAMPLE_WAVEFORM_PYRAMID_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace scxt::sample
+{
+struct Sample;
+
+/*
+ * A min/max pyramid over each channel of a sample, for drawing waveforms at any zoom
+ * without rescanning the sample. Level 0 summarises blocks of baseBlockSize samples and
+ * each level above pairs up the blocks of the one below, so any span can be answered
+ * from O(log n) blocks plus at most two partial base blocks read from the sample itself.
+ *
+ * Values are in the same [-1,1] scale the UI draws (integer formats divided by their
+ * positive full scale). The pyramid is built once per sample data (the SampleManager
+ * does it at load) and costs about a quarter of a byte per sample frame per channel.
+ */
+struct WaveformPyramid
+{
+    static constexpr size_t baseBlockShift{6};
+    static constexpr size_t baseBlockSize{1 << baseBlockShift};
+
+    struct MinMax
+    {
+        float min{0.f}, max{0.f};
+    };
+
+    size_t sampleLength{0};
+    int channels{0};
+    std::vector<std::vector<MinMax>> levels[2];
+
+    static std::shared_ptr<const WaveformPyramid> build(Sample &s);
+
+    /*
+     * The min and max of channel ch over samples [start, end). The sample must be the
+     * one (or share data with the one) the pyramid was built from.
+     */
+    MinMax minMaxBetween(Sample &s, int ch, size_t start, size_t end) const;
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_WAVEFORM_PYRAMID_H
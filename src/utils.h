@@ -36,6 +36,9 @@
 #include <filesystem>
 #include <thread>
 #include <array>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 #include <iostream>
 #include <map>
@@ -92,14 +95,20 @@ template <> inline const std::string ZoneID::display_name() const { return "Zone
 typedef ID<7> EngineID;
 template <> inline const std::string EngineID::display_name() const { return "Engine"; }
 
+/*
+ * Identifies a sample by its content hash, the path it was loaded from and (for multi
+ * sample files) where in the file. The content hash is held as its 16 byte binary
+ * digest; the 32 character hex form is only rebuilt for display and streaming, in the
+ * case it arrived in (all lower or all upper). Ids which aren't a hex digest (legacy and
+ * invalid ones, or mixed case hex) keep up to 32 characters of text instead. Every setter
+ * refreshes a cached hash so map lookups and comparisons never touch strings.
+ */
 struct SampleID
 {
     static constexpr size_t md5len{32};
-    char md5[md5len + 1]{};
-
+    static constexpr size_t digestLen{md5len / 2};
     static constexpr int unusedAddress{-1};
-    size_t pathHash{0};
-    std::array<int, 3> multiAddress{unusedAddress, unusedAddress, unusedAddress};
+    using multiAddress_t = std::array<int32_t, 3>;
 
     SampleID() { setAsInvalid(); }
 
@@ -107,48 +116,159 @@ struct SampleID
     {
         std::string hd{"SampleID"};
         if (multiAddress[0] == unusedAddress)
-            return fmt::format("{}:{}-{:016x}", hd, std::string(md5), pathHash);
+            return fmt::format("{}:{}-{:016x}", hd, getMD5(), pathHash);
         else
-            return fmt::format("{}:{}-{:016x}@{}/{}/{}", hd, std::string(md5), pathHash,
+            return fmt::format("{}:{}-{:016x}@{}/{}/{}", hd, getMD5(), pathHash,
                                multiAddress[0], multiAddress[1], multiAddress[2]);
     }
 
     bool operator==(const SampleID &other) const
     {
-        return strncmp(md5, other.md5, md5len) == 0 && multiAddress[0] == other.multiAddress[0] &&
-               pathHash == other.pathHash && multiAddress[1] == other.multiAddress[1] &&
-               multiAddress[2] == other.multiAddress[2];
+        return hashValue == other.hashValue && pathHash == other.pathHash &&
+               multiAddress == other.multiAddress && sameMD5As(other);
     }
     bool operator!=(const SampleID &other) const { return !(other == *this); }
 
-    bool isValid() const { return md5[0] != 'x' && md5[1] != '\0'; }
+    bool isValid() const
+    {
+        return digestForm != TEXT || (digest[0] != 'x' && digest[1] != '\0');
+    }
+
+    bool sameMD5As(const SampleID &other) const
+    {
+        return digestForm == other.digestForm && digest == other.digest;
+    }
+
+    std::string getMD5() const
+    {
+        if (digestForm == TEXT)
+            return std::string((const char *)digest.data(),
+                               strnlen((const char *)digest.data(), digest.size()));
 
-    bool sameMD5As(const SampleID &other) const { return strncmp(md5, other.md5, md5len) == 0; }
+        const char *hex = digestForm == UPPER_HEX ? "0123456789ABCDEF" : "0123456789abcdef";
+        std::string res(md5len, '0');
+        for (size_t i = 0; i < digestLen; ++i)
+        {
+            res[2 * i] = hex[digest[i] >> 4];
+            res[2 * i + 1] = hex[digest[i] & 0xF];
+        }
+        return res;
+    }
+    size_t getPathHash() const { return pathHash; }
+    const multiAddress_t &getMultiAddress() const { return multiAddress; }
+    size_t hash() const { return hashValue; }
 
     void setAsInvalid()
     {
-        memset(md5, 0, sizeof(md5));
-        std::fill(multiAddress.begin(), multiAddress.end(), unusedAddress);
-        md5[0] = '!';
+        setMD5Digest("!");
+        multiAddress.fill(unusedAddress);
+        rehash();
     }
     void setAsMD5(const std::string &m)
     {
-        strncpy(md5, m.c_str(), md5len + 1);
-        std::fill(multiAddress.begin(), multiAddress.end(), unusedAddress);
+        setMD5Digest(m);
+        multiAddress.fill(unusedAddress);
+        rehash();
     }
     void setAsLegacy(int oldId)
     {
         auto ls = fmt::format("lgcy({})", oldId);
         setAsMD5(ls);
     }
-    void setPathHash(const fs::path &p) { pathHash = std::hash<std::string>()(p.u8string()); }
+    void setPathHash(const fs::path &p) { setPathHash(std::hash<std::string>()(p.u8string())); }
+    void setPathHash(size_t h)
+    {
+        pathHash = h;
+        rehash();
+    }
+    void setMultiAddress(const multiAddress_t &a)
+    {
+        multiAddress = a;
+        rehash();
+    }
 
     void setAsMD5WithAddress(const std::string &m, int a0, int a1, int a2)
     {
-        strncpy(md5, m.c_str(), md5len + 1);
-        multiAddress[0] = a0;
-        multiAddress[1] = a1;
-        multiAddress[2] = a2;
+        setMD5Digest(m);
+        multiAddress = {a0, a1, a2};
+        rehash();
+    }
+
+  private:
+    // Hex digests use the first digestLen bytes; text uses all of them
+    std::array<uint8_t, md5len> digest{};
+    enum DigestForm : uint8_t
+    {
+        LOWER_HEX,
+        UPPER_HEX,
+        TEXT
+    } digestForm{TEXT};
+    size_t pathHash{0};
+    multiAddress_t multiAddress{unusedAddress, unusedAddress, unusedAddress};
+    size_t hashValue{0};
+
+    void setMD5Digest(const std::string &m)
+    {
+        digest.fill(0);
+        bool sawLower{false}, sawUpper{false};
+        auto nib = [&](char c) -> int {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+            {
+                sawLower = true;
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F')
+            {
+                sawUpper = true;
+                return c - 'A' + 10;
+            }
+            return -1;
+        };
+
+        bool isHex = m.size() == md5len;
+        for (size_t i = 0; i < digestLen && isHex; ++i)
+        {
+            auto h = nib(m[2 * i]), l = nib(m[2 * i + 1]);
+            if (h < 0 || l < 0)
+                isHex = false;
+            else
+                digest[i] = (uint8_t)((h << 4) | l);
+        }
+
+        // Mixed case wouldn't stream back out as it came in, so it stays text
+        if (isHex && !(sawLower && sawUpper))
+        {
+            digestForm = sawUpper ? UPPER_HEX : LOWER_HEX;
+        }
+        else
+        {
+            // Nothing we write is longer; anything longer is cut here
+            digestForm = TEXT;
+            digest.fill(0);
+            memcpy(digest.data(), m.data(), std::min(m.size(), digest.size()));
+        }
+    }
+
+    void rehash()
+    {
+        // The digest is already well mixed; fold it with the rest, splitmix style
+        auto mix = [](uint64_t h, uint64_t v) {
+            h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= h >> 31;
+            h *= 0xbf58476d1ce4e5b9ULL;
+            return h ^ (h >> 29);
+        };
+        uint64_t d[4];
+        memcpy(d, digest.data(), sizeof(d));
+        uint64_t h = mix(d[0], d[1] + digestForm);
+        if (digestForm == TEXT)
+            h = mix(h, d[2] ^ (d[3] << 1));
+        h = mix(h, pathHash);
+        h = mix(h, ((uint64_t)(uint32_t)multiAddress[0] << 32) | (uint32_t)multiAddress[1]);
+        h = mix(h, (uint32_t)multiAddress[2]);
+        hashValue = (size_t)h;
     }
 };
 
@@ -354,18 +474,6 @@ template <int idType> struct std::hash<scxt::ID<idType>>
 
 template <> struct std::hash<scxt::SampleID>
 {
-    size_t operator()(const scxt::SampleID &v) const
-    {
-        auto mh = std::hash<std::string>()(v.md5);
-        mh ^= 0x9e3779b9 + (v.pathHash << 6) + (v.pathHash >> 2);
-        for (int i = 0; i < 3; ++i)
-        {
-            if (v.multiAddress[i] >= 0)
-            {
-                mh = mh + ((v.multiAddress[i] + 1) << (i * 8));
-            }
-        }
-        return mh;
-    }
+    size_t operator()(const scxt::SampleID &v) const { return v.hash(); }
 };
 #endif
@@ -35,6 +35,8 @@
 #include "sst/basic-blocks/dsp/PanLaws.h"
 #include "engine/engine.h"
 #include "dsp/processor/routing.h"
+#include "messaging/messaging.h"
+#include "sample/sample_mipmap.h"
 
 namespace scxt::voice
 {
@@ -65,6 +67,11 @@ Voice::~Voice()
 
 void Voice::cleanupVoice()
 {
+    if (playingSample)
+    {
+        playingSample->markVoiceEnded();
+        playingSample = nullptr;
+    }
     zone->removeVoice(this);
     zone = nullptr;
     isVoiceAssigned = false;
@@ -256,6 +263,7 @@ template <bool OS> bool Voice::processWithOS()
     calculateGeneratorRatio(fpitch);
     if (useOversampling)
         GD.ratio = GD.ratio >> 1;
+    GD.ratio = GD.ratio >> mipLevel;
     fpitch -= 69;
 
     // TODO : Start and End Points
@@ -265,7 +273,7 @@ template <bool OS> bool Voice::processWithOS()
         assert(s);
 
         GD.sampleStart = 0;
-        GD.sampleStop = s->sample_length;
+        GD.sampleStop = GDIO.waveSize;
 
         GD.gated = isGated;
         GD.loopInvertedBounds = 1.f / std::max(1, GD.loopUpperBound - GD.loopLowerBound);
@@ -612,6 +620,21 @@ void Voice::initializeGenerator()
         return;
     }
 
+    s->markVoiceStarted();
+    playingSample = s.get();
+
+    // An evicted sample only has its first frames resident. Play those and ask the serial
+    // thread to bring the rest back for the next voice.
+    auto evicted = s->isEvicted();
+    if (evicted && !s->reloadRequested.exchange(true))
+    {
+        messaging::audio::AudioToSerialization req;
+        req.id = messaging::audio::a2s_sample_reload_request;
+        req.payloadType = messaging::audio::AudioToSerialization::VOID_STAR;
+        req.payload.p = s.get();
+        engine->getMessageController()->sendAudioToSerialization(req);
+    }
+
     auto &variantData = zone->variantData.variants[sampleIndex];
 
     GDIO.outputL = output[0];
@@ -621,6 +644,11 @@ void Voice::initializeGenerator()
         GDIO.sampleDataL = s->GetSamplePtrI16(0);
         GDIO.sampleDataR = s->GetSamplePtrI16(1);
     }
+    else if (s->bitDepth == sample::Sample::BD_I24)
+    {
+        GDIO.sampleDataL = s->GetSamplePtrI24(0);
+        GDIO.sampleDataR = s->GetSamplePtrI24(1);
+    }
     else if (s->bitDepth == sample::Sample::BD_F32)
     {
         GDIO.sampleDataL = s->GetSamplePtrF32(0);
@@ -630,7 +658,7 @@ void Voice::initializeGenerator()
     {
         assert(false);
     }
-    GDIO.waveSize = s->sample_length;
+    GDIO.waveSize = s->playableLength();
 
     GD.samplePos = variantData.startSample;
     GD.sampleSubPos = 0;
@@ -642,10 +670,23 @@ void Voice::initializeGenerator()
     GD.direction = 1;
     GD.isFinished = false;
 
-    if (variantData.loopActive)
+    // The loop may well be outside the resident frames so evicted samples play one shot
+    auto loopActive = variantData.loopActive && !evicted;
+    GDIO.loopSplice = nullptr;
+    if (loopActive)
     {
         GD.loopLowerBound = variantData.startLoop;
         GD.loopUpperBound = variantData.endLoop;
+        GDIO.loopSplice = zone->loopSplices[sampleIndex].get();
+    }
+    if (evicted)
+    {
+        auto lastFrame = (int)s->playableLength() - 1;
+        GD.playbackLowerBound = std::min(GD.playbackLowerBound, lastFrame);
+        GD.playbackUpperBound = std::min(GD.playbackUpperBound, lastFrame);
+        GD.samplePos = std::clamp(GD.samplePos, GD.playbackLowerBound, GD.playbackUpperBound);
+        GD.loopLowerBound = GD.playbackLowerBound;
+        GD.loopUpperBound = GD.playbackUpperBound;
     }
 
     if (variantData.playReverse)
@@ -655,24 +696,136 @@ void Voice::initializeGenerator()
     }
     GD.directionAtOutset = GD.direction;
 
+    sourceRateRatio = s->sample_rate * sampleRateInv;
+    renditionRatio = 1.0;
     calculateGeneratorRatio(calculateVoicePitch());
 
     // TODO: This constant came from SC. Wonder why it is this value. There was a comment
     // comparing with 167777216 so any speedup at all.
     useOversampling = std::abs(GD.ratio) > 18000000 || forceOversample;
+
+    selectMipLevel(s, loopActive);
+    if (mipLevel == 0)
+    {
+        // A rendition changes the ratio (to exactly 1 at the root key), so decide again
+        selectRendition(s, loopActive);
+        useOversampling = std::abs(GD.ratio) > 18000000 || forceOversample;
+    }
     GD.blockSize = blockSize * (useOversampling ? 2 : 1);
 
     Generator = nullptr;
 
     monoGenerator = s->channels == 1;
-    Generator = dsp::GetFPtrGeneratorSample(!monoGenerator, s->bitDepth == sample::Sample::BD_F32,
-                                            variantData.loopActive,
+    auto generatorFormat = dsp::SF_I16;
+    if (s->bitDepth == sample::Sample::BD_F32)
+        generatorFormat = dsp::SF_F32;
+    else if (s->bitDepth == sample::Sample::BD_I24)
+        generatorFormat = dsp::SF_I24;
+    Generator = dsp::GetFPtrGeneratorSample(!monoGenerator, generatorFormat, loopActive,
                                             variantData.loopDirection == engine::Zone::FORWARD_ONLY,
                                             variantData.loopMode == engine::Zone::LOOP_WHILE_GATED);
 
     GD.interpolationType = variantData.interpolationType;
 }
 
+void Voice::selectMipLevel(const std::shared_ptr<sample::Sample> &s, bool loopActive)
+{
+    mipLevel = 0;
+    if (s->isEvicted())
+        return;
+
+    auto want = sample::SampleMipmap::levelForRatio(GD.ratio >> (useOversampling ? 1 : 0));
+    if (want == 0)
+        return;
+
+    auto *mm = s->getMipmap();
+    if (!mm)
+    {
+        if (!s->mipmapRequested.exchange(true))
+        {
+            messaging::audio::AudioToSerialization req;
+            req.id = messaging::audio::a2s_sample_mipmap_request;
+            req.payloadType = messaging::audio::AudioToSerialization::VOID_STAR;
+            req.payload.p = s.get();
+            engine->getMessageController()->sendAudioToSerialization(req);
+        }
+        return;
+    }
+
+    // A loop whose ends don't land on a level's frames would change length there
+    mipLevel = std::min(want, mm->highestLevel());
+    if (loopActive)
+    {
+        while (mipLevel > 0 && ((GD.loopLowerBound | GD.loopUpperBound) & ((1 << mipLevel) - 1)))
+            mipLevel--;
+    }
+    if (mipLevel == 0)
+        return;
+
+    const auto &level = mm->level(mipLevel);
+    GDIO.sampleDataL = level.sampleData[0];
+    GDIO.sampleDataR = level.sampleData[1];
+    GDIO.waveSize = level.length;
+    GDIO.loopSplice = nullptr;
+
+    auto lastFrame = (int32_t)level.length - 1;
+    auto scale = [this, lastFrame](int32_t v) { return std::min(v >> mipLevel, lastFrame); };
+    // The generators lag a frame of whatever they read, so going forward start the rest
+    // of a level 0 frame on to keep in time with voices playing the sample
+    auto start = GD.samplePos + (GD.direction > 0 ? (1 << mipLevel) - 1 : 0);
+    GD.sampleSubPos = (start & ((1 << mipLevel) - 1)) << (24 - mipLevel);
+    GD.samplePos = scale(start);
+    GD.loopLowerBound = scale(GD.loopLowerBound);
+    GD.loopUpperBound = scale(GD.loopUpperBound);
+    GD.playbackLowerBound = scale(GD.playbackLowerBound);
+    GD.playbackUpperBound = scale(GD.playbackUpperBound);
+    GD.loopFade = GD.loopFade >> mipLevel;
+    GD.ratio = GD.ratio >> mipLevel;
+}
+
+void Voice::selectRendition(const std::shared_ptr<sample::Sample> &s, bool loopActive)
+{
+    // An oversampled group runs its voices at twice the engine rate, where a rendition at
+    // the engine rate would be read at half speed rather than frame by frame
+    const auto &sm = engine->getSampleManager();
+    if (!sm->renderAtEngineRate || loopActive || forceOversample || s->isEvicted() ||
+        s->sample_rate == sampleRate)
+        return;
+
+    auto *r = s->getRendition();
+    if (!r || r->sampleRate != sampleRate)
+    {
+        if (!s->renditionRequested.exchange(true))
+        {
+            messaging::audio::AudioToSerialization req;
+            req.id = messaging::audio::a2s_sample_rendition_request;
+            req.payloadType = messaging::audio::AudioToSerialization::VOID_STAR;
+            req.payload.p = s.get();
+            engine->getMessageController()->sendAudioToSerialization(req);
+        }
+        return;
+    }
+
+    GDIO.sampleDataL = r->sampleData[0];
+    GDIO.sampleDataR = r->sampleData[1];
+    GDIO.waveSize = r->length;
+    GDIO.loopSplice = nullptr;
+
+    auto lastFrame = (int32_t)r->length - 1;
+    auto scale = [r, lastFrame](int32_t v)
+    { return std::min((int32_t)std::lround(v * r->ratio), lastFrame); };
+    GD.samplePos = scale(GD.samplePos);
+    GD.sampleSubPos = 0;
+    GD.loopLowerBound = scale(GD.loopLowerBound);
+    GD.loopUpperBound = scale(GD.loopUpperBound);
+    GD.playbackLowerBound = scale(GD.playbackLowerBound);
+    GD.playbackUpperBound = scale(GD.playbackUpperBound);
+
+    renditionRatio = r->ratio;
+    sourceRateRatio = 1.0;
+    calculateGeneratorRatio(calculateVoicePitch());
+}
+
 float Voice::calculateVoicePitch()
 {
     auto fpitch = key + *endpoints->mappingTarget.pitchOffsetP;
@@ -724,8 +877,8 @@ void Voice::calculateGeneratorRatio(float pitch)
         float ndiff = pitch - zone->mapping.rootKey;
         auto fac = tuning::equalTuning.note_to_pitch(ndiff);
         // TODO round robin
-        GD.ratio = (int32_t)((1 << 24) * fac * zone->samplePointers[sampleIndex]->sample_rate *
-                             sampleRateInv * (1.0 + *endpoints->mappingTarget.playbackRatioP));
+        GD.ratio = (int32_t)((1 << 24) * fac * sourceRateRatio *
+                             (1.0 + *endpoints->mappingTarget.playbackRatioP));
     }
 }
 
@@ -54,11 +54,19 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
     engine::Engine *engine{nullptr};
     engine::Engine::pathToZone_t zonePath{};
     int8_t sampleIndex{0}; // int since - == no sample
+    // The sample this voice has marked as playing (see Sample::playingVoices), if any
+    sample::Sample *playingSample{nullptr};
 
     bool forceOversample{true};
 
     dsp::GeneratorState GD;
     dsp::GeneratorIO GDIO;
+    // The sample mipmap level GD and GDIO address (see SampleMipmap); 0 is the sample
+    int mipLevel{0};
+    // The sample's rate over the engine's, or exactly 1 reading an EngineRateRendition, and
+    // that rendition's frames per sample frame (1 if there isn't one)
+    double sourceRateRatio{1.0};
+    double renditionRatio{1.0};
     dsp::GeneratorFPtr Generator;
     bool monoGenerator{false};
 
@@ -133,6 +141,31 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
      */
     void initializeGenerator();
 
+    /**
+     * Point the generator at the sample mipmap level nearest its ratio, asking for the
+     * mipmap to be built if the sample doesn't have one yet. Called at the end of
+     * initializeGenerator; it scales the positions GD and GDIO hold to that level.
+     */
+    void selectMipLevel(const std::shared_ptr<sample::Sample> &s, bool loopActive);
+
+    /*
+     * Otherwise point it at the sample's EngineRateRendition if the SampleManager makes
+     * them, asking for one at this rate if need be. Loops keep playing the sample, since
+     * their ends don't land on the rendition's frames.
+     */
+    void selectRendition(const std::shared_ptr<sample::Sample> &s, bool loopActive);
+
+    /*
+     * Where the generator is, in frames of the sample rather than of whatever it reads
+     */
+    int64_t samplePosInSample() const
+    {
+        auto pos = (int64_t)GD.samplePos << mipLevel;
+        if (renditionRatio != 1.0)
+            pos = (int64_t)(pos / renditionRatio);
+        return pos;
+    }
+
     /**
      * Calculates the pitch of this voice with modulation, MPE, tuning etc in
      */
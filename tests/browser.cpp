@@ -0,0 +1,505 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample_manager.h"
+#include "sample/preview_stream.h"
+#include "browser/browser_db.h"
+#include "browser/missing_sample_search.h"
+
+#include "test_sample_files.h"
+
+#include "sqlite3.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using namespace scxt;
+using namespace scxt::test;
+
+TEST_CASE("Browser Catalogue", "[browser]")
+{
+    TempSampleDir td("scxt-test-catalogue", 3, 1000);
+    auto dbDir = fs::temp_directory_path() / "scxt-test-catalogue-db";
+    fs::remove_all(dbDir);
+    fs::create_directories(dbDir);
+
+    auto sub = td.dir / "sub";
+    fs::create_directories(sub);
+    writeTestWav(sub / "deeper.wav", 2500, 2, 9, 24);
+    writeTestAiff(td.dir / "one.aif", 700);
+    appendSmplChunk(td.files[0], 64, 100, 899);
+    {
+        std::ofstream o(td.dir / "notes.txt");
+        o << "not a sample";
+    }
+    {
+        std::ofstream o(td.dir / "kit.sfz");
+        o << "<region> sample=sample_0.wav";
+    }
+
+    browser::BrowserDB db(dbDir);
+    db.crawl(td.dir);
+    REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+
+    SECTION("Indexes What Loads")
+    {
+        auto top = db.getCatalogueEntries(td.dir);
+        REQUIRE(top.size() == 6);
+        REQUIRE(top[0].kind == browser::CatalogueEntry::DIRECTORY);
+        REQUIRE(top[0].path == sub);
+        REQUIRE(top.back().kind == browser::CatalogueEntry::MULTI_SAMPLE);
+        REQUIRE(top.back().frames == -1);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            auto e = db.getCatalogueEntry(td.files[i]);
+            REQUIRE(e.has_value());
+            REQUIRE(e->kind == browser::CatalogueEntry::SINGLE_SAMPLE);
+            REQUIRE(e->size == (int64_t)fs::file_size(td.files[i]));
+            REQUIRE(e->frames == 1000);
+            REQUIRE(e->sampleRate == 48000);
+            REQUIRE(e->channels == 1 + (i % 2));
+            REQUIRE(e->bitDepth == 16);
+            REQUIRE(e->rootKey == (i == 0 ? 64 : -1));
+            REQUIRE(e->loopStart == (i == 0 ? 100 : -1));
+            REQUIRE(e->loopEnd == (i == 0 ? 900 : -1));
+        }
+
+        auto aiff = db.getCatalogueEntry(td.dir / "one.aif");
+        REQUIRE(aiff.has_value());
+        REQUIRE(aiff->frames == 700);
+        REQUIRE(aiff->sampleRate == 48000);
+        REQUIRE(aiff->channels == 1);
+
+        auto deep = db.getCatalogueEntries(sub);
+        REQUIRE(deep.size() == 1);
+        REQUIRE(deep[0].frames == 2500);
+        REQUIRE(deep[0].channels == 2);
+        REQUIRE(deep[0].bitDepth == 24);
+
+        // and the loader agrees with the header parse
+        ThreadingChecker tc;
+        sample::SampleManager sm(tc);
+        auto sid = sm.loadSampleByPath(sub / "deeper.wav");
+        REQUIRE(sid.has_value());
+        REQUIRE(sm.getSample(*sid)->sample_length == deep[0].frames);
+    }
+
+    SECTION("Rescans Pick Up Changes")
+    {
+        writeTestWav(td.files[1], 3000, 2, 1);
+        fs::remove(td.files[2]);
+        fs::remove_all(sub);
+        db.crawl(td.dir);
+        REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+
+        REQUIRE(db.getCatalogueEntry(td.files[1])->frames == 3000);
+        REQUIRE(!db.getCatalogueEntry(td.files[2]).has_value());
+        REQUIRE(!db.getCatalogueEntry(sub).has_value());
+        REQUIRE(!db.getCatalogueEntry(sub / "deeper.wav").has_value());
+        REQUIRE(db.getCatalogueEntries(td.dir).size() == 4);
+    }
+
+    SECTION("Search")
+    {
+        auto names = [&db](const browser::CatalogueQuery &q) {
+            std::vector<std::string> res;
+            for (const auto &e : db.queryCatalogue(q))
+                res.push_back(e.path.filename().u8string());
+            return res;
+        };
+        using v_t = std::vector<std::string>;
+
+        browser::CatalogueQuery q;
+        REQUIRE(names(q) == v_t{"deeper.wav", "kit.sfz", "one.aif", "sample_0.wav",
+                                "sample_1.wav", "sample_2.wav"});
+
+        q.text = "SAM";
+        REQUIRE(names(q) == v_t{"sample_0.wav", "sample_1.wav", "sample_2.wav"});
+        q.text = "sample 2";
+        REQUIRE(names(q) == v_t{"sample_2.wav"});
+        q.text = "sample \"2 OR";
+        REQUIRE(names(q).empty());
+        q.text = "deep";
+        REQUIRE(names(q) == v_t{"deeper.wav"});
+
+        q = {};
+        q.channels = 2;
+        REQUIRE(names(q) == v_t{"deeper.wav", "sample_1.wav"});
+        q.folder = td.dir;
+        q.formats = {"wav"};
+        REQUIRE(names(q) == v_t{"deeper.wav", "sample_1.wav"});
+        q.folder = sub;
+        REQUIRE(names(q) == v_t{"deeper.wav"});
+
+        q = {};
+        q.formats = {"aif", "sfz"};
+        REQUIRE(names(q) == v_t{"kit.sfz", "one.aif"});
+
+        q = {};
+        q.rootKey = 64;
+        REQUIRE(names(q) == v_t{"sample_0.wav"});
+
+        // 1000 frames at 48k is 0.0208s, 700 is 0.0146s and 2500 is 0.052s
+        q = {};
+        q.minDuration = 0.015;
+        q.maxDuration = 0.03;
+        REQUIRE(names(q) == v_t{"sample_0.wav", "sample_1.wav", "sample_2.wav"});
+        q.minDuration.reset();
+        REQUIRE(names(q) == v_t{"one.aif", "sample_0.wav", "sample_1.wav", "sample_2.wav"});
+
+        q = {};
+        q.sampleRate = 44100;
+        REQUIRE(names(q).empty());
+        q.sampleRate = 48000;
+        q.limit = 2;
+        auto page = db.queryCatalogue(q);
+        REQUIRE(page.size() == 2);
+        q.after = page.back();
+        REQUIRE(names(q) == v_t{"sample_0.wav", "sample_1.wav"});
+        q.after = db.queryCatalogue(q).back();
+        REQUIRE(names(q) == v_t{"sample_2.wav"});
+
+        q = {};
+        q.kind = browser::CatalogueEntry::DIRECTORY;
+        REQUIRE(names(q) == v_t{"sub"});
+    }
+
+#if LINUX
+    SECTION("Watches For Changes")
+    {
+        auto late = td.dir / "late.wav";
+        writeTestWav(late, 500, 1, 5);
+        std::optional<browser::CatalogueEntry> e;
+        for (int i = 0; i < 200 && !e.has_value(); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            db.waitForJobsOutstandingComplete(1000);
+            e = db.getCatalogueEntry(late);
+        }
+        REQUIRE(e.has_value());
+        REQUIRE(e->frames == 500);
+    }
+#endif
+    fs::remove_all(dbDir);
+}
+
+TEST_CASE("Browser Database Sharing", "[browser]")
+{
+    TempSampleDir a("scxt-test-share-a", 200, 200);
+    TempSampleDir b("scxt-test-share-b", 200, 200);
+    auto dbDir = fs::temp_directory_path() / "scxt-test-share-db";
+    fs::remove_all(dbDir);
+    fs::create_directories(dbDir);
+
+    {
+        // Two instances crawling into the same database at once, and reading as they go
+        browser::BrowserDB one(dbDir), two(dbDir);
+        auto t0 = std::chrono::steady_clock::now();
+        one.crawl(a.dir);
+        two.crawl(b.dir);
+        for (int i = 0; i < 20; ++i)
+        {
+            one.queryCatalogue({});
+            two.getCatalogueEntries(a.dir);
+        }
+        REQUIRE(one.waitForJobsOutstandingComplete(10000) == 0);
+        REQUIRE(two.waitForJobsOutstandingComplete(10000) == 0);
+        // neither sat out a lock the other held
+        REQUIRE(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(3));
+
+        REQUIRE(one.getCatalogueEntries(b.dir).size() == 200);
+        REQUIRE(two.getCatalogueEntries(a.dir).size() == 200);
+        REQUIRE(fs::exists(dbDir / "SCXTBrowser.db-wal"));
+    }
+    fs::remove_all(dbDir);
+}
+
+TEST_CASE("Missing Sample Search", "[browser]")
+{
+    using infrastructure::ContentHashKind;
+    TempSampleDir cat("scxt-test-missing-cat", 3, 1500);
+    TempSampleDir uncat("scxt-test-missing-uncat", 0, 0);
+    auto dbDir = fs::temp_directory_path() / "scxt-test-missing-db";
+    fs::remove_all(dbDir);
+    fs::create_directories(dbDir);
+
+    auto deep = uncat.dir / "a" / "b";
+    fs::create_directories(deep);
+    writeTestWav(deep / "moved.wav", 1700, 2, 31);
+    writeTestWav(uncat.dir / "legacy.wav", 900, 1, 32);
+    writeTestWav(uncat.dir / "twice.wav", 900, 1, 33);
+    writeTestWav(deep / "twice.wav", 900, 1, 34);
+
+    browser::BrowserDB db(dbDir);
+    db.crawl(cat.dir);
+    REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+
+    auto sizeOf = [](const fs::path &p) { return (int64_t)fs::file_size(p); };
+    std::vector<browser::MissingSampleQuery> qs{
+        // renamed since the patch was saved, so found by size in the catalogue
+        {infrastructure::createContentHashFromFile(ContentHashKind::XXH3_128, cat.files[0]),
+         "was_called_this.wav", sizeOf(cat.files[0])},
+        // an older patch with no size, found by name
+        {infrastructure::createContentHashFromFile(ContentHashKind::MD5, cat.files[1]),
+         "sample_1.wav", -1},
+        // not catalogued, so crawled for
+        {infrastructure::createContentHashFromFile(ContentHashKind::XXH3_128, deep / "moved.wav"),
+         "moved.wav", sizeOf(deep / "moved.wav")},
+        // legacy ids match a unique name only
+        {"legacy-id", "legacy.wav", -1},
+        {"legacy-id", "twice.wav", -1},
+        // and something which is nowhere
+        {"0123456789abcdef0123456789abcdef", "sample_2.wav", sizeOf(cat.files[2])}};
+
+    {
+        // A cancelled search stops before the crawl but still answers every query
+        browser::MissingSampleSearchControl control;
+        control.cancel = true;
+        auto cancelled = browser::findMissingSamples(db, qs, {cat.dir, uncat.dir}, &control);
+        REQUIRE(cancelled.size() == qs.size());
+        REQUIRE(!cancelled[2].has_value());
+    }
+
+    std::vector<std::string> progress;
+    browser::MissingSampleSearchControl control;
+    control.onProgress = [&progress](const auto &s) { progress.push_back(s); };
+    auto res = browser::findMissingSamples(db, qs, {cat.dir, uncat.dir}, &control);
+    REQUIRE(!progress.empty());
+    REQUIRE(progress.front() == "Looking up 6 missing samples");
+    REQUIRE(std::any_of(progress.begin(), progress.end(),
+                        [](const auto &s) { return s.find("on disk") != std::string::npos; }));
+    REQUIRE(res.size() == qs.size());
+    REQUIRE(res[0] == cat.files[0]);
+    REQUIRE(res[1] == cat.files[1]);
+    REQUIRE(res[2] == deep / "moved.wav");
+    REQUIRE(res[3] == uncat.dir / "legacy.wav");
+    REQUIRE(!res[4].has_value());
+    REQUIRE(!res[5].has_value());
+
+    // What we hashed is in the identity cache, so a second pass finds it without a crawl
+    REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+    auto again = browser::findMissingSamples(db, {qs[2]}, {});
+    REQUIRE(again.size() == 1);
+    REQUIRE(again[0] == deep / "moved.wav");
+
+    fs::remove_all(dbDir);
+}
+
+TEST_CASE("Browser Preview", "[browser]")
+{
+    TempSampleDir td("scxt-test-preview", 2, 20000);
+    writeTestAiff(td.dir / "one.aif", 20000);
+
+    sample::PreviewStream ps;
+    ps.setEngineSampleRate(48000);
+
+    // Give the decoder time to get all of a short file into the ring, then play it out
+    auto playOut = [&ps](size_t maxFrames) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::vector<float> L(maxFrames, 0.f), R(maxFrames, 0.f);
+        for (size_t pos = 0; pos < maxFrames && ps.isPlaying(); pos += 32)
+            ps.processBlockAdding(L.data() + pos, R.data() + pos, 32);
+        return std::make_pair(L, R);
+    };
+    auto wavValue = [](int i, int seed, int c) {
+        return 0.5f * (int16_t)(16000 * std::sin(0.01 * (i + 1) * (seed + c + 1))) / 32768.f;
+    };
+
+    SECTION("Streams The File")
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        ps.start(td.files[1]);
+        float L[32]{}, R[32]{};
+        while (L[0] == 0.f && std::chrono::high_resolution_clock::now() - startTime <
+                                  std::chrono::milliseconds(500))
+        {
+            ps.processBlockAdding(L, R, 32);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        auto firstAudio = std::chrono::high_resolution_clock::now() - startTime;
+        REQUIRE(L[0] == Approx(wavValue(0, 1, 0)).margin(1e-6));
+        REQUIRE(R[0] == Approx(wavValue(0, 1, 1)).margin(1e-6));
+        REQUIRE(firstAudio < std::chrono::milliseconds(50));
+
+        ps.start(td.files[1]);
+        auto [pl, pr] = playOut(24000);
+        REQUIRE(!ps.isPlaying());
+        for (int i = 0; i < 20000; ++i)
+        {
+            REQUIRE(pl[i] == Approx(wavValue(i, 1, 0)).margin(1e-6));
+            REQUIRE(pr[i] == Approx(wavValue(i, 1, 1)).margin(1e-6));
+        }
+        for (int i = 20000; i < 24000; ++i)
+            REQUIRE(pl[i] == 0.f);
+    }
+
+    SECTION("Resamples To The Engine")
+    {
+        ps.setEngineSampleRate(96000);
+        ps.start(td.dir / "one.aif");
+        auto [pl, pr] = playOut(44000);
+        REQUIRE(!ps.isPlaying());
+        for (int i = 0; i < 40000; i += 2)
+        {
+            auto v = 0.5f * (int16_t)(16000 * std::sin(0.01 * (i / 2))) / 32768.f;
+            REQUIRE(pl[i] == Approx(v).margin(1e-6));
+            REQUIRE(pr[i] == pl[i]);
+        }
+        REQUIRE(pl[40000] == 0.f);
+    }
+
+    SECTION("Changing File Cancels")
+    {
+        ps.start(td.files[1]);
+        playOut(512);
+        REQUIRE(ps.isPlaying());
+
+        ps.start(td.files[0]);
+        auto [pl, pr] = playOut(24000);
+        REQUIRE(!ps.isPlaying());
+        for (int i = 0; i < 20000; ++i)
+        {
+            REQUIRE(pl[i] == Approx(wavValue(i, 0, 0)).margin(1e-6));
+            REQUIRE(pr[i] == pl[i]);
+        }
+
+        ps.start(td.files[1]);
+        playOut(512);
+        ps.stop();
+        REQUIRE(!ps.isPlaying());
+        float L[32]{}, R[32]{};
+        ps.processBlockAdding(L, R, 32);
+        REQUIRE(std::all_of(L, L + 32, [](auto f) { return f == 0.f; }));
+    }
+
+    SECTION("Unreadable Files Finish")
+    {
+        {
+            std::ofstream o(td.dir / "broken.wav");
+            o << "not a sample";
+        }
+        ps.start(td.dir / "broken.wav");
+        playOut(32);
+        REQUIRE(!ps.isPlaying());
+    }
+}
+
+TEST_CASE("Catalogue Search Benchmark", "[.][bench]")
+{
+    // Hidden; run with `scxt-test "[bench]"`. Fills the catalogue with 500k made up names, each
+    // of three words from a short list, then times a page of each query. On a linux desktop
+    // a word in a sixth of the names takes about 10ms (down from 55ms when every match was
+    // sorted), as does that word in a folder, two such words about 6ms, and rarer text and
+    // the attribute queries under a ms.
+    auto dbDir = fs::temp_directory_path() / "scxt-test-catalogue-bench-db";
+    fs::remove_all(dbDir);
+    fs::create_directories(dbDir);
+
+    static constexpr int rows{500000};
+    std::vector<std::string> words{"kick", "snare", "hat",  "clap", "tom",    "pad",
+                                   "bass", "lead",  "vox",  "fx",   "808",    "909",
+                                   "hard", "soft",  "open", "wet",  "closed", "dry"};
+
+    browser::BrowserDB db(dbDir);
+    REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+    {
+        sqlite3 *h{nullptr};
+        REQUIRE(sqlite3_open((dbDir / "SCXTBrowser.db").u8string().c_str(), &h) == SQLITE_OK);
+        sqlite3_busy_timeout(h, 5000);
+        sqlite3_stmt *ins{nullptr};
+        sqlite3_exec(h, "BEGIN", nullptr, nullptr, nullptr);
+        sqlite3_prepare_v2(h,
+                           "INSERT INTO Catalogue (parent, name, path, kind, size, mtime, frames, "
+                           "sample_rate, channels, bit_depth, root_key, loop_start, loop_end, "
+                           "format, duration) VALUES (?1, ?2, ?3, 1, 1000, 1, ?4, ?5, ?6, 24, ?7, "
+                           "-1, -1, 'wav', ?4 * 1.0 / ?5)",
+                           -1, &ins, nullptr);
+        std::mt19937 gen(17);
+        auto pick = [&](const auto &v) { return v[gen() % v.size()]; };
+        for (int i = 0; i < rows; ++i)
+        {
+            auto parent = "/lib/pack" + std::to_string(i % 500) + "/sub" + std::to_string(i % 7);
+            auto name = pick(words) + "_" + pick(words) + "_" + pick(words) + "_" +
+                        std::to_string(i) + ".wav";
+            auto path = parent + "/" + name;
+            sqlite3_bind_text(ins, 1, parent.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins, 3, path.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(ins, 4, 1000 + (int)(gen() % 499000));
+            sqlite3_bind_int(ins, 5, pick(std::vector<int>{44100, 48000, 96000}));
+            sqlite3_bind_int(ins, 6, 1 + (int)(gen() % 2));
+            sqlite3_bind_int(ins, 7, pick(std::vector<int>{-1, 36, 48, 60}));
+            REQUIRE(sqlite3_step(ins) == SQLITE_DONE);
+            sqlite3_reset(ins);
+        }
+        sqlite3_finalize(ins);
+        sqlite3_exec(h, "COMMIT; ANALYZE;", nullptr, nullptr, nullptr);
+        sqlite3_close(h);
+    }
+
+    using clock_t = std::chrono::high_resolution_clock;
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    auto timeQuery = [&](const std::string &what, const browser::CatalogueQuery &q) {
+        double best{1e9};
+        size_t found{0};
+        for (int i = 0; i < 5; ++i)
+        {
+            auto s = clock_t::now();
+            found = db.queryCatalogue(q).size();
+            best = std::min(best, ms(clock_t::now() - s));
+        }
+        std::cout << "   " << what << " : " << best << "ms (" << found << " entries)\n";
+        return found;
+    };
+
+    std::cout << "Catalogue search over " << rows << " entries\n";
+    browser::CatalogueQuery q;
+    q.text = "kick";
+    REQUIRE(timeQuery("one common word", q) == 100);
+    q.text = "kick 808";
+    REQUIRE(timeQuery("two common words", q) == 100);
+    q.text = "kick 808 wet 12";
+    timeQuery("four words", q);
+    q.text = "12345";
+    REQUIRE(timeQuery("a rare word", q) > 0);
+    q.folder = fs::path("/lib/pack7");
+    q.text = "kick";
+    timeQuery("a folder and a word", q);
+    q = {};
+    q.channels = 2;
+    q.sampleRate = 96000;
+    REQUIRE(timeQuery("channels and sample rate", q) == 100);
+    std::cout << std::flush;
+
+    fs::remove_all(dbDir);
+}
@@ -0,0 +1,113 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample_manager.h"
+#include "dsp/resampling.h"
+
+using namespace scxt;
+
+TEST_CASE("Embedded Sample Restore", "[patch]")
+{
+    // Channel data as a monolith holds it: FIRoffset silent frames either side
+    static constexpr uint32_t frames{1000};
+    auto block = std::make_shared<std::vector<int16_t>>(2 * (frames + dsp::FIRipol_N), 0);
+    void *chan[2]{block->data(), block->data() + frames + dsp::FIRipol_N};
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        (*block)[dsp::FIRoffset + i] = (int16_t)(i * 7);
+        (*block)[frames + dsp::FIRipol_N + dsp::FIRoffset + i] = (int16_t)(-(int)i);
+    }
+
+    auto makeEmbedded = [&](const std::string &md5) {
+        auto s = std::make_shared<sample::Sample>();
+        s->channels = 2;
+        s->sample_length = frames;
+        s->sample_rate = 44100;
+        s->type = sample::Sample::WAV_FILE;
+        s->mFileName = fs::temp_directory_path() / "scxt-not-here" / (md5 + ".wav");
+        s->md5Sum = md5;
+        s->id.setAsMD5(md5);
+        s->id.setPathHash(s->mFileName);
+        return s;
+    };
+
+    SECTION("Plays In Place")
+    {
+        auto s = makeEmbedded("0123456789abcdef0123456789abcdef");
+        REQUIRE(s->referenceMappedData(block, chan, sample::Sample::BD_I16));
+        REQUIRE(s->dataIsMapped);
+        REQUIRE(s->bitDepth == sample::Sample::BD_I16);
+        REQUIRE(s->GetSamplePtrI16(0)[10] == 70);
+        REQUIRE(s->GetSamplePtrI16(1)[10] == -10);
+        REQUIRE(s->sampleDataOwner[1].get() == chan[1]);
+
+        // the owner lives as long as the sample does
+        auto weak = std::weak_ptr<std::vector<int16_t>>(block);
+        auto held = block;
+        block.reset();
+        REQUIRE(!weak.expired());
+        held.reset();
+        REQUIRE(!weak.expired());
+        s.reset();
+        REQUIRE(weak.expired());
+    }
+
+    SECTION("Needs Silent Pads")
+    {
+        auto s = makeEmbedded("0123456789abcdef0123456789abcdef");
+        (*block)[frames + dsp::FIRoffset + 2] = 1;
+        REQUIRE(!s->referenceMappedData(block, chan, sample::Sample::BD_I16));
+        REQUIRE(!s->dataIsMapped);
+        REQUIRE(!s->sampleData[0]);
+    }
+
+    SECTION("Restores Without The Files")
+    {
+        auto s = makeEmbedded("0123456789abcdef0123456789abcdef");
+        REQUIRE(s->referenceMappedData(block, chan, sample::Sample::BD_I16));
+        auto gone = makeEmbedded("fedcba9876543210fedcba9876543210");
+
+        ThreadingChecker tc;
+        sample::SampleManager sm(tc);
+        sm.provideEmbeddedSamples({s});
+        sm.restoreFromSampleAddressesAndIDs(
+            {{s->id, s->getSampleFileAddress()}, {gone->id, gone->getSampleFileAddress()}});
+
+        REQUIRE(sm.getSample(s->id) == s);
+        REQUIRE(!sm.getSample(s->id)->isMissingPlaceholder);
+        REQUIRE(sm.getSample(gone->id));
+        REQUIRE(sm.getSample(gone->id)->isMissingPlaceholder);
+        // mapped data isn't ours to count
+        REQUIRE(sm.sampleMemoryInBytes == 0);
+
+        // and the hand over is only good for one restore
+        sm.reset();
+        sm.restoreFromSampleAddressesAndIDs({{s->id, s->getSampleFileAddress()}});
+        REQUIRE(sm.getSample(s->id)->isMissingPlaceholder);
+    }
+}
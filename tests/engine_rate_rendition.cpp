@@ -0,0 +1,181 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample.h"
+#include "sample/engine_rate_rendition.h"
+#include "dsp/generator.h"
+#include "dsp/resampling.h"
+#include <cmath>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+std::shared_ptr<sample::Sample> sineSample(size_t len, double hz, double rate,
+                                           sample::Sample::BitDepth bd)
+{
+    auto s = std::make_shared<sample::Sample>();
+    std::vector<float> f32(len);
+    std::vector<int16_t> i16(len);
+    for (size_t i = 0; i < len; ++i)
+    {
+        f32[i] = (float)(0.8 * std::sin(2 * M_PI * hz * i / rate));
+        i16[i] = (int16_t)(f32[i] * 32767);
+    }
+    if (bd == sample::Sample::BD_I16)
+    {
+        s->allocateI16(0, len);
+        s->load_data_i16(0, i16.data(), len, sizeof(int16_t));
+    }
+    else
+    {
+        s->allocateF32(0, len);
+        s->load_data_f32(0, f32.data(), len, sizeof(float));
+    }
+    s->sample_length = len;
+    s->sample_rate = rate;
+    s->channels = 1;
+    s->sample_loaded = true;
+    return s;
+}
+
+// Play mono float data one shot at the given ratio
+std::vector<float> render(void *data, int32_t length, int32_t ratio, int blocks,
+                          dsp::InterpolationTypes interp)
+{
+    dsp::GeneratorState GD;
+    GD.ratio = ratio;
+    GD.samplePos = 0;
+    GD.sampleSubPos = 0;
+    GD.direction = 1;
+    GD.isFinished = false;
+    GD.playbackUpperBound = length - 1;
+    GD.loopUpperBound = GD.playbackUpperBound;
+    GD.interpolationType = interp;
+
+    float outL[scxt::blockSize], outR[scxt::blockSize];
+    dsp::GeneratorIO IO;
+    IO.outputL = outL;
+    IO.outputR = outR;
+    IO.waveSize = length;
+    IO.sampleDataL = data;
+
+    auto gen = dsp::GetFPtrGeneratorSample(false, dsp::SF_F32, false, true, false);
+    std::vector<float> res;
+    for (int b = 0; b < blocks && !GD.isFinished; ++b)
+    {
+        gen(&GD, &IO);
+        res.insert(res.end(), outL, outL + scxt::blockSize);
+    }
+    return res;
+}
+} // namespace
+
+TEST_CASE("Engine Rate Rendition", "[sample]")
+{
+    SECTION("Layout")
+    {
+        for (auto bd : {sample::Sample::BD_I16, sample::Sample::BD_F32})
+        {
+            auto s = sineSample(4410, 441.0, 44100, bd);
+            auto r = sample::EngineRateRendition::build(*s, 48000);
+            REQUIRE(r);
+            REQUIRE(r->sampleRate == 48000);
+            REQUIRE(r->ratio == Approx(48000.0 / 44100.0));
+            REQUIRE(r->format == (bd == sample::Sample::BD_I16 ? dsp::SF_I16 : dsp::SF_F32));
+            REQUIRE(r->channels == 1);
+            // the last frame lands short of the last frame of the sample
+            REQUIRE(r->length == 4799);
+            REQUIRE(r->sizeInBytes() == (r->length + dsp::FIRipol_N) *
+                                            (bd == sample::Sample::BD_I16 ? 2 : 4));
+
+            int sz = bd == sample::Sample::BD_I16 ? 2 : 4;
+            int pad = (int)dsp::FIRoffset * sz;
+            auto *d = (const char *)r->sampleData[0];
+            for (int i = 0; i < pad; ++i)
+            {
+                REQUIRE(d[i - pad] == 0);
+                REQUIRE(d[(int)r->length * sz + i] == 0);
+            }
+        }
+    }
+
+    SECTION("Nothing To Do")
+    {
+        auto s = sineSample(4410, 441.0, 48000, sample::Sample::BD_F32);
+        REQUIRE_FALSE(sample::EngineRateRendition::build(*s, 48000));
+        REQUIRE_FALSE(sample::EngineRateRendition::build(*s, 0));
+    }
+
+    SECTION("Is The Sample At The New Rate")
+    {
+        for (auto [from, to] : {std::pair{44100.0, 48000.0}, std::pair{48000.0, 44100.0},
+                                std::pair{44100.0, 96000.0}})
+        {
+            auto s = sineSample(20000, 1000.0, from, sample::Sample::BD_F32);
+            auto r = sample::EngineRateRendition::build(*s, to);
+            REQUIRE(r);
+            auto *d = (const float *)r->sampleData[0];
+            // away from the ends, where the kernel runs off the data
+            for (uint32_t i = 500; i < r->length - 500; ++i)
+                REQUIRE(d[i] == Approx(0.8 * std::sin(2 * M_PI * 1000.0 * i / to)).margin(1e-3));
+        }
+    }
+
+    SECTION("Removes What Would Alias")
+    {
+        // 22k is fine at 48k but above the 22.05k nyquist going down to 44.1k
+        auto s = sineSample(20000, 23000.0, 48000, sample::Sample::BD_F32);
+        auto r = sample::EngineRateRendition::build(*s, 44100);
+        REQUIRE(r);
+        auto *d = (const float *)r->sampleData[0];
+        double sum{0};
+        for (uint32_t i = 1000; i < r->length - 1000; ++i)
+            sum += d[i] * d[i];
+        REQUIRE(std::sqrt(sum / (r->length - 2000)) < 1e-3);
+    }
+
+    SECTION("Unity Ratio Reads The Frames Out")
+    {
+        auto s = sineSample(4410, 441.0, 44100, sample::Sample::BD_F32);
+        auto r = sample::EngineRateRendition::build(*s, 48000);
+        REQUIRE(r);
+        auto *d = (const float *)r->sampleData[0];
+        auto blocks = 2000 / scxt::blockSize;
+        for (auto interp : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear})
+        {
+            auto out = render(r->sampleData[0], r->length, 1 << 24, blocks, interp);
+            REQUIRE(out.size() == blocks * scxt::blockSize);
+            // the generators run a frame behind what they read
+            REQUIRE(out[0] == 0.f);
+            for (size_t i = 1; i < out.size(); ++i)
+                REQUIRE(out[i] == d[i - 1]);
+        }
+    }
+}
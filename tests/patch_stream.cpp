@@ -0,0 +1,708 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "RIFF.h" // from libgig
+#include "patch_io/riff_stream.h"
+#include "patch_io/monolith.h"
+#include "sample/sample_manager.h"
+#include "dsp/resampling.h"
+#include "engine/part.h"
+#include "engine/patch.h"
+#include "json/engine_traits.h"
+#include "json/engine_events.h"
+
+#include "tao/json/msgpack/events/to_string.hpp"
+#include "tao/json/msgpack/from_string.hpp"
+#include "tao/json/msgpack/to_stream.hpp"
+#include "tao/json/msgpack/to_string.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace scxt;
+
+namespace
+{
+std::string testBytes(size_t n, int seed)
+{
+    std::string res(n, 0);
+    for (size_t i = 0; i < n; ++i)
+        res[i] = (char)((i * 31 + seed) & 0xFF);
+    return res;
+}
+
+std::string fileContents(const fs::path &p)
+{
+    std::ifstream i(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(i), std::istreambuf_iterator<char>());
+}
+
+/*
+ * How far the resident set peaked above where it was when this was made. Writing 5 to
+ * clear_refs resets the kernel's high water mark, so this only works on Linux; elsewhere
+ * growthKB is -1.
+ */
+struct PeakResidentGrowth
+{
+    int64_t startKB{-1};
+
+    static int64_t statusKB(const std::string &field)
+    {
+        std::ifstream s("/proc/self/status");
+        std::string line;
+        while (std::getline(s, line))
+            if (line.rfind(field, 0) == 0)
+                return std::stoll(line.substr(field.size()));
+        return -1;
+    }
+
+    PeakResidentGrowth()
+    {
+#if defined(__linux__)
+#if defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+        std::ofstream("/proc/self/clear_refs") << "5";
+        startKB = statusKB("VmRSS:");
+#endif
+    }
+
+    int64_t growthKB() const
+    {
+        auto peak = statusKB("VmHWM:");
+        return (startKB < 0 || peak < 0) ? -1 : peak - startKB;
+    }
+};
+
+// Unstreams the parts of an engine stream walk into the given parts, as the engine does
+struct PartsSink
+{
+    std::vector<engine::Part *> parts;
+    std::map<std::string, json::scxt_value> engineMembers;
+    json::scxt_value partRest, groupRest;
+    size_t partIndex{0};
+    engine::Part *part{nullptr};
+    engine::Group *group{nullptr};
+
+    void begin(json::EngineEventLevel l)
+    {
+        if (l == json::EngineEventLevel::PART)
+        {
+            part = parts.at(partIndex++);
+            part->clearGroups();
+            partRest = tao::json::empty_object;
+        }
+        else if (l == json::EngineEventLevel::GROUP)
+        {
+            group = part->getGroup(part->addGroup() - 1).get();
+            groupRest = tao::json::empty_object;
+        }
+    }
+
+    void member(json::EngineEventLevel l, const std::string &key, json::scxt_value &&v)
+    {
+        if (l == json::EngineEventLevel::ENGINE)
+            engineMembers[key] = std::move(v);
+        else if (l == json::EngineEventLevel::PART)
+            partRest.get_object().emplace(key, std::move(v));
+        else if (l == json::EngineEventLevel::GROUP)
+            groupRest.get_object().emplace(key, std::move(v));
+    }
+
+    void zone(json::scxt_value &&v) { json::unstreamZoneInto(v, *group); }
+
+    void end(json::EngineEventLevel l)
+    {
+        if (l == json::EngineEventLevel::PART)
+            json::unstreamPartSettings(partRest, *part);
+        else if (l == json::EngineEventLevel::GROUP)
+            json::unstreamGroupSettings(groupRest, *group);
+    }
+};
+
+using PartsWalker =
+    json::EngineEventWalker<tao::json::events::to_basic_value<json::scxt_traits>, PartsSink>;
+
+// Both passes, the way unstreamEngineState goes over a multi
+void walkEngine(PartsSink &sink, std::string_view msg)
+{
+    engine::Engine::UnstreamGuard sg(scxt::currentStreamingVersion);
+    PartsWalker settings(sink, false);
+    tao::json::msgpack::events::from_string(settings, msg.data(), msg.size());
+    PartsWalker patch(sink, true);
+    tao::json::msgpack::events::from_string(patch, msg.data(), msg.size());
+}
+
+// An engine document holding just these parts
+json::scxt_value engineDocument(const std::vector<const engine::Part *> &parts)
+{
+    json::scxt_value pv = tao::json::empty_array;
+    for (auto *p : parts)
+        pv.get_array().emplace_back(json::scxt_value(*p));
+    json::scxt_value patch = {{"busses", tao::json::empty_object}, {"parts", pv}};
+    json::scxt_value res = {{"patch", patch},
+                            {"sampleManager", tao::json::empty_object},
+                            {"streamingVersion", scxt::currentStreamingVersion}};
+    return res;
+}
+} // namespace
+
+TEST_CASE("Patch RIFF Streaming", "[patch]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-patch-stream";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // an odd sized chunk to check the padding, and one big enough to matter
+    auto manifest = std::string("{\"type\":\"part\",\"version\":\"1\"}");
+    auto data = testBytes(1000001, 3);
+    REQUIRE(manifest.size() % 2 == 1);
+
+    auto ours = dir / "ours.scm";
+    {
+        patch_io::RIFFStreamWriter w(ours, 'SCXT');
+        w.addChunk('scmf', manifest);
+        w.addChunk('scdt', [&data](std::ostream &os) {
+            for (size_t i = 0; i < data.size(); i += 4096)
+                os.write(data.data() + i, std::min((size_t)4096, data.size() - i));
+        });
+        REQUIRE(w.finish());
+    }
+    REQUIRE(fs::exists(ours));
+    REQUIRE(!fs::exists(dir / "ours.scm.saving"));
+
+    SECTION("Matches libgig")
+    {
+        auto theirs = dir / "theirs.scm";
+        {
+            auto f = std::make_unique<RIFF::File>('SCXT');
+            f->SetByteOrder(RIFF::endian_little);
+            for (auto &[id, s] : {std::make_pair('scmf', manifest), std::make_pair('scdt', data)})
+            {
+                auto c = f->AddSubChunk(id, s.size());
+                memcpy(c->LoadChunkData(), s.data(), s.size());
+            }
+            f->Save(theirs.u8string());
+        }
+        REQUIRE(fileContents(ours) == fileContents(theirs));
+
+        auto f = std::make_unique<RIFF::File>(ours.u8string());
+        auto c = f->GetSubChunk('scdt');
+        REQUIRE(c);
+        REQUIRE(c->GetSize() == data.size());
+        REQUIRE(memcmp(c->LoadChunkData(), data.data(), data.size()) == 0);
+    }
+
+    SECTION("Reads In Place")
+    {
+        patch_io::RIFFMappedReader r(ours);
+        REQUIRE(r.isValid());
+        REQUIRE(r.getFormType() == 'SCXT');
+        REQUIRE(r.getChunk('scmf') == std::string_view(manifest));
+        REQUIRE(r.getChunk('scdt') == std::string_view(data));
+        REQUIRE(!r.getChunk('scsm').has_value());
+
+        auto s = fileContents(ours);
+        {
+            std::ofstream o(dir / "short.scm", std::ios::binary);
+            o.write(s.data(), s.size() - 100);
+        }
+        REQUIRE(!patch_io::RIFFMappedReader(dir / "short.scm").isValid());
+        REQUIRE(!patch_io::RIFFMappedReader(dir / "nothere.scm").isValid());
+    }
+
+    SECTION("Failed Save Keeps The Old File")
+    {
+        auto before = fileContents(ours);
+        try
+        {
+            patch_io::RIFFStreamWriter w(ours, 'SCXT');
+            w.addChunk('scmf', manifest);
+            w.addChunk('scdt', [](std::ostream &os) {
+                os << "partway";
+                throw std::runtime_error("streaming failed");
+            });
+            w.finish();
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+        REQUIRE(fileContents(ours) == before);
+        REQUIRE(!fs::exists(dir / "ours.scm.saving"));
+
+        patch_io::RIFFStreamWriter w(dir / "nodir" / "x.scm", 'SCXT');
+        w.addChunk('scmf', manifest);
+        REQUIRE(!w.finish());
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Monolith Samples", "[patch]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-monolith";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    auto mono = std::make_shared<sample::Sample>();
+    mono->channels = 1;
+    mono->sample_length = 1001;
+    mono->sample_rate = 44100;
+    mono->allocateI16(0, mono->sample_length);
+    for (uint32_t i = 0; i < mono->sample_length; ++i)
+        mono->GetSamplePtrI16(0)[i] = (int16_t)(i * 13);
+    mono->meta.loop_present = true;
+    mono->meta.loop_start = 100;
+    mono->meta.loop_end = 900;
+    mono->meta.key_root = 48;
+    mono->mFileName = dir / "gone" / "mono.wav";
+    mono->md5Sum = "0123456789abcdef0123456789abcdef";
+    mono->id.setAsMD5(mono->md5Sum);
+    mono->id.setPathHash(mono->mFileName);
+
+    auto stereo = std::make_shared<sample::Sample>();
+    stereo->channels = 2;
+    stereo->sample_length = 777;
+    stereo->sample_rate = 48000;
+    stereo->type = sample::Sample::AIFF_FILE;
+    for (int c = 0; c < 2; ++c)
+    {
+        stereo->allocateF32(c, stereo->sample_length);
+        for (uint32_t i = 0; i < stereo->sample_length; ++i)
+            stereo->GetSamplePtrF32(c)[i] = (c ? -0.001f : 0.001f) * i;
+    }
+    stereo->mFileName = dir / "gone" / "stereo.aif";
+    stereo->md5Sum = "fedcba9876543210fedcba9876543210";
+    stereo->id.setAsMD5(stereo->md5Sum);
+    stereo->id.setPathHash(stereo->mFileName);
+
+    auto path = dir / "mono.scm";
+    {
+        patch_io::RIFFStreamWriter w(path, 'SCXT');
+        w.addChunk('scmf', std::string("{\"type\":\"multi\",\"version\":\"1\"}"));
+        patch_io::addMonolithSampleChunks(w, {mono, stereo});
+        REQUIRE(w.finish());
+    }
+
+    auto reader = std::make_shared<patch_io::RIFFMappedReader>(path);
+    REQUIRE(reader->isValid());
+    REQUIRE(patch_io::hasMonolithSamples(*reader));
+    auto read = patch_io::readMonolithSamples(reader);
+    REQUIRE(read.size() == 2);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        auto &orig = i == 0 ? mono : stereo;
+        auto &s = read[i];
+        REQUIRE(s->id == orig->id);
+        REQUIRE(s->getPath() == orig->getPath());
+        REQUIRE(s->type == orig->type);
+        REQUIRE(s->Embedded);
+        REQUIRE(s->dataIsMapped);
+        REQUIRE(s->bitDepth == orig->bitDepth);
+        REQUIRE(s->channels == orig->channels);
+        REQUIRE(s->sample_length == orig->sample_length);
+        REQUIRE(s->sample_rate == orig->sample_rate);
+        auto chunk = *reader->getChunk('scsd');
+        for (int c = 0; c < s->channels; ++c)
+        {
+            // played in place, from a page boundary
+            REQUIRE((const char *)s->sampleData[c] >= chunk.data());
+            REQUIRE((const char *)s->sampleData[c] < chunk.data() + chunk.size());
+            REQUIRE((uintptr_t)s->sampleData[c] % patch_io::monolithDataAlignment == 0);
+            REQUIRE(memcmp(s->sampleData[c], orig->sampleData[c],
+                           s->channelDataSizeInBytes()) == 0);
+        }
+    }
+    REQUIRE(read[0]->meta.loop_present);
+    REQUIRE(read[0]->meta.loop_end == 900);
+    REQUIRE(read[0]->meta.key_root == 48);
+
+    // The patch restores them without the files being there
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    sm.provideEmbeddedSamples(read);
+    sm.restoreFromSampleAddressesAndIDs({{mono->id, mono->getSampleFileAddress()},
+                                         {stereo->id, stereo->getSampleFileAddress()}});
+    REQUIRE(sm.getSample(mono->id) == read[0]);
+    REQUIRE(sm.getSample(stereo->id) == read[1]);
+
+    // and the mapping outlives the reader while they play from it
+    auto weak = std::weak_ptr<patch_io::RIFFMappedReader>(reader);
+    reader.reset();
+    read.clear();
+    REQUIRE(!weak.expired());
+    REQUIRE(sm.getSample(stereo->id)->GetSamplePtrF32(1)[10] == Approx(-0.01f));
+    sm.reset();
+    REQUIRE(weak.expired());
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Part Stream Dirty Tracking", "[patch]")
+{
+    auto sg = engine::Engine::StreamGuard(engine::Engine::FOR_DAW);
+    engine::Part part(0);
+    auto gidx = part.addGroup() - 1;
+    auto &group = part.getGroup(gidx);
+    group->addZone(std::make_unique<engine::Zone>());
+    auto &zone = group->getZone(0);
+
+    auto g0 = part.getStreamGeneration();
+    auto s0 = tao::json::to_string(json::scxt_value(part));
+
+    SECTION("Unchanged Parts Stream The Same")
+    {
+        REQUIRE(part.getStreamGeneration() == g0);
+        REQUIRE(tao::json::to_string(json::scxt_value(part)) == s0);
+    }
+
+    SECTION("Zones And Groups Mark Their Part")
+    {
+        zone->mapping.rootKey = 72;
+        zone->markStreamDirty();
+        auto g1 = part.getStreamGeneration();
+        REQUIRE(g1 != g0);
+        REQUIRE(tao::json::to_string(json::scxt_value(part)) != s0);
+
+        group->name = "Renamed";
+        group->markStreamDirty();
+        REQUIRE(part.getStreamGeneration() != g1);
+    }
+
+    SECTION("Detached Zones Mark Nothing")
+    {
+        auto z = std::make_unique<engine::Zone>();
+        z->markStreamDirty();
+        REQUIRE(part.getStreamGeneration() == g0);
+    }
+}
+
+TEST_CASE("DAW Stream Cache", "[patch]")
+{
+    auto sg = engine::Engine::StreamGuard(engine::Engine::FOR_DAW);
+    engine::Patch patch;
+    auto &part = patch.getPart(1);
+    auto &group = part->getGroup(part->addGroup() - 1);
+    group->addZone(std::make_unique<engine::Zone>());
+    group->getZone(0)->mapping.rootKey = 72;
+    auto direct = tao::json::to_string(json::scxt_value(patch));
+
+    json::DAWStreamCache cache;
+    for (int i = 0; i < numParts; ++i)
+    {
+        const auto &p = patch.getPart(i);
+        cache.parts[i] = json::DAWStreamCache::PartEntry{
+            p->id, p->getStreamGeneration(), tao::json::msgpack::to_string(json::scxt_value(*p))};
+    }
+
+    SECTION("Parts From The Cache Stream The Same")
+    {
+        json::DAWStreamCacheGuard cg(cache);
+        REQUIRE(tao::json::to_string(json::scxt_value(patch)) == direct);
+    }
+
+    SECTION("The Cache Is What Streams")
+    {
+        group->getZone(0)->mapping.rootKey = 60;
+        {
+            json::DAWStreamCacheGuard cg(cache);
+            REQUIRE(tao::json::to_string(json::scxt_value(patch)) == direct);
+        }
+        REQUIRE(tao::json::to_string(json::scxt_value(patch)) != direct);
+    }
+
+    SECTION("Missing Entries Stream The Part")
+    {
+        cache.parts[1].reset();
+        json::DAWStreamCacheGuard cg(cache);
+        REQUIRE(tao::json::to_string(json::scxt_value(patch)) == direct);
+    }
+}
+
+TEST_CASE("Engine Event Walk", "[patch]")
+{
+    // Two parts of a few groups each, with something to tell every group and zone apart
+    engine::Part a(0), b(1);
+    for (auto *p : {&a, &b})
+    {
+        int pi = (p == &a) ? 0 : 1;
+        p->configuration.channel = 3 + pi;
+        p->macros[1].value = 0.25f * (pi + 1);
+        for (int g = 0; g < 2 + pi; ++g)
+        {
+            auto &group = p->getGroup(p->addGroup() - 1);
+            group->name = "Part " + std::to_string(pi) + " Group " + std::to_string(g);
+            group->outputInfo.amplitude = 0.1f * (g + 1);
+            for (int z = 0; z < g + 1; ++z)
+            {
+                group->addZone(std::make_unique<engine::Zone>());
+                group->getZone(z)->mapping.rootKey = 40 + 10 * g + z + pi;
+            }
+        }
+    }
+
+    auto requireSame = [](const engine::Part &orig, const engine::Part &read) {
+        REQUIRE(read.configuration.channel == orig.configuration.channel);
+        REQUIRE(read.macros[1].value == orig.macros[1].value);
+        REQUIRE(read.getGroups().size() == orig.getGroups().size());
+        for (size_t g = 0; g < orig.getGroups().size(); ++g)
+        {
+            auto &og = orig.getGroup(g);
+            auto &rg = read.getGroup(g);
+            REQUIRE(rg->name == og->name);
+            REQUIRE(rg->outputInfo.amplitude == og->outputInfo.amplitude);
+            REQUIRE(rg->getZones().size() == og->getZones().size());
+            for (size_t z = 0; z < og->getZones().size(); ++z)
+                REQUIRE(rg->getZone(z)->mapping.rootKey == og->getZone(z)->mapping.rootKey);
+        }
+    };
+
+    SECTION("Msgpack Round Trip")
+    {
+        auto msg = tao::json::msgpack::to_string(engineDocument({&a, &b}));
+
+        engine::Part ra(0), rb(1);
+        PartsSink sink{{&ra, &rb}};
+        walkEngine(sink, msg);
+
+        REQUIRE(sink.partIndex == 2);
+        REQUIRE(sink.engineMembers.size() == 2);
+        REQUIRE(sink.engineMembers.count("sampleManager"));
+        REQUIRE(sink.engineMembers.count("streamingVersion"));
+        requireSame(a, ra);
+        requireSame(b, rb);
+    }
+
+    SECTION("Saved As Events")
+    {
+        // What the ChildEventsGuard writes reads back the same, and is the same bytes
+        std::string msg;
+        {
+            json::ChildEventsGuard cg;
+            msg = tao::json::msgpack::to_string(engineDocument({&a, &b}));
+        }
+        REQUIRE(msg == tao::json::msgpack::to_string(engineDocument({&a, &b})));
+
+        engine::Part ra(0), rb(1);
+        PartsSink sink{{&ra, &rb}};
+        walkEngine(sink, msg);
+        requireSame(a, ra);
+        requireSame(b, rb);
+    }
+
+    SECTION("Members Streamed After The Children")
+    {
+        // Our writer sorts keys, so zones come last in a group; nothing should rely on it
+        tao::json::msgpack::events::to_string out;
+        out.begin_object(1);
+        out.key("patch");
+        out.begin_object(1);
+        out.key("parts");
+        out.begin_array(1);
+        out.begin_object(2);
+        out.key("groups");
+        out.begin_array(1);
+        out.begin_object(2);
+        out.key("zones");
+        out.begin_array(1);
+        tao::json::events::from_value(out, json::scxt_value(*a.getGroup(1)->getZone(1)));
+        out.element();
+        out.end_array(1);
+        out.member();
+        out.key("name");
+        out.string("Named Late");
+        out.member();
+        out.end_object(2);
+        out.element();
+        out.end_array(1);
+        out.member();
+        out.key("config");
+        tao::json::events::from_value(out, json::scxt_value(a.configuration));
+        out.member();
+        out.end_object(2);
+        out.element();
+        out.end_array(1);
+        out.member();
+        out.end_object(1);
+        out.member();
+        out.end_object(1);
+        auto msg = out.value();
+
+        engine::Part ra(0);
+        PartsSink sink{{&ra}};
+        walkEngine(sink, msg);
+        REQUIRE(ra.configuration.channel == a.configuration.channel);
+        REQUIRE(ra.getGroups().size() == 1);
+        REQUIRE(ra.getGroup(0)->name == "Named Late");
+        REQUIRE(ra.getGroup(0)->getZones().size() == 1);
+        REQUIRE(ra.getGroup(0)->getZone(0)->mapping.rootKey ==
+                a.getGroup(1)->getZone(1)->mapping.rootKey);
+    }
+
+    SECTION("Malformed Streams Throw")
+    {
+        json::scxt_value patch = {{"parts", 7}};
+        json::scxt_value doc = {{"patch", patch}};
+        auto msg = tao::json::msgpack::to_string(doc);
+
+        engine::Part ra(0);
+        PartsSink sink{{&ra}};
+        REQUIRE_THROWS_AS(walkEngine(sink, msg), SCXTError);
+    }
+}
+
+TEST_CASE("Patch Streaming Benchmark", "[.][bench]")
+{
+    // A multi of one 10k zone part saved and read back the way we used to (msgpack into a
+    // string, copied into a chunk, parsed to a value), as a value streamed to the file and
+    // parsed in place, and as events: each child made only as it is written, and walked a zone
+    // at a time as it is read. With the time each took and how far it pushed up the peak
+    // resident set.
+    auto dir = fs::temp_directory_path() / "scxt-test-patch-bench";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    engine::Part part(0);
+    for (int g = 0; g < 10; ++g)
+    {
+        auto idx = part.addGroup() - 1;
+        for (int z = 0; z < 1000; ++z)
+            part.getGroup(idx)->addZone(std::make_unique<engine::Zone>());
+    }
+
+    auto ms = [](auto a, auto b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    auto parse = [](const char *d, size_t sz) {
+        tao::json::events::transformer<tao::json::events::to_basic_value<json::scxt_traits>>
+            consumer;
+        tao::json::msgpack::events::from_string(consumer, d, sz);
+        return std::move(consumer.value);
+    };
+    using clock = std::chrono::high_resolution_clock;
+
+    // The smaller peaks go first, since memory the allocator holds on to from a bigger one
+    // would hide what a later run needs
+    int64_t eventSaveKB, valueSaveKB, stringSaveKB;
+    auto t0 = clock::now();
+    {
+        PeakResidentGrowth peak;
+        patch_io::RIFFStreamWriter w(dir / "events.scm", 'SCXT');
+        w.addChunk('scdt', [&part](std::ostream &os) {
+            json::ChildEventsGuard cg;
+            tao::json::msgpack::to_stream(os, engineDocument({&part}));
+        });
+        REQUIRE(w.finish());
+        eventSaveKB = peak.growthKB();
+    }
+    auto t1 = clock::now();
+    {
+        PeakResidentGrowth peak;
+        patch_io::RIFFStreamWriter w(dir / "value.scm", 'SCXT');
+        auto v = engineDocument({&part});
+        w.addChunk('scdt', [&v](std::ostream &os) { tao::json::msgpack::to_stream(os, v); });
+        REQUIRE(w.finish());
+        valueSaveKB = peak.growthKB();
+    }
+    auto t2 = clock::now();
+    size_t msgpackBytes{0};
+    {
+        PeakResidentGrowth peak;
+        auto msg = tao::json::msgpack::to_string(engineDocument({&part}));
+        auto f = std::make_unique<RIFF::File>('SCXT');
+        f->SetByteOrder(RIFF::endian_little);
+        auto c = f->AddSubChunk('scdt', msg.size());
+        memcpy(c->LoadChunkData(), msg.data(), msg.size());
+        f->Save((dir / "string.scm").u8string());
+        msgpackBytes = msg.size();
+        stringSaveKB = peak.growthKB();
+    }
+    auto t3 = clock::now();
+
+    REQUIRE(fileContents(dir / "events.scm") == fileContents(dir / "value.scm"));
+    REQUIRE(fileContents(dir / "string.scm") == fileContents(dir / "value.scm"));
+
+    int64_t walkLoadKB, mapLoadKB, stringLoadKB;
+    engine::Part walked(0);
+    json::scxt_value fromString, fromMap;
+    auto t4 = clock::now();
+    {
+        PeakResidentGrowth peak;
+        patch_io::RIFFMappedReader r(dir / "events.scm");
+        auto c = r.getChunk('scdt');
+        REQUIRE(c.has_value());
+        PartsSink sink{{&walked}};
+        walkEngine(sink, *c);
+        walkLoadKB = peak.growthKB();
+    }
+    auto t5 = clock::now();
+    {
+        PeakResidentGrowth peak;
+        patch_io::RIFFMappedReader r(dir / "value.scm");
+        auto c = r.getChunk('scdt');
+        REQUIRE(c.has_value());
+        fromMap = parse(c->data(), c->size());
+        mapLoadKB = peak.growthKB();
+    }
+    auto t6 = clock::now();
+    {
+        PeakResidentGrowth peak;
+        auto f = std::make_unique<RIFF::File>((dir / "string.scm").u8string());
+        auto c = f->GetSubChunk('scdt');
+        auto payload = std::string((char *)c->LoadChunkData(), c->GetSize());
+        fromString = parse(payload.data(), payload.size());
+        stringLoadKB = peak.growthKB();
+    }
+    auto t7 = clock::now();
+
+    REQUIRE(fromString == fromMap);
+    REQUIRE(walked.getGroups().size() == 10);
+    REQUIRE(walked.getGroup(9)->getZones().size() == 1000);
+
+    INFO("10k zone multi is " << msgpackBytes << " bytes of msgpack; peaks are KiB above the "
+                              << "resident set at the start, or -1 where we can't tell");
+    INFO("event save " << ms(t0, t1) << "ms peak " << eventSaveKB << "; value save "
+                       << ms(t1, t2) << "ms peak " << valueSaveKB << "; string save "
+                       << ms(t2, t3) << "ms peak " << stringSaveKB);
+    INFO("walked load " << ms(t4, t5) << "ms peak " << walkLoadKB << "; mapped value load "
+                        << ms(t5, t6) << "ms peak " << mapLoadKB << "; string load "
+                        << ms(t6, t7) << "ms peak " << stringLoadKB);
+    WARN("patch streaming benchmark done");
+
+    fs::remove_all(dir);
+}
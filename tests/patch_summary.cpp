@@ -0,0 +1,182 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "RIFF.h" // from libgig
+#include "browser/browser_db.h"
+#include "patch_io/patch_summary.h"
+
+#include "tao/json/from_string.hpp"
+#include "tao/json/msgpack/to_string.hpp"
+
+#include <cstring>
+#include <fstream>
+
+using namespace scxt;
+
+namespace
+{
+// A patch file as patch_io lays it out, with a stand in for the patch data we never read
+void writeTestPatch(const fs::path &p, const std::string &type, const std::string &summary,
+                    const std::string &data = "not streamed")
+{
+    auto f = std::make_unique<RIFF::File>('SCXT');
+    f->SetByteOrder(RIFF::endian_little);
+    auto add = [&f](uint32_t id, const std::string &s) {
+        auto c = f->AddSubChunk(id, s.size());
+        memcpy(c->LoadChunkData(), s.data(), s.size());
+    };
+    add('scmf', "{\"type\":\"" + type + "\",\"version\":\"1\"}");
+    if (!summary.empty())
+        add('scsm', summary);
+    add('scdt', data);
+    f->Save(p.u8string());
+}
+
+const std::string md5a{"0123456789abcdef0123456789abcdef"};
+const std::string md5b{"fedcba9876543210fedcba9876543210"};
+} // namespace
+
+TEST_CASE("Patch Summary", "[patch]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-patch-summary";
+    auto dbDir = fs::temp_directory_path() / "scxt-test-patch-summary-db";
+    fs::remove_all(dir);
+    fs::remove_all(dbDir);
+    fs::create_directories(dir / "sub");
+    fs::create_directories(dbDir);
+
+    writeTestPatch(dir / "kit.scm", "multi",
+                   "{\"version\":1,\"partNames\":[\"Drums\",\"Bass\"],\"zoneCount\":12,"
+                   "\"sampleIDs\":[{\"m\":\"" +
+                       md5a + "\",\"a\":[-1,-1,-1],\"p\":17},{\"m\":\"" + md5b +
+                       "\",\"a\":[0,2,4],\"p\":9}],\"sampleBytes\":123456}");
+    writeTestPatch(dir / "sub" / "lead.scp", "part",
+                   "{\"version\":1,\"partNames\":[\"Lead\"],\"zoneCount\":1,"
+                   "\"sampleIDs\":[{\"m\":\"" +
+                       md5a + "\",\"a\":[-1,-1,-1],\"p\":17}],\"sampleBytes\":2048}");
+    writeTestPatch(dir / "old.scp", "part", "");
+
+    SECTION("Reads Without The Patch")
+    {
+        auto s = patch_io::readPatchSummary(dir / "kit.scm");
+        REQUIRE(s.has_value());
+        REQUIRE(s->type == "multi");
+        REQUIRE(s->partNames == std::vector<std::string>{"Drums", "Bass"});
+        REQUIRE(s->zoneCount == 12);
+        REQUIRE(s->sampleBytes == 123456);
+        REQUIRE(s->sampleIDs.size() == 2);
+        REQUIRE(s->sampleIDs[0].getMD5() == md5a);
+        REQUIRE(s->sampleIDs[1].getMultiAddress()[2] == 4);
+
+        auto old = patch_io::readPatchSummary(dir / "old.scp");
+        REQUIRE(old.has_value());
+        REQUIRE(old->type == "part");
+        REQUIRE(old->zoneCount == -1);
+        REQUIRE(old->sampleIDs.empty());
+
+        {
+            std::ofstream o(dir / "broken.scp");
+            o << "not a riff file";
+        }
+        REQUIRE(!patch_io::readPatchSummary(dir / "broken.scp").has_value());
+    }
+
+    SECTION("Worked Out From Legacy Patch Data")
+    {
+        auto sid = [](const std::string &md5) {
+            return "{\"m\":\"" + md5 + "\",\"a\":[-1,-1,-1],\"p\":17}";
+        };
+        auto zone = [&sid](const std::string &md5, const std::string &key) {
+            return "{\"mappingData\":{\"rootKey\":60},\"" + key +
+                   "\":{\"variants\":[{\"active\":true,\"id\":" + sid(md5) +
+                   "},{\"active\":false}]}}";
+        };
+        auto part = "{\"config\":{\"c\":2},\"groups\":[{\"name\":\"g\",\"zones\":[" +
+                    zone(md5a, "variantData") + "," + zone(md5b, "sampleData") + "," +
+                    zone(md5a, "variantData") + "]}]}";
+        auto msgpack = [](const std::string &json) {
+            return tao::json::msgpack::to_string(tao::json::from_string(json));
+        };
+
+        writeTestPatch(dir / "legacy.scp", "part", "", msgpack(part));
+        writeTestPatch(dir / "legacy.scm", "multi", "",
+                       msgpack("{\"patch\":{\"busses\":{},\"parts\":[{\"config\":{},"
+                               "\"groups\":[]}," +
+                               part + "]},\"sampleManager\":{}}"));
+
+        for (auto f : {"legacy.scp", "legacy.scm"})
+        {
+            INFO(f);
+            auto s = patch_io::readPatchSummary(dir / f);
+            REQUIRE(s.has_value());
+            REQUIRE(s->partNames == std::vector<std::string>{"Part ch=3"});
+            REQUIRE(s->zoneCount == 3);
+            REQUIRE(s->sampleBytes == -1);
+            REQUIRE(s->sampleIDs.size() == 2);
+            REQUIRE(s->sampleIDs[0].getMD5() == md5a);
+            REQUIRE(s->sampleIDs[1].getMD5() == md5b);
+        }
+        fs::remove(dir / "legacy.scp");
+        fs::remove(dir / "legacy.scm");
+    }
+
+    SECTION("Catalogued By The Browser")
+    {
+        browser::BrowserDB db(dbDir);
+        db.crawl(dir);
+        REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+
+        auto all = db.getPatchSummaries(dir);
+        REQUIRE(all.size() == 3);
+        REQUIRE(all[0].path == dir / "kit.scm");
+        REQUIRE(all[0].partNames == std::vector<std::string>{"Drums", "Bass"});
+        REQUIRE(all[0].sampleBytes == 123456);
+        REQUIRE(all[0].sampleIDs.size() == 2);
+        REQUIRE(all[0].sampleIDs[1].getMD5() == md5b);
+        REQUIRE(all[0].sampleIDs[1].getPathHash() == 9);
+        REQUIRE(all[1].path == dir / "old.scp");
+        REQUIRE(all[1].zoneCount == -1);
+        REQUIRE(all[2].path == dir / "sub" / "lead.scp");
+        REQUIRE(db.getPatchSummaries(dir / "sub").size() == 1);
+
+        SampleID id;
+        id.setAsMD5(md5a);
+        REQUIRE(db.getPatchesUsingSample(id).size() == 2);
+        id.setAsMD5(md5b);
+        REQUIRE(db.getPatchesUsingSample(id).size() == 1);
+
+        fs::remove(dir / "kit.scm");
+        db.crawl(dir);
+        REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+        REQUIRE(db.getPatchSummaries(dir).size() == 2);
+        REQUIRE(db.getPatchesUsingSample(id).empty());
+    }
+
+    fs::remove_all(dir);
+    fs::remove_all(dbDir);
+}
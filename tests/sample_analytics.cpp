@@ -27,8 +27,10 @@
 
 #include "catch2/catch2.hpp"
 #include "dsp/sample_analytics.h"
+#include <chrono>
 #include <limits>
 #include <cmath>
+#include <vector>
 
 using namespace scxt;
 
@@ -114,3 +116,131 @@ TEST_CASE("Sample Analytics", "[sample]")
                      Catch::WithinRel(saw_rms, tolerance));
     }
 }
+
+namespace
+{
+std::shared_ptr<sample::Sample> makeSineSample(float amp, float freq, float dc, size_t len,
+                                               int channels = 1, uint32_t rate = 48000)
+{
+    auto s = std::make_shared<sample::Sample>();
+    std::vector<float> buffer(len);
+    for (size_t i = 0; i < len; ++i)
+        buffer[i] = dc + amp * std::sin(2.0 * M_PI * freq * i / rate);
+    for (int c = 0; c < channels; ++c)
+    {
+        s->allocateF32(c, len);
+        s->load_data_f32(c, buffer.data(), len, sizeof(float));
+    }
+    s->sample_length = len;
+    s->channels = channels;
+    s->sample_rate = rate;
+    s->sample_loaded = true;
+    return s;
+}
+} // namespace
+
+TEST_CASE("Sample Analytics DC And Loudness", "[sample]")
+{
+    SECTION("DC Offset")
+    {
+        auto s = makeSineSample(0.4f, 1000.f, 0.1f, 48000);
+        REQUIRE_THAT(dsp::sample_analytics::computeDCOffset(s), Catch::WithinAbs(0.1f, 1e-4));
+    }
+
+    SECTION("Integrated Loudness")
+    {
+        // BS.1770 is calibrated so a 1kHz sine at -20 dBFS in one channel reads -23 LUFS
+        // (the -0.691 offset cancels the K weighting gain at 1k), and 3 dB more in stereo
+        auto amp = std::pow(10.f, -20.f / 20.f);
+        auto mono = makeSineSample(amp, 997.f, 0.f, 48000 * 2);
+        auto monoL = dsp::sample_analytics::computeIntegratedLoudness(mono);
+        REQUIRE_THAT(monoL, Catch::WithinAbs(-23.0, 0.1));
+
+        auto stereo = makeSineSample(amp, 997.f, 0.f, 48000 * 2, 2);
+        REQUIRE_THAT(dsp::sample_analytics::computeIntegratedLoudness(stereo),
+                     Catch::WithinAbs(monoL + 3.01, 0.05));
+
+        // and the absolute gate stops silence from reading anything but the floor
+        auto silent = makeSineSample(0.f, 997.f, 0.f, 48000);
+        REQUIRE(dsp::sample_analytics::computeIntegratedLoudness(silent) == -70.f);
+
+        // Shorter than a gating block is measured as one block
+        auto shortS = makeSineSample(amp, 997.f, 0.f, 4800);
+        REQUIRE_THAT(dsp::sample_analytics::computeIntegratedLoudness(shortS),
+                     Catch::WithinAbs(monoL, 0.2));
+    }
+
+    SECTION("Analytics are cached and dropped on reallocation")
+    {
+        auto s = makeSineSample(0.5f, 440.f, 0.f, 4096);
+        REQUIRE(!s->getCachedAnalytics());
+        REQUIRE_THAT(dsp::sample_analytics::computePeak(s), Catch::WithinRel(0.5f, 1e-3f));
+        auto cached = s->getCachedAnalytics();
+        REQUIRE(cached);
+        dsp::sample_analytics::computeRMS(s);
+        REQUIRE(s->getCachedAnalytics() == cached);
+
+        std::vector<float> quieter(4096, 0.25f);
+        s->allocateF32(0, quieter.size());
+        REQUIRE(!s->getCachedAnalytics());
+        s->load_data_f32(0, quieter.data(), quieter.size(), sizeof(float));
+        REQUIRE(dsp::sample_analytics::computePeak(s) == 0.25f);
+    }
+
+    SECTION("Batch analysis matches single analysis")
+    {
+        std::vector<std::shared_ptr<sample::Sample>> batch, single;
+        for (int i = 0; i < 9; ++i)
+        {
+            auto amp = 0.1f + 0.08f * i;
+            batch.push_back(makeSineSample(amp, 200.f + 50 * i, 0.01f * i, 20000 + 777 * i,
+                                           1 + (i % 2)));
+            single.push_back(makeSineSample(amp, 200.f + 50 * i, 0.01f * i, 20000 + 777 * i,
+                                            1 + (i % 2)));
+        }
+        batch.push_back(batch[3]);
+        batch.push_back(nullptr);
+
+        dsp::sample_analytics::analyseSamples(batch, 4);
+        for (int i = 0; i < 9; ++i)
+        {
+            REQUIRE(batch[i]->getCachedAnalytics());
+            auto b = *batch[i]->getCachedAnalytics();
+            auto s = dsp::sample_analytics::computeAnalytics(*single[i]);
+            REQUIRE(b.peak == s.peak);
+            REQUIRE(b.rms == s.rms);
+            REQUIRE(b.dcOffset == s.dcOffset);
+            REQUIRE(b.integratedLoudness == s.integratedLoudness);
+        }
+    }
+}
+
+TEST_CASE("Sample Analytics Benchmark", "[.][bench]")
+{
+    // Compare one uncached analysis pass against the cached reads normalisation now does,
+    // and the batch analysis against a serial one.
+    std::vector<std::shared_ptr<sample::Sample>> batch;
+    for (int i = 0; i < 32; ++i)
+        batch.push_back(makeSineSample(0.5f, 440.f + i, 0.f, 48000 * 10, 2));
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (auto &s : batch)
+        dsp::sample_analytics::computeAnalytics(*s);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    dsp::sample_analytics::analyseSamples(batch);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    float sum{0};
+    for (int k = 0; k < 100; ++k)
+        for (auto &s : batch)
+            sum += dsp::sample_analytics::computePeak(s) + dsp::sample_analytics::computeRMS(s);
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    auto ms = [](auto a, auto b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    auto secs = 32 * 10 * 2;
+    INFO("serial pass " << ms(t0, t1) << "ms (" << secs / ms(t0, t1) * 1000 << "x realtime)");
+    INFO("batch pass " << ms(t1, t2) << "ms");
+    INFO("3200 cached reads " << ms(t2, t3) << "ms " << sum);
+    WARN("analytics benchmark done");
+}
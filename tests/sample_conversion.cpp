@@ -0,0 +1,221 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "dsp/sample_conversion.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace scxt;
+namespace conv = scxt::dsp::sample_conversion;
+
+namespace
+{
+std::vector<uint8_t> randomBytes(size_t n, int seed = 23)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> d(0, 255);
+    std::vector<uint8_t> res(n);
+    for (auto &b : res)
+        b = (uint8_t)d(gen);
+    return res;
+}
+
+// The straightforward byte-at-a-time decode we compare the kernels against
+int64_t readInt(const uint8_t *p, int bytes, bool bigEndian)
+{
+    int64_t v{0};
+    for (int b = 0; b < bytes; ++b)
+        v |= (int64_t)p[bigEndian ? bytes - 1 - b : b] << (8 * b);
+    auto sign = (int64_t)1 << (8 * bytes - 1);
+    return (v ^ sign) - sign;
+}
+} // namespace
+
+TEST_CASE("Sample Format Conversion", "[sample]")
+{
+    for (size_t n : {0, 1, 7, 16, 37, 1001})
+    {
+        for (int channels : {1, 2})
+        {
+            for (int channel = 0; channel < channels; ++channel)
+            {
+                DYNAMIC_SECTION("n=" << n << " channels=" << channels << " ch=" << channel)
+                {
+                    auto raw = randomBytes(n * channels * 8 + 1);
+                    for (bool be : {false, true})
+                    {
+                        INFO("Big Endian " << be);
+
+                        std::vector<int16_t> i16(n + 1, 77);
+                        size_t stride = channels * 2;
+                        conv::i16ToI16(raw.data() + channel * 2, stride, i16.data(), n, be);
+                        for (size_t i = 0; i < n; ++i)
+                            REQUIRE(i16[i] == readInt(&raw[i * stride + channel * 2], 2, be));
+                        REQUIRE(i16[n] == 77);
+
+                        std::vector<dsp::PackedInt24> i24(n + 1, dsp::PackedInt24::fromInt32(77));
+                        stride = channels * 3;
+                        conv::i24ToI24(raw.data() + channel * 3, stride, i24.data(), n, be);
+                        for (size_t i = 0; i < n; ++i)
+                            REQUIRE(i24[i].toInt32() ==
+                                    readInt(&raw[i * stride + channel * 3], 3, be));
+                        REQUIRE(i24[n].toInt32() == 77);
+
+                        std::vector<float> f(n + 1, 77.f);
+                        stride = channels * 4;
+                        conv::i32ToF32(raw.data() + channel * 4, stride, f.data(), n, be);
+                        for (size_t i = 0; i < n; ++i)
+                            REQUIRE(f[i] == (float)readInt(&raw[i * stride + channel * 4], 4, be) *
+                                                4.6566128730772E-10f);
+                        REQUIRE(f[n] == 77.f);
+                    }
+
+                    for (bool isUnsigned : {false, true})
+                    {
+                        std::vector<int16_t> i16(n + 1, 77);
+                        conv::i8ToI16(raw.data() + channel, channels, i16.data(), n, isUnsigned);
+                        for (size_t i = 0; i < n; ++i)
+                        {
+                            auto b = raw[i * channels + channel];
+                            auto expected = isUnsigned ? (b - 128) * 256 : (int8_t)b * 256;
+                            REQUIRE(i16[i] == expected);
+                        }
+                        REQUIRE(i16[n] == 77);
+                    }
+
+                    std::vector<float> fsrc(n * channels);
+                    std::vector<double> dsrc(n * channels);
+                    for (size_t i = 0; i < fsrc.size(); ++i)
+                    {
+                        fsrc[i] = (float)readInt(&raw[i * 2], 2, false) / 32768.f;
+                        dsrc[i] = fsrc[i] * 1.0000001;
+                    }
+                    std::vector<float> f(n + 1, 77.f), d(n + 1, 77.f);
+                    conv::f32ToF32(fsrc.data() + channel, channels * 4, f.data(), n);
+                    conv::f64ToF32(dsrc.data() + channel, channels * 8, d.data(), n);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        REQUIRE(f[i] == fsrc[i * channels + channel]);
+                        REQUIRE(d[i] == (float)dsrc[i * channels + channel]);
+                    }
+                    REQUIRE(f[n] == 77.f);
+                    REQUIRE(d[n] == 77.f);
+                }
+            }
+        }
+
+        DYNAMIC_SECTION("Planar n=" << n)
+        {
+            std::vector<int32_t> src(n);
+            std::mt19937 gen(n);
+            std::uniform_int_distribution<int32_t> d(-8388608, 8388607);
+            for (auto &v : src)
+                v = d(gen);
+
+            std::vector<dsp::PackedInt24> i24(n + 1, dsp::PackedInt24::fromInt32(77));
+            conv::planarI32ToI24(src.data(), i24.data(), n);
+            for (size_t i = 0; i < n; ++i)
+                REQUIRE(i24[i].toInt32() == src[i]);
+            REQUIRE(i24[n].toInt32() == 77);
+
+            std::vector<float> f(n + 1, 77.f);
+            conv::planarI32ToF32(src.data(), f.data(), n, 24);
+            for (size_t i = 0; i < n; ++i)
+                REQUIRE(f[i] == src[i] * (1.f / 8388608.f));
+            REQUIRE(f[n] == 77.f);
+
+            for (auto &v : src)
+                v >>= 8;
+            std::vector<int16_t> i16(n + 1, 77);
+            conv::planarI32ToI16(src.data(), i16.data(), n);
+            for (size_t i = 0; i < n; ++i)
+                REQUIRE(i16[i] == src[i]);
+            REQUIRE(i16[n] == 77);
+        }
+    }
+}
+
+TEST_CASE("Sample Format Conversion Benchmark", "[.][bench]")
+{
+    // Hidden; run with `scxt-test "[bench]"`. Reports the rate each loader kernel
+    // consumes source data for a stereo file, to compare against a plain memcpy.
+    static constexpr size_t frames{8 * 1024 * 1024};
+    auto raw = randomBytes(frames * 2 * 8 + 64);
+    std::vector<uint8_t> out(frames * 4 + 64);
+
+    using clock_t = std::chrono::high_resolution_clock;
+    auto report = [](const std::string &name, size_t srcBytes, auto op) {
+        op(); // warm the pages
+        auto s0 = clock_t::now();
+        static constexpr int reps{5};
+        for (int r = 0; r < reps; ++r)
+            op();
+        auto secs = std::chrono::duration<double>(clock_t::now() - s0).count() / reps;
+        std::cout << "   " << name << " : " << (srcBytes / secs / (1024 * 1024 * 1024))
+                  << " GB/s" << std::endl;
+    };
+
+    std::cout << "Stereo source conversion rates (" << frames << " frames)" << std::endl;
+    report("memcpy (reference)", frames * 4,
+           [&]() { memcpy(out.data(), raw.data(), frames * 4); });
+
+    // Convert both channels of an interleaved stereo buffer of sampleBytes wide samples
+    auto stereo = [&](const std::string &name, size_t sampleBytes, auto op) {
+        report(name, frames * 2 * sampleBytes, [&]() {
+            op(raw.data(), 2 * sampleBytes);
+            op(raw.data() + sampleBytes, 2 * sampleBytes);
+        });
+    };
+    auto *i16 = (int16_t *)out.data();
+    auto *i24 = (dsp::PackedInt24 *)out.data();
+    auto *f32 = (float *)out.data();
+    stereo("ui8   -> i16", 1,
+           [&](auto *s, size_t st) { conv::i8ToI16(s, st, i16, frames, true); });
+    stereo("i16   -> i16", 2,
+           [&](auto *s, size_t st) { conv::i16ToI16(s, st, i16, frames, false); });
+    stereo("i16BE -> i16", 2,
+           [&](auto *s, size_t st) { conv::i16ToI16(s, st, i16, frames, true); });
+    stereo("i24   -> i24", 3,
+           [&](auto *s, size_t st) { conv::i24ToI24(s, st, i24, frames, false); });
+    stereo("i24BE -> i24", 3,
+           [&](auto *s, size_t st) { conv::i24ToI24(s, st, i24, frames, true); });
+    stereo("i32   -> f32", 4,
+           [&](auto *s, size_t st) { conv::i32ToF32(s, st, f32, frames, false); });
+    stereo("i32BE -> f32", 4,
+           [&](auto *s, size_t st) { conv::i32ToF32(s, st, f32, frames, true); });
+    stereo("f32   -> f32", 4, [&](auto *s, size_t st) { conv::f32ToF32(s, st, f32, frames); });
+    stereo("f64   -> f32", 8, [&](auto *s, size_t st) { conv::f64ToF32(s, st, f32, frames); });
+    report("planar i32 -> i24", frames * 8, [&]() {
+        conv::planarI32ToI24((const int32_t *)raw.data(), i24, frames);
+        conv::planarI32ToI24((const int32_t *)raw.data() + frames, i24, frames);
+    });
+}
@@ -0,0 +1,1238 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "infrastructure/bulk_file_reader.h"
+#include "infrastructure/file_map_view.h"
+#include "infrastructure/resident_memory.h"
+#include "sample/sample_manager.h"
+#include "sample/shared_sample_store.h"
+#include "sample/loaders/pcm_header.h"
+#include "sample/waveform_pyramid.h"
+#include "browser/browser_db.h"
+#include "dsp/generator.h"
+#include "dsp/sample_analytics.h"
+#include "dsp/loop_splice.h"
+#include "dsp/resampling.h"
+
+#include "test_sample_files.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <thread>
+
+using namespace scxt;
+using namespace scxt::test;
+
+namespace
+{
+// A float copy of a packed 24 bit sample, which is what we used to load 24 bit files as
+std::shared_ptr<sample::Sample> widenToF32(const sample::Sample &s)
+{
+    auto res = std::make_shared<sample::Sample>();
+    res->SetMeta(s.channels, s.sample_rate, s.sample_length);
+    for (int c = 0; c < s.channels; ++c)
+    {
+        res->allocateF32(c, s.sample_length);
+        auto *src = const_cast<sample::Sample &>(s).GetSamplePtrI24(c);
+        auto *dst = res->GetSamplePtrF32(c);
+        for (uint32_t i = 0; i < s.sample_length; ++i)
+            dst[i] = src[i].toInt32() * dsp::I24InvScale;
+    }
+    return res;
+}
+
+// Run the generator to completion (or maxBlocks) and return the left channel
+std::vector<float> renderGenerator(sample::Sample &s, dsp::GeneratorSampleFormat fmt,
+                                   dsp::InterpolationTypes interp, bool loop,
+                                   int maxBlocks = 1 << 30, int loopFade = 200,
+                                   const dsp::LoopSplice *splice = nullptr)
+{
+    dsp::GeneratorState GD;
+    GD.ratio = (int32_t)((1 << 24) * 0.731);
+    GD.direction = 1;
+    GD.isFinished = false;
+    GD.playbackUpperBound = s.sample_length - 1;
+    GD.interpolationType = interp;
+    if (loop)
+    {
+        GD.loopLowerBound = s.sample_length / 4;
+        GD.loopUpperBound = s.sample_length - 1;
+        GD.loopFade = loopFade;
+        GD.gated = true;
+    }
+    else
+    {
+        GD.loopUpperBound = GD.playbackUpperBound;
+    }
+
+    float outL[scxt::blockSize], outR[scxt::blockSize];
+    dsp::GeneratorIO IO;
+    IO.outputL = outL;
+    IO.outputR = outR;
+    IO.waveSize = s.sample_length;
+    IO.loopSplice = splice;
+    for (int c = 0; c < s.channels; ++c)
+    {
+        void *d = (fmt == dsp::SF_I24) ? (void *)s.GetSamplePtrI24(c) : (void *)s.GetSamplePtrF32(c);
+        (c == 0 ? IO.sampleDataL : IO.sampleDataR) = d;
+    }
+
+    auto gen = dsp::GetFPtrGeneratorSample(s.channels == 2, fmt, loop, true, false);
+    std::vector<float> res;
+    for (int b = 0; b < maxBlocks && !GD.isFinished; ++b)
+    {
+        gen(&GD, &IO);
+        res.insert(res.end(), outL, outL + scxt::blockSize);
+    }
+    return res;
+}
+} // namespace
+
+TEST_CASE("Bulk File Reader", "[sample]")
+{
+    TempSampleDir td("scxt-test-bulk-read", 24, 4096);
+
+    SECTION("Reads Every File Once")
+    {
+        auto paths = td.files;
+        paths.push_back(td.dir / "not_there.wav");
+
+        std::set<size_t> seen;
+        infrastructure::BulkFileReader::Options opt;
+        opt.queueDepth = 4;
+        opt.maxBytesInFlight = 32 * 1024; // smaller than the batch so we exercise the stall
+        infrastructure::BulkFileReader::readAll(
+            paths,
+            [&](auto &r) {
+                REQUIRE(seen.find(r.index) == seen.end());
+                seen.insert(r.index);
+                REQUIRE(r.path == paths[r.index]);
+                if (r.index == paths.size() - 1)
+                {
+                    REQUIRE(!r.isValid);
+                }
+                else
+                {
+                    REQUIRE(r.isValid);
+                    REQUIRE(r.dataSize == fs::file_size(r.path));
+                    REQUIRE(std::string((const char *)r.data.get(), 4) == "RIFF");
+                }
+            },
+            opt);
+        REQUIRE(seen.size() == paths.size());
+    }
+
+    SECTION("Batch Load Matches Single Load")
+    {
+        ThreadingChecker tc;
+        sample::SampleManager single(tc);
+        sample::SampleManager bulk(tc);
+
+        auto paths = td.files;
+        paths.push_back(td.files[3]); // duplicates resolve to the same sample
+        auto res = bulk.loadSamplesByPath(paths);
+        REQUIRE(res.size() == paths.size());
+
+        for (size_t i = 0; i < td.files.size(); ++i)
+        {
+            auto sid = single.loadSampleByPath(td.files[i]);
+            REQUIRE(sid.has_value());
+            REQUIRE(res[i].has_value());
+            REQUIRE(*res[i] == *sid);
+
+            auto a = single.getSample(*sid);
+            auto b = bulk.getSample(*res[i]);
+            REQUIRE(a->sample_length == b->sample_length);
+            REQUIRE(a->channels == b->channels);
+            REQUIRE(memcmp(a->GetSamplePtrI16(0), b->GetSamplePtrI16(0),
+                           a->sample_length * sizeof(int16_t)) == 0);
+        }
+        REQUIRE(*res.back() == *res[3]);
+        REQUIRE(single.sampleMemoryInBytes == bulk.sampleMemoryInBytes);
+    }
+}
+
+TEST_CASE("Sample Content Sharing", "[sample]")
+{
+    TempSampleDir td("scxt-test-content-share", 2, 4096);
+    auto copyDir = td.dir / "copies";
+    fs::create_directories(copyDir);
+    auto copyPath = copyDir / "same_as_zero.wav";
+    fs::copy_file(td.files[0], copyPath);
+
+    ThreadingChecker tc;
+
+    SECTION("Single Loads Share")
+    {
+        sample::SampleManager sm(tc);
+        auto a = sm.loadSampleByPath(td.files[0]);
+        REQUIRE(a.has_value());
+        auto memOne = sm.sampleMemoryInBytes.load();
+
+        auto b = sm.loadSampleByPath(copyPath);
+        REQUIRE(b.has_value());
+        REQUIRE(*a != *b);
+        REQUIRE(a->sameMD5As(*b));
+
+        auto sa = sm.getSample(*a);
+        auto sb = sm.getSample(*b);
+        REQUIRE(sa->getPath() == td.files[0]);
+        REQUIRE(sb->getPath() == copyPath);
+        REQUIRE(sa->sampleData[0] == sb->sampleData[0]);
+        REQUIRE(sm.sampleMemoryInBytes == memOne);
+
+        // Different content is not shared
+        auto c = sm.loadSampleByPath(td.files[1]);
+        REQUIRE(sm.getSample(*c)->sampleData[0] != sa->sampleData[0]);
+        REQUIRE(sm.sampleMemoryInBytes > memOne);
+
+        // and the data outlives the sample it was first loaded by
+        auto keepB = sb;
+        sa.reset();
+        sb.reset();
+        sm.purgeUnreferencedSamples();
+        REQUIRE(!sm.getSample(*a));
+        REQUIRE(sm.getSample(*b) == keepB);
+        REQUIRE(keepB->GetSamplePtrI16(0)[10] != 0);
+    }
+
+    SECTION("Bulk Loads Share")
+    {
+        sample::SampleManager sm(tc);
+        auto res = sm.loadSamplesByPath({td.files[0], copyPath, td.files[1]});
+        REQUIRE(res[0].has_value());
+        REQUIRE(res[1].has_value());
+        REQUIRE(sm.getSample(*res[0])->sampleData[0] == sm.getSample(*res[1])->sampleData[0]);
+
+        sample::SampleManager unshared(tc);
+        unshared.loadSamplesByPath({td.files[0], td.files[1]});
+        REQUIRE(sm.sampleMemoryInBytes == unshared.sampleMemoryInBytes);
+    }
+}
+
+TEST_CASE("Binary SampleID", "[sample]")
+{
+    auto hex = std::string("d41d8cd98f00b204e9800998ecf8427e");
+
+    SECTION("Hex Round Trips")
+    {
+        SampleID a;
+        a.setAsMD5(hex);
+        REQUIRE(a.isValid());
+        REQUIRE(a.getMD5() == hex);
+        REQUIRE(a.to_string() == "SampleID:" + hex + "-0000000000000000");
+    }
+
+    SECTION("Text Ids Keep Their Text")
+    {
+        SampleID inv, leg, upper, mixed, longText, other;
+        REQUIRE(!inv.isValid());
+        leg.setAsLegacy(1234);
+        REQUIRE(leg.getMD5() == "lgcy(1234)");
+
+        // Upper case hex is a digest too and streams back out as it came in
+        auto upperHex = std::string("D41D8CD98F00B204E9800998ECF8427E");
+        upper.setAsMD5(upperHex);
+        REQUIRE(upper.isValid());
+        REQUIRE(upper.getMD5() == upperHex);
+        REQUIRE(!upper.sameMD5As(leg));
+
+        SampleID lower;
+        lower.setAsMD5(hex);
+        REQUIRE(!upper.sameMD5As(lower));
+
+        auto mixedHex = std::string("d41d8cd98f00b204E9800998ECF8427E");
+        mixed.setAsMD5(mixedHex);
+        REQUIRE(mixed.getMD5() == mixedHex);
+        REQUIRE(!mixed.sameMD5As(lower));
+        REQUIRE(!mixed.sameMD5As(upper));
+
+        // Text ids which only differ after 16 characters stay apart
+        auto t1 = std::string("legacy-sample-id-number-0001");
+        auto t2 = std::string("legacy-sample-id-number-0002");
+        longText.setAsMD5(t1);
+        other.setAsMD5(t2);
+        REQUIRE(longText.getMD5() == t1);
+        REQUIRE(other.getMD5() == t2);
+        REQUIRE(!longText.sameMD5As(other));
+        REQUIRE(longText != other);
+        REQUIRE(longText.hash() != other.hash());
+    }
+
+    SECTION("Equality And Hash Follow Every Field")
+    {
+        SampleID a, b;
+        a.setAsMD5WithAddress(hex, 1, 2, 3);
+        b.setAsMD5WithAddress(hex, 1, 2, 3);
+        REQUIRE(a == b);
+        REQUIRE(std::hash<SampleID>()(a) == std::hash<SampleID>()(b));
+
+        b.setPathHash(fs::path("/elsewhere.wav"));
+        REQUIRE(a != b);
+        REQUIRE(a.sameMD5As(b));
+        b.setPathHash((size_t)0);
+        REQUIRE(a == b);
+
+        b.setMultiAddress({1, 2, 4});
+        REQUIRE(a != b);
+        REQUIRE(a.hash() != b.hash());
+    }
+}
+
+TEST_CASE("Sample Lookup Indices", "[sample]")
+{
+    TempSampleDir td("scxt-test-indices", 3, 1024);
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+
+    SECTION("Repeat loads hit and purge forgets")
+    {
+        auto a = sm.loadSampleByPath(td.files[0]);
+        REQUIRE(a.has_value());
+        REQUIRE(sm.loadSampleByPath(td.files[0]) == a);
+        REQUIRE(sm.loadSamplesByPath({td.files[0], td.files[1]})[0] == a);
+
+        sm.purgeUnreferencedSamples();
+        REQUIRE(!sm.getSample(*a));
+        auto again = sm.loadSampleByPath(td.files[0]);
+        REQUIRE(again == a);
+        REQUIRE(sm.getSample(*again));
+    }
+
+    SECTION("Alias chains resolve in one step")
+    {
+        auto target = sm.loadSampleByPath(td.files[2]);
+        REQUIRE(target.has_value());
+
+        std::vector<SampleID> chain;
+        for (int i = 0; i < 5; ++i)
+        {
+            SampleID sid;
+            sid.setAsMD5(fmt::format("{:032x}", i + 1));
+            chain.push_back(sid);
+        }
+        // built back to front and front to back, so both halves of addIdAlias get used
+        sm.addIdAlias(chain[0], chain[1]);
+        sm.addIdAlias(chain[1], chain[2]);
+        sm.addIdAlias(chain[3], chain[4]);
+        sm.addIdAlias(chain[2], chain[3]);
+        sm.addIdAlias(chain[4], *target);
+
+        for (const auto &sid : chain)
+        {
+            REQUIRE(sm.resolveAlias(sid) == *target);
+            REQUIRE(sm.getSample(sid) == sm.getSample(*target));
+        }
+
+        sm.reset();
+        REQUIRE(sm.resolveAlias(chain[0]) == chain[0]);
+    }
+}
+
+TEST_CASE("Sample Memory Budget", "[sample]")
+{
+    TempSampleDir td("scxt-test-memory-budget", 7, 48000);
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    sm.preloadMilliseconds = 100;
+
+    std::vector<std::shared_ptr<sample::Sample>> smp;
+    std::vector<std::vector<int16_t>> original;
+    for (int i = 0; i < 6; ++i)
+    {
+        auto id = sm.loadSampleByPath(td.files[i]);
+        REQUIRE(id.has_value());
+        smp.push_back(sm.getSample(*id));
+        auto *d = smp.back()->GetSamplePtrI16(0);
+        original.emplace_back(d, d + smp.back()->sample_length);
+    }
+    auto fullMemory = sm.sampleMemoryInBytes.load();
+
+    // Play them in the order 2 3 4 0 5 and leave a voice sounding on 1
+    for (auto i : {2, 3, 4, 0, 5})
+    {
+        smp[i]->markVoiceStarted();
+        smp[i]->markVoiceEnded();
+    }
+    smp[1]->markVoiceStarted();
+
+    auto evicted = [&smp]() {
+        std::vector<int> res;
+        for (int i = 0; i < (int)smp.size(); ++i)
+            if (smp[i]->isEvicted())
+                res.push_back(i);
+        return res;
+    };
+
+    SECTION("Eviction is least recently played first and keeps the preload")
+    {
+        sm.setMemoryBudget(fullMemory - 1);
+        REQUIRE(evicted() == std::vector<int>{2});
+        REQUIRE(sm.sampleMemoryInBytes < fullMemory);
+
+        auto &s = *smp[2];
+        REQUIRE(s.sample_length == 48000);
+        REQUIRE(s.playableLength() == 4800);
+        REQUIRE(s.getSampleLength() == 48000);
+        auto *d = s.GetSamplePtrI16(0);
+        for (int f = 0; f < 4800; ++f)
+            REQUIRE(d[f] == original[2][f]);
+        // the trailing FIR pad is silent
+        for (int f = 4800; f < 4800 + dsp::FIRoffset; ++f)
+            REQUIRE(d[f] == 0);
+
+        sm.setMemoryBudget(sm.sampleMemoryInBytes - 1);
+        REQUIRE(evicted() == std::vector<int>{2, 3});
+
+        // Everything but the sounding sample can go
+        sm.setMemoryBudget(1);
+        REQUIRE(evicted() == std::vector<int>{0, 2, 3, 4, 5});
+        REQUIRE(!smp[1]->isEvicted());
+    }
+
+    SECTION("Evicted samples reload to their original data")
+    {
+        sm.setMemoryBudget(1);
+        REQUIRE(smp[3]->isEvicted());
+        auto budgetMemory = sm.sampleMemoryInBytes.load();
+
+        sm.setMemoryBudget(0);
+        smp[3]->reloadRequested = true;
+        REQUIRE(sm.reloadEvictedSample(smp[3].get()));
+        REQUIRE(!smp[3]->isEvicted());
+        REQUIRE(!smp[3]->reloadRequested);
+        REQUIRE(smp[3]->playableLength() == 48000);
+        auto *d = smp[3]->GetSamplePtrI16(0);
+        for (int f = 0; f < 48000; ++f)
+            REQUIRE(d[f] == original[3][f]);
+
+        // and a second request does nothing
+        REQUIRE(!sm.reloadEvictedSample(smp[3].get()));
+
+        sm.purgeUnreferencedSamples();
+        REQUIRE(sm.sampleMemoryInBytes > budgetMemory);
+    }
+
+    SECTION("Evicted samples still give up all their data to be written out")
+    {
+        REQUIRE(sm.fullDataFor(smp[2]) == smp[2]);
+
+        sm.setMemoryBudget(1);
+        REQUIRE(smp[2]->isEvicted());
+        auto memory = sm.sampleMemoryInBytes.load();
+        {
+            auto full = sm.fullDataFor(smp[2]);
+            REQUIRE(full);
+            REQUIRE(full != smp[2]);
+            REQUIRE(full->playableLength() == 48000);
+            auto *d = (const int16_t *)full->sampleData[0] + dsp::FIRoffset;
+            for (int f = 0; f < 48000; ++f)
+                REQUIRE(d[f] == original[2][f]);
+        }
+        // and the copy isn't kept, or counted
+        REQUIRE(smp[2]->isEvicted());
+        REQUIRE(sm.sampleMemoryInBytes == memory);
+
+        fs::remove(td.files[2]);
+        REQUIRE(!sm.fullDataFor(smp[2]));
+    }
+
+    SECTION("Analytics and pyramid are built lazily but before eviction")
+    {
+        for (auto &s : smp)
+        {
+            REQUIRE(!s->getCachedAnalytics());
+        }
+        auto full = dsp::sample_analytics::computeAnalytics(*smp[2]);
+        REQUIRE(!smp[2]->getCachedAnalytics());
+
+        sm.setMemoryBudget(fullMemory - 1);
+        REQUIRE(evicted() == std::vector<int>{2});
+        auto cached = smp[2]->getCachedAnalytics();
+        REQUIRE(cached);
+        REQUIRE(cached->peak == full.peak);
+        REQUIRE(cached->rms == full.rms);
+
+        // and the pyramid still sees the part which is no longer resident
+        auto pyr = smp[2]->getWaveformPyramid();
+        REQUIRE(pyr == smp[2]->getWaveformPyramid());
+        sample::SampleManager ref(tc);
+        auto rs = ref.getSample(*ref.loadSampleByPath(td.files[2]));
+        auto block = sample::WaveformPyramid::baseBlockSize;
+        auto want = rs->getWaveformPyramid()->minMaxBetween(*rs, 0, 600 * block, 700 * block);
+        auto got = pyr->minMaxBetween(*smp[2], 0, 600 * block, 700 * block);
+        REQUIRE(got.min == want.min);
+        REQUIRE(got.max == want.max);
+        REQUIRE(got.max > got.min);
+    }
+
+    SECTION("Serial thread leaves samples alone while their swap is queued")
+    {
+        std::vector<std::pair<std::function<void()>, std::function<void()>>> queued;
+        sm.runOnAudioThread = [&queued](auto onAudio, auto thenOnSerial) {
+            queued.emplace_back(onAudio, thenOnSerial);
+        };
+
+        auto *before = smp[2]->sampleData[0];
+        sm.setMemoryBudget(fullMemory - 1);
+        REQUIRE(queued.size() == 1);
+        REQUIRE(smp[2]->dataSwapInFlight);
+        REQUIRE(smp[2]->sampleData[0] == before);
+
+        // Not a share donor and not reloaded until it lands
+        auto copyPath = td.dir / "copy_of_two.wav";
+        fs::copy_file(td.files[2], copyPath);
+        auto copy = sm.getSample(*sm.loadSampleByPath(copyPath));
+        REQUIRE(copy->sampleData[0] != before);
+        REQUIRE(!sm.reloadEvictedSample(smp[2].get()));
+
+        queued[0].first();
+        REQUIRE(smp[2]->dataSwapInFlight);
+        queued[0].second();
+        REQUIRE(!smp[2]->dataSwapInFlight);
+        REQUIRE(smp[2]->isEvicted());
+        REQUIRE(smp[2]->sampleData[0] != before);
+        auto *d = smp[2]->GetSamplePtrI16(0);
+        for (int f = 0; f < 4800; ++f)
+            REQUIRE(d[f] == original[2][f]);
+    }
+
+    SECTION("Reset forgets everything once queued swaps land")
+    {
+        std::vector<std::pair<std::function<void()>, std::function<void()>>> queued;
+        sm.runOnAudioThread = [&queued](auto onAudio, auto thenOnSerial) {
+            queued.emplace_back(onAudio, thenOnSerial);
+        };
+        sm.setMemoryBudget(fullMemory - 1);
+        REQUIRE(queued.size() == 1);
+
+        std::weak_ptr<void> oldData = smp[2]->sampleDataOwner[0];
+        sm.provideEmbeddedSamples({smp[4]});
+        sm.reset();
+        REQUIRE(sm.takeEmbeddedSamples().empty());
+        REQUIRE(!oldData.expired());
+
+        // voices which started on it could run until the swap, so it goes after that
+        queued[0].first();
+        REQUIRE(!oldData.expired());
+        queued[0].second();
+        REQUIRE(oldData.expired());
+    }
+
+    SECTION("Unreferenced samples go first")
+    {
+        auto id = sm.loadSampleByPath(td.files[6]);
+        REQUIRE(id.has_value());
+        sm.getSample(*id)->markVoiceStarted();
+        sm.getSample(*id)->markVoiceEnded();
+
+        sm.setMemoryBudget(sm.sampleMemoryInBytes - 1);
+        REQUIRE(evicted().empty());
+        REQUIRE(sm.getSample(*id)->isEvicted());
+    }
+
+    smp[1]->markVoiceEnded();
+}
+
+TEST_CASE("Shared Sample Store", "[sample]")
+{
+    // A multi's worth of samples loaded by many instances, as a DAW session with the same
+    // kit on many tracks would
+    TempSampleDir td("scxt-test-shared-store", 8, 24000);
+    ThreadingChecker tc;
+    auto &store = sample::SharedSampleStore::instance();
+    REQUIRE(store.liveEntryCount() == 0);
+
+    auto loadInstances = [&](int n, bool share) {
+        std::vector<std::unique_ptr<sample::SampleManager>> res;
+        for (int i = 0; i < n; ++i)
+        {
+            auto sm = std::make_unique<sample::SampleManager>(tc);
+            sm->useSharedSampleStore = share;
+            auto ids = sm->loadSamplesByPath(td.files);
+            for (const auto &id : ids)
+                REQUIRE(id.has_value());
+            res.push_back(std::move(sm));
+        }
+        return res;
+    };
+    auto distinctBuffers = [&](const auto &instances) {
+        std::set<const void *> res;
+        for (const auto &sm : instances)
+            for (auto it = sm->samplesBegin(); it != sm->samplesEnd(); ++it)
+                res.insert((const void *)it->second->sampleData[0]);
+        return res.size();
+    };
+
+    for (auto n : {1, 4, 16})
+    {
+        DYNAMIC_SECTION("Instances " << n)
+        {
+            auto unshared = loadInstances(n, false);
+            REQUIRE(distinctBuffers(unshared) == td.files.size() * n);
+            REQUIRE(store.liveEntryCount() == 0);
+
+            auto shared = loadInstances(n, true);
+            REQUIRE(distinctBuffers(shared) == td.files.size());
+            auto oneInstance = shared.front()->sampleMemoryInBytes.load();
+            REQUIRE(store.liveEntryCount() == td.files.size());
+            REQUIRE(store.liveDataBytes() == oneInstance);
+
+            // Each instance still has its own view
+            auto a = shared.front()->samplesBegin()->second;
+            auto b = shared.back()->getSample(shared.front()->samplesBegin()->first);
+            REQUIRE(b);
+            if (n > 1)
+                REQUIRE(a != b);
+            REQUIRE(a->sampleData[0] == b->sampleData[0]);
+            REQUIRE(a->getPath() == b->getPath());
+
+            // and the data lives on in whichever instances are left
+            shared.erase(shared.begin());
+            if (n > 1)
+            {
+                REQUIRE(store.liveEntryCount() == td.files.size());
+                REQUIRE(b->GetSamplePtrI16(0)[100] != 0);
+            }
+            shared.clear();
+            b.reset();
+            a.reset();
+            REQUIRE(store.liveEntryCount() == 0);
+            REQUIRE(store.liveDataBytes() == 0);
+        }
+    }
+}
+
+TEST_CASE("SF2 Sample Mapping", "[sample]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-sf2-map";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // Just enough sfbk for the locator: an INFO list ahead of the sdta list holding smpl
+    auto sf2 = dir / "map.sf2";
+    std::vector<int16_t> smpl(1000);
+    for (size_t i = 0; i < smpl.size(); ++i)
+        smpl[i] = (int16_t)(i * 7 - 3000);
+    {
+        auto put32 = [](std::ofstream &o, uint32_t v) { o.write((const char *)&v, 4); };
+        uint32_t smplBytes = smpl.size() * sizeof(int16_t);
+        std::ofstream o(sf2, std::ios::binary);
+        o.write("RIFF", 4);
+        put32(o, 4 + (8 + 4 + 8 + 4) + (8 + 4 + 8 + smplBytes));
+        o.write("sfbk", 4);
+        o.write("LIST", 4);
+        put32(o, 4 + 8 + 4);
+        o.write("INFO", 4);
+        o.write("ifil", 4);
+        put32(o, 4);
+        put32(o, 0x00010002);
+        o.write("LIST", 4);
+        put32(o, 4 + 8 + smplBytes);
+        o.write("sdta", 4);
+        o.write("smpl", 4);
+        put32(o, smplBytes);
+        o.write((const char *)smpl.data(), smplBytes);
+    }
+
+    SECTION("Finds the smpl chunk")
+    {
+        auto m = sample::SF2SampleMapping::map(sf2);
+        REQUIRE(m);
+        REQUIRE(m->smplFrames == smpl.size());
+        REQUIRE(std::equal(smpl.begin(), smpl.end(), m->smpl));
+    }
+
+    SECTION("Rejects other files")
+    {
+        auto wav = dir / "not.wav";
+        writeTestWav(wav, 1000, 1, 3);
+        REQUIRE(!sample::SF2SampleMapping::map(wav));
+        REQUIRE(!sample::SF2SampleMapping::map(dir / "missing.sf2"));
+    }
+
+    SECTION("Banks over 2GB")
+    {
+        // A sparse file, so this costs a few pages of disk rather than 2.2GB
+        auto big = dir / "big.sf2";
+        uint32_t bigBytes = 2200000000u;
+        int16_t last = 1234;
+        {
+            auto put32 = [](std::ofstream &o, uint32_t v) { o.write((const char *)&v, 4); };
+            std::ofstream o(big, std::ios::binary);
+            o.write("RIFF", 4);
+            put32(o, 4 + (8 + 4 + 8 + bigBytes) + (8 + 4));
+            o.write("sfbk", 4);
+            o.write("LIST", 4);
+            put32(o, 4 + 8 + bigBytes);
+            o.write("sdta", 4);
+            o.write("smpl", 4);
+            put32(o, bigBytes);
+            o.seekp(bigBytes - sizeof(last), std::ios::cur);
+            o.write((const char *)&last, sizeof(last));
+            o.write("LIST", 4);
+            put32(o, 4);
+            o.write("pdta", 4);
+            REQUIRE(o.good());
+        }
+        REQUIRE(fs::file_size(big) > (uintmax_t)std::numeric_limits<int>::max());
+
+        auto m = sample::SF2SampleMapping::map(big);
+        REQUIRE(m);
+        REQUIRE(m->smplFrames == bigBytes / sizeof(int16_t));
+        REQUIRE(m->smpl[0] == 0);
+        REQUIRE(m->smpl[m->smplFrames - 1] == last);
+        m.reset();
+        fs::remove(big);
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Resident Sample Memory", "[sample]")
+{
+    auto &rm = infrastructure::ResidentMemory::instance();
+    auto total = [&rm]() {
+        auto r = rm.report();
+        return r.lockedBytes + r.unlockedBytes;
+    };
+    auto before = total();
+
+    SECTION("Disabled is plain allocation")
+    {
+        rm.setEnabled(false);
+        auto s = std::make_shared<sample::Sample>();
+        REQUIRE(s->allocateI16(0, 100000));
+        REQUIRE(total() == before);
+        REQUIRE(!rm.lockRange(s->sampleData[0], 1000));
+    }
+
+    SECTION("Enabled buffers are page aligned, accounted and released")
+    {
+        rm.setEnabled(true);
+        {
+            auto s = std::make_shared<sample::Sample>();
+            REQUIRE(s->allocateF32(0, 1 << 20));
+            REQUIRE(((uintptr_t)s->sampleData[0] & 4095) == 0);
+            REQUIRE(total() >= before + ((1 << 20) + dsp::FIRipol_N) * sizeof(float));
+
+            // The pads are still zeroed around the data
+            REQUIRE(s->GetSamplePtrF32(0)[-1] == 0.f);
+            REQUIRE(s->GetSamplePtrF32(0)[1 << 20] == 0.f);
+
+            std::vector<uint8_t> block(100000, 1);
+            auto beforeRange = total();
+            auto token = rm.lockRange(block.data() + 17, 50000);
+            REQUIRE(token);
+            REQUIRE(total() >= beforeRange + 50000);
+            token.reset();
+            REQUIRE(total() == beforeRange);
+        }
+        REQUIRE(total() == before);
+        rm.setEnabled(false);
+    }
+}
+
+TEST_CASE("Sample Identity Cache", "[sample]")
+{
+    TempSampleDir td("scxt-test-identity", 2, 2048);
+    auto dbDir = td.dir / "db";
+    fs::create_directories(dbDir);
+
+    using infrastructure::ContentHashKind;
+
+    SECTION("XXH3 128 Known Answers")
+    {
+        // Reference values from the upstream xxHash implementation (xxhsum -H2)
+        auto xxh = [](const std::string &s) {
+            return infrastructure::createContentHash(ContentHashKind::XXH3_128, s.data(),
+                                                     s.size());
+        };
+        REQUIRE(xxh("") == "99aa06d3014798d86001c324468d497f");
+        REQUIRE(xxh("a") == "a96faf705af16834e6c632b61e964e1f");
+        REQUIRE(xxh("abc") == "06b05ab6733a618578af5f94892f3950");
+        REQUIRE(xxh("The quick brown fox jumps over the lazy dog") ==
+                "ddd650205ca3e7fa24a1cc2e3a8a7651");
+
+        // and one long enough to run the striped accumulator loop
+        std::string big(100000, '\0');
+        for (size_t i = 0; i < big.size(); ++i)
+            big[i] = (char)((i * 7 + 3) & 0xFF);
+        REQUIRE(xxh(big) == "d9e155dd16e141d00c056f6fcc340974");
+    }
+
+    SECTION("Fast Hash Is Stable And Distinct")
+    {
+        auto hashFile = [](auto k, const fs::path &p) {
+            return infrastructure::createContentHashFromFile(k, p);
+        };
+        auto a = hashFile(ContentHashKind::XXH3_128, td.files[0]);
+        auto b = hashFile(ContentHashKind::XXH3_128, td.files[1]);
+        auto m = hashFile(ContentHashKind::MD5, td.files[0]);
+        REQUIRE(a.size() == 32);
+        REQUIRE(a != b);
+        REQUIRE(a != m);
+        REQUIRE(a == hashFile(ContentHashKind::XXH3_128, td.files[0]));
+    }
+
+    SECTION("Ids Resolve With Their Own Hash Kind")
+    {
+        // A patch saved with MD5 ids still resolves by MD5 on a manager which hashes new
+        // content with XXH3, and reads and fills only the MD5 rows of the cache
+        browser::BrowserDB db(dbDir);
+        ThreadingChecker tc;
+        sample::SampleManager sm(tc);
+        sm.setIdentityCache(&db);
+        sm.contentHashKind = ContentHashKind::XXH3_128;
+
+        auto md5 = infrastructure::createContentHashFromFile(ContentHashKind::MD5, td.files[0]);
+        auto sid = sm.loadSampleByPath(td.files[0], ContentHashKind::MD5);
+        REQUIRE(sid.has_value());
+        auto smp = sm.getSample(*sid);
+        REQUIRE(smp->md5Sum == md5);
+        REQUIRE(smp->getSampleFileAddress().contentHashKind == ContentHashKind::MD5);
+
+        REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+        auto cached = db.getCachedContentHash(td.files[0], ContentHashKind::MD5);
+        REQUIRE(cached.has_value());
+        REQUIRE(*cached == md5);
+        REQUIRE(!db.getCachedContentHash(td.files[0], ContentHashKind::XXH3_128).has_value());
+
+        // while a plain load uses the manager's kind
+        auto other = sm.getSample(*sm.loadSampleByPath(td.files[1]));
+        REQUIRE(other->contentHashKind == ContentHashKind::XXH3_128);
+        REQUIRE(other->md5Sum ==
+                infrastructure::createContentHashFromFile(ContentHashKind::XXH3_128, td.files[1]));
+    }
+
+    for (auto kind : {ContentHashKind::MD5, ContentHashKind::XXH3_128})
+    {
+        DYNAMIC_SECTION("Cache Round Trip " << infrastructure::contentHashKindName(kind))
+        {
+            browser::BrowserDB db(dbDir);
+            ThreadingChecker tc;
+            sample::SampleManager sm(tc);
+            sm.setIdentityCache(&db);
+            sm.contentHashKind = kind;
+
+            auto sid = sm.loadSampleByPath(td.files[0]);
+            REQUIRE(sid.has_value());
+            REQUIRE(db.waitForJobsOutstandingComplete(5000) == 0);
+
+            auto expected = infrastructure::createContentHashFromFile(kind, td.files[0]);
+            REQUIRE(sm.getSample(*sid)->md5Sum == expected);
+
+            auto cached = db.getCachedContentHash(td.files[0], kind);
+            REQUIRE(cached.has_value());
+            REQUIRE(*cached == expected);
+
+            // A changed file is a miss
+            writeTestWav(td.files[0], 1024, 1, 77);
+            REQUIRE(!db.getCachedContentHash(td.files[0], kind).has_value());
+        }
+    }
+}
+
+TEST_CASE("Wave And AIFF Headers", "[sample]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-pcm-headers";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    auto le = [](std::ofstream &o, uint32_t v, int bytes) { o.write((const char *)&v, bytes); };
+    auto be = [](std::ofstream &o, uint32_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i)
+            o.put((char)(v >> (8 * i)));
+    };
+    auto value = [](int i) { return (int16_t)(12000 * std::sin(0.02 * i)); };
+    static constexpr uint32_t frames{3000};
+
+    auto checkLoads = [&value](const fs::path &p, int channels) {
+        sample::Sample s;
+        REQUIRE(s.load(p));
+        REQUIRE(s.channels == channels);
+        REQUIRE(s.sample_length == frames);
+        REQUIRE(s.sample_rate == 48000);
+        for (int c = 0; c < channels; ++c)
+            for (uint32_t i = 0; i < frames; ++i)
+                REQUIRE(s.GetSamplePtrI16(c)[i] == value(i + c));
+    };
+    auto parse = [](const fs::path &p, auto parser) {
+        infrastructure::FileMapView v(p);
+        REQUIRE(v.isMapped());
+        return parser(v.data(), v.dataSize());
+    };
+
+    SECTION("Extensible wave with its data ahead of its format")
+    {
+        auto p = dir / "ext.wav";
+        {
+            std::ofstream o(p, std::ios::binary);
+            o.write("RIFF", 4);
+            le(o, 4 + (8 + 4) + (8 + frames * 4) + (8 + 40), 4);
+            o.write("WAVE", 4);
+            o.write("junk", 4);
+            le(o, 3, 4);
+            o.write("abc\0", 4); // odd length, so padded
+            o.write("data", 4);
+            le(o, frames * 4, 4);
+            for (uint32_t i = 0; i < frames; ++i)
+                for (int c = 0; c < 2; ++c)
+                    le(o, (uint16_t)value(i + c), 2);
+            o.write("fmt ", 4);
+            le(o, 40, 4);
+            for (auto [v, b] : std::vector<std::pair<uint32_t, int>>{
+                     {0xFFFE, 2}, {2, 2}, {48000, 4}, {48000 * 4, 4}, {4, 2}, {16, 2}, {22, 2}})
+                le(o, v, b);
+            le(o, 16, 2);
+            le(o, 3, 4);
+            le(o, 1, 2); // WAVE_FORMAT_PCM in the sub format guid
+            for (int i = 0; i < 14; ++i)
+                o.put(0);
+        }
+
+        auto h = parse(p, [](auto d, auto s) { return sample::loaders::parseWaveHeader(d, s); });
+        REQUIRE(h.has_value());
+        REQUIRE(h->dataOffset == 12 + 12 + 8);
+        REQUIRE(h->frames == frames);
+        REQUIRE(h->channels == 2);
+        REQUIRE(h->bytesPerSample == 2);
+        REQUIRE(!h->isFloat);
+        checkLoads(p, 2);
+    }
+
+    SECTION("Little endian AIFC")
+    {
+        auto p = dir / "sowt.aif";
+        {
+            std::ofstream o(p, std::ios::binary);
+            o.write("FORM", 4);
+            be(o, 4 + (8 + 22) + (8 + 8 + 4 + frames * 2), 4);
+            o.write("AIFC", 4);
+            o.write("COMM", 4);
+            be(o, 22, 4);
+            be(o, 1, 2);
+            be(o, frames, 4);
+            be(o, 16, 2);
+            const unsigned char rate48k[10]{0x40, 0x0E, 0xBB, 0x80, 0, 0, 0, 0, 0, 0};
+            o.write((const char *)rate48k, 10);
+            o.write("sowt", 4);
+            o.write("SSND", 4);
+            be(o, 8 + 4 + frames * 2, 4);
+            be(o, 4, 4); // an offset to skip
+            be(o, 0, 4);
+            be(o, 0, 4);
+            for (uint32_t i = 0; i < frames; ++i)
+                le(o, (uint16_t)value(i), 2);
+        }
+
+        auto h = parse(p, sample::loaders::parseAiffHeader);
+        REQUIRE(h.has_value());
+        REQUIRE(!h->bigEndian);
+        REQUIRE(h->dataOffset == 12 + 30 + 8 + 8 + 4);
+        REQUIRE(h->frames == frames);
+        REQUIRE(h->sampleRate == 48000);
+        checkLoads(p, 1);
+    }
+
+    SECTION("Neither takes the other's files")
+    {
+        writeTestWav(dir / "a.wav", 100, 1, 1);
+        writeTestAiff(dir / "a.aif", 100);
+        REQUIRE(!parse(dir / "a.wav", sample::loaders::parseAiffHeader));
+        REQUIRE(!parse(dir / "a.aif", [](auto d, auto s) {
+            return sample::loaders::parseWaveHeader(d, s);
+        }));
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Packed 24 Bit Samples", "[sample]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-i24";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto p = dir / "i24.wav";
+    writeTestWav(p, 3000, 2, 4, 24);
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    auto sid = sm.loadSampleByPath(p);
+    REQUIRE(sid.has_value());
+    auto s = sm.getSample(*sid);
+    REQUIRE(s->bitDepth == sample::Sample::BD_I24);
+    REQUIRE(s->getBitDepthText() == "I24");
+    REQUIRE(s->channelDataSizeInBytes() == (3000 + dsp::FIRipol_N) * 3);
+
+    SECTION("Values Round Trip")
+    {
+        for (int c = 0; c < 2; ++c)
+        {
+            auto *d = s->GetSamplePtrI24(c);
+            for (int i : {0, 17, 2999})
+                REQUIRE(d[i].toInt32() == (int32_t)(8000000 * std::sin(0.01 * (i + 1) * (5 + c))));
+            REQUIRE(d[-1].toInt32() == 0);
+            REQUIRE(d[3000].toInt32() == 0);
+        }
+        REQUIRE(dsp::PackedInt24::fromInt32(-1).toInt32() == -1);
+        REQUIRE(dsp::PackedInt24::fromInt32(-8388608).toInt32() == -8388608);
+        REQUIRE(dsp::PackedInt24::fromInt32(8388607).toInt32() == 8388607);
+    }
+
+    SECTION("Generator Matches F32")
+    {
+        auto f = widenToF32(*s);
+        for (auto interp : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear,
+                            dsp::InterpolationTypes::ZeroOrderHold})
+        {
+            for (auto loop : {false, true})
+            {
+                INFO("Interpolation " << dsp::toStringInterpolationTypes(interp) << " loop "
+                                      << loop);
+                auto a = renderGenerator(*s, dsp::SF_I24, interp, loop, 600);
+                auto b = renderGenerator(*f, dsp::SF_F32, interp, loop, 600);
+                REQUIRE(a.size() == b.size());
+                REQUIRE(a.size() > 100);
+                float maxDiff{0}, maxVal{0};
+                for (size_t i = 0; i < a.size(); ++i)
+                {
+                    maxDiff = std::max(maxDiff, std::fabs(a[i] - b[i]));
+                    maxVal = std::max(maxVal, std::fabs(a[i]));
+                }
+                REQUIRE(maxVal > 0.5f);
+                REQUIRE(maxDiff < 1e-5f);
+            }
+        }
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Loop Splice", "[sample]")
+{
+    auto dir = fs::temp_directory_path() / "scxt-test-splice";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto p = dir / "splice.wav";
+    writeTestWav(p, 3000, 2, 2, 24);
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    auto sid = sm.loadSampleByPath(p);
+    REQUIRE(sid.has_value());
+    auto f = widenToF32(*sm.getSample(*sid));
+
+    // The loop renderGenerator sets up
+    int32_t lower = 3000 / 4, upper = 3000 - 1;
+    void *data[2]{f->GetSamplePtrF32(0), f->GetSamplePtrF32(1)};
+
+    SECTION("Splice Contents")
+    {
+        auto sp = dsp::LoopSplice::build(dsp::SF_F32, 2, data, 3000, lower, upper, 200);
+        REQUIRE(sp);
+        REQUIRE(sp->matches(lower, upper, 200));
+        REQUIRE(!sp->matches(lower, upper, 199));
+        REQUIRE(sp->spliceFrom == upper - 200 - dsp::FIRoffset);
+
+        for (int c = 0; c < 2; ++c)
+        {
+            auto *x = f->GetSamplePtrF32(c);
+            auto *d = (float *)sp->data[c].get() + dsp::FIRoffset - sp->spliceFrom;
+            // before the fade, untouched; after the loop point, the start of the loop
+            REQUIRE(d[upper - 200] == x[upper - 200]);
+            for (int k = 0; k <= dsp::FIRoffset; ++k)
+                REQUIRE(d[upper + k] == x[lower + k]);
+            // and the fade lands on the loop start
+            REQUIRE(d[upper - 1] == Approx(x[lower - 1]).margin(0.02));
+        }
+    }
+
+    SECTION("Rejects Loops Which Don't Fit")
+    {
+        REQUIRE(!dsp::LoopSplice::build(dsp::SF_F32, 2, data, 3000, lower, 3001, 0));
+        REQUIRE(!dsp::LoopSplice::build(dsp::SF_F32, 2, data, 3000, lower, lower, 0));
+        REQUIRE(!dsp::LoopSplice::build(dsp::SF_F32, 2, data, 3000, 100, 200, 101));
+        REQUIRE(!dsp::LoopSplice::build(dsp::SF_F32, 2, data, 3000, 100, 2000, 101));
+        void *none[2]{nullptr, nullptr};
+        REQUIRE(!dsp::LoopSplice::build(dsp::SF_F32, 1, none, 3000, lower, upper, 0));
+    }
+
+    SECTION("Generator Plays The Unrolled Loop")
+    {
+        // Write the loop out longhand, crossfades and all, and play that one shot. The
+        // spliced loop should sound the same bar the few frames after each wrap, where
+        // the FIR reaches back before the loop start rather than into the fade.
+        int32_t fade = 200, length = upper - lower, passes = 5;
+        sample::Sample unrolled;
+        unrolled.SetMeta(1, 48000, upper + passes * length);
+        unrolled.allocateF32(0, unrolled.sample_length);
+        auto *x = f->GetSamplePtrF32(0);
+        auto *y = unrolled.GetSamplePtrF32(0);
+        for (int32_t n = 0; n < (int32_t)unrolled.sample_length; ++n)
+        {
+            auto m = n;
+            while (m >= upper)
+                m -= length;
+            y[n] = x[m];
+            if (m > upper - fade && n + length < (int32_t)unrolled.sample_length)
+            {
+                auto g = dsp::getFadeGain(m, upper - fade, upper);
+                y[n] = x[m] * dsp::getFadeGainToAmp(1.f - g) +
+                       x[m - length] * dsp::getFadeGainToAmp(g);
+            }
+        }
+
+        auto sp = dsp::LoopSplice::build(dsp::SF_F32, 2, data, 3000, lower, upper, fade);
+        REQUIRE(sp);
+
+        for (auto interp : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear,
+                            dsp::InterpolationTypes::ZeroOrderHold})
+        {
+            INFO("Interpolation " << dsp::toStringInterpolationTypes(interp));
+            auto a = renderGenerator(*f, dsp::SF_F32, interp, true, 600, fade, sp.get());
+            auto b = renderGenerator(unrolled, dsp::SF_F32, interp, false, 600);
+            REQUIRE(a.size() == b.size());
+            float maxDiff{0}, maxVal{0};
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                maxDiff = std::max(maxDiff, std::fabs(a[i] - b[i]));
+                maxVal = std::max(maxVal, std::fabs(a[i]));
+            }
+            REQUIRE(maxVal > 0.5f);
+            REQUIRE(maxDiff < 0.03f);
+        }
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Packed 24 Bit Benchmark", "[.][bench]")
+{
+    // Hidden; run with `scxt-test "[bench]"`. Compares the packed 24 bit storage
+    // with the float32 widening we used to do at load.
+    auto dir = fs::temp_directory_path() / "scxt-test-i24-bench";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto p = dir / "i24.wav";
+    uint32_t frames = 4 * 1024 * 1024;
+    writeTestWav(p, frames, 2, 4, 24);
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    auto s = sm.getSample(*sm.loadSampleByPath(p));
+    auto f = widenToF32(*s);
+    std::cout << "Memory for " << frames << " stereo 24 bit frames: I24 "
+              << (2 * s->channelDataSizeInBytes() / (1024 * 1024)) << "mb, F32 "
+              << (2 * f->channelDataSizeInBytes() / (1024 * 1024)) << "mb" << std::endl;
+
+    using clock_t = std::chrono::high_resolution_clock;
+    for (auto interp : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear,
+                        dsp::InterpolationTypes::ZeroOrderHold})
+    {
+        auto time = [&](auto &smp, auto fmt) {
+            auto s0 = clock_t::now();
+            auto res = renderGenerator(smp, fmt, interp, false);
+            auto secs = std::chrono::duration<double>(clock_t::now() - s0).count();
+            return res.size() / secs / 1e6;
+        };
+        auto i24 = time(*s, dsp::SF_I24);
+        auto f32 = time(*f, dsp::SF_F32);
+        std::cout << "   " << dsp::toStringInterpolationTypes(interp) << " stereo : I24 " << i24
+                  << " Msamples/s, F32 " << f32 << " Msamples/s" << std::endl;
+    }
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Bulk Read Benchmark", "[.][bench]")
+{
+    // Hidden; run with `scxt-test "[bench]"`. The cold cache numbers are only
+    // meaningful on linux where we can ask the kernel to drop the file pages.
+    TempSampleDir td("scxt-test-bulk-bench", 128, 512 * 1024);
+    auto evictAll = [&td]() {
+        for (const auto &p : td.files)
+            infrastructure::BulkFileReader::evictFromPageCache(p);
+    };
+
+    ThreadingChecker tc;
+    using clock_t = std::chrono::high_resolution_clock;
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    evictAll();
+    sample::SampleManager mmapManager(tc);
+    auto s0 = clock_t::now();
+    for (const auto &p : td.files)
+        mmapManager.loadSampleByPath(p);
+    auto mmapTime = ms(clock_t::now() - s0);
+
+    evictAll();
+    sample::SampleManager bulkManager(tc);
+    auto s1 = clock_t::now();
+    bulkManager.loadSamplesByPath(td.files);
+    auto bulkTime = ms(clock_t::now() - s1);
+
+    std::cout << "Cold cache load of " << td.files.size() << " files ("
+              << (mmapManager.sampleMemoryInBytes / (1024 * 1024)) << "mb in memory)\n"
+              << "   mmap one at a time : " << mmapTime << "ms\n"
+              << "   bulk ("
+              << infrastructure::BulkFileReader::backendName(
+                     infrastructure::BulkFileReader::backend())
+              << ") : " << bulkTime << "ms" << std::endl;
+
+    REQUIRE(mmapManager.sampleMemoryInBytes == bulkManager.sampleMemoryInBytes);
+}
+
+TEST_CASE("Sample Import Benchmark", "[.][bench]")
+{
+    // Hidden; an SFZ sized import, loading each region's file one at a time and then
+    // again, as a second group referencing the same files would.
+    TempSampleDir td("scxt-test-import-bench", 10000, 64);
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    using clock_t = std::chrono::high_resolution_clock;
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    std::vector<SampleID> ids;
+    auto s0 = clock_t::now();
+    for (const auto &p : td.files)
+        ids.push_back(*sm.loadSampleByPath(p));
+    auto firstTime = ms(clock_t::now() - s0);
+
+    auto s1 = clock_t::now();
+    for (size_t i = 0; i < td.files.size(); ++i)
+        REQUIRE(sm.loadSampleByPath(td.files[i]) == ids[i]);
+    auto repeatTime = ms(clock_t::now() - s1);
+
+    std::cout << "Import of " << td.files.size() << " samples : " << firstTime
+              << "ms; reloading all of them : " << repeatTime << "ms" << std::endl;
+}
@@ -0,0 +1,202 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample.h"
+#include "sample/sample_mipmap.h"
+#include "dsp/generator.h"
+#include "dsp/resampling.h"
+#include <cmath>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+std::shared_ptr<sample::Sample> sineSample(size_t len, float omega, sample::Sample::BitDepth bd)
+{
+    auto s = std::make_shared<sample::Sample>();
+    std::vector<float> f32(len);
+    std::vector<int16_t> i16(len);
+    for (size_t i = 0; i < len; ++i)
+    {
+        f32[i] = 0.8f * std::sin(omega * i);
+        i16[i] = (int16_t)(f32[i] * 32767);
+    }
+    if (bd == sample::Sample::BD_I16)
+    {
+        s->allocateI16(0, len);
+        s->load_data_i16(0, i16.data(), len, sizeof(int16_t));
+    }
+    else
+    {
+        s->allocateF32(0, len);
+        s->load_data_f32(0, f32.data(), len, sizeof(float));
+    }
+    s->sample_length = len;
+    s->channels = 1;
+    s->sample_loaded = true;
+    return s;
+}
+
+float rms(const float *d, size_t from, size_t to)
+{
+    double sum{0};
+    for (auto i = from; i < to; ++i)
+        sum += d[i] * d[i];
+    return (float)std::sqrt(sum / (to - from));
+}
+
+// Play mono float data one shot with sinc at the given ratio
+std::vector<float> render(void *data, int32_t length, int32_t ratio, int blocks,
+                          int32_t samplePos = 0, int32_t sampleSubPos = 0)
+{
+    dsp::GeneratorState GD;
+    GD.ratio = ratio;
+    GD.samplePos = samplePos;
+    GD.sampleSubPos = sampleSubPos;
+    GD.direction = 1;
+    GD.isFinished = false;
+    GD.playbackUpperBound = length - 1;
+    GD.loopUpperBound = GD.playbackUpperBound;
+    GD.interpolationType = dsp::InterpolationTypes::Sinc;
+
+    float outL[scxt::blockSize], outR[scxt::blockSize];
+    dsp::GeneratorIO IO;
+    IO.outputL = outL;
+    IO.outputR = outR;
+    IO.waveSize = length;
+    IO.sampleDataL = data;
+
+    auto gen = dsp::GetFPtrGeneratorSample(false, dsp::SF_F32, false, true, false);
+    std::vector<float> res;
+    for (int b = 0; b < blocks && !GD.isFinished; ++b)
+    {
+        gen(&GD, &IO);
+        res.insert(res.end(), outL, outL + scxt::blockSize);
+    }
+    return res;
+}
+} // namespace
+
+TEST_CASE("Sample Mipmap", "[sample]")
+{
+    SECTION("Level Choice")
+    {
+        auto r = [](double v) { return (int32_t)(v * (1 << 24)); };
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(1.0)) == 0);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(0.25)) == 0);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(1.3)) == 0);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(1.5)) == 1);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(-2.0)) == 1);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(3.0)) == 2);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(5.0)) == 2);
+        REQUIRE(sample::SampleMipmap::levelForRatio(r(100.0)) ==
+                sample::SampleMipmap::maxLevel);
+    }
+
+    SECTION("Layout")
+    {
+        for (auto bd : {sample::Sample::BD_I16, sample::Sample::BD_F32})
+        {
+            auto s = sineSample(10001, 0.01f, bd);
+            auto mm = sample::SampleMipmap::build(*s);
+            REQUIRE(mm);
+            REQUIRE(mm->highestLevel() == sample::SampleMipmap::maxLevel);
+            REQUIRE(mm->format == (bd == sample::Sample::BD_I16 ? dsp::SF_I16 : dsp::SF_F32));
+            uint32_t expected = 10001;
+            size_t bytes{0};
+            for (int l = 1; l <= mm->highestLevel(); ++l)
+            {
+                expected = (expected + 1) / 2;
+                REQUIRE(mm->level(l).length == expected);
+                REQUIRE(mm->level(l).sampleData[1] == nullptr);
+                bytes += (expected + dsp::FIRipol_N) * (bd == sample::Sample::BD_I16 ? 2 : 4);
+            }
+            REQUIRE(mm->sizeInBytes() == bytes);
+
+            // Pads are zero and a low sine comes through, lined up at frame n << level
+            for (int l = 1; l <= mm->highestLevel(); ++l)
+            {
+                const auto &lv = mm->level(l);
+                for (int k = 1; k <= dsp::FIRoffset; ++k)
+                {
+                    if (bd == sample::Sample::BD_I16)
+                    {
+                        auto *d = (int16_t *)lv.sampleData[0];
+                        REQUIRE(d[-k] == 0);
+                        REQUIRE(d[lv.length - 1 + k] == 0);
+                        REQUIRE(d[500] / 32767.f ==
+                                Approx(0.8f * std::sin(0.01f * (500 << l))).margin(2e-3));
+                    }
+                    else
+                    {
+                        auto *d = (float *)lv.sampleData[0];
+                        REQUIRE(d[-k] == 0.f);
+                        REQUIRE(d[lv.length - 1 + k] == 0.f);
+                        REQUIRE(d[500] ==
+                                Approx(0.8f * std::sin(0.01f * (500 << l))).margin(1e-3));
+                    }
+                }
+            }
+        }
+
+        auto tiny = sineSample(20, 0.01f, sample::Sample::BD_F32);
+        REQUIRE(!sample::SampleMipmap::build(*tiny));
+    }
+
+    SECTION("Removes What Would Alias")
+    {
+        // Above the half band, so it has to go rather than fold back down
+        auto s = sineSample(20000, 0.75f * M_PI, sample::Sample::BD_F32);
+        auto mm = sample::SampleMipmap::build(*s, 1);
+        REQUIRE(mm);
+        REQUIRE(mm->highestLevel() == 1);
+        REQUIRE(rms(s->GetSamplePtrF32(0), 100, 19900) > 0.5f);
+        REQUIRE(rms((float *)mm->level(1).sampleData[0], 100, 9900) < 2e-3f);
+    }
+
+    SECTION("Plays Like The Sample")
+    {
+        auto s = sineSample(40000, 0.01f, sample::Sample::BD_F32);
+        auto mm = sample::SampleMipmap::build(*s);
+        REQUIRE(mm);
+
+        int32_t ratio = (int32_t)(3.7 * (1 << 24));
+        auto l = sample::SampleMipmap::levelForRatio(ratio);
+        REQUIRE(l == 2);
+        auto a = render(s->GetSamplePtrF32(0), 40000, ratio, 400);
+        // Starting on as the voice does, since the generator lags a frame of what it reads
+        auto b = render(mm->level(l).sampleData[0], mm->level(l).length, ratio >> l, 400, 0,
+                        ((1 << l) - 1) << (24 - l));
+        REQUIRE(a.size() == b.size());
+        float maxDiff{0};
+        for (size_t i = 0; i < a.size(); ++i)
+            maxDiff = std::max(maxDiff, std::fabs(a[i] - b[i]));
+        REQUIRE(maxDiff < 2e-3f);
+    }
+}
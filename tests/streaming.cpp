@@ -116,6 +116,32 @@ TEST_CASE("Stream modulation::modulators::StepLFOStorage")
     }
 }
 
+TEST_CASE("Stream a SampleID")
+{
+    SECTION("Digest And Address")
+    {
+        SampleID k1, k2;
+        k1.setAsMD5WithAddress("0123456789abcdef00ff10ee20dd30cc", 2, -1, 17);
+        k1.setPathHash(fs::path("/tmp/a.sf2"));
+        REQUIRE(k1 != k2);
+        auto s = testStream(k1);
+        REQUIRE(s.find("0123456789abcdef00ff10ee20dd30cc") != std::string::npos);
+        testUnstream(s, k2);
+        REQUIRE(k1 == k2);
+        REQUIRE(k1.hash() == k2.hash());
+    }
+
+    SECTION("Legacy Text")
+    {
+        SampleID k1, k2;
+        k1.setAsLegacy(42);
+        auto s = testStream(k1);
+        testUnstream(s, k2);
+        REQUIRE(k1 == k2);
+        REQUIRE(k2.getMD5() == "lgcy(42)");
+    }
+}
+
 TEST_CASE("Stream engine::Zone")
 {
     SECTION("Compiles")
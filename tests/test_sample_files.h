@@ -0,0 +1,149 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_TESTS_TEST_SAMPLE_FILES_H
+#define SCXT_TESTS_TEST_SAMPLE_FILES_H
+
+#include "infrastructure/filesystem_import.h"
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace scxt::test
+{
+// Write a 16 or 24 bit PCM wav with a little deterministic content so every file hashes apart
+inline void writeTestWav(const fs::path &p, uint32_t frames, uint16_t channels, int seed,
+                         uint16_t bits = 16)
+{
+    auto put32 = [](std::ofstream &o, uint32_t v) { o.write((const char *)&v, 4); };
+    auto put16 = [](std::ofstream &o, uint16_t v) { o.write((const char *)&v, 2); };
+
+    uint16_t bytesPerSample = bits / 8;
+    uint32_t dataBytes = frames * channels * bytesPerSample;
+    std::ofstream o(p, std::ios::binary);
+    o.write("RIFF", 4);
+    put32(o, 36 + dataBytes);
+    o.write("WAVE", 4);
+    o.write("fmt ", 4);
+    put32(o, 16);
+    put16(o, 1);
+    put16(o, channels);
+    put32(o, 48000);
+    put32(o, 48000 * channels * bytesPerSample);
+    put16(o, channels * bytesPerSample);
+    put16(o, bits);
+    o.write("data", 4);
+    put32(o, dataBytes);
+
+    double amp = (bits == 24 ? 8000000 : 16000);
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            auto v = (int32_t)(amp * std::sin(0.01 * (i + 1) * (seed + c + 1)));
+            o.write((const char *)&v, bytesPerSample); // little endian low bytes
+        }
+    }
+}
+
+// Append a smpl chunk with a root key and a single forward loop (inclusive end, as on disk)
+inline void appendSmplChunk(const fs::path &p, uint32_t rootKey, uint32_t loopStart,
+                            uint32_t loopEnd)
+{
+    {
+        std::ofstream o(p, std::ios::binary | std::ios::app);
+        auto put32 = [&o](uint32_t v) { o.write((const char *)&v, 4); };
+        o.write("smpl", 4);
+        put32(36 + 24);
+        for (auto v : {0u, 0u, 0u, rootKey, 0u, 0u, 0u, 1u, 0u})
+            put32(v);
+        for (auto v : {0u, 0u, loopStart, loopEnd, 0u, 0u})
+            put32(v);
+    }
+    uint32_t riffSize = (uint32_t)fs::file_size(p) - 8;
+    std::fstream f(p, std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(4);
+    f.write((const char *)&riffSize, 4);
+}
+
+// A 16 bit mono 48k AIFF
+inline void writeTestAiff(const fs::path &p, uint32_t frames)
+{
+    auto put32 = [](std::ofstream &o, uint32_t v) {
+        unsigned char b[4]{(unsigned char)(v >> 24), (unsigned char)(v >> 16),
+                           (unsigned char)(v >> 8), (unsigned char)v};
+        o.write((const char *)b, 4);
+    };
+    auto put16 = [](std::ofstream &o, uint16_t v) {
+        unsigned char b[2]{(unsigned char)(v >> 8), (unsigned char)v};
+        o.write((const char *)b, 2);
+    };
+
+    std::ofstream o(p, std::ios::binary);
+    o.write("FORM", 4);
+    put32(o, 4 + 26 + 16 + frames * 2);
+    o.write("AIFF", 4);
+    o.write("COMM", 4);
+    put32(o, 18);
+    put16(o, 1);
+    put32(o, frames);
+    put16(o, 16);
+    const unsigned char rate48k[10]{0x40, 0x0E, 0xBB, 0x80, 0, 0, 0, 0, 0, 0};
+    o.write((const char *)rate48k, 10);
+    o.write("SSND", 4);
+    put32(o, 8 + frames * 2);
+    put32(o, 0);
+    put32(o, 0);
+    for (uint32_t i = 0; i < frames; ++i)
+        put16(o, (uint16_t)(int16_t)(16000 * std::sin(0.01 * i)));
+}
+
+// A directory of small wavs, alternating mono and stereo, removed when we go
+struct TempSampleDir
+{
+    fs::path dir;
+    std::vector<fs::path> files;
+    TempSampleDir(const std::string &name, int count, uint32_t frames)
+    {
+        dir = fs::temp_directory_path() / name;
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        for (int i = 0; i < count; ++i)
+        {
+            auto p = dir / ("sample_" + std::to_string(i) + ".wav");
+            writeTestWav(p, frames, 1 + (i % 2), i);
+            files.push_back(p);
+        }
+    }
+    ~TempSampleDir() { fs::remove_all(dir); }
+};
+} // namespace scxt::test
+
+#endif // SCXT_TESTS_TEST_SAMPLE_FILES_H
@@ -0,0 +1,201 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+
+#include "catch2/catch2.hpp"
+#include "sample/sample.h"
+#include "sample/waveform_pyramid.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+std::vector<float> noisyWave(size_t len, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+    std::vector<float> res(len);
+    for (size_t i = 0; i < len; ++i)
+        res[i] = 0.8f * std::sin(i * 0.0013f) * std::sin(i * 0.17f) + noise(gen);
+    return res;
+}
+
+std::shared_ptr<sample::Sample> makeSample(const std::vector<float> &d, int channels,
+                                           sample::Sample::BitDepth bd)
+{
+    auto s = std::make_shared<sample::Sample>();
+    for (int c = 0; c < channels; ++c)
+    {
+        if (bd == sample::Sample::BD_I16)
+        {
+            std::vector<int16_t> i16(d.size());
+            for (size_t i = 0; i < d.size(); ++i)
+                i16[i] = (int16_t)(d[i] * (c ? -32767 : 32767));
+            s->allocateI16(c, d.size());
+            s->load_data_i16(c, i16.data(), d.size(), sizeof(int16_t));
+        }
+        else if (bd == sample::Sample::BD_I24)
+        {
+            std::vector<uint8_t> i24(d.size() * 3);
+            for (size_t i = 0; i < d.size(); ++i)
+            {
+                auto v = (int32_t)(d[i] * (c ? -8388607 : 8388607));
+                i24[i * 3] = v & 0xFF;
+                i24[i * 3 + 1] = (v >> 8) & 0xFF;
+                i24[i * 3 + 2] = (v >> 16) & 0xFF;
+            }
+            s->allocateI24(c, d.size());
+            s->load_data_i24(c, i24.data(), d.size(), 3);
+        }
+        else
+        {
+            std::vector<float> f32(d.size());
+            for (size_t i = 0; i < d.size(); ++i)
+                f32[i] = c ? -d[i] : d[i];
+            s->allocateF32(c, d.size());
+            s->load_data_f32(c, f32.data(), d.size(), sizeof(float));
+        }
+    }
+    s->sample_length = d.size();
+    s->channels = channels;
+    s->sample_loaded = true;
+    return s;
+}
+
+float valueAt(sample::Sample &s, int ch, size_t i)
+{
+    switch (s.bitDepth)
+    {
+    case sample::Sample::BD_I16:
+        return s.GetSamplePtrI16(ch)[i] * (1.f / 32767.f);
+    case sample::Sample::BD_I24:
+        return s.GetSamplePtrI24(ch)[i].toInt32() * (1.f / 8388607.f);
+    default:
+        return s.GetSamplePtrF32(ch)[i];
+    }
+}
+} // namespace
+
+TEST_CASE("Waveform Pyramid", "[sample]")
+{
+    for (auto bd : {sample::Sample::BD_I16, sample::Sample::BD_I24, sample::Sample::BD_F32})
+    {
+        for (auto len : {1UL, 63UL, 64UL, 65UL, 1000UL, 4096UL, 100003UL})
+        {
+            DYNAMIC_SECTION("Format " << sample::Sample::bitDepthName(bd) << " length " << len)
+            {
+                auto s = makeSample(noisyWave(len, len), 2, bd);
+                auto pyr = s->getWaveformPyramid();
+                REQUIRE(pyr);
+                REQUIRE(pyr->channels == 2);
+                REQUIRE(s->getWaveformPyramid() == pyr);
+
+                std::mt19937 gen(17);
+                std::uniform_int_distribution<size_t> pos(0, len);
+                for (int t = 0; t < 200; ++t)
+                {
+                    auto a = pos(gen), b = pos(gen);
+                    if (t == 0)
+                    {
+                        a = 0;
+                        b = len;
+                    }
+                    if (a > b)
+                        std::swap(a, b);
+                    if (a == b)
+                        continue;
+
+                    for (int ch = 0; ch < 2; ++ch)
+                    {
+                        auto mm = pyr->minMaxBetween(*s, ch, a, b);
+                        float mn = valueAt(*s, ch, a), mx = mn;
+                        for (auto i = a; i < b; ++i)
+                        {
+                            mn = std::min(mn, valueAt(*s, ch, i));
+                            mx = std::max(mx, valueAt(*s, ch, i));
+                        }
+                        REQUIRE(mm.min == mn);
+                        REQUIRE(mm.max == mx);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Reallocation drops the pyramid")
+    {
+        auto s = makeSample(noisyWave(5000, 3), 1, sample::Sample::BD_F32);
+        auto pyr = s->getWaveformPyramid();
+        std::vector<float> flat(5000, 0.25f);
+        s->allocateF32(0, flat.size());
+        s->load_data_f32(0, flat.data(), flat.size(), sizeof(float));
+        auto np = s->getWaveformPyramid();
+        REQUIRE(np != pyr);
+        auto mm = np->minMaxBetween(*s, 0, 0, 5000);
+        REQUIRE(mm.min == 0.25f);
+        REQUIRE(mm.max == 0.25f);
+    }
+}
+
+TEST_CASE("Waveform Pyramid Benchmark", "[.][bench]")
+{
+    // Ten minutes of stereo 48k drawn across 1000 pixels, by scanning (what the waveform
+    // display used to do on every rebuild) and from the pyramid
+    auto len = 48000UL * 600;
+    auto s = makeSample(noisyWave(len, 1), 2, sample::Sample::BD_I16);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    auto pyr = s->getWaveformPyramid();
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    float scanSum{0}, pyrSum{0};
+    auto fac = len / 1000;
+    for (int ch = 0; ch < 2; ++ch)
+        for (size_t p = 0; p < len; p += fac)
+        {
+            float mx{-2.f};
+            for (auto i = p; i < std::min(p + fac, len); ++i)
+                mx = std::max(mx, valueAt(*s, ch, i));
+            scanSum += mx;
+        }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (int ch = 0; ch < 2; ++ch)
+        for (size_t p = 0; p < len; p += fac)
+            pyrSum += pyr->minMaxBetween(*s, ch, p, p + fac).max;
+    auto t3 = std::chrono::high_resolution_clock::now();
+    REQUIRE(scanSum == pyrSum);
+
+    auto ms = [](auto a, auto b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    INFO("build " << ms(t0, t1) << "ms, scan " << ms(t1, t2) << "ms, pyramid " << ms(t2, t3)
+                  << "ms");
+    WARN("waveform pyramid benchmark done");
+}